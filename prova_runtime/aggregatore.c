@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aggregazione.h"
+#include "registro.h"
+
+/* Aggregatore della rete:
+ *   aggregatore [-p [host:]porta] [-u host:porta -i nodo] [-s max_stazioni] [-d durata] [-r periodo]
+ * Riceve i delta dei nodi (replay -a, o altri aggregatori) e li fonde nella
+ * vista globale. Registra i nodi nuovi e i loro cambi di stato, i trigger e
+ * gli allarmi, e ogni periodo s (default 1) una riga di riepilogo. Con -u
+ * rimanda la vista a un aggregatore superiore come nodo nodo; le stazioni
+ * dei nodi in ritardo partono segnate come non aggiornate. Si ferma dopo
+ * durata s (default 0: mai) o con SIGINT/SIGTERM, poi stampa i totali per
+ * nodo e la latenza dal cambiamento sul nodo alla fusione. */
+
+#define MAX_STAZIONI  65536
+#define ATTESA_MS     10       /* ms massimi tra due controlli dei nodi */
+
+typedef struct {
+    VistaAggregata vista;
+    EmettitoreAggregazione superiore;
+    int inoltra;
+    double inizio;             /* s */
+} Aggregatore;
+
+static volatile sig_atomic_t termina = 0;
+
+static void su_segnale(int segnale) {
+    (void)segnale;
+    termina = 1;
+}
+
+static void inoltra(Aggregatore *a, int slot) {
+    const StazioneAggregata *s = &a->vista.stazioni[slot];
+    VoceAggregazione voce = s->voce;
+    if (non_aggiornata_vista(&a->vista, slot)) {
+        voce.stato |= VOCE_NON_AGGIORNATA;
+    }
+    aggiorna_emettitore(&a->superiore, slot, &voce, s->t_arrivo);
+}
+
+static void su_stazione(void *contesto, const VistaAggregata *v, int slot, const VoceAggregazione *precedente) {
+    Aggregatore *a = contesto;
+    const StazioneAggregata *s = &v->stazioni[slot];
+    unsigned int nodo = v->nodi[s->nodo].nodo;
+    if (s->voce.fase != precedente->fase || s->voce.t_trigger != precedente->t_trigger) {
+        if (s->voce.fase == STATO_ALLARME) {
+            REGISTRA(REGISTRO_AVVISO, "%10.3f s  allarme   stazione %u nodo %u (PGD %.4f cm)\n",
+                     REGISTRO_REALE(s->t_arrivo - a->inizio), REGISTRO_INTERO(s->voce.stazione),
+                     REGISTRO_INTERO(nodo), REGISTRO_REALE(s->voce.pgd_allarme * 100.0));
+        } else if (s->voce.fase == STATO_TRIGGERED) {
+            REGISTRA(REGISTRO_INFO, "%10.3f s  trigger   stazione %u nodo %u\n",
+                     REGISTRO_REALE(s->t_arrivo - a->inizio), REGISTRO_INTERO(s->voce.stazione),
+                     REGISTRO_INTERO(nodo));
+        }
+    }
+    if (a->inoltra) {
+        inoltra(a, slot);
+    }
+}
+
+static void su_nodo(void *contesto, const VistaAggregata *v, int k, StatoNodo precedente) {
+    Aggregatore *a = contesto;
+    const NodoAggregato *nd = &v->nodi[k];
+    double t = istante_aggregazione() - a->inizio;
+    if (nd->stato == precedente) {
+        REGISTRA(REGISTRO_INFO, "%10.3f s  nodo %u nuovo\n", REGISTRO_REALE(t), REGISTRO_INTERO(nd->nodo));
+        return;
+    }
+    REGISTRA(nd->stato == NODO_ATTIVO || nd->stato == NODO_CHIUSO ? REGISTRO_INFO : REGISTRO_AVVISO,
+             "%10.3f s  nodo %u %s (era %s)\n", REGISTRO_REALE(t), REGISTRO_INTERO(nd->nodo),
+             REGISTRO_TESTO(nome_stato_nodo(nd->stato)), REGISTRO_TESTO(nome_stato_nodo(precedente)));
+    /* Il livello superiore deve sapere che le stazioni del nodo sono ferme (o di nuovo aggiornate) */
+    if (a->inoltra) {
+        for (int i = 0; i < v->capacita; i++) {
+            if (v->stazioni[i].nodo == k) {
+                inoltra(a, i);
+            }
+        }
+    }
+}
+
+static void stampa_riepilogo(const Aggregatore *a, double t) {
+    RiepilogoVista r;
+    riepilogo_vista(&a->vista, &r);
+    svuota_registro();
+    printf("%10.3f s  nodi %d attivi, %d in ritardo, %d persi, %d chiusi; stazioni %d, "
+           "scattate %d (+%d non aggiornate), allarmi %d (+%d), PGD max %.4f cm\n",
+           t - a->inizio, r.nodi_attivi, r.nodi_in_ritardo, r.nodi_persi, r.nodi_chiusi, r.stazioni,
+           r.scattate, r.scattate_non_aggiornate, r.allarmi, r.allarmi_non_aggiornati, r.pgd_max * 100.0);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    const char *ascolto = AGGREGAZIONE_PORTA, *superiore = NULL;
+    long nodo = -1;
+    int max_stazioni = MAX_STAZIONI;
+    double durata = 0.0, periodo = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            ascolto = argv[++i];
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            superiore = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            nodo = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            max_stazioni = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            durata = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            periodo = atof(argv[++i]);
+        } else {
+            max_stazioni = 0;
+            break;
+        }
+    }
+    if (max_stazioni < 1 || durata < 0.0 || periodo <= 0.0 || (superiore && nodo < 0)) {
+        fprintf(stderr, "Uso: %s [-p [host:]porta] [-u host:porta -i nodo] [-s max_stazioni] [-d durata] "
+                        "[-r periodo]\n", argv[0]);
+        return 1;
+    }
+
+    static Aggregatore a;
+    RicevitoreAggregazione ricevitore;
+    if (init_vista(&a.vista, max_stazioni) != 0) {
+        fprintf(stderr, "Errore: memoria insufficiente\n");
+        return 1;
+    }
+    if (apri_ricevitore(&ricevitore, ascolto) != 0) {
+        fprintf(stderr, "Errore: impossibile ascoltare su %s\n", ascolto);
+        return 1;
+    }
+    /* L'indice dell'emettitore è lo slot della vista, stabile */
+    if (superiore && apri_emettitore(&a.superiore, superiore, (unsigned int)nodo, a.vista.capacita) != 0) {
+        fprintf(stderr, "Errore: aggregatore superiore %s non valido\n", superiore);
+        return 1;
+    }
+    a.inoltra = (superiore != NULL);
+    CallbackAggregazione callback = { su_stazione, su_nodo, &a };
+    imposta_callback_vista(&a.vista, &callback);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = su_segnale;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Aggregatore sulla porta %d, fino a %d stazioni, buffer di ricezione %d KiB", porta_ricevitore(&ricevitore),
+           max_stazioni, buffer_ricevitore(&ricevitore) / 1024);
+    if (superiore) printf(", inoltro a %s come nodo %ld", superiore, nodo);
+    printf("\n\n");
+    fflush(stdout);
+    if (avvia_registro(stdout, 0) != 0) {
+        fprintf(stderr, "Errore: avvio del registro fallito\n");
+        return 1;
+    }
+
+    a.inizio = istante_aggregazione();
+    double prossimo_riepilogo = a.inizio + periodo;
+    int errore = 0;
+    while (!termina) {
+        if (ricevi_aggregazione(&ricevitore, &a.vista, ATTESA_MS) < 0) {
+            errore = 1;
+            break;
+        }
+        double t = istante_aggregazione();
+        controlla_nodi(&a.vista, t);
+        if (a.inoltra) {
+            a.superiore.stazioni_nodo = (unsigned int)a.vista.n_stazioni;
+            invia_emettitore(&a.superiore, t, 0);
+        }
+        if (t >= prossimo_riepilogo) {
+            stampa_riepilogo(&a, t);
+            prossimo_riepilogo += periodo;
+        }
+        if (durata > 0.0 && t - a.inizio >= durata) {
+            break;
+        }
+    }
+    ferma_registro();
+    if (errore) {
+        fprintf(stderr, "Errore: ricezione fallita\n");
+    }
+    stampa_riepilogo(&a, istante_aggregazione());
+
+    const VistaAggregata *v = &a.vista;
+    printf("\nNodo        stato        stazioni  pacchetti      persi  fuori ordine\n");
+    for (int k = 0; k < v->n_nodi; k++) {
+        const NodoAggregato *nd = &v->nodi[k];
+        printf("%-10u  %-11s  %8d  %9lld  %9lld  %12lld\n", nd->nodo, nome_stato_nodo(nd->stato),
+               nd->n_stazioni, nd->pacchetti, nd->persi, nd->fuori_ordine);
+    }
+    printf("Ricevuti %lld pacchetti in %lld lotti (%.1f per lotto), %lld voci applicate, "
+           "%lld malformati, %lld voci scartate\n", ricevitore.datagrammi, ricevitore.lotti,
+           ricevitore.lotti > 0 ? (double)ricevitore.datagrammi / ricevitore.lotti : 0.0,
+           v->voci, v->malformati, v->scartate);
+    if (v->latenza.n > 0) {
+        stampa_latenza(&v->latenza, "Latenza cambiamento-fusione");
+    }
+    if (a.inoltra) {
+        chiudi_emettitore(&a.superiore);
+        printf("Inoltro: %lld pacchetti, %lld voci, %lld errori di invio\n",
+               a.superiore.pacchetti, a.superiore.voci, a.superiore.errori);
+    }
+
+    chiudi_ricevitore(&ricevitore);
+    free_vista(&a.vista);
+    return errore;
+}
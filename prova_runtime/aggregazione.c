@@ -0,0 +1,551 @@
+#define _GNU_SOURCE   /* recvmmsg */
+
+#include "aggregazione.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BUFFER_RICEZIONE   (8 * 1024 * 1024)   /* byte richiesti, il sistema li limita a rmem_max */
+#define MAX_LOTTI          64                  /* per chiamata di ricevi_aggregazione */
+
+typedef struct {
+    struct mmsghdr msg[AGGREGAZIONE_LOTTO];
+    struct iovec iov[AGGREGAZIONE_LOTTO];
+} MessaggiRicevitore;
+
+double istante_aggregazione(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void voce_aggregazione(VoceAggregazione *v, const StatoDOSEWS *sys, unsigned int stazione, double t0,
+                       const VoceAggregazione *precedente) {
+    memset(v, 0, sizeof(*v));
+    v->stazione = stazione;
+    v->fase = (unsigned char)sys->fase;
+    v->stato = (sys->evento_confermato ? VOCE_CONFERMATA : 0u) | (sys->allarme_anticipato ? VOCE_ANTICIPATA : 0u);
+    if (sys->fase == STATO_ATTESA_TRIGGER) {
+        return;
+    }
+    double fs = sys->config.frequenza;
+    v->t_trigger = t0 + sys->indice_trigger / fs;
+    v->pgd_max = (float)sys->pgd_max;
+    if (sys->fase == STATO_ALLARME) {
+        v->ritardo_allarme = (float)((sys->indice_allarme - sys->indice_trigger) / fs);
+        v->pgd_allarme = (float)sys->pgd_allarme;
+        if (precedente && precedente->fase == STATO_ALLARME && precedente->pgd_allarme == v->pgd_allarme) {
+            v->prob = precedente->prob;
+        } else {
+            RisultatiDOSEWS r;
+            calcola_risultati(sys, &r);
+            v->prob = (float)r.prob_calcolata;
+        }
+    }
+}
+
+/* "host:porta" o solo "porta" (host_default, NULL = tutti gli indirizzi) */
+static int risolvi(const char *indirizzo, const char *host_default, int passivo,
+                   struct sockaddr_storage *ss, socklen_t *dim) {
+    char host[256];
+    const char *porta = strrchr(indirizzo, ':');
+    const char *nome = host_default;
+    if (porta) {
+        size_t n = (size_t)(porta - indirizzo);
+        if (n >= sizeof(host)) return -1;
+        memcpy(host, indirizzo, n);
+        host[n] = '\0';
+        nome = (n > 0) ? host : host_default;
+        porta++;
+    } else {
+        porta = indirizzo;
+    }
+    struct addrinfo indizi = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM,
+                               .ai_flags = passivo ? AI_PASSIVE : 0 };
+    struct addrinfo *ris;
+    if (getaddrinfo(nome, porta, &indizi, &ris) != 0) {
+        return -1;
+    }
+    memcpy(ss, ris->ai_addr, ris->ai_addrlen);
+    *dim = ris->ai_addrlen;
+    freeaddrinfo(ris);
+    return 0;
+}
+
+static int non_bloccante(int s) {
+    int flags = fcntl(s, F_GETFL, 0);
+    return (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0) ? -1 : 0;
+}
+
+/* ---- Nodo ---- */
+
+int apri_emettitore(EmettitoreAggregazione *e, const char *destinazione, unsigned int nodo, int n_stazioni) {
+    memset(e, 0, sizeof(*e));
+    e->socket = -1;
+    if (n_stazioni < 1 || risolvi(destinazione, "127.0.0.1", 0, &e->destinazione, &e->dim_destinazione) != 0) {
+        return -1;
+    }
+    e->correnti = calloc((size_t)n_stazioni, sizeof(VoceAggregazione));
+    e->inviate = calloc((size_t)n_stazioni, sizeof(VoceAggregazione));
+    e->sporche = malloc((size_t)n_stazioni * sizeof(int));
+    e->segnate = calloc((size_t)n_stazioni, 1);
+    e->socket = socket(e->destinazione.ss_family, SOCK_DGRAM, 0);
+    if (!e->correnti || !e->inviate || !e->sporche || !e->segnate || e->socket < 0 || non_bloccante(e->socket) != 0) {
+        if (e->socket >= 0) close(e->socket);
+        free(e->correnti);
+        free(e->inviate);
+        free(e->sporche);
+        free(e->segnate);
+        e->socket = -1;
+        return -1;
+    }
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    e->avvio = (unsigned int)(t.tv_nsec ^ (t.tv_sec << 20) ^ ((long)getpid() << 8));
+    e->nodo = nodo;
+    e->n_stazioni = n_stazioni;
+    e->stazioni_nodo = (unsigned int)n_stazioni;
+    e->periodo = AGGREGAZIONE_PERIODO;
+    /* Il primo invio è un battito: l'aggregatore conosce il nodo subito */
+    e->ultimo_invio = e->ultimo_rinfresco = 0.0;
+    return 0;
+}
+
+static void segna(EmettitoreAggregazione *e, int indice, double t) {
+    if (e->segnate[indice]) {
+        return;
+    }
+    if (e->n_sporche == 0) {
+        e->t_cambiamento = t;
+    }
+    e->segnate[indice] = 1;
+    e->sporche[e->n_sporche++] = indice;
+}
+
+void aggiorna_emettitore(EmettitoreAggregazione *e, int indice, const VoceAggregazione *v, double t) {
+    e->correnti[indice] = *v;
+    if (e->segnate[indice]) {
+        return;
+    }
+    const VoceAggregazione *u = &e->inviate[indice];
+    if (v->stazione == u->stazione && v->fase == u->fase && v->stato == u->stato && v->t_trigger == u->t_trigger
+        && v->ritardo_allarme == u->ritardo_allarme && v->pgd_allarme == u->pgd_allarme
+        && fabsf(v->pgd_max - u->pgd_max) <= (float)AGGREGAZIONE_DELTA_PGD * u->pgd_max) {
+        return;
+    }
+    segna(e, indice, t);
+}
+
+/* Un datagramma con le ultime n voci segnate; ritorna 0 o -1 (restano segnate) */
+static int manda(EmettitoreAggregazione *e, int n, double t, unsigned int flags) {
+    unsigned char dati[AGGREGAZIONE_MAX_DATAGRAMMA];
+    IntestazioneAggregazione h = {
+        .magic = AGGREGAZIONE_MAGIC, .versione = AGGREGAZIONE_VERSIONE, .n_voci = (unsigned short)n,
+        .nodo = e->nodo, .sequenza = e->sequenza + 1, .avvio = e->avvio,
+        .n_stazioni = e->stazioni_nodo, .flags = flags,
+        .t_invio = t, .t_cambiamento = (n > 0) ? e->t_cambiamento : t,
+    };
+    const int *indici = &e->sporche[e->n_sporche - n];
+    memcpy(dati, &h, sizeof(h));
+    for (int k = 0; k < n; k++) {
+        memcpy(dati + sizeof(h) + (size_t)k * sizeof(VoceAggregazione), &e->correnti[indici[k]],
+               sizeof(VoceAggregazione));
+    }
+    size_t dim = sizeof(h) + (size_t)n * sizeof(VoceAggregazione);
+    if (sendto(e->socket, dati, dim, 0, (const struct sockaddr *)&e->destinazione, e->dim_destinazione)
+        != (ssize_t)dim) {
+        e->errori++;
+        return -1;
+    }
+    for (int k = 0; k < n; k++) {
+        e->inviate[indici[k]] = e->correnti[indici[k]];
+        e->segnate[indici[k]] = 0;
+    }
+    e->n_sporche -= n;
+    e->sequenza++;
+    e->pacchetti++;
+    e->voci += n;
+    return 0;
+}
+
+int invia_emettitore(EmettitoreAggregazione *e, double t, int forza) {
+    if (!forza && t - e->ultimo_invio < e->periodo) {
+        return 0;
+    }
+    /* Rinfresco: le stazioni non a riposo ripartono a ogni battito, così
+     * una voce persa non resta persa */
+    if (t - e->ultimo_rinfresco >= AGGREGAZIONE_BATTITO) {
+        e->ultimo_rinfresco = t;
+        for (int i = 0; i < e->n_stazioni; i++) {
+            if (e->correnti[i].fase != STATO_ATTESA_TRIGGER || e->correnti[i].stato != 0) {
+                segna(e, i, t);
+            }
+        }
+    }
+    if (e->n_sporche == 0 && t - e->ultimo_invio < AGGREGAZIONE_BATTITO) {
+        return 0;
+    }
+    int pacchetti = 0;
+    do {
+        int n = (e->n_sporche < AGGREGAZIONE_VOCI_PACCHETTO) ? e->n_sporche : AGGREGAZIONE_VOCI_PACCHETTO;
+        if (manda(e, n, t, 0) != 0) {
+            break;
+        }
+        pacchetti++;
+    } while (e->n_sporche > 0);
+    if (pacchetti > 0) {
+        e->ultimo_invio = t;
+    }
+    return pacchetti;
+}
+
+void chiudi_emettitore(EmettitoreAggregazione *e) {
+    if (e->socket < 0) {
+        return;
+    }
+    double t = istante_aggregazione();
+    while (e->n_sporche > AGGREGAZIONE_VOCI_PACCHETTO && manda(e, AGGREGAZIONE_VOCI_PACCHETTO, t, 0) == 0) {
+    }
+    if (e->n_sporche <= AGGREGAZIONE_VOCI_PACCHETTO) {
+        manda(e, e->n_sporche, t, AGGREGAZIONE_FINE);
+    }
+    close(e->socket);
+    e->socket = -1;
+    free(e->correnti);
+    free(e->inviate);
+    free(e->sporche);
+    free(e->segnate);
+}
+
+/* ---- Aggregatore ---- */
+
+int init_vista(VistaAggregata *v, int max_stazioni) {
+    memset(v, 0, sizeof(*v));
+    if (max_stazioni < 1) {
+        return -1;
+    }
+    /* Riempimento al più a metà: sondaggi lineari brevi */
+    int capacita = 16;
+    while (capacita < 2 * max_stazioni) {
+        capacita *= 2;
+    }
+    v->stazioni = calloc((size_t)capacita, sizeof(StazioneAggregata));
+    if (!v->stazioni) {
+        return -1;
+    }
+    for (int i = 0; i < capacita; i++) {
+        v->stazioni[i].nodo = -1;
+    }
+    v->capacita = capacita;
+    azzera_latenza(&v->latenza);
+    return 0;
+}
+
+void free_vista(VistaAggregata *v) {
+    free(v->stazioni);
+    v->stazioni = NULL;
+}
+
+void imposta_callback_vista(VistaAggregata *v, const CallbackAggregazione *callback) {
+    v->callback = *callback;
+}
+
+static unsigned int mescola(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    return x ^ (x >> 16);
+}
+
+/* Slot della stazione o, se manca, slot libero in cui inserirla; -1 a tabella piena */
+static int slot_stazione(const VistaAggregata *v, unsigned int stazione, int *nuova) {
+    unsigned int maschera = (unsigned int)v->capacita - 1u;
+    for (unsigned int i = mescola(stazione) & maschera;; i = (i + 1u) & maschera) {
+        const StazioneAggregata *s = &v->stazioni[i];
+        if (s->nodo < 0) {
+            *nuova = 1;
+            return (v->n_stazioni < v->capacita / 2) ? (int)i : -1;
+        }
+        if (s->voce.stazione == stazione) {
+            *nuova = 0;
+            return (int)i;
+        }
+    }
+}
+
+static void cambia_stato_nodo(VistaAggregata *v, int k, StatoNodo stato) {
+    StatoNodo precedente = v->nodi[k].stato;
+    if (precedente == stato) {
+        return;
+    }
+    v->nodi[k].stato = stato;
+    if (v->callback.nodo) {
+        v->callback.nodo(v->callback.contesto, v, k, precedente);
+    }
+}
+
+static int trova_nodo(VistaAggregata *v, const IntestazioneAggregazione *h) {
+    for (int k = 0; k < v->n_nodi; k++) {
+        if (v->nodi[k].nodo == h->nodo) {
+            return k;
+        }
+    }
+    if (v->n_nodi == AGGREGAZIONE_MAX_NODI) {
+        return -1;
+    }
+    int k = v->n_nodi++;
+    NodoAggregato *nd = &v->nodi[k];
+    memset(nd, 0, sizeof(*nd));
+    nd->nodo = h->nodo;
+    nd->avvio = h->avvio;
+    nd->sequenza = h->sequenza - 1u;
+    nd->stato = NODO_ATTIVO;
+    if (v->callback.nodo) {
+        v->callback.nodo(v->callback.contesto, v, k, NODO_ATTIVO);
+    }
+    return k;
+}
+
+int applica_pacchetto(VistaAggregata *v, const void *dati, size_t n, double t) {
+    IntestazioneAggregazione h;
+    if (n < sizeof(h)) {
+        v->malformati++;
+        return -1;
+    }
+    memcpy(&h, dati, sizeof(h));
+    if (h.magic != AGGREGAZIONE_MAGIC || h.versione != AGGREGAZIONE_VERSIONE
+        || n != sizeof(h) + (size_t)h.n_voci * sizeof(VoceAggregazione)) {
+        v->malformati++;
+        return -1;
+    }
+    int k = trova_nodo(v, &h);
+    if (k < 0) {
+        v->scartate += h.n_voci;
+        return 0;
+    }
+    NodoAggregato *nd = &v->nodi[k];
+    if (nd->avvio != h.avvio) {
+        /* Nodo riavviato: la numerazione riparte */
+        nd->avvio = h.avvio;
+        nd->sequenza = h.sequenza - 1u;
+    }
+    int salto = (int)(h.sequenza - nd->sequenza);
+    if (salto > 0) {
+        nd->persi += salto - 1;
+        nd->sequenza = h.sequenza;
+    } else {
+        nd->fuori_ordine++;
+    }
+    nd->pacchetti++;
+    nd->ultimo_arrivo = t;
+    nd->n_stazioni = (int)h.n_stazioni;
+    nd->latenza = t - h.t_cambiamento;
+    v->pacchetti++;
+    if (h.n_voci > 0) {
+        registra_latenza(&v->latenza, nd->latenza > 0.0 ? nd->latenza : 0.0);
+    }
+    cambia_stato_nodo(v, k, (h.flags & AGGREGAZIONE_FINE) ? NODO_CHIUSO
+                            : (nd->latenza > AGGREGAZIONE_MAX_LATENZA) ? NODO_IN_RITARDO : NODO_ATTIVO);
+
+    const unsigned char *p = (const unsigned char *)dati + sizeof(h);
+    int applicate = 0;
+    for (int i = 0; i < h.n_voci; i++) {
+        VoceAggregazione voce;
+        memcpy(&voce, p + (size_t)i * sizeof(voce), sizeof(voce));
+        int nuova;
+        int slot = slot_stazione(v, voce.stazione, &nuova);
+        if (slot < 0) {
+            v->scartate++;
+            continue;
+        }
+        StazioneAggregata *s = &v->stazioni[slot];
+        VoceAggregazione precedente = s->voce;
+        if (nuova) {
+            memset(&precedente, 0, sizeof(precedente));
+            v->n_stazioni++;
+        } else if (s->nodo == k && s->avvio == h.avvio && (int)(h.sequenza - s->sequenza) < 0) {
+            continue;   /* pacchetto più vecchio dell'ultimo applicato */
+        }
+        /* Da un altro avvio del nodo la sequenza non si confronta: riparte
+         * da capo e la voce vale comunque più di quella del vecchio avvio */
+        s->voce = voce;
+        s->nodo = k;
+        s->sequenza = h.sequenza;
+        s->avvio = h.avvio;
+        s->t_arrivo = t;
+        applicate++;
+        if (v->callback.stazione) {
+            v->callback.stazione(v->callback.contesto, v, slot, &precedente);
+        }
+    }
+    v->voci += applicate;
+    return applicate;
+}
+
+int controlla_nodi(VistaAggregata *v, double t) {
+    int transizioni = 0;
+    for (int k = 0; k < v->n_nodi; k++) {
+        const NodoAggregato *nd = &v->nodi[k];
+        if (nd->stato == NODO_CHIUSO) {
+            continue;
+        }
+        double silenzio = t - nd->ultimo_arrivo;
+        StatoNodo stato = (silenzio > AGGREGAZIONE_PERSO) ? NODO_PERSO
+                        : (silenzio > AGGREGAZIONE_SILENZIO || nd->latenza > AGGREGAZIONE_MAX_LATENZA) ? NODO_IN_RITARDO
+                        : NODO_ATTIVO;
+        if (stato != nd->stato) {
+            cambia_stato_nodo(v, k, stato);
+            transizioni++;
+        }
+    }
+    return transizioni;
+}
+
+int non_aggiornata_vista(const VistaAggregata *v, int slot) {
+    const StazioneAggregata *s = &v->stazioni[slot];
+    StatoNodo stato = v->nodi[s->nodo].stato;
+    return (stato != NODO_ATTIVO && stato != NODO_CHIUSO) || (s->voce.stato & VOCE_NON_AGGIORNATA);
+}
+
+void riepilogo_vista(const VistaAggregata *v, RiepilogoVista *r) {
+    memset(r, 0, sizeof(*r));
+    for (int k = 0; k < v->n_nodi; k++) {
+        switch (v->nodi[k].stato) {
+        case NODO_ATTIVO:     r->nodi_attivi++; break;
+        case NODO_IN_RITARDO: r->nodi_in_ritardo++; break;
+        case NODO_PERSO:      r->nodi_persi++; break;
+        case NODO_CHIUSO:     r->nodi_chiusi++; break;
+        }
+    }
+    for (int i = 0; i < v->capacita; i++) {
+        const StazioneAggregata *s = &v->stazioni[i];
+        if (s->nodo < 0) {
+            continue;
+        }
+        r->stazioni++;
+        if (s->voce.fase == STATO_ATTESA_TRIGGER) {
+            continue;
+        }
+        int vecchia = non_aggiornata_vista(v, i);
+        int allarme = (s->voce.fase == STATO_ALLARME);
+        r->scattate += !vecchia;
+        r->allarmi += !vecchia && allarme;
+        r->scattate_non_aggiornate += vecchia;
+        r->allarmi_non_aggiornati += vecchia && allarme;
+        r->pgd_max = fmax(r->pgd_max, s->voce.pgd_max);
+        if (r->primo_trigger == 0.0 || s->voce.t_trigger < r->primo_trigger) {
+            r->primo_trigger = s->voce.t_trigger;
+        }
+    }
+}
+
+const char *nome_stato_nodo(StatoNodo s) {
+    switch (s) {
+    case NODO_ATTIVO:     return "attivo";
+    case NODO_IN_RITARDO: return "in ritardo";
+    case NODO_PERSO:      return "perso";
+    case NODO_CHIUSO:     return "chiuso";
+    }
+    return "?";
+}
+
+int apri_ricevitore(RicevitoreAggregazione *r, const char *indirizzo) {
+    memset(r, 0, sizeof(*r));
+    struct sockaddr_storage ss;
+    socklen_t dim;
+    if (risolvi(indirizzo, NULL, 1, &ss, &dim) != 0) {
+        r->socket = -1;
+        return -1;
+    }
+    r->socket = socket(ss.ss_family, SOCK_DGRAM, 0);
+    if (r->socket < 0) {
+        return -1;
+    }
+    int buffer = BUFFER_RICEZIONE;
+    setsockopt(r->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    r->dati = malloc((size_t)AGGREGAZIONE_LOTTO * AGGREGAZIONE_MAX_DATAGRAMMA);
+    MessaggiRicevitore *m = calloc(1, sizeof(MessaggiRicevitore));
+    if (!r->dati || !m || bind(r->socket, (const struct sockaddr *)&ss, dim) != 0) {
+        free(r->dati);
+        free(m);
+        close(r->socket);
+        r->socket = -1;
+        return -1;
+    }
+    for (int i = 0; i < AGGREGAZIONE_LOTTO; i++) {
+        m->iov[i].iov_base = r->dati + (size_t)i * AGGREGAZIONE_MAX_DATAGRAMMA;
+        m->iov[i].iov_len = AGGREGAZIONE_MAX_DATAGRAMMA;
+        m->msg[i].msg_hdr.msg_iov = &m->iov[i];
+        m->msg[i].msg_hdr.msg_iovlen = 1;
+    }
+    r->messaggi = m;
+    return 0;
+}
+
+void chiudi_ricevitore(RicevitoreAggregazione *r) {
+    if (r->socket >= 0) {
+        close(r->socket);
+        r->socket = -1;
+    }
+    free(r->dati);
+    free(r->messaggi);
+    r->dati = NULL;
+    r->messaggi = NULL;
+}
+
+int porta_ricevitore(const RicevitoreAggregazione *r) {
+    struct sockaddr_storage ss;
+    socklen_t dim = sizeof(ss);
+    if (getsockname(r->socket, (struct sockaddr *)&ss, &dim) != 0) {
+        return -1;
+    }
+    if (ss.ss_family == AF_INET) return ntohs(((const struct sockaddr_in *)&ss)->sin_port);
+    if (ss.ss_family == AF_INET6) return ntohs(((const struct sockaddr_in6 *)&ss)->sin6_port);
+    return -1;
+}
+
+int buffer_ricevitore(const RicevitoreAggregazione *r) {
+    int buffer = 0;
+    socklen_t dim = sizeof(buffer);
+    getsockopt(r->socket, SOL_SOCKET, SO_RCVBUF, &buffer, &dim);
+    return buffer;
+}
+
+int ricevi_aggregazione(RicevitoreAggregazione *r, VistaAggregata *v, int attesa_ms) {
+    struct pollfd p = { .fd = r->socket, .events = POLLIN };
+    int pronti = poll(&p, 1, attesa_ms);
+    if (pronti <= 0) {
+        return (pronti == 0 || errno == EINTR) ? 0 : -1;
+    }
+    MessaggiRicevitore *m = r->messaggi;
+    int totale = 0;
+    /* Al più MAX_LOTTI lotti, poi il chiamante torna a controllare i nodi */
+    for (int lotto = 0; lotto < MAX_LOTTI; lotto++) {
+        int n = recvmmsg(r->socket, m->msg, AGGREGAZIONE_LOTTO, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            return -1;
+        }
+        double t = istante_aggregazione();
+        for (int i = 0; i < n; i++) {
+            if (m->msg[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                v->malformati++;
+                continue;
+            }
+            applica_pacchetto(v, r->dati + (size_t)i * AGGREGAZIONE_MAX_DATAGRAMMA, m->msg[i].msg_len, t);
+        }
+        r->lotti++;
+        r->datagrammi += n;
+        totale += n;
+        if (n < AGGREGAZIONE_LOTTO) break;
+    }
+    return totale;
+}
@@ -0,0 +1,236 @@
+#ifndef AGGREGAZIONE_H
+#define AGGREGAZIONE_H
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include "dosews.h"
+#include "tempo_reale.h"
+
+/* Aggregazione multi-nodo. Ogni processo DOSEWS (nodo) manda via UDP a un
+ * aggregatore delta compatti dello stato delle sue stazioni: una voce da
+ * 32 byte per stazione cambiata, coalescenti tra due invii (conta solo
+ * l'ultimo stato), in datagrammi fino a AGGREGAZIONE_MAX_DATAGRAMMA byte e
+ * al più ogni periodo. Un nodo senza cambiamenti manda solo un battito ogni
+ * AGGREGAZIONE_BATTITO s, con cui ripete anche le stazioni non in attesa
+ * del trigger: una voce persa è recuperata entro un battito.
+ * L'aggregatore svuota il socket a lotti (una chiamata di sistema e una
+ * lettura dell'orologio per lotto) e fonde le voci in una vista globale. Un
+ * nodo muto o in ritardo non blocca gli altri: le sue stazioni restano
+ * nella vista con l'ultimo stato, segnate come non aggiornate. Un
+ * aggregatore può rimandare la vista a un livello superiore come un nodo
+ * qualsiasi (fan-in gerarchico).
+ * Il formato è nell'ordine dei byte dell'host (come gli archivi .dws) e
+ * gli istanti sono CLOCK_REALTIME: tra macchine diverse la latenza misurata
+ * vale quanto la sincronizzazione degli orologi. */
+
+#define AGGREGAZIONE_MAGIC          0x47475744u   /* "DWGG" */
+#define AGGREGAZIONE_VERSIONE       1u
+#define AGGREGAZIONE_PORTA          "47000"
+#define AGGREGAZIONE_MAX_DATAGRAMMA 1400          /* byte, sotto la MTU di Ethernet */
+#define AGGREGAZIONE_PERIODO        0.02          /* s tra due invii di un nodo */
+#define AGGREGAZIONE_BATTITO        1.0           /* s */
+#define AGGREGAZIONE_SILENZIO       3.0           /* s senza pacchetti: nodo in ritardo */
+#define AGGREGAZIONE_PERSO          30.0          /* s senza pacchetti: nodo perso */
+#define AGGREGAZIONE_MAX_LATENZA    0.5           /* s dal cambiamento alla fusione: nodo in ritardo */
+#define AGGREGAZIONE_DELTA_PGD      0.05          /* variazione relativa del PGD che merita un invio */
+#define AGGREGAZIONE_LOTTO          64            /* datagrammi per chiamata di sistema */
+#define AGGREGAZIONE_MAX_NODI       1024
+
+/* Bit di IntestazioneAggregazione.flags */
+#define AGGREGAZIONE_FINE           (1u << 0)     /* ultimo pacchetto del nodo */
+
+/* Bit di VoceAggregazione.stato */
+#define VOCE_CONFERMATA             (1u << 0)     /* evento confermato dalla rete */
+#define VOCE_ANTICIPATA             (1u << 1)     /* allarme da Pd e tau_c */
+#define VOCE_NON_AGGIORNATA         (1u << 2)     /* nodo d'origine in ritardo (da un aggregatore) */
+
+typedef struct {
+    unsigned int magic;
+    unsigned short versione;
+    unsigned short n_voci;
+    unsigned int nodo;
+    unsigned int sequenza;         /* +1 per pacchetto: i salti sono perdite */
+    unsigned int avvio;            /* cambia a ogni avvio del nodo */
+    unsigned int n_stazioni;       /* del nodo */
+    unsigned int flags;            /* AGGREGAZIONE_* */
+    unsigned int riservato;
+    double t_invio;                /* s */
+    double t_cambiamento;          /* s, cambiamento più vecchio tra le voci */
+} IntestazioneAggregazione;
+
+typedef struct {
+    double t_trigger;              /* s, assoluto; 0 in attesa del trigger */
+    unsigned int stazione;         /* identificativo nella rete */
+    unsigned char fase;            /* StatoSistema */
+    unsigned char stato;           /* VOCE_* */
+    unsigned short riservato;
+    float ritardo_allarme;         /* s dal trigger, 0 senza allarme */
+    float pgd_max;                 /* m */
+    float pgd_allarme;             /* m */
+    float prob;                    /* % */
+} VoceAggregazione;
+
+_Static_assert(sizeof(IntestazioneAggregazione) == 48, "intestazione senza padding");
+_Static_assert(sizeof(VoceAggregazione) == 32, "voce senza padding");
+
+#define AGGREGAZIONE_VOCI_PACCHETTO \
+    ((AGGREGAZIONE_MAX_DATAGRAMMA - (int)sizeof(IntestazioneAggregazione)) / (int)sizeof(VoceAggregazione))
+
+/* Istante corrente su CLOCK_REALTIME [s] */
+double istante_aggregazione(void);
+
+/* Voce dallo stato di una stazione; t0 è l'istante assoluto del suo primo
+ * campione. La probabilità d'allarme (calcola_risultati) è copiata da
+ * precedente se il PGD d'allarme non è cambiato: con l'ultima voce della
+ * stazione, il costo per campione è di qualche lettura. precedente può
+ * essere NULL, non v. */
+void voce_aggregazione(VoceAggregazione *v, const StatoDOSEWS *sys, unsigned int stazione, double t0,
+                       const VoceAggregazione *precedente);
+
+/* ---- Nodo ---- */
+
+typedef struct {
+    int socket;
+    struct sockaddr_storage destinazione;
+    socklen_t dim_destinazione;
+    unsigned int nodo, sequenza, avvio;
+    int n_stazioni;
+    unsigned int stazioni_nodo;    /* dichiarate nell'intestazione, default n_stazioni */
+    double periodo;                /* s */
+    VoceAggregazione *correnti;    /* ultimo stato noto, per indice */
+    VoceAggregazione *inviate;     /* ultimo stato inviato */
+    int *sporche;                  /* indici con cambiamenti non inviati */
+    unsigned char *segnate;
+    int n_sporche;
+    double t_cambiamento;          /* s, del primo cambiamento non inviato */
+    double ultimo_invio, ultimo_rinfresco;
+    long long pacchetti, voci, errori;
+} EmettitoreAggregazione;
+
+/* Socket UDP non bloccante verso destinazione ("host:porta") per n_stazioni
+ * indici locali. Ritorna 0, -1 se l'indirizzo non è valido o manca memoria. */
+int apri_emettitore(EmettitoreAggregazione *e, const char *destinazione, unsigned int nodo, int n_stazioni);
+
+/* Manda un pacchetto AGGREGAZIONE_FINE con le voci ancora da inviare, poi
+ * chiude il socket. */
+void chiudi_emettitore(EmettitoreAggregazione *e);
+
+/* Percorso critico, O(1) e senza chiamate di sistema: registra lo stato
+ * dell'indice e lo segna da inviare se differisce abbastanza dall'ultimo
+ * inviato (fase, stato, allarme, PGD oltre AGGREGAZIONE_DELTA_PGD). t è
+ * l'istante corrente, anche approssimato. */
+void aggiorna_emettitore(EmettitoreAggregazione *e, int indice, const VoceAggregazione *v, double t);
+
+/* Invia le voci segnate se è passato il periodo dall'ultimo invio (sempre
+ * con forza != 0), oppure il battito. Con il socket pieno le voci restano
+ * segnate per l'invio successivo. Ritorna i pacchetti inviati. */
+int invia_emettitore(EmettitoreAggregazione *e, double t, int forza);
+
+/* ---- Aggregatore ---- */
+
+typedef enum {
+    NODO_ATTIVO = 0,
+    NODO_IN_RITARDO,               /* silenzio o latenza oltre i limiti */
+    NODO_PERSO,                    /* silenzio oltre AGGREGAZIONE_PERSO */
+    NODO_CHIUSO                    /* ha mandato AGGREGAZIONE_FINE */
+} StatoNodo;
+
+typedef struct {
+    unsigned int nodo, avvio, sequenza;
+    int n_stazioni;
+    StatoNodo stato;
+    double ultimo_arrivo;          /* s */
+    double latenza;                /* s, dell'ultimo pacchetto con voci */
+    long long pacchetti, persi, fuori_ordine;
+} NodoAggregato;
+
+typedef struct {
+    VoceAggregazione voce;
+    int nodo;                      /* indice in VistaAggregata.nodi, -1 se libera */
+    unsigned int sequenza;         /* del pacchetto che l'ha aggiornata */
+    unsigned int avvio;            /* del nodo, quando l'ha aggiornata */
+    double t_arrivo;               /* s */
+} StazioneAggregata;
+
+typedef struct VistaAggregata VistaAggregata;
+
+/* Notifiche della fusione, sul thread che riceve. Campi NULL = nessuna. */
+typedef struct {
+    /* Ogni voce applicata; precedente è lo stato di prima (tutto zero per
+     * una stazione nuova). La posizione è stabile: vista->stazioni[slot]. */
+    void (*stazione)(void *contesto, const VistaAggregata *v, int slot, const VoceAggregazione *precedente);
+    void (*nodo)(void *contesto, const VistaAggregata *v, int nodo, StatoNodo precedente);
+    void *contesto;
+} CallbackAggregazione;
+
+struct VistaAggregata {
+    NodoAggregato nodi[AGGREGAZIONE_MAX_NODI];
+    int n_nodi;
+    StazioneAggregata *stazioni;   /* tabella a indirizzamento aperto sull'identificativo */
+    int capacita;                  /* potenza di 2, mai ridimensionata */
+    int n_stazioni;
+    CallbackAggregazione callback;
+    IstogrammaLatenza latenza;     /* dal cambiamento sul nodo alla fusione */
+    long long pacchetti, voci, malformati, scartate;
+};
+
+/* Riepilogo della vista; le stazioni di nodi non attivi (o segnate da un
+ * aggregatore inferiore) sono contate a parte. */
+typedef struct {
+    int nodi_attivi, nodi_in_ritardo, nodi_persi, nodi_chiusi;
+    int stazioni;
+    int scattate, allarmi;         /* aggiornate */
+    int scattate_non_aggiornate, allarmi_non_aggiornati;
+    double pgd_max;                /* m, su tutte */
+    double primo_trigger;          /* s, 0 senza trigger */
+} RiepilogoVista;
+
+/* Tabella per max_stazioni stazioni. Ritorna 0 o -1. */
+int init_vista(VistaAggregata *v, int max_stazioni);
+
+void free_vista(VistaAggregata *v);
+
+void imposta_callback_vista(VistaAggregata *v, const CallbackAggregazione *callback);
+
+/* Fonde un datagramma arrivato all'istante t. Le voci di un pacchetto più
+ * vecchio dell'ultimo applicato alla stessa stazione sono ignorate.
+ * Ritorna le voci applicate, -1 se il datagramma non è valido. */
+int applica_pacchetto(VistaAggregata *v, const void *dati, size_t n, double t);
+
+/* Stato dei nodi all'istante t (silenzio e latenza). Ritorna le transizioni. */
+int controlla_nodi(VistaAggregata *v, double t);
+
+/* Non zero se la stazione nello slot è di un nodo non attivo o segnata
+ * come non aggiornata. */
+int non_aggiornata_vista(const VistaAggregata *v, int slot);
+
+/* Scansione di tutta la tabella: da chiamare a cadenza di stampa, non per voce. */
+void riepilogo_vista(const VistaAggregata *v, RiepilogoVista *r);
+
+const char *nome_stato_nodo(StatoNodo s);
+
+typedef struct {
+    int socket;
+    unsigned char *dati;           /* AGGREGAZIONE_LOTTO datagrammi */
+    void *messaggi;                /* struct mmsghdr e iovec per recvmmsg */
+    long long lotti, datagrammi;
+} RicevitoreAggregazione;
+
+/* Socket UDP in ascolto su indirizzo ("[host:]porta", porta 0 = scelta dal
+ * sistema), con il buffer di ricezione più grande concesso. Ritorna 0 o -1. */
+int apri_ricevitore(RicevitoreAggregazione *r, const char *indirizzo);
+
+void chiudi_ricevitore(RicevitoreAggregazione *r);
+
+/* Porta effettiva, -1 se ignota */
+int porta_ricevitore(const RicevitoreAggregazione *r);
+
+/* Byte del buffer di ricezione concessi dal sistema */
+int buffer_ricevitore(const RicevitoreAggregazione *r);
+
+/* Attende fino a attesa_ms un datagramma, poi svuota il socket a lotti di
+ * AGGREGAZIONE_LOTTO applicandoli alla vista. Ritorna i datagrammi
+ * ricevuti (0 allo scadere dell'attesa o se interrotta), -1 per errore. */
+int ricevi_aggregazione(RicevitoreAggregazione *r, VistaAggregata *v, int attesa_ms);
+
+#endif
@@ -0,0 +1,360 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "archivio.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INTESTAZIONE_BLOCCO  8   /* primo intero, larghezza in bit, riservati */
+#define MARGINE_LETTURA      8   /* byte dopo i dati: letture da 64 bit senza controlli */
+#define TRATTO_DECODIFICA    256
+
+/* Byte di un blocco di n campioni a w bit per differenza */
+static size_t dimensione_blocco(unsigned int n, unsigned int w) {
+    size_t dati = ((size_t)(n - 1) * w + 7) / 8;
+    return INTESTAZIONE_BLOCCO + ((dati + 7) & ~(size_t)7) + MARGINE_LETTURA;
+}
+
+static unsigned int zigzag(long long d) {
+    return (unsigned int)(((unsigned long long)d << 1) ^ (unsigned long long)(d >> 63));
+}
+
+/* ---- Scrittura ---- */
+
+double quanto_per_ampiezza(double massimo_assoluto) {
+    int e;
+    frexp(massimo_assoluto, &e);   /* massimo < 2^e */
+    return (massimo_assoluto > 0.0) ? ldexp(1.0, e - 29) : 1.0;
+}
+
+int apri_scrittore_archivio(ScrittoreArchivio *s, const char *percorso,
+                            double frequenza, double t0, double quanto) {
+    memset(s, 0, sizeof(*s));
+    if (frequenza <= 0.0 || !(quanto > 0.0)) {
+        return -1;
+    }
+
+    s->capacita_indice = 64;
+    s->indice = malloc(s->capacita_indice * sizeof(VoceIndice));
+    s->blocco = malloc(ARCHIVIO_CAMPIONI_BLOCCO * sizeof(int));
+    s->codificato = calloc(dimensione_blocco(ARCHIVIO_CAMPIONI_BLOCCO, 32), 1);
+    s->fp = fopen(percorso, "wb");
+    if (!s->indice || !s->blocco || !s->codificato || !s->fp) {
+        if (s->fp) fclose(s->fp);
+        free(s->indice);
+        free(s->blocco);
+        free(s->codificato);
+        memset(s, 0, sizeof(*s));
+        return -1;
+    }
+
+    IntestazioneArchivio *h = &s->intestazione;
+    h->magic = ARCHIVIO_MAGIC;
+    h->versione = ARCHIVIO_VERSIONE;
+    h->campioni_blocco = ARCHIVIO_CAMPIONI_BLOCCO;
+    h->frequenza = frequenza;
+    h->t0 = t0;
+    h->quanto = quanto;
+
+    /* Intestazione provvisoria, riscritta alla chiusura */
+    s->offset = sizeof(IntestazioneArchivio);
+    if (fwrite(h, sizeof(*h), 1, s->fp) != 1) {
+        s->errore = 1;
+    }
+    return 0;
+}
+
+static void chiudi_blocco(ScrittoreArchivio *s) {
+    unsigned int n = s->n_blocco;
+    const int *v = s->blocco;
+    double quanto = s->intestazione.quanto;
+
+    unsigned int w = 0;
+    double minimo = v[0] * quanto, massimo = minimo, energia = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+        double x = v[i] * quanto;
+        minimo = (x < minimo) ? x : minimo;
+        massimo = (x > massimo) ? x : massimo;
+        energia += x * x;
+        if (i > 0) {
+            unsigned int z = zigzag((long long)v[i] - v[i - 1]);
+            while (w < 32 && (z >> w) != 0) {
+                w++;
+            }
+        }
+    }
+
+    size_t dim = dimensione_blocco(n, w);
+    unsigned char *p = s->codificato;
+    memset(p, 0, dim);
+    memcpy(p, &v[0], sizeof(int));
+    p[4] = (unsigned char)w;
+
+    unsigned char *dati = p + INTESTAZIONE_BLOCCO;
+    unsigned long long accumulatore = 0;
+    unsigned int bit = 0;
+    size_t byte = 0;
+    for (unsigned int i = 1; i < n && w > 0; i++) {
+        accumulatore |= (unsigned long long)zigzag((long long)v[i] - v[i - 1]) << bit;
+        bit += w;
+        while (bit >= 8) {
+            dati[byte++] = (unsigned char)accumulatore;
+            accumulatore >>= 8;
+            bit -= 8;
+        }
+    }
+    if (bit > 0) {
+        dati[byte] = (unsigned char)accumulatore;
+    }
+
+    if (s->intestazione.n_blocchi == s->capacita_indice) {
+        VoceIndice *nuovo = realloc(s->indice, 2 * s->capacita_indice * sizeof(VoceIndice));
+        if (!nuovo) {
+            s->errore = 1;
+            return;
+        }
+        s->indice = nuovo;
+        s->capacita_indice *= 2;
+    }
+    VoceIndice *voce = &s->indice[s->intestazione.n_blocchi++];
+    voce->offset = s->offset;
+    voce->minimo = minimo;
+    voce->massimo = massimo;
+    voce->energia = energia;
+    voce->dimensione = (unsigned int)dim;
+    voce->riservato = 0;
+
+    if (fwrite(p, 1, dim, s->fp) != dim) {
+        s->errore = 1;
+    }
+    s->offset += dim;
+    s->intestazione.n_campioni += n;
+    s->n_blocco = 0;
+}
+
+int scrivi_archivio(ScrittoreArchivio *s, const double *valori, long n) {
+    double scala = 1.0 / s->intestazione.quanto;   /* potenza di 2: esatta */
+    for (long i = 0; i < n && !s->errore; i++) {
+        double q = nearbyint(valori[i] * scala);
+        if (!(fabs(q) < ARCHIVIO_LIMITE_INTERO)) {
+            s->errore = 1;
+            break;
+        }
+        s->blocco[s->n_blocco++] = (int)q;
+        if (s->n_blocco == s->intestazione.campioni_blocco) {
+            chiudi_blocco(s);
+        }
+    }
+    return s->errore ? -1 : 0;
+}
+
+int chiudi_scrittore_archivio(ScrittoreArchivio *s) {
+    if (s->n_blocco > 0 && !s->errore) {
+        chiudi_blocco(s);
+    }
+
+    IntestazioneArchivio *h = &s->intestazione;
+    h->offset_indice = s->offset;
+    int ok = !s->errore
+          && fwrite(s->indice, sizeof(VoceIndice), h->n_blocchi, s->fp) == h->n_blocchi
+          && fseek(s->fp, 0, SEEK_SET) == 0
+          && fwrite(h, sizeof(*h), 1, s->fp) == 1;
+    ok = (fclose(s->fp) == 0) && ok;
+
+    free(s->indice);
+    free(s->blocco);
+    free(s->codificato);
+    memset(s, 0, sizeof(*s));
+    return ok ? 0 : -1;
+}
+
+/* ---- Lettura ---- */
+
+static int archivio_valido(const Archivio *a) {
+    const IntestazioneArchivio *h = a->intestazione;
+    if (h->magic != ARCHIVIO_MAGIC || h->versione != ARCHIVIO_VERSIONE
+        || h->campioni_blocco < 2 || h->campioni_blocco > ARCHIVIO_MAX_CAMPIONI_BLOCCO
+        || !(h->frequenza > 0.0) || !(h->quanto > 0.0)
+        || h->offset_indice > a->dimensione || h->offset_indice % 8 != 0
+        || (a->dimensione - h->offset_indice) / sizeof(VoceIndice) < h->n_blocchi
+        || h->n_campioni > (unsigned long long)h->n_blocchi * h->campioni_blocco
+        || h->n_campioni + h->campioni_blocco <= (unsigned long long)h->n_blocchi * h->campioni_blocco) {
+        return 0;
+    }
+
+    /* Ogni blocco deve stare nel file con lo spazio per la sua larghezza */
+    for (unsigned int k = 0; k < h->n_blocchi; k++) {
+        const VoceIndice *v = &a->indice[k];
+        if (v->offset > h->offset_indice || v->dimensione > h->offset_indice - v->offset
+            || v->dimensione < INTESTAZIONE_BLOCCO) {
+            return 0;
+        }
+        unsigned int w = a->mappa[v->offset + 4];
+        unsigned int n = (k + 1 < h->n_blocchi)
+                       ? h->campioni_blocco
+                       : (unsigned int)(h->n_campioni - (unsigned long long)k * h->campioni_blocco);
+        if (w > 32 || v->dimensione < dimensione_blocco(n, w)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int apri_archivio(Archivio *a, const char *percorso) {
+    memset(a, 0, sizeof(*a));
+
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IntestazioneArchivio)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t dim = (size_t)st.st_size;
+    void *mappa = mmap(NULL, dim, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappa == MAP_FAILED) {
+        return -1;
+    }
+
+    a->mappa = mappa;
+    a->dimensione = dim;
+    a->intestazione = mappa;
+    if (a->intestazione->magic != ARCHIVIO_MAGIC || a->intestazione->offset_indice > dim
+        || a->intestazione->offset_indice % 8 != 0) {
+        chiudi_archivio(a);
+        return -1;
+    }
+    a->indice = (const VoceIndice *)(a->mappa + a->intestazione->offset_indice);
+    if (!archivio_valido(a)) {
+        chiudi_archivio(a);
+        return -1;
+    }
+
+    /* Lettura sequenziale: il kernel può leggere in anticipo */
+    posix_madvise(mappa, dim, POSIX_MADV_SEQUENTIAL);
+    return 0;
+}
+
+int riconosci_archivio(const char *percorso) {
+    unsigned int magic = 0;
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    int letti = (int)read(fd, &magic, sizeof(magic));
+    close(fd);
+    return letti == (int)sizeof(magic) && magic == ARCHIVIO_MAGIC;
+}
+
+void chiudi_archivio(Archivio *a) {
+    if (a->mappa) {
+        munmap((void *)a->mappa, a->dimensione);
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+int decodifica_blocco_archivio(const Archivio *a, unsigned int k, double *out) {
+    const IntestazioneArchivio *h = a->intestazione;
+    if (k >= h->n_blocchi) {
+        return -1;
+    }
+    unsigned int n = (k + 1 < h->n_blocchi)
+                   ? h->campioni_blocco
+                   : (unsigned int)(h->n_campioni - (unsigned long long)k * h->campioni_blocco);
+
+    const unsigned char *p = a->mappa + a->indice[k].offset;
+    const unsigned char *dati = p + INTESTAZIONE_BLOCCO;
+    unsigned int w = p[4];
+    unsigned long long maschera = (1ULL << w) - 1;
+    double quanto = h->quanto;
+
+    int primo;
+    memcpy(&primo, p, sizeof(primo));
+    int v = primo;   /* |v| < 2^30 */
+    out[0] = (double)v * quanto;
+
+    /* A tratti: differenze (letture da 64 bit indipendenti, al più 32 + 7
+     * bit utili), somma progressiva intera, che è l'unica catena, e infine
+     * conversione in double, vettorizzabile */
+    int valori[TRATTO_DECODIFICA];
+    size_t pos = 0;
+    for (unsigned int inizio = 1; inizio < n; inizio += TRATTO_DECODIFICA) {
+        unsigned int m = (n - inizio < TRATTO_DECODIFICA) ? n - inizio : TRATTO_DECODIFICA;
+        for (unsigned int j = 0; j < m; j++) {
+            size_t bit = pos + (size_t)j * w;
+            unsigned long long parola;
+            memcpy(&parola, dati + (bit >> 3), sizeof(parola));
+            unsigned int z = (unsigned int)((parola >> (bit & 7)) & maschera);
+            valori[j] = (int)(z >> 1) ^ -(int)(z & 1);
+        }
+        pos += (size_t)m * w;
+        for (unsigned int j = 0; j < m; j++) {
+            v += valori[j];
+            valori[j] = v;
+        }
+        double *uscita = out + inizio;
+        for (unsigned int j = 0; j < m; j++) {
+            uscita[j] = (double)valori[j] * quanto;
+        }
+    }
+    return (int)n;
+}
+
+unsigned int blocco_da_tempo(const Archivio *a, double t) {
+    const IntestazioneArchivio *h = a->intestazione;
+    double campione = floor((t - h->t0) * h->frequenza);
+    if (campione <= 0.0 || h->n_blocchi == 0) {
+        return 0;
+    }
+    double k = floor(campione / h->campioni_blocco);
+    return (k < h->n_blocchi) ? (unsigned int)k : h->n_blocchi - 1;
+}
+
+long long leggi_finestra_archivio(const Archivio *a, double t_inizio, double durata,
+                                  double *out, long long max_campioni) {
+    const IntestazioneArchivio *h = a->intestazione;
+    double primo = ceil((t_inizio - h->t0) * h->frequenza);
+    double ultimo = ceil((t_inizio + durata - h->t0) * h->frequenza);   /* escluso */
+    if (primo < 0.0) primo = 0.0;
+    if (ultimo > (double)h->n_campioni) ultimo = (double)h->n_campioni;
+    if (ultimo <= primo || max_campioni <= 0) {
+        return 0;
+    }
+
+    long long inizio = (long long)primo;
+    long long fine = (long long)ultimo;
+    if (fine - inizio > max_campioni) {
+        fine = inizio + max_campioni;
+    }
+
+    long long scritti = 0;
+    unsigned int n_blocco = h->campioni_blocco;
+    double *appoggio = NULL;
+    for (unsigned int k = (unsigned int)(inizio / n_blocco); scritti < fine - inizio; k++) {
+        long long base = (long long)k * n_blocco;
+        long long da = (inizio > base) ? inizio - base : 0;
+        long long a_fine = (fine < base + n_blocco) ? fine - base : n_blocco;
+
+        if (da == 0 && a_fine == n_blocco) {
+            /* Blocco intero: decodifica direttamente nell'uscita */
+            decodifica_blocco_archivio(a, k, out + scritti);
+        } else {
+            if (!appoggio && !(appoggio = malloc(n_blocco * sizeof(double)))) {
+                break;
+            }
+            decodifica_blocco_archivio(a, k, appoggio);
+            memcpy(out + scritti, appoggio + da, (size_t)(a_fine - da) * sizeof(double));
+        }
+        scritti += a_fine - da;
+    }
+    free(appoggio);
+    return scritti;
+}
@@ -0,0 +1,107 @@
+#ifndef ARCHIVIO_H
+#define ARCHIVIO_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Archivio binario delle forme d'onda (.dws), una traccia per file:
+ *
+ *   IntestazioneArchivio | blocco 0 | blocco 1 | ... | indice (VoceIndice x n_blocchi)
+ *
+ * I campioni sono quantizzati a interi (valore = intero * quanto, quanto
+ * potenza di 2, |intero| < 2^30) e divisi in blocchi di campioni_blocco.
+ * Ogni blocco contiene il primo intero e le differenze successive in
+ * zigzag, impacchettate con la larghezza in bit minima per quel blocco
+ * (come le differenze di Steim, ma con una sola larghezza per blocco, così
+ * la decodifica non ha salti). L'indice dà per ogni blocco posizione,
+ * minimo, massimo ed energia dei valori decodificati; con frequenza
+ * costante il blocco di un istante si calcola senza scorrere il file.
+ * Little-endian, come il formato dei checkpoint. */
+
+#define ARCHIVIO_MAGIC                0x41535744u  /* "DWSA" */
+#define ARCHIVIO_VERSIONE             1u
+#define ARCHIVIO_CAMPIONI_BLOCCO      1024
+#define ARCHIVIO_MAX_CAMPIONI_BLOCCO  65536
+#define ARCHIVIO_LIMITE_INTERO        (1 << 30)
+
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned int campioni_blocco;
+    unsigned int n_blocchi;
+    unsigned long long n_campioni;
+    unsigned long long offset_indice;
+    double frequenza;              /* Hz */
+    double t0;                     /* s, istante del primo campione */
+    double quanto;                 /* unità per intero */
+    unsigned long long riservato;
+} IntestazioneArchivio;
+
+typedef struct {
+    unsigned long long offset;     /* inizio del blocco nel file */
+    double minimo, massimo;
+    double energia;                /* somma dei quadrati */
+    unsigned int dimensione;       /* byte del blocco, padding incluso */
+    unsigned int riservato;
+} VoceIndice;
+
+/* ---- Scrittura ---- */
+
+typedef struct {
+    FILE *fp;
+    IntestazioneArchivio intestazione;
+    VoceIndice *indice;
+    unsigned int capacita_indice;
+    int *blocco;                   /* interi del blocco corrente */
+    unsigned int n_blocco;
+    unsigned char *codificato;
+    unsigned long long offset;
+    int errore;
+} ScrittoreArchivio;
+
+/* Quanto (potenza di 2) più fine per cui massimo_assoluto resta entro
+ * ARCHIVIO_LIMITE_INTERO. */
+double quanto_per_ampiezza(double massimo_assoluto);
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int apri_scrittore_archivio(ScrittoreArchivio *s, const char *percorso,
+                            double frequenza, double t0, double quanto);
+
+/* Ritorna 0, oppure -1 se un valore non è rappresentabile con il quanto
+ * scelto o la scrittura fallisce (l'errore resta fino alla chiusura). */
+int scrivi_archivio(ScrittoreArchivio *s, const double *valori, long n);
+
+/* Chiude l'ultimo blocco, scrive indice e intestazione. Ritorna 0 o -1. */
+int chiudi_scrittore_archivio(ScrittoreArchivio *s);
+
+/* ---- Lettura (mmap) ---- */
+
+typedef struct {
+    const unsigned char *mappa;
+    size_t dimensione;
+    const IntestazioneArchivio *intestazione;
+    const VoceIndice *indice;
+} Archivio;
+
+/* Ritorna 0, oppure -1 se il file manca, non è un archivio o è troncato. */
+int apri_archivio(Archivio *a, const char *percorso);
+
+/* 1 se il file comincia con ARCHIVIO_MAGIC, 0 altrimenti: distingue un
+ * archivio rovinato (da rifiutare) da un file di testo. */
+int riconosci_archivio(const char *percorso);
+
+void chiudi_archivio(Archivio *a);
+
+/* Decodifica il blocco k in out (almeno campioni_blocco valori).
+ * Ritorna il numero di campioni, -1 se k non esiste. */
+int decodifica_blocco_archivio(const Archivio *a, unsigned int k, double *out);
+
+/* Blocco che contiene l'istante t [s], limitato all'archivio. */
+unsigned int blocco_da_tempo(const Archivio *a, double t);
+
+/* Campioni con istante in [t_inizio, t_inizio + durata), al più max_campioni.
+ * Decodifica solo i blocchi coinvolti. Ritorna il numero scritto in out. */
+long long leggi_finestra_archivio(const Archivio *a, double t_inizio, double durata,
+                                  double *out, long long max_campioni);
+
+#endif
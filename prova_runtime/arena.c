@@ -0,0 +1,26 @@
+#include "arena.h"
+#include <stdint.h>
+#include <string.h>
+
+int init_arena(Arena *arena, void *memoria, size_t dimensione) {
+    arena->base = NULL;
+    arena->dimensione = 0;
+    arena->usato = 0;
+    if (!memoria || (uintptr_t)memoria % ARENA_ALLINEAMENTO != 0) {
+        return -1;
+    }
+    arena->base = memoria;
+    arena->dimensione = dimensione;
+    return 0;
+}
+
+void *alloca_arena(Arena *arena, size_t n) {
+    size_t blocco = ARENA_ALLINEA(n);
+    if (blocco < n || blocco > arena->dimensione - arena->usato) {
+        return NULL;
+    }
+    void *p = arena->base + arena->usato;
+    arena->usato += blocco;
+    memset(p, 0, n);
+    return p;
+}
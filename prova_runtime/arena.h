@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Memoria fornita dal chiamante, distribuita in blocchi allineati senza
+ * liberazioni individuali: tutto lo stato di una o più stazioni sta in una
+ * sola allocazione, che il chiamante libera quando non serve più. */
+
+#define ARENA_ALLINEAMENTO  64   /* linea di cache */
+#define ARENA_ALLINEA(n)    (((size_t)(n) + ARENA_ALLINEAMENTO - 1) & ~(size_t)(ARENA_ALLINEAMENTO - 1))
+
+typedef struct {
+    unsigned char *base;
+    size_t dimensione;
+    size_t usato;
+} Arena;
+
+/* memoria deve essere allineata ad ARENA_ALLINEAMENTO byte (aligned_alloc,
+ * oppure una porzione di un'arena più grande). Ritorna 0 o -1. */
+int init_arena(Arena *arena, void *memoria, size_t dimensione);
+
+/* n byte azzerati, allineati; NULL se l'arena non basta. Ogni blocco occupa
+ * ARENA_ALLINEA(n) byte, così le funzioni di dimensionamento possono sommare
+ * le richieste senza conoscere l'ordine delle allocazioni. */
+void *alloca_arena(Arena *arena, size_t n);
+
+#endif
@@ -0,0 +1,206 @@
+#include "associazione.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define STAZIONI_PER_CELLA 4.0
+
+int init_rete(ReteStazioni *rete, int capacita, int k, int n,
+              double velocita_p, double tolleranza) {
+    memset(rete, 0, sizeof(*rete));
+    if (n < 1 || n > ASSOCIAZIONE_MAX_VICINI + 1 || k < 1 || k > n) {
+        return -1;
+    }
+
+    rete->stazioni = calloc(capacita, sizeof(Postazione));
+    if (!rete->stazioni) {
+        return -1;
+    }
+    rete->capacita = capacita;
+    rete->k = k;
+    rete->n = n;
+    rete->velocita_p = velocita_p;
+    rete->tolleranza = tolleranza;
+    return 0;
+}
+
+void free_rete(ReteStazioni *rete) {
+    free(rete->stazioni);
+    free(rete->inizio_cella);
+    free(rete->indici);
+    rete->stazioni = NULL;
+    rete->inizio_cella = NULL;
+    rete->indici = NULL;
+}
+
+int aggiungi_stazione(ReteStazioni *rete, double lat, double lon) {
+    if (rete->n_stazioni >= rete->capacita) {
+        return -1;
+    }
+    Postazione *p = &rete->stazioni[rete->n_stazioni];
+    p->lat = lat;
+    p->lon = lon;
+    p->ultimo_trigger = -1.0;
+    p->triggerata = 0;
+    return rete->n_stazioni++;
+}
+
+static int cella_di(const ReteStazioni *rete, double x, double y, int *cx, int *cy) {
+    *cx = (int)((x - rete->x_min) / rete->cella_km);
+    *cy = (int)((y - rete->y_min) / rete->cella_km);
+    if (*cx >= rete->nx) *cx = rete->nx - 1;
+    if (*cy >= rete->ny) *cy = rete->ny - 1;
+    return *cy * rete->nx + *cx;
+}
+
+/* Inserisce j nella lista ordinata per distanza dei vicini di p (max m) */
+static void inserisci_vicino(Postazione *p, int m, int j, double d) {
+    if (p->n_vicini == m && d >= p->distanze[m - 1]) {
+        return;
+    }
+    int pos = (p->n_vicini < m) ? p->n_vicini++ : m - 1;
+    while (pos > 0 && p->distanze[pos - 1] > d) {
+        p->vicini[pos] = p->vicini[pos - 1];
+        p->distanze[pos] = p->distanze[pos - 1];
+        pos--;
+    }
+    p->vicini[pos] = j;
+    p->distanze[pos] = d;
+}
+
+static void cerca_vicini(ReteStazioni *rete, int i) {
+    Postazione *p = &rete->stazioni[i];
+    int m = rete->n - 1;
+    p->n_vicini = 0;
+    if (m == 0) return;
+
+    int cx, cy;
+    cella_di(rete, p->x, p->y, &cx, &cy);
+    int raggio_max = (rete->nx > rete->ny) ? rete->nx : rete->ny;
+
+    /* Anelli di celle crescenti: ci si ferma quando l'anello successivo non
+     * può contenere stazioni più vicine dell'ultimo vicino trovato */
+    for (int r = 0; r <= raggio_max; r++) {
+        if (p->n_vicini == m && (r - 1) * rete->cella_km > p->distanze[m - 1]) {
+            break;
+        }
+        for (int gy = cy - r; gy <= cy + r; gy++) {
+            if (gy < 0 || gy >= rete->ny) continue;
+            for (int gx = cx - r; gx <= cx + r; gx++) {
+                if (gx < 0 || gx >= rete->nx) continue;
+                if (abs(gx - cx) != r && abs(gy - cy) != r) continue;
+
+                int c = gy * rete->nx + gx;
+                for (int q = rete->inizio_cella[c]; q < rete->inizio_cella[c + 1]; q++) {
+                    int j = rete->indici[q];
+                    if (j == i) continue;
+                    double dx = rete->stazioni[j].x - p->x;
+                    double dy = rete->stazioni[j].y - p->y;
+                    inserisci_vicino(p, m, j, sqrt(dx * dx + dy * dy));
+                }
+            }
+        }
+    }
+}
+
+int costruisci_indice_rete(ReteStazioni *rete) {
+    int N = rete->n_stazioni;
+    if (N == 0) {
+        return -1;
+    }
+
+    /* Proiezione equirettangolare attorno al baricentro */
+    double lat0 = 0.0, lon0 = 0.0;
+    for (int i = 0; i < N; i++) {
+        lat0 += rete->stazioni[i].lat;
+        lon0 += rete->stazioni[i].lon;
+    }
+    lat0 /= N;
+    lon0 /= N;
+    double kx = RAGGIO_TERRA_KM * M_PI / 180.0 * cos(lat0 * M_PI / 180.0);
+    double ky = RAGGIO_TERRA_KM * M_PI / 180.0;
+
+    double x_max = -INFINITY, y_max = -INFINITY;
+    rete->x_min = INFINITY;
+    rete->y_min = INFINITY;
+    for (int i = 0; i < N; i++) {
+        Postazione *p = &rete->stazioni[i];
+        p->x = (p->lon - lon0) * kx;
+        p->y = (p->lat - lat0) * ky;
+        if (p->x < rete->x_min) rete->x_min = p->x;
+        if (p->y < rete->y_min) rete->y_min = p->y;
+        if (p->x > x_max) x_max = p->x;
+        if (p->y > y_max) y_max = p->y;
+    }
+
+    double area = fmax((x_max - rete->x_min) * (y_max - rete->y_min), 1.0);
+    rete->cella_km = fmax(sqrt(area * STAZIONI_PER_CELLA / N), 1e-3);
+    rete->nx = (int)((x_max - rete->x_min) / rete->cella_km) + 1;
+    rete->ny = (int)((y_max - rete->y_min) / rete->cella_km) + 1;
+
+    int n_celle = rete->nx * rete->ny;
+    free(rete->inizio_cella);
+    free(rete->indici);
+    rete->inizio_cella = calloc(n_celle + 1, sizeof(int));
+    rete->indici = malloc(N * sizeof(int));
+    int *cella = malloc(N * sizeof(int));
+    if (!rete->inizio_cella || !rete->indici || !cella) {
+        free(cella);
+        return -1;
+    }
+
+    /* Ordinamento per cella con conteggio (counting sort) */
+    for (int i = 0; i < N; i++) {
+        int cx, cy;
+        cella[i] = cella_di(rete, rete->stazioni[i].x, rete->stazioni[i].y, &cx, &cy);
+        rete->inizio_cella[cella[i] + 1]++;
+    }
+    for (int c = 0; c < n_celle; c++) {
+        rete->inizio_cella[c + 1] += rete->inizio_cella[c];
+    }
+    int *riempimento = malloc(n_celle * sizeof(int));
+    if (!riempimento) {
+        free(cella);
+        return -1;
+    }
+    memcpy(riempimento, rete->inizio_cella, n_celle * sizeof(int));
+    for (int i = 0; i < N; i++) {
+        rete->indici[riempimento[cella[i]]++] = i;
+    }
+    free(riempimento);
+    free(cella);
+
+    for (int i = 0; i < N; i++) {
+        cerca_vicini(rete, i);
+    }
+    return 0;
+}
+
+int vicini_compatibili(const ReteStazioni *rete, int id, double t, int *compatibili) {
+    const Postazione *p = &rete->stazioni[id];
+
+    /* Due trigger sono compatibili se la differenza dei tempi non supera il
+     * tempo di percorrenza dell'onda P tra le due stazioni */
+    int conteggio = 0;
+    for (int v = 0; v < p->n_vicini; v++) {
+        const Postazione *q = &rete->stazioni[p->vicini[v]];
+        if (!q->triggerata) continue;
+        double finestra = p->distanze[v] / rete->velocita_p + rete->tolleranza;
+        if (fabs(t - q->ultimo_trigger) <= finestra) {
+            if (compatibili) compatibili[conteggio] = p->vicini[v];
+            conteggio++;
+        }
+    }
+    return conteggio;
+}
+
+int registra_trigger(ReteStazioni *rete, int id, double t) {
+    Postazione *p = &rete->stazioni[id];
+    p->ultimo_trigger = t;
+    p->triggerata = 1;
+    return 1 + vicini_compatibili(rete, id, t, NULL) >= rete->k;
+}
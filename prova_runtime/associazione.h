@@ -0,0 +1,64 @@
+#ifndef ASSOCIAZIONE_H
+#define ASSOCIAZIONE_H
+
+/* Associazione di rete k-su-n: un trigger locale diventa evento confermato
+ * quando almeno k delle n stazioni più vicine (stazione inclusa) hanno
+ * triggerato con tempi compatibili con la propagazione dell'onda P.
+ * I vicini sono precalcolati con una griglia uniforme, quindi il costo per
+ * trigger è O(n) indipendentemente dal numero di stazioni. */
+
+#define ASSOCIAZIONE_MAX_VICINI 32
+#define RAGGIO_TERRA_KM         6371.0
+
+typedef struct {
+    double x, y;               /* coordinate locali [km] */
+    double lat, lon;           /* gradi */
+    double ultimo_trigger;     /* [s], negativo se mai triggerata */
+    int triggerata;
+    int n_vicini;
+    int vicini[ASSOCIAZIONE_MAX_VICINI];
+    double distanze[ASSOCIAZIONE_MAX_VICINI];  /* [km] */
+} Postazione;
+
+typedef struct {
+    Postazione *stazioni;
+    int n_stazioni;
+    int capacita;
+
+    /* Griglia in formato compresso: le stazioni della cella c sono
+     * indici[inizio_cella[c] .. inizio_cella[c + 1]) */
+    double cella_km;
+    double x_min, y_min;
+    int nx, ny;
+    int *inizio_cella;
+    int *indici;
+
+    int k;                     /* trigger richiesti per la conferma */
+    int n;                     /* stazioni considerate, inclusa quella che triggera */
+    double velocita_p;         /* [km/s] */
+    double tolleranza;         /* [s] */
+} ReteStazioni;
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int init_rete(ReteStazioni *rete, int capacita, int k, int n,
+              double velocita_p, double tolleranza);
+
+void free_rete(ReteStazioni *rete);
+
+/* Ritorna l'identificativo della stazione, -1 se la rete è piena. */
+int aggiungi_stazione(ReteStazioni *rete, double lat, double lon);
+
+/* Da chiamare dopo l'ultima aggiungi_stazione: proietta le coordinate,
+ * costruisce la griglia e le liste dei vicini. */
+int costruisci_indice_rete(ReteStazioni *rete);
+
+/* Registra il trigger della stazione id al tempo t [s].
+ * Ritorna 1 se con questo trigger l'evento è confermato. */
+int registra_trigger(ReteStazioni *rete, int id, double t);
+
+/* Vicini di id già triggerati con tempi compatibili con t: se compatibili
+ * non è NULL (almeno ASSOCIAZIONE_MAX_VICINI elementi) ne scrive gli
+ * identificativi. Ritorna quanti sono. */
+int vicini_compatibili(const ReteStazioni *rete, int id, double t, int *compatibili);
+
+#endif
@@ -0,0 +1,301 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aggregazione.h"
+
+/* Aggregazione multi-nodo su un solo host:
+ *   bench_aggregazione [durata] [attivita]
+ * Per ogni configurazione (nodi x stazioni per nodo) un thread fa da
+ * aggregatore e N_MITTENTI thread simulano i nodi, ciascuno con il proprio
+ * socket: a ogni periodo di invio la frazione attivita delle stazioni di
+ * ogni nodo cambia (default 1: tutte, come un evento forte su tutta la
+ * rete) e i delta partono su loopback. Per durata s (default 2) misura le
+ * voci inviate e fuse al secondo, i pacchetti persi, la latenza dal
+ * cambiamento alla fusione e il tempo di CPU dell'aggregatore. Una
+ * configurazione è sostenuta se non perde pacchetti e il 99% delle voci è
+ * fuso entro due periodi. Infine un nodo su otto si ferma: misura dopo
+ * quanto silenzio l'aggregatore lo segna in ritardo e verifica che gli
+ * altri restino attivi, e un nodo riavviato (nuovo avvio, sequenza da capo)
+ * deve sostituire nella vista l'allarme del vecchio avvio. */
+
+#define N_MITTENTI   4
+#define DURATA       2.0      /* s per configurazione */
+#define SCARICO      0.2      /* s per svuotare il socket alla fine */
+#define FERMO_DOPO   1.0      /* s, del nodo che si ferma */
+
+typedef struct {
+    EmettitoreAggregazione *nodi;
+    int primo, n;              /* nodi del thread */
+    int stazioni;
+    double attivita, durata;
+    int fermo;                 /* indice del nodo che si ferma dopo FERMO_DOPO, -1 nessuno */
+    unsigned long long seme;
+} Mittente;
+
+typedef struct {
+    VistaAggregata *vista;
+    RicevitoreAggregazione *ricevitore;
+    atomic_int termina;
+    double cpu;                /* s */
+    /* Prova del nodo fermo */
+    unsigned int nodo_fermo;
+    double t_ritardo;          /* s, CLOCK_REALTIME della transizione, 0 se mai */
+    int altri_non_attivi;
+} Aggregatore;
+
+static double uniforme(unsigned long long *seme) {
+    *seme = *seme * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((*seme >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double cpu_thread(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void *esegui_mittente(void *arg) {
+    Mittente *m = arg;
+    struct timespec prossimo;
+    istante_corrente(&prossimo);
+    double inizio = istante_aggregazione();
+    for (;;) {
+        double t = istante_aggregazione();
+        if (t - inizio >= m->durata) {
+            break;
+        }
+        for (int k = m->primo; k < m->primo + m->n; k++) {
+            if (k == m->fermo && t - inizio >= FERMO_DOPO) {
+                continue;
+            }
+            EmettitoreAggregazione *e = &m->nodi[k];
+            for (int i = 0; i < m->stazioni; i++) {
+                if (uniforme(&m->seme) >= m->attivita) {
+                    continue;
+                }
+                /* PGD in crescita oltre AGGREGAZIONE_DELTA_PGD: ogni cambiamento va inviato */
+                VoceAggregazione v = e->correnti[i];
+                v.stazione = (unsigned int)k << 16 | (unsigned int)i;
+                v.fase = STATO_TRIGGERED;
+                v.t_trigger = inizio;
+                v.pgd_max = (v.pgd_max > 1.0f) ? 1e-4f : v.pgd_max * 1.1f + 1e-4f;
+                aggiorna_emettitore(e, i, &v, t);
+            }
+            invia_emettitore(e, t, 1);
+        }
+        avanza_istante(&prossimo, AGGREGAZIONE_PERIODO);
+        attendi_istante(&prossimo);
+    }
+    return NULL;
+}
+
+static void su_nodo(void *contesto, const VistaAggregata *v, int k, StatoNodo precedente) {
+    Aggregatore *a = contesto;
+    const NodoAggregato *nd = &v->nodi[k];
+    if (nd->stato == precedente) {
+        return;
+    }
+    if (nd->nodo == a->nodo_fermo) {
+        if (nd->stato == NODO_IN_RITARDO && a->t_ritardo == 0.0) a->t_ritardo = istante_aggregazione();
+    } else if (nd->stato != NODO_ATTIVO) {
+        a->altri_non_attivi++;
+    }
+}
+
+static void *esegui_aggregatore(void *arg) {
+    Aggregatore *a = arg;
+    double cpu = cpu_thread();
+    while (!atomic_load(&a->termina)) {
+        ricevi_aggregazione(a->ricevitore, a->vista, 5);
+        controlla_nodi(a->vista, istante_aggregazione());
+    }
+    while (ricevi_aggregazione(a->ricevitore, a->vista, 0) > 0) {
+    }
+    a->cpu = cpu_thread() - cpu;
+    return NULL;
+}
+
+typedef struct {
+    long long inviate, fuse, pacchetti, persi, errori;
+    double cpu;
+    double p50, p99, massimo;
+    double t_ritardo;          /* s di silenzio del nodo fermo, negativo se mai segnato */
+    int altri_non_attivi;
+} Esito;
+
+/* Una configurazione; ritorna 0 o -1 */
+static int prova(int n_nodi, int stazioni, double attivita, double durata, int fermo, Esito *esito) {
+    memset(esito, 0, sizeof(*esito));
+    VistaAggregata *vista = malloc(sizeof(VistaAggregata));
+    EmettitoreAggregazione *nodi = calloc((size_t)n_nodi, sizeof(EmettitoreAggregazione));
+    RicevitoreAggregazione ricevitore;
+    if (!vista || !nodi || init_vista(vista, n_nodi * stazioni) != 0) {
+        free(vista);
+        free(nodi);
+        return -1;
+    }
+    if (apri_ricevitore(&ricevitore, "127.0.0.1:0") != 0) {
+        free_vista(vista);
+        free(vista);
+        free(nodi);
+        return -1;
+    }
+    char destinazione[64];
+    snprintf(destinazione, sizeof(destinazione), "127.0.0.1:%d", porta_ricevitore(&ricevitore));
+    int aperti = 0;
+    while (aperti < n_nodi && apri_emettitore(&nodi[aperti], destinazione, (unsigned int)aperti, stazioni) == 0) {
+        aperti++;
+    }
+
+    Aggregatore a = { .vista = vista, .ricevitore = &ricevitore, .nodo_fermo = (unsigned int)fermo };
+    atomic_init(&a.termina, 0);
+    CallbackAggregazione callback = { NULL, su_nodo, &a };
+    imposta_callback_vista(vista, &callback);
+
+    int n_mittenti = (n_nodi < N_MITTENTI) ? n_nodi : N_MITTENTI;
+    Mittente mittenti[N_MITTENTI];
+    pthread_t thread[N_MITTENTI], thread_aggregatore;
+    int errore = (aperti < n_nodi) || pthread_create(&thread_aggregatore, NULL, esegui_aggregatore, &a) != 0;
+    double t_fermo = istante_aggregazione() + FERMO_DOPO;
+    int avviati = 0;
+    for (int j = 0; j < n_mittenti && !errore; j++) {
+        int primo = n_nodi * j / n_mittenti, ultimo = n_nodi * (j + 1) / n_mittenti;
+        mittenti[j] = (Mittente){ nodi, primo, ultimo - primo, stazioni, attivita, durata, fermo,
+                                  0x9e3779b97f4a7c15ULL * (unsigned long long)(j + 1) };
+        errore = pthread_create(&thread[j], NULL, esegui_mittente, &mittenti[j]) != 0;
+        avviati += !errore;
+    }
+    for (int j = 0; j < avviati; j++) {
+        pthread_join(thread[j], NULL);
+    }
+    if (aperti == n_nodi && (avviati > 0 || !errore)) {
+        struct timespec scarico;
+        istante_corrente(&scarico);
+        avanza_istante(&scarico, SCARICO);
+        attendi_istante(&scarico);
+        atomic_store(&a.termina, 1);
+        pthread_join(thread_aggregatore, NULL);
+    }
+
+    for (int k = 0; k < aperti; k++) {
+        esito->inviate += nodi[k].voci;
+        esito->errori += nodi[k].errori;
+    }
+    for (int k = 0; k < vista->n_nodi; k++) {
+        esito->persi += vista->nodi[k].persi;
+    }
+    esito->fuse = vista->voci;
+    esito->pacchetti = vista->pacchetti;
+    esito->cpu = a.cpu;
+    esito->p50 = percentile_latenza(&vista->latenza, 0.5);
+    esito->p99 = percentile_latenza(&vista->latenza, 0.99);
+    esito->massimo = vista->latenza.massimo;
+    /* Il nodo fermo tace da t_fermo, salvo l'ultimo invio già partito */
+    esito->t_ritardo = (a.t_ritardo > 0.0) ? a.t_ritardo - t_fermo : -1.0;
+    esito->altri_non_attivi = a.altri_non_attivi;
+
+    for (int k = 0; k < aperti; k++) {
+        chiudi_emettitore(&nodi[k]);
+    }
+    chiudi_ricevitore(&ricevitore);
+    free_vista(vista);
+    free(vista);
+    free(nodi);
+    return errore ? -1 : 0;
+}
+
+/* Datagramma di una voce dal nodo 0, stazione 7 */
+static void applica_voce(VistaAggregata *v, unsigned int avvio, unsigned int sequenza,
+                         StatoSistema fase, int *applicate) {
+    unsigned char dati[sizeof(IntestazioneAggregazione) + sizeof(VoceAggregazione)];
+    IntestazioneAggregazione h = {
+        .magic = AGGREGAZIONE_MAGIC, .versione = AGGREGAZIONE_VERSIONE, .n_voci = 1,
+        .nodo = 0, .sequenza = sequenza, .avvio = avvio, .n_stazioni = 1,
+    };
+    VoceAggregazione voce = { .stazione = 7, .fase = (unsigned char)fase };
+    if (fase == STATO_ALLARME) {
+        voce.t_trigger = 1.0;
+        voce.ritardo_allarme = 1.0f;
+    }
+    memcpy(dati, &h, sizeof(h));
+    memcpy(dati + sizeof(h), &voce, sizeof(voce));
+    int n = applica_pacchetto(v, dati, sizeof(dati), 0.0);
+    *applicate += (n > 0) ? n : 0;
+}
+
+/* Riavvio: 0 se l'allarme del vecchio avvio è sostituito e l'ordine delle
+ * sequenze vale ancora dentro il nuovo avvio */
+static int prova_riavvio(void) {
+    VistaAggregata *v = malloc(sizeof(VistaAggregata));
+    if (!v || init_vista(v, 16) != 0) {
+        free(v);
+        return -1;
+    }
+    int applicate = 0;
+    applica_voce(v, 1, 5000, STATO_ALLARME, &applicate);
+    applica_voce(v, 2, 2, STATO_ATTESA_TRIGGER, &applicate);
+    applica_voce(v, 2, 1, STATO_ALLARME, &applicate);    /* fuori ordine: ignorata */
+    RiepilogoVista r;
+    riepilogo_vista(v, &r);
+    printf("Nodo riavviato: %d voci applicate su 3 (attese 2), allarmi nella vista %d (atteso 0)\n",
+           applicate, r.allarmi + r.allarmi_non_aggiornati);
+    int esito = (applicate == 2 && r.allarmi + r.allarmi_non_aggiornati == 0) ? 0 : -1;
+    free_vista(v);
+    free(v);
+    return esito;
+}
+
+int main(int argc, char *argv[]) {
+    double durata = (argc > 1) ? atof(argv[1]) : DURATA;
+    double attivita = (argc > 2) ? atof(argv[2]) : 1.0;
+    if (durata <= 0.0 || attivita <= 0.0 || attivita > 1.0) {
+        fprintf(stderr, "Uso: %s [durata] [attivita]\n", argv[0]);
+        return 1;
+    }
+
+    static const struct { int nodi, stazioni; } CONFIGURAZIONI[] = {
+        { 8, 100 }, { 32, 250 }, { 128, 250 }, { 256, 250 }, { 256, 1000 },
+    };
+    printf("Periodo di invio %.0f ms, %d voci per datagramma, attività %.0f%%, %.1f s per configurazione\n\n",
+           AGGREGAZIONE_PERIODO * 1e3, AGGREGAZIONE_VOCI_PACCHETTO, attivita * 100.0, durata);
+    printf("%5s  %9s  %12s  %12s  %10s  %7s  %9s  %9s  %9s  %7s\n", "nodi", "stazioni", "inviate/s", "fuse/s",
+           "pacchetti", "persi", "p50 [ms]", "p99 [ms]", "max [ms]", "CPU [%]");
+    int sostenute = 0, n_config = (int)(sizeof(CONFIGURAZIONI) / sizeof(CONFIGURAZIONI[0]));
+    for (int c = 0; c < n_config; c++) {
+        Esito e;
+        if (prova(CONFIGURAZIONI[c].nodi, CONFIGURAZIONI[c].stazioni, attivita, durata, -1, &e) != 0) {
+            fprintf(stderr, "Errore: configurazione %d x %d non avviata\n",
+                    CONFIGURAZIONI[c].nodi, CONFIGURAZIONI[c].stazioni);
+            return 1;
+        }
+        int sostenuta = (e.persi == 0 && e.p99 <= 2.0 * AGGREGAZIONE_PERIODO);
+        sostenute += sostenuta;
+        printf("%5d  %9d  %12.0f  %12.0f  %10lld  %7lld  %9.3f  %9.3f  %9.3f  %7.1f  %s\n",
+               CONFIGURAZIONI[c].nodi, CONFIGURAZIONI[c].nodi * CONFIGURAZIONI[c].stazioni,
+               e.inviate / durata, e.fuse / durata, e.pacchetti, e.persi, e.p50 * 1e3, e.p99 * 1e3,
+               e.massimo * 1e3, e.cpu / (durata + SCARICO) * 100.0, sostenuta ? "sostenuta" : "satura");
+    }
+
+    /* Nodo fermo: il limite è AGGREGAZIONE_SILENZIO più un controllo dei nodi */
+    Esito e;
+    double durata_fermo = FERMO_DOPO + AGGREGAZIONE_SILENZIO + 1.0;
+    if (prova(8, 100, 0.1, durata_fermo, 0, &e) != 0) {
+        fprintf(stderr, "Errore: prova del nodo fermo non avviata\n");
+        return 1;
+    }
+    if (e.t_ritardo >= 0.0) {
+        printf("\nNodo fermo segnato in ritardo dopo %.3f s di silenzio (limite %.1f s); ",
+               e.t_ritardo, AGGREGAZIONE_SILENZIO);
+    } else {
+        printf("\nNodo fermo mai segnato in ritardo; ");
+    }
+    printf("altri nodi non attivi: %d\n", e.altri_non_attivi);
+    printf("Configurazioni sostenute: %d su %d\n", sostenute, n_config);
+    int riavvio = prova_riavvio();
+    return (e.t_ritardo >= 0.0 && e.altri_non_attivi == 0 && riavvio == 0) ? 0 : 1;
+}
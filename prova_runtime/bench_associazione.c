@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "associazione.h"
+
+/* Associazione k-su-n:
+ *   bench_associazione [n_stazioni] [k] [n] [trigger]
+ * stazioni casuali su un'area come l'Italia (11 x 12 gradi), poi trigger
+ * di stazioni casuali a istanti crescenti, raggruppati in eventi: metà dei
+ * trigger arriva a raffica da una zona, il resto è rumore sparso. Misura
+ * la costruzione dell'indice e il costo medio di registra_trigger. */
+
+#define N_STAZIONI  5000
+#define K           3
+#define N           6
+#define N_TRIGGER   2000000
+#define VELOCITA_P  6.0      /* km/s */
+#define TOLLERANZA  1.0      /* s */
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long seme = 12345;
+static double uniforme(void) {
+    seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((seme >> 11) + 0.5) / 9007199254740992.0;
+}
+
+int main(int argc, char *argv[]) {
+    int n_stazioni = (argc > 1) ? atoi(argv[1]) : N_STAZIONI;
+    int k = (argc > 2) ? atoi(argv[2]) : K;
+    int n = (argc > 3) ? atoi(argv[3]) : N;
+    long n_trigger = (argc > 4) ? atol(argv[4]) : N_TRIGGER;
+    if (n_stazioni < 2 || k < 1 || n < k || n > ASSOCIAZIONE_MAX_VICINI || n_trigger < 1) {
+        fprintf(stderr, "Uso: %s [n_stazioni] [k] [n] [trigger]\n", argv[0]);
+        return 1;
+    }
+
+    ReteStazioni rete;
+    if (init_rete(&rete, n_stazioni, k, n, VELOCITA_P, TOLLERANZA) != 0) {
+        fprintf(stderr, "Errore: memoria insufficiente\n");
+        return 1;
+    }
+    for (int i = 0; i < n_stazioni; i++) {
+        aggiungi_stazione(&rete, 36.0 + 11.0 * uniforme(), 6.0 + 12.0 * uniforme());
+    }
+    double t0 = ora();
+    if (costruisci_indice_rete(&rete) != 0) {
+        fprintf(stderr, "Errore: indice della rete fallito\n");
+        return 1;
+    }
+    double costruzione = ora() - t0;
+
+    /* Sequenza generata prima della misura */
+    int *id = malloc((size_t)n_trigger * sizeof(int));
+    double *t = malloc((size_t)n_trigger * sizeof(double));
+    if (!id || !t) {
+        fprintf(stderr, "Errore: memoria insufficiente\n");
+        return 1;
+    }
+    double istante = 0.0;
+    int centro = 0;
+    for (long i = 0; i < n_trigger; i++) {
+        if (i % 64 == 0) {
+            centro = (int)(uniforme() * n_stazioni);
+            istante += 60.0;
+        }
+        if (uniforme() < 0.5) {
+            /* Evento: il centro e i suoi vicini, pochi decimi di secondo dopo */
+            const Postazione *c = &rete.stazioni[centro];
+            int v = (int)(uniforme() * (c->n_vicini + 1));
+            id[i] = (v < c->n_vicini) ? c->vicini[v] : centro;
+            t[i] = istante + 0.5 * uniforme();
+        } else {
+            id[i] = (int)(uniforme() * n_stazioni);
+            t[i] = istante + 30.0 * uniforme();
+        }
+    }
+
+    t0 = ora();
+    long conferme = 0;
+    for (long i = 0; i < n_trigger; i++) {
+        conferme += registra_trigger(&rete, id[i], t[i]);
+    }
+    double durata = ora() - t0;
+
+    printf("%d stazioni, k=%d su n=%d: indice in %.2f ms\n", n_stazioni, k, n, costruzione * 1e3);
+    printf("%ld trigger in %.3f ms: %.1f ns/trigger, %ld conferme\n",
+           n_trigger, durata * 1e3, durata * 1e9 / n_trigger, conferme);
+
+    free(id);
+    free(t);
+    free_rete(&rete);
+    return 0;
+}
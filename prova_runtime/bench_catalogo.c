@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "catalogo.h"
+
+/* Catalogo degli eventi:
+ *   bench_catalogo [n_record] [percorso]
+ * scrive n_record sintetici (stazioni e istanti casuali, un terzo con
+ * allarme), poi misura la prima apertura (costruzione dell'indice), la
+ * riapertura con l'indice già scritto, l'aggiornamento dopo un'aggiunta
+ * dell'1% e alcune interrogazioni, verificate contro una scansione lineare
+ * dei record. */
+
+#define N_RECORD    2000000
+#define N_STAZIONI  500
+#define DURATA      (365.0 * 86400.0)   /* s, un anno di eventi */
+#define LOTTO       4096
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long seme = 12345;
+static double uniforme(void) {
+    seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((seme >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static int scrivi(const char *percorso, long long n) {
+    ScrittoreCatalogo s;
+    if (apri_scrittore_catalogo(&s, percorso) != 0) {
+        return -1;
+    }
+    RecordCatalogo lotto[LOTTO];
+    for (long long k = 0; k < n; k += LOTTO) {
+        int m = (int)((n - k < LOTTO) ? n - k : LOTTO);
+        for (int i = 0; i < m; i++) {
+            RecordCatalogo *r = &lotto[i];
+            memset(r, 0, sizeof(*r));
+            r->t_trigger = uniforme() * DURATA;
+            r->stazione = (unsigned int)(uniforme() * N_STAZIONI);
+            r->pgd_max = 0.05 * pow(uniforme(), 3.0);
+            r->config = 0x5eed;
+            r->esito = CATALOGO_TRIGGER;
+            if (uniforme() < 1.0 / 3.0) {
+                r->esito |= CATALOGO_ALLARME;
+                r->lead_time = (float)(20.0 * uniforme());
+                r->t_allarme = r->t_trigger + 3.0;
+                r->pgd_allarme = r->pgd_max * uniforme();
+                r->prob = (float)(100.0 * uniforme());
+            }
+        }
+        if (aggiungi_catalogo(&s, lotto, m) != 0) {
+            chiudi_scrittore_catalogo(&s);
+            return -1;
+        }
+    }
+    chiudi_scrittore_catalogo(&s);
+    return 0;
+}
+
+static long long scansione(const Catalogo *c, const FiltroCatalogo *f) {
+    long long n = 0;
+    for (long long i = 0; i < c->n_record; i++) {
+        const RecordCatalogo *r = &c->record[i];
+        n += r->t_trigger >= f->t_da && r->t_trigger < f->t_a
+          && (f->stazione < 0 || r->stazione == (unsigned int)f->stazione)
+          && (r->esito & f->esito_presente) == f->esito_presente && (r->esito & f->esito_assente) == 0
+          && r->pgd_allarme >= f->pgd_min;
+    }
+    return n;
+}
+
+static double apri(Catalogo *c, const char *percorso) {
+    double t0 = ora();
+    if (apri_catalogo(c, percorso) != 0) {
+        return -1.0;
+    }
+    return ora() - t0;
+}
+
+int main(int argc, char *argv[]) {
+    long long n = (argc > 1) ? atoll(argv[1]) : N_RECORD;
+    const char *percorso = (argc > 2) ? argv[2] : "/tmp/bench_catalogo.dwk";
+    if (n < 1) {
+        fprintf(stderr, "Uso: %s [n_record] [percorso]\n", argv[0]);
+        return 1;
+    }
+    char percorso_indice[512];
+    snprintf(percorso_indice, sizeof(percorso_indice), "%s.idx", percorso);
+    unlink(percorso);
+    unlink(percorso_indice);
+
+    double t0 = ora();
+    if (scrivi(percorso, n) != 0) {
+        fprintf(stderr, "Errore: impossibile scrivere %s\n", percorso);
+        return 1;
+    }
+    double durata = ora() - t0;
+    printf("Scrittura: %lld record in %.1f ms (%.1f ns/record)\n", n, durata * 1e3, durata * 1e9 / n);
+
+    Catalogo c;
+    double costruzione = apri(&c, percorso);
+    chiudi_catalogo(&c);
+    double riapertura = apri(&c, percorso);
+    chiudi_catalogo(&c);
+    long long aggiunti = n / 100 > 0 ? n / 100 : 1;
+    if (costruzione < 0.0 || riapertura < 0.0 || scrivi(percorso, aggiunti) != 0) {
+        fprintf(stderr, "Errore: apertura di %s fallita\n", percorso);
+        return 1;
+    }
+    double aggiornamento = apri(&c, percorso);
+    if (aggiornamento < 0.0 || c.n_voci != n + aggiunti) {
+        fprintf(stderr, "Errore: aggiornamento dell'indice fallito\n");
+        return 1;
+    }
+    printf("Indice: costruzione %.1f ms, riapertura %.3f ms, aggiornamento con %lld record %.1f ms\n",
+           costruzione * 1e3, riapertura * 1e3, aggiunti, aggiornamento * 1e3);
+
+    static const struct {
+        const char *nome;
+        FiltroCatalogo f;
+    } INTERROGAZIONI[] = {
+        { "allarmi in un giorno, PGD >= 1 cm",
+          { 100.0 * 86400.0, 101.0 * 86400.0, -1, CATALOGO_ALLARME, 0, 0.01 } },
+        { "senza allarme in un'ora",
+          { 200.0 * 86400.0, 200.0 * 86400.0 + 3600.0, -1, CATALOGO_TRIGGER, CATALOGO_ALLARME, 0.0 } },
+        { "stazione 42, un mese",
+          { 30.0 * 86400.0, 60.0 * 86400.0, 42, CATALOGO_TRIGGER, 0, 0.0 } },
+        { "tutti gli allarmi",
+          { -INFINITY, INFINITY, -1, CATALOGO_ALLARME, 0, 0.0 } },
+    };
+    unsigned int *risultati = malloc((size_t)c.n_voci * sizeof(unsigned int));
+    if (!risultati) {
+        chiudi_catalogo(&c);
+        return 1;
+    }
+    int errori = 0;
+    for (size_t q = 0; q < sizeof(INTERROGAZIONI) / sizeof(INTERROGAZIONI[0]); q++) {
+        const FiltroCatalogo *f = &INTERROGAZIONI[q].f;
+        t0 = ora();
+        long long trovati = filtra_catalogo(&c, f, risultati, c.n_voci);
+        durata = ora() - t0;
+        t0 = ora();
+        long long attesi = scansione(&c, f);
+        double durata_scansione = ora() - t0;
+        errori += (trovati != attesi);
+        printf("%-36s %9lld record in %8.3f ms (scansione %8.3f ms)%s\n", INTERROGAZIONI[q].nome,
+               trovati, durata * 1e3, durata_scansione * 1e3, trovati == attesi ? "" : "  <-- diverso");
+    }
+
+    free(risultati);
+    chiudi_catalogo(&c);
+    unlink(percorso);
+    unlink(percorso_indice);
+    return errori ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "oscillatori.h"
+
+/* Banco di oscillatori:
+ *   bench_oscillatori [n_edifici] [secondi]
+ * prima confronta la ricorsione esatta con un'integrazione Runge-Kutta a
+ * passo fine del telaio completo (1 e 3 piani, tutti i modi inclusi), poi
+ * misura il costo per campione di n_edifici misti contro il budget di un
+ * campione a 200 Hz. */
+
+#define FREQUENZA   200.0
+#define N_EDIFICI   500
+#define SECONDI     60.0
+#define SOTTOPASSI  100
+#define MAX_GDL     OSCILLATORI_MAX_MODI
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Scossa sintetica deterministica, m/s^2 */
+static double suolo(double t) {
+    double inviluppo = (t < 2.0) ? t / 2.0 : exp(-(t - 2.0) / 4.0);
+    return inviluppo * (2.0 * sin(2.0 * M_PI * 1.7 * t) + 1.2 * sin(2.0 * M_PI * 4.3 * t + 0.5)
+                        + 0.6 * sin(2.0 * M_PI * 9.1 * t + 1.3));
+}
+
+/* Telaio shear-type di n piani con masse unitarie, rigidezza k e
+ * smorzamento classico (modale z su tutti i modi) */
+typedef struct {
+    int n;
+    double k;
+    double c[MAX_GDL][MAX_GDL];
+} Telaio;
+
+static void derivata(const Telaio *s, const double *x, double acc, double *dx) {
+    int n = s->n;
+    for (int i = 0; i < n; i++) {
+        double sotto = (i > 0) ? x[i] - x[i - 1] : x[i];
+        double sopra = (i < n - 1) ? x[i + 1] - x[i] : 0.0;
+        double forza = -s->k * (sotto - sopra) - acc;
+        for (int j = 0; j < n; j++) {
+            forza -= s->c[i][j] * x[n + j];
+        }
+        dx[i] = x[n + i];
+        dx[n + i] = forza;
+    }
+}
+
+static void passo_rk4(const Telaio *s, double *x, double a0, double a1, double h) {
+    int m = 2 * s->n;
+    double k1[2 * MAX_GDL], k2[2 * MAX_GDL], k3[2 * MAX_GDL], k4[2 * MAX_GDL], y[2 * MAX_GDL];
+    derivata(s, x, a0, k1);
+    for (int i = 0; i < m; i++) y[i] = x[i] + 0.5 * h * k1[i];
+    derivata(s, y, 0.5 * (a0 + a1), k2);
+    for (int i = 0; i < m; i++) y[i] = x[i] + 0.5 * h * k2[i];
+    derivata(s, y, 0.5 * (a0 + a1), k3);
+    for (int i = 0; i < m; i++) y[i] = x[i] + h * k3[i];
+    derivata(s, y, a1, k4);
+    for (int i = 0; i < m; i++) x[i] += h / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+}
+
+/* Drift massimo di riferimento con gli stessi modi del banco */
+static double drift_riferimento(int n, double periodo, double z, double secondi, int *piano) {
+    Telaio s = { .n = n };
+    double ws = 2.0 * M_PI / periodo / (2.0 * sin(M_PI / (2.0 * (2 * n + 1))));
+    s.k = ws * ws;
+    for (int j = 0; j < n; j++) {
+        double m = 2 * j + 1;
+        double w = 2.0 * ws * sin(m * M_PI / (2.0 * (2 * n + 1)));
+        double phi[MAX_GDL], norma = 0.0;
+        for (int i = 0; i < n; i++) {
+            phi[i] = sin(m * (i + 1) * M_PI / (2 * n + 1));
+            norma += phi[i] * phi[i];
+        }
+        for (int a = 0; a < n; a++)
+            for (int b = 0; b < n; b++)
+                s.c[a][b] += 2.0 * z * w * phi[a] * phi[b] / norma;
+    }
+
+    double x[2 * MAX_GDL] = { 0 };
+    double h = 1.0 / (FREQUENZA * SOTTOPASSI);
+    double massimo = 0.0;
+    long passi = (long)(secondi * FREQUENZA);
+    for (long k = 0; k < passi; k++) {
+        for (int p = 0; p < SOTTOPASSI; p++) {
+            double t = (k + (double)p / SOTTOPASSI) / FREQUENZA;
+            /* Ingresso lineare tra i campioni, come nella ricorsione */
+            double ak = suolo(k / FREQUENZA), ak1 = suolo((k + 1) / FREQUENZA);
+            double a0 = ak + (ak1 - ak) * (t * FREQUENZA - k);
+            double a1 = ak + (ak1 - ak) * (t * FREQUENZA + 1.0 / SOTTOPASSI - k);
+            passo_rk4(&s, x, a0, a1, h);
+        }
+        for (int i = 0; i < n; i++) {
+            double d = fabs(x[i] - (i > 0 ? x[i - 1] : 0.0));
+            if (d > massimo) {
+                massimo = d;
+                *piano = i + 1;
+            }
+        }
+    }
+    return massimo;
+}
+
+static void verifica(int n_piani, double periodo) {
+    const double secondi = 20.0;
+    BancoOscillatori b;
+    ConfigurazioneAllarme soglie = RC_BASSO;
+    if (init_oscillatori(&b, 1, n_piani, FREQUENZA) != 0
+        || aggiungi_oscillatore(&b, periodo, OSCILLATORI_SMORZAMENTO, n_piani, &soglie) != 0) {
+        fprintf(stderr, "Errore: banco non valido\n");
+        exit(1);
+    }
+    avanza_oscillatori(&b, suolo(0.0));
+    for (long k = 1; k < (long)(secondi * FREQUENZA); k++) {
+        avanza_oscillatori(&b, suolo(k / FREQUENZA));
+    }
+    int piano, piano_rif = 0;
+    double drift = drift_edificio_oscillatori(&b, 0, &piano);
+    double rif = drift_riferimento(n_piani, periodo, OSCILLATORI_SMORZAMENTO, secondi, &piano_rif);
+    printf("%d piani, T1=%.2f s: drift %.6e m al piano %d, Runge-Kutta %.6e m al piano %d (errore %.1e)\n",
+           n_piani, periodo, drift, piano, rif, piano_rif, fabs(drift - rif) / rif);
+    free_oscillatori(&b);
+}
+
+int main(int argc, char *argv[]) {
+    int n_edifici = (argc > 1) ? atoi(argv[1]) : N_EDIFICI;
+    double secondi = (argc > 2) ? atof(argv[2]) : SECONDI;
+    if (n_edifici < 1 || secondi <= 0.0) {
+        fprintf(stderr, "Uso: %s [n_edifici] [secondi]\n", argv[0]);
+        return 1;
+    }
+
+    /* La ricorsione parte da a(-1) = 0 come il banco: il primo campione
+     * della scossa sintetica è nullo */
+    verifica(1, 0.4);
+    verifica(3, 0.39);
+    verifica(3, 1.2);
+
+    static const char *const TIPOLOGIE[] = { "RC", "URM_REG", "URM_STONE" };
+    BancoOscillatori b;
+    if (init_oscillatori(&b, n_edifici, 8, FREQUENZA) != 0) {
+        return 1;
+    }
+    for (int e = 0; e < n_edifici; e++) {
+        aggiungi_edificio_oscillatori(&b, TIPOLOGIE[e % 3], 1 + (e * 7 / 3) % 8);
+    }
+
+    long n_campioni = (long)(secondi * FREQUENZA);
+    double t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        avanza_oscillatori(&b, suolo(k / FREQUENZA));
+    }
+    double durata = ora() - t0;
+    int superamenti[3];
+    conta_superamenti_oscillatori(&b, superamenti);
+
+    double per_campione = durata / n_campioni;
+    printf("%d edifici (fino a 8 piani), %ld campioni: %.2f us/campione, %.1f ns/edificio, "
+           "%.2f%% del periodo di campionamento\n",
+           b.n_edifici, n_campioni, per_campione * 1e6, per_campione * 1e9 / b.n_edifici,
+           per_campione * FREQUENZA * 100.0);
+    printf("Oltre soglia MDS %d, EDS %d, CDS %d\n", superamenti[0], superamenti[1], superamenti[2]);
+    free_oscillatori(&b);
+    return 0;
+}
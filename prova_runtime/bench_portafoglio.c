@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "allarme.h"
+#include "portafoglio.h"
+
+/* Fragilità su un portafoglio di edifici:
+ *   bench_portafoglio [n_edifici] [n_stazioni] [ripetizioni]
+ * inventario sintetico (tipologie e piani casuali, stazione più vicina
+ * casuale) e PGD log-uniformi tra 0.01 e 20 cm. Misura valuta_portafoglio
+ * (miglior tempo su ripetizioni) e il ciclo scalare con
+ * get_configurazione e calcola_probabilita_previsiva per edificio, poi
+ * confronta probabilità e decisioni di superamento dei due percorsi. */
+
+#define N_EDIFICI     500000
+#define N_STAZIONI    2000
+#define RIPETIZIONI   20
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long seme = 12345;
+static double uniforme(void) {
+    seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((seme >> 11) + 0.5) / 9007199254740992.0;
+}
+
+int main(int argc, char *argv[]) {
+    int n_edifici = (argc > 1) ? atoi(argv[1]) : N_EDIFICI;
+    int n_stazioni = (argc > 2) ? atoi(argv[2]) : N_STAZIONI;
+    int ripetizioni = (argc > 3) ? atoi(argv[3]) : RIPETIZIONI;
+    if (n_edifici < 1 || n_stazioni < 1 || ripetizioni < 1) {
+        fprintf(stderr, "Uso: %s [n_edifici] [n_stazioni] [ripetizioni]\n", argv[0]);
+        return 1;
+    }
+
+    Portafoglio p;
+    double *pgd = malloc((size_t)n_stazioni * sizeof(double));
+    float *scalare = malloc((size_t)n_edifici * 3 * sizeof(float));
+    if (!pgd || !scalare || init_portafoglio(&p, n_edifici) != 0) {
+        fprintf(stderr, "Errore: memoria insufficiente\n");
+        return 1;
+    }
+    for (int i = 0; i < n_edifici; i++) {
+        Tipologia t = (Tipologia)(uniforme() * N_TIPOLOGIE);
+        aggiungi_edificio(&p, t, 1 + (int)(uniforme() * 8), 36.0 + 11.0 * uniforme(), 6.0 + 12.0 * uniforme(),
+                          (int)(uniforme() * n_stazioni));
+    }
+    for (int s = 0; s < n_stazioni; s++) {
+        pgd[s] = 1e-4 * pow(10.0, 3.3 * uniforme());
+    }
+
+    double migliore = INFINITY;
+    for (int r = 0; r < ripetizioni; r++) {
+        double t0 = ora();
+        if (valuta_portafoglio(&p, pgd, n_stazioni) != 0) {
+            fprintf(stderr, "Errore: valutazione fallita\n");
+            return 1;
+        }
+        migliore = fmin(migliore, ora() - t0);
+    }
+
+    /* Percorso scalare: la configurazione risolta per nome a ogni edificio */
+    double t0 = ora();
+    int superamenti[3] = { 0, 0, 0 };
+    for (int i = 0; i < n_edifici; i++) {
+        const ConfigurazioneAllarme *c = get_configurazione(nome_tipologia((Tipologia)p.tipologia[i]), p.n_piani[i]);
+        double x = pgd[p.stazione[i]];
+        scalare[3 * i]     = (float)calcola_probabilita_previsiva(x, c->mds);
+        scalare[3 * i + 1] = (float)calcola_probabilita_previsiva(x, c->eds);
+        scalare[3 * i + 2] = (float)calcola_probabilita_previsiva(x, c->cds);
+        superamenti[0] += scalare[3 * i] >= c->p_mds;
+        superamenti[1] += scalare[3 * i + 1] >= c->p_eds;
+        superamenti[2] += scalare[3 * i + 2] >= c->p_cds;
+    }
+    double durata_scalare = ora() - t0;
+
+    double errore = 0.0;
+    long long diverse = 0;
+    for (int i = 0; i < n_edifici; i++) {
+        const ConfigurazioneAllarme *c = get_configurazione(nome_tipologia((Tipologia)p.tipologia[i]), p.n_piani[i]);
+        const float v[3] = { p.p_mds[i], p.p_eds[i], p.p_cds[i] };
+        const double soglie[3] = { c->p_mds, c->p_eds, c->p_cds };
+        for (int k = 0; k < 3; k++) {
+            errore = fmax(errore, fabs(v[k] - scalare[3 * i + k]));
+            diverse += (v[k] >= soglie[k]) != (scalare[3 * i + k] >= soglie[k]);
+        }
+    }
+
+    printf("%d edifici, %d stazioni\n", n_edifici, n_stazioni);
+    printf("valuta_portafoglio: %8.3f ms (%.2f ns/edificio), migliore su %d\n",
+           migliore * 1e3, migliore * 1e9 / n_edifici, ripetizioni);
+    printf("Scalare:            %8.3f ms (%.2f ns/edificio)\n", durata_scalare * 1e3, durata_scalare * 1e9 / n_edifici);
+    printf("Superamenti MDS/EDS/CDS: %d/%d/%d (scalare %d/%d/%d)\n", p.n_superamenti[0], p.n_superamenti[1],
+           p.n_superamenti[2], superamenti[0], superamenti[1], superamenti[2]);
+    printf("Differenza massima: %.2e punti percentuali, decisioni diverse: %lld\n", errore, diverse);
+
+    free_portafoglio(&p);
+    free(pgd);
+    free(scalare);
+    return (errore <= 1e-4 && diverse == 0) ? 0 : 1;
+}
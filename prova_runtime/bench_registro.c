@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "registro.h"
+
+/* Costo di una chiamata al registro dal punto di vista del thread che
+ * elabora i campioni:
+ *   bench_registro [n_thread] [raffiche]
+ * ogni thread scrive raffiche di RAFFICA messaggi (come molte stazioni che
+ * scattano insieme) separate da una pausa. Tre uscite: printf diretto su
+ * /dev/null, registro su /dev/null, registro su una pipe che nessuno legge,
+ * dove printf resterebbe bloccato e il registro deve solo perdere messaggi.
+ * Infine SUCCESSIVI thread uno dopo l'altro, più di REGISTRO_MAX_THREAD:
+ * gli anelli dei thread usciti vanno riusati, nessun messaggio perso. */
+
+#define N_THREAD   4
+#define RAFFICHE   200
+#define RAFFICA    100
+#define PAUSA_NS   2000000L
+#define SUCCESSIVI (4 * REGISTRO_MAX_THREAD)
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    int diretto;          /* 1: fprintf su uscita invece del registro */
+    FILE *uscita;
+    int raffiche;
+    double tempo;         /* s dentro le raffiche */
+    double peggiore;      /* s per messaggio, raffica più lenta */
+} Produttore;
+
+static void *produci(void *arg) {
+    Produttore *p = arg;
+    struct timespec pausa = { 0, PAUSA_NS };
+    if (!p->diretto) {
+        iscrivi_thread_registro();
+    }
+    long long k = 0;
+    for (int b = 0; b < p->raffiche; b++) {
+        double t0 = ora();
+        for (int i = 0; i < RAFFICA; i++, k++) {
+            if (p->diretto) {
+                fprintf(p->uscita, "Trigger rilevato a: %.3f s (campione %lld)\n", k / 200.0, k);
+            } else {
+                REGISTRA(REGISTRO_INFO, "Trigger rilevato a: %.3f s (campione %lld)\n",
+                         REGISTRO_REALE(k / 200.0), REGISTRO_INTERO(k));
+            }
+        }
+        double dt = ora() - t0;
+        p->tempo += dt;
+        if (dt / RAFFICA > p->peggiore) {
+            p->peggiore = dt / RAFFICA;
+        }
+        nanosleep(&pausa, NULL);
+    }
+    return NULL;
+}
+
+static void misura(const char *nome, int diretto, FILE *uscita, int n_thread, int raffiche) {
+    Produttore p[REGISTRO_MAX_THREAD];
+    pthread_t t[REGISTRO_MAX_THREAD];
+    long long persi_prima = messaggi_persi_registro();
+    if (!diretto) {
+        avvia_registro(uscita, 1);
+    }
+    for (int i = 0; i < n_thread; i++) {
+        p[i] = (Produttore){ diretto, uscita, raffiche, 0.0, 0.0 };
+        pthread_create(&t[i], NULL, produci, &p[i]);
+    }
+    double tempo = 0.0, peggiore = 0.0;
+    for (int i = 0; i < n_thread; i++) {
+        pthread_join(t[i], NULL);
+        tempo += p[i].tempo;
+        if (p[i].peggiore > peggiore) peggiore = p[i].peggiore;
+    }
+    long long totale = (long long)n_thread * raffiche * RAFFICA;
+    long long persi = messaggi_persi_registro() - persi_prima;
+    printf("%-28s %8.1f ns/messaggio (raffica peggiore %8.1f), persi %lld su %lld\n",
+           nome, tempo * 1e9 / totale, peggiore * 1e9, diretto ? 0 : persi, totale);
+    fflush(stdout);
+}
+
+static void *un_messaggio(void *arg) {
+    REGISTRA(REGISTRO_INFO, "thread %d\n", REGISTRO_INTERO(*(int *)arg));
+    return NULL;
+}
+
+/* Ritorna i messaggi persi */
+static long long thread_successivi(FILE *uscita) {
+    long long persi_prima = messaggi_persi_registro();
+    avvia_registro(uscita, 1);
+    for (int i = 0; i < SUCCESSIVI; i++) {
+        pthread_t t;
+        pthread_create(&t, NULL, un_messaggio, &i);
+        pthread_join(t, NULL);
+        svuota_registro();
+    }
+    ferma_registro();
+    long long persi = messaggi_persi_registro() - persi_prima;
+    printf("%-28s persi %lld su %d\n", "thread in sequenza", persi, SUCCESSIVI);
+    return persi;
+}
+
+static void *leggi_pipe(void *arg) {
+    int fd = *(int *)arg;
+    char buf[65536];
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int n_thread = (argc > 1) ? atoi(argv[1]) : N_THREAD;
+    int raffiche = (argc > 2) ? atoi(argv[2]) : RAFFICHE;
+    if (n_thread < 1 || n_thread >= REGISTRO_MAX_THREAD / 4 || raffiche < 1) {
+        fprintf(stderr, "Uso: %s [n_thread < %d] [raffiche]\n", argv[0], REGISTRO_MAX_THREAD / 4);
+        return 1;
+    }
+
+    FILE *nulla = fopen("/dev/null", "w");
+    int fd[2];
+    if (!nulla || pipe(fd) != 0) {
+        return 1;
+    }
+    FILE *bloccata = fdopen(fd[1], "w");
+
+    printf("%d thread, %d raffiche da %d messaggi\n", n_thread, raffiche, RAFFICA);
+    misura("printf, /dev/null", 1, nulla, n_thread, raffiche);
+    misura("registro, /dev/null", 0, nulla, n_thread, raffiche);
+    ferma_registro();
+
+    /* Il formattatore si blocca sulla pipe piena; i produttori no */
+    misura("registro, pipe bloccata", 0, bloccata, n_thread, raffiche);
+    pthread_t lettore;
+    pthread_create(&lettore, NULL, leggi_pipe, &fd[0]);
+    ferma_registro();
+    fclose(bloccata);
+    pthread_join(lettore, NULL);
+    close(fd[0]);
+
+    long long persi = thread_successivi(nulla);
+    fclose(nulla);
+    return persi ? 1 : 0;
+}
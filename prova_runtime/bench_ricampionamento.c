@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ricampionamento.h"
+
+/* Ricampionatore:
+ *   bench_ricampionamento [secondi]
+ * prima verifica che i rapporti fuori dominio siano rifiutati (frequenze
+ * che arrotondano a 0 mHz, NaN, L o M ridotti troppo grandi), poi che una
+ * sinusoide in banda passi con ampiezza unitaria e il numero atteso di
+ * uscite, infine misura il costo per campione di ingresso. */
+
+#define SECONDI 600.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    double fs_in, fs_out;
+    const char *motivo;
+} Rifiutato;
+
+static const Rifiutato RIFIUTATI[] = {
+    { 0.0004, 200.0, "ingresso a 0 mHz" },
+    { 200.0, 0.0004, "uscita a 0 mHz" },
+    { 0.0, 200.0, "ingresso nullo" },
+    { -100.0, 200.0, "ingresso negativo" },
+    { NAN, 200.0, "ingresso NaN" },
+    { 200.0, INFINITY, "uscita infinita" },
+    { 1.0, 200.0, "L = 200" },
+    { 200.0, 0.1, "M = 2000" },
+    { 100.001, 100.0, "L = 100000" },
+};
+
+typedef struct {
+    double fs_in, fs_out;
+} Accettato;
+
+static const Accettato ACCETTATI[] = {
+    { 100.0, 200.0 },
+    { 250.0, 200.0 },
+    { 1000.0, 200.0 },
+    { 200.0, 200.0 },
+    { 0.5, 1.0 },
+};
+
+/* Sinusoide di 16 campioni di uscita per periodo, in banda per tutti i
+ * rapporti provati: ampiezza dal valore efficace su periodi interi dopo il
+ * transitorio */
+#define CAMPIONI_PERIODO 16
+
+static int verifica_sinusoide(double fs_in, double fs_out, double *ampiezza, long *uscite) {
+    CoeffRicampionatore c;
+    StatoRicampionatore s;
+    if (calcola_coeff_ricampionatore(fs_in, fs_out, &c) != 0) {
+        return -1;
+    }
+    if (init_ricampionatore(&s, &c) != 0) {
+        free_coeff_ricampionatore(&c);
+        return -1;
+    }
+
+    double f = fs_out / CAMPIONI_PERIODO;
+    long n_in = (long)(200.0 * fs_in / f);
+    double *out = malloc(max_uscite_ricampionatore(&c) * sizeof(double));
+    long transitorio = CAMPIONI_PERIODO * ((long)(2.0 * c.ritardo_gruppo * fs_out) / CAMPIONI_PERIODO + 1);
+    double *coda = malloc(CAMPIONI_PERIODO * sizeof(double));
+    double energia = 0.0;
+    long n_energia = 0;
+    *uscite = 0;
+    for (long k = 0; k < n_in; k++) {
+        int n = ricampiona_campione(sin(2.0 * M_PI * f * k / fs_in), &c, &s, out);
+        for (int i = 0; i < n; i++, (*uscite)++) {
+            if (*uscite < transitorio) {
+                continue;
+            }
+            /* Il periodo in corso conta solo quando è completo */
+            coda[(*uscite - transitorio) % CAMPIONI_PERIODO] = out[i];
+            if ((*uscite - transitorio) % CAMPIONI_PERIODO == CAMPIONI_PERIODO - 1) {
+                for (int j = 0; j < CAMPIONI_PERIODO; j++) {
+                    energia += coda[j] * coda[j];
+                }
+                n_energia += CAMPIONI_PERIODO;
+            }
+        }
+    }
+    *ampiezza = n_energia > 0 ? sqrt(2.0 * energia / n_energia) : 0.0;
+
+    free(coda);
+    free(out);
+    free_ricampionatore(&s);
+    free_coeff_ricampionatore(&c);
+    return 0;
+}
+
+static double costo(double fs_in, double fs_out, double secondi) {
+    CoeffRicampionatore c;
+    StatoRicampionatore s;
+    if (calcola_coeff_ricampionatore(fs_in, fs_out, &c) != 0 || init_ricampionatore(&s, &c) != 0) {
+        return -1.0;
+    }
+
+    long n_in = (long)(secondi * fs_in);
+    double *out = malloc(max_uscite_ricampionatore(&c) * sizeof(double));
+    volatile double pozzo = 0.0;
+    unsigned long long seme = 12345;
+    double t0 = ora();
+    for (long k = 0; k < n_in; k++) {
+        seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+        int n = ricampiona_campione((double)(seme >> 11) / 9007199254740992.0 - 0.5, &c, &s, out);
+        if (n > 0) {
+            pozzo += out[n - 1];
+        }
+    }
+    double t = ora() - t0;
+
+    free(out);
+    free_ricampionatore(&s);
+    free_coeff_ricampionatore(&c);
+    return t / n_in * 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    double secondi = (argc > 1) ? atof(argv[1]) : SECONDI;
+    int errori = 0;
+
+    printf("Rapporti rifiutati:\n");
+    for (size_t i = 0; i < sizeof(RIFIUTATI) / sizeof(RIFIUTATI[0]); i++) {
+        const Rifiutato *r = &RIFIUTATI[i];
+        CoeffRicampionatore c;
+        int esito = calcola_coeff_ricampionatore(r->fs_in, r->fs_out, &c);
+        if (esito == 0) {
+            free_coeff_ricampionatore(&c);
+            errori++;
+        }
+        printf("  %10g -> %-10g  %-20s %s\n", r->fs_in, r->fs_out, r->motivo,
+               esito == 0 ? "ACCETTATO" : "rifiutato");
+    }
+
+    printf("\nSinusoide in banda:\n");
+    for (size_t i = 0; i < sizeof(ACCETTATI) / sizeof(ACCETTATI[0]); i++) {
+        const Accettato *a = &ACCETTATI[i];
+        double ampiezza;
+        long uscite;
+        if (verifica_sinusoide(a->fs_in, a->fs_out, &ampiezza, &uscite) != 0) {
+            printf("  %10g -> %-10g  RIFIUTATO\n", a->fs_in, a->fs_out);
+            errori++;
+            continue;
+        }
+        long attese = 200 * CAMPIONI_PERIODO;
+        int ok = fabs(ampiezza - 1.0) < 1e-3 && labs(uscite - attese) <= 1;
+        if (!ok) {
+            errori++;
+        }
+        printf("  %10g -> %-10g  ampiezza %.6f, uscite %ld su %ld  %s\n",
+               a->fs_in, a->fs_out, ampiezza, uscite, attese, ok ? "ok" : "ERRATO");
+    }
+
+    printf("\nCosto (%.0f s di segnale):\n", secondi);
+    for (size_t i = 0; i < sizeof(ACCETTATI) / sizeof(ACCETTATI[0]); i++) {
+        const Accettato *a = &ACCETTATI[i];
+        printf("  %10g -> %-10g  %7.1f ns/campione\n", a->fs_in, a->fs_out,
+               costo(a->fs_in, a->fs_out, secondi));
+    }
+
+    printf("\n%s\n", errori ? "ERRORI" : "tutto ok");
+    return errori ? 1 : 0;
+}
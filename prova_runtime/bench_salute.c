@@ -0,0 +1,228 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "salute.h"
+#include "costanti.h"
+
+/* Monitor di salute:
+ *   bench_salute [n_stazioni] [secondi]
+ * prima verifica la PSD (Parseval su rumore bianco più una sinusoide) e le
+ * diagnosi su canali guasti sintetici, poi misura il costo per campione
+ * del produttore con il thread di analisi attivo, contro una copia nuda, e
+ * la capacità dell'analisi in blocchi al secondo; infine lo stesso flusso
+ * senza thread, con l'analisi sincrona. */
+
+#define FREQUENZA   200.0
+#define N_STAZIONI  200
+#define SECONDI     600.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum { SANO, SATURATO, PIATTO, LACUNA, SPOSTATO, RUMOROSO, N_CANALI };
+
+static const char *const NOMI_CANALE[N_CANALI] = {
+    "sano", "saturato", "piatto", "lacuna", "offset", "rumoroso"
+};
+static const int ATTESO[N_CANALI] = {
+    0, SALUTE_SATURAZIONE, SALUTE_PIATTO, SALUTE_LACUNA, SALUTE_OFFSET, SALUTE_RUMORE
+};
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Gaussiana di Box-Muller su un generatore lineare congruenziale */
+static unsigned long long seme = 12345;
+static double gaussiana(void) {
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+        u[i] = ((seme >> 11) + 0.5) / 9007199254740992.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+/* Campione k del canale, g */
+static double canale(int tipo, long k) {
+    double rumore = 2e-4 * gaussiana();
+    double t = k / FREQUENZA;
+    switch (tipo) {
+    case SATURATO: return (k % 700 == 300) ? 2.0 : rumore;
+    case PIATTO:   return (k % SALUTE_CAMPIONI_BLOCCO < 400) ? 0.0123 : rumore;
+    case LACUNA:   return (k % SALUTE_CAMPIONI_BLOCCO == 10) ? NAN : rumore;
+    case SPOSTATO: return 0.08 + rumore;
+    case RUMOROSO: return 20.0 * rumore + 0.01 * sin(2.0 * M_PI * 5.0 * t);
+    default:       return rumore;
+    }
+}
+
+static int verifica_psd(void) {
+    ConfigSalute c;
+    MonitorSalute m;
+    config_salute(&c, FREQUENZA);
+    if (init_salute(&m, &c, 1) != 0) {
+        return -1;
+    }
+    /* Quattro blocchi: la coda basta anche senza thread */
+    const double sigma = 1e-3, ampiezza = 2e-3;
+    long n = SALUTE_BLOCCHI_CODA * SALUTE_CAMPIONI_BLOCCO;
+    for (long k = 0; k < n; k++) {
+        campione_salute(&m, 0, k, sigma * gaussiana() + ampiezza * sin(2.0 * M_PI * 12.5 * k / FREQUENZA));
+    }
+    ferma_salute(&m);
+
+    const double *psd = psd_salute(&m, 0);
+    double df = FREQUENZA / SALUTE_N_FFT, totale = 0.0, base = 0.0;
+    int picco = 0, n_base = 0;
+    for (int k = 0; k <= SALUTE_N_FFT / 2; k++) {
+        totale += psd[k] * df;
+        if (psd[k] > psd[picco]) picco = k;
+        if (k * df > 30.0 && k * df < 90.0) {
+            base += psd[k];
+            n_base++;
+        }
+    }
+    double varianza = (sigma * sigma + ampiezza * ampiezza / 2.0) * G * G;
+    double bianco = 2.0 * sigma * sigma * G * G / FREQUENZA;
+    printf("PSD: integrale %.4e, varianza %.4e (rapporto %.3f); picco a %.2f Hz; "
+           "fondo %.1f dB, atteso %.1f dB rel (m/s^2)^2/Hz\n",
+           totale, varianza, totale / varianza, picco * df,
+           10.0 * log10(base / n_base), 10.0 * log10(bianco));
+    free_salute(&m);
+    return 0;
+}
+
+static int verifica_diagnosi(void) {
+    ConfigSalute c;
+    MonitorSalute m;
+    config_salute(&c, FREQUENZA);
+    if (init_salute(&m, &c, N_CANALI) != 0) {
+        return -1;
+    }
+    long n = SALUTE_BLOCCHI_CODA * SALUTE_CAMPIONI_BLOCCO;
+    for (int s = 0; s < N_CANALI; s++) {
+        for (long k = 0; k < n; k++) {
+            campione_salute(&m, s, k, canale(s, k));
+        }
+    }
+    ferma_salute(&m);
+
+    int errori = 0;
+    for (int s = 0; s < N_CANALI; s++) {
+        RapportoSalute r;
+        char diagnosi[96];
+        rapporto_salute(&m, s, &r);
+        descrivi_salute(r.stato, diagnosi, sizeof(diagnosi));
+        int ok = (r.stato == ATTESO[s]);
+        errori += !ok;
+        printf("Canale %-9s: %-12s veto %d, rumore %.2e g rms, offset %+.2e g%s\n",
+               NOMI_CANALE[s], diagnosi, atomic_load(veto_salute(&m, s)), r.rumore, r.offset,
+               ok ? "" : "  <-- atteso diverso");
+    }
+    free_salute(&m);
+    return errori;
+}
+
+int main(int argc, char *argv[]) {
+    int n_stazioni = (argc > 1) ? atoi(argv[1]) : N_STAZIONI;
+    double secondi = (argc > 2) ? atof(argv[2]) : SECONDI;
+    if (n_stazioni < 1 || secondi <= 0.0) {
+        fprintf(stderr, "Uso: %s [n_stazioni] [secondi]\n", argv[0]);
+        return 1;
+    }
+
+    if (verifica_psd() != 0 || verifica_diagnosi() != 0) {
+        fprintf(stderr, "Errore: verifica fallita\n");
+        return 1;
+    }
+
+    /* Un campione per stazione alla volta, come nel replay */
+    long n_campioni = (long)(secondi * FREQUENZA);
+    double *segnale = malloc(8192 * sizeof(double));
+    double *copia = malloc((size_t)n_stazioni * SALUTE_CAMPIONI_BLOCCO * sizeof(double));
+    if (!segnale || !copia) {
+        return 1;
+    }
+    for (int i = 0; i < 8192; i++) {
+        segnale[i] = canale(SANO, i);
+    }
+
+    double t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        for (int s = 0; s < n_stazioni; s++) {
+            copia[(size_t)s * SALUTE_CAMPIONI_BLOCCO + k % SALUTE_CAMPIONI_BLOCCO] = segnale[(k + s) & 8191];
+        }
+    }
+    double durata_copia = ora() - t0;
+    volatile double pozzo = copia[n_stazioni / 2];
+    (void)pozzo;
+
+    ConfigSalute c;
+    MonitorSalute m;
+    config_salute(&c, FREQUENZA);
+    if (init_salute(&m, &c, n_stazioni) != 0 || avvia_salute(&m) != 0) {
+        return 1;
+    }
+    t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        for (int s = 0; s < n_stazioni; s++) {
+            campione_salute(&m, s, k, segnale[(k + s) & 8191]);
+        }
+    }
+    double durata = ora() - t0;
+    ferma_salute(&m);
+
+    long long blocchi = 0, scartati = 0;
+    int guaste = 0;
+    for (int s = 0; s < n_stazioni; s++) {
+        RapportoSalute r;
+        rapporto_salute(&m, s, &r);
+        blocchi += r.blocchi;
+        scartati += r.scartati;
+        guaste += (r.stato != 0);
+    }
+    double campioni = (double)n_campioni * n_stazioni;
+    /* Il produttore corre molto più del tempo reale: gli scarti misurano
+     * solo quanto l'analisi resta indietro a questa velocità */
+    printf("%d stazioni, %ld campioni ciascuna: %.2f ns/campione (copia nuda %.2f ns), "
+           "%lld blocchi analizzati, %lld scartati, %d stazioni con diagnosi\n",
+           n_stazioni, n_campioni, durata * 1e9 / campioni, durata_copia * 1e9 / campioni,
+           blocchi, scartati, guaste);
+    printf("Analisi: %.0f blocchi/s, in tempo reale ne arrivano %.1f/s\n",
+           blocchi / durata, n_stazioni * FREQUENZA / SALUTE_CAMPIONI_BLOCCO);
+    free_salute(&m);
+
+    /* Senza thread, come da file e nel replay: analisi a fine blocco nel
+     * produttore, nessuno scarto */
+    if (init_salute(&m, &c, n_stazioni) != 0) {
+        return 1;
+    }
+    t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        for (int s = 0; s < n_stazioni; s++) {
+            campione_salute(&m, s, k, segnale[(k + s) & 8191]);
+        }
+    }
+    durata = ora() - t0;
+    blocchi = scartati = 0;
+    for (int s = 0; s < n_stazioni; s++) {
+        RapportoSalute r;
+        rapporto_salute(&m, s, &r);
+        blocchi += r.blocchi;
+        scartati += r.scartati;
+    }
+    printf("Sincrono: %.2f ns/campione con l'analisi, %lld blocchi analizzati, %lld scartati\n",
+           durata * 1e9 / campioni, blocchi, scartati);
+    free_salute(&m);
+    free(segnale);
+    free(copia);
+    return 0;
+}
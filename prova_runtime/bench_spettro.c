@@ -0,0 +1,139 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "spettro.h"
+#include "oscillatori.h"
+#include "filter.h"
+
+/* Spettro di risposta:
+ *   bench_spettro [n_periodi] [secondi]
+ * prima confronta gli spostamenti massimi del banco multirate con la
+ * ricorsione a stato (q, q') di oscillatori.h a piena frequenza sugli
+ * stessi periodi: la differenza viene dai picchi campionati più radi e
+ * deve restare entro 1 - cos(pi / SPETTRO_CAMPIONI_PERIODO) più l'1%. Poi
+ * misura il costo per campione del banco contro quello di un biquad di
+ * filter.h (applica_filtro) e contro il budget di un campione a 200 Hz. */
+
+#define FREQUENZA   200.0
+#define N_PERIODI   100
+#define SECONDI     60.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Scossa sintetica deterministica, m/s^2 */
+static double suolo(double t) {
+    double inviluppo = (t < 2.0) ? t / 2.0 : exp(-(t - 2.0) / 4.0);
+    return inviluppo * (2.0 * sin(2.0 * M_PI * 1.7 * t) + 1.2 * sin(2.0 * M_PI * 4.3 * t + 0.5)
+                        + 0.6 * sin(2.0 * M_PI * 9.1 * t + 1.3));
+}
+
+static double verifica(int n_periodi) {
+    const double secondi = 20.0;
+    SpettroRisposta s;
+    BancoOscillatori b;
+    ConfigurazioneAllarme soglie = RC_BASSO;
+    if (init_spettro(&s, n_periodi, SPETTRO_T_MIN, SPETTRO_T_MAX, SPETTRO_SMORZAMENTO, FREQUENZA) != 0
+        || init_oscillatori(&b, n_periodi, 1, FREQUENZA) != 0) {
+        fprintf(stderr, "Errore: spettro non valido\n");
+        exit(1);
+    }
+    for (int i = 0; i < n_periodi; i++) {
+        aggiungi_oscillatore(&b, s.periodo[i], SPETTRO_SMORZAMENTO, 1, &soglie);
+    }
+    for (long k = 0; k < (long)(secondi * FREQUENZA); k++) {
+        double a = suolo(k / FREQUENZA);
+        avanza_spettro(&s, a);
+        avanza_oscillatori(&b, a);
+    }
+
+    /* Con un piano il drift è lo spostamento relativo dell'oscillatore */
+    double errore = 0.0;
+    int i_picco = 0;
+    for (int i = 0; i < n_periodi; i++) {
+        double rif = drift_edificio_oscillatori(&b, i, NULL);
+        double e = fabs(s.sd[i] - rif) / rif;
+        errore = (e > errore) ? e : errore;
+        if (s.sd[i] * s.omega2[i] > s.sd[i_picco] * s.omega2[i_picco]) {
+            i_picco = i;
+        }
+    }
+    printf("%d periodi in [%.2f, %.2f] s su %d livelli: errore massimo su SD %.1e, "
+           "PSA massima %.3f m/s^2 a T=%.3f s\n",
+           n_periodi, SPETTRO_T_MIN, SPETTRO_T_MAX, s.n_livelli, errore,
+           s.sd[i_picco] * s.omega2[i_picco], s.periodo[i_picco]);
+    free_oscillatori(&b);
+    free_spettro(&s);
+    return errore;
+}
+
+int main(int argc, char *argv[]) {
+    int n_periodi = (argc > 1) ? atoi(argv[1]) : N_PERIODI;
+    double secondi = (argc > 2) ? atof(argv[2]) : SECONDI;
+    if (n_periodi < 1 || n_periodi > SPETTRO_MAX_PERIODI || secondi <= 0.0) {
+        fprintf(stderr, "Uso: %s [n_periodi] [secondi]\n", argv[0]);
+        return 1;
+    }
+
+    double tolleranza = 1.0 - cos(M_PI / SPETTRO_CAMPIONI_PERIODO) + 0.01;
+    if (verifica(20) > tolleranza || verifica(n_periodi) > tolleranza) {
+        fprintf(stderr, "Errore: spettro oltre la tolleranza %.1e\n", tolleranza);
+        return 1;
+    }
+
+    long n_campioni = (long)(secondi * FREQUENZA);
+    double *ingresso = malloc(n_campioni * sizeof(double));
+    if (!ingresso) {
+        return 1;
+    }
+    for (long k = 0; k < n_campioni; k++) {
+        ingresso[k] = suolo(k / FREQUENZA);
+    }
+
+    /* Riferimento: un biquad passa-alto, un campione per chiamata */
+    CoeffFiltro coeff;
+    StatoFiltro stato;
+    calcola_coeff_highpass(FREQUENZA, 0.075, &coeff);
+    reset_stato_filtro(&stato);
+    volatile double uscita = 0.0;
+    double t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        uscita = applica_filtro(ingresso[k], &coeff, &stato);
+    }
+    double durata_biquad = (ora() - t0) / n_campioni;
+    (void)uscita;
+
+    SpettroRisposta s;
+    if (init_spettro(&s, n_periodi, SPETTRO_T_MIN, SPETTRO_T_MAX, SPETTRO_SMORZAMENTO, FREQUENZA) != 0) {
+        free(ingresso);
+        return 1;
+    }
+    t0 = ora();
+    for (long k = 0; k < n_campioni; k++) {
+        avanza_spettro(&s, ingresso[k]);
+    }
+    double per_campione = (ora() - t0) / n_campioni;
+
+    /* Aggiornamenti di colonna per campione, come periodi a piena frequenza */
+    double colonne = 0.0;
+    for (int j = 0; j < s.n_livelli; j++) {
+        colonne += (double)(s.inizio[j + 1] - s.inizio[j]) / (1 << j);
+    }
+    printf("%d periodi (come %.1f a piena frequenza), %ld campioni: %.1f ns/campione, %.2f ns/periodo, "
+           "pari a %.1f biquad (%.1f ns), %.3f%% del periodo di campionamento\n",
+           s.n_periodi, colonne, n_campioni, per_campione * 1e9, per_campione * 1e9 / s.n_periodi,
+           per_campione / durata_biquad, durata_biquad * 1e9, per_campione * FREQUENZA * 100.0);
+    free_spettro(&s);
+    free(ingresso);
+    return 0;
+}
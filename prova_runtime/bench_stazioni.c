@@ -0,0 +1,107 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dosews.h"
+
+/* Creazione di molte stazioni sullo stesso processo:
+ *   bench_stazioni [n_stazioni]
+ * confronta init_dosews (buffer allocati per stazione) con init_dosews_arena
+ * su un unico blocco, poi fa girare un secondo di rumore su tutte le
+ * stazioni per verificare che i due percorsi diano lo stesso stato. */
+
+#define FREQUENZA        200.0
+#define N_STAZIONI       10000
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Rumore deterministico, stesso per tutte le stazioni */
+static double rumore(unsigned int *seme) {
+    *seme = *seme * 1103515245u + 12345u;
+    return ((double)(*seme >> 8) / 16777216.0 - 0.5) * 1e-4;
+}
+
+int main(int argc, char *argv[]) {
+    int n_stazioni = (argc > 1) ? atoi(argv[1]) : N_STAZIONI;
+    if (n_stazioni < 1) {
+        fprintf(stderr, "Uso: %s [n_stazioni]\n", argv[0]);
+        return 1;
+    }
+
+    ConfigSistema config = {
+        .frequenza      = FREQUENZA,
+        .dt             = 1.0 / FREQUENZA,
+        .sta_sec        = 0.5,
+        .lta_sec        = 6.0,
+        .soglia_sta_lta = 4.0,
+        .tipo_trigger   = TRIGGER_STA_LTA,
+        .fc_hp          = 0.075,
+        .n_piani        = 3,
+    };
+    strncpy(config.tipologia, "RC", sizeof(config.tipologia) - 1);
+    strncpy(config.soglia_target, "EDS", sizeof(config.soglia_target) - 1);
+
+    StatoDOSEWS *heap = malloc((size_t)n_stazioni * sizeof(StatoDOSEWS));
+    StatoDOSEWS *arena = malloc((size_t)n_stazioni * sizeof(StatoDOSEWS));
+    size_t per_stazione = dimensione_memoria_dosews(&config);
+    if (!heap || !arena || per_stazione == 0) {
+        return 1;
+    }
+
+    /* Un buffer per stazione */
+    double t0 = ora();
+    for (int s = 0; s < n_stazioni; s++) {
+        if (init_dosews(&heap[s], &config) != 0) {
+            return 1;
+        }
+    }
+    double t_heap = ora() - t0;
+
+    /* Una sola allocazione per tutte le stazioni */
+    t0 = ora();
+    size_t totale = per_stazione * (size_t)n_stazioni;
+    unsigned char *memoria = aligned_alloc(ARENA_ALLINEAMENTO, totale);
+    if (!memoria) {
+        return 1;
+    }
+    for (int s = 0; s < n_stazioni; s++) {
+        if (init_dosews_arena(&arena[s], &config, memoria + (size_t)s * per_stazione,
+                              per_stazione) != 0) {
+            return 1;
+        }
+    }
+    double t_arena = ora() - t0;
+
+    unsigned int seme_heap = 1, seme_arena = 1;
+    int diverse = 0;
+    for (int s = 0; s < n_stazioni; s++) {
+        for (int i = 0; i < (int)FREQUENZA; i++) {
+            processa_campione(&heap[s], rumore(&seme_heap));
+            processa_campione(&arena[s], rumore(&seme_arena));
+        }
+        diverse += memcmp(heap[s].trigger.buf, arena[s].trigger.buf,
+                          (heap[s].trigger.maschera + 1) * sizeof(double)) != 0
+                || heap[s].trigger.lta_somma != arena[s].trigger.lta_somma;
+    }
+
+    printf("Stazioni: %d, %zu byte per stazione (%.1f MB)\n",
+           n_stazioni, per_stazione, totale / 1048576.0);
+    printf("init_dosews       : %8.2f ms\n", t_heap * 1e3);
+    printf("init_dosews_arena : %8.2f ms (1 allocazione)\n", t_arena * 1e3);
+    printf("Stato dopo 1 s    : %s\n", diverse ? "DIVERSO" : "uguale");
+
+    for (int s = 0; s < n_stazioni; s++) {
+        free_dosews(&heap[s]);
+        free_dosews(&arena[s]);
+    }
+    free(memoria);
+    free(heap);
+    free(arena);
+    return diverse ? 1 : 0;
+}
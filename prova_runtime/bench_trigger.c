@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "filter.h"
+#include "trigger.h"
+#include "costanti.h"
+
+/* Confronto dei motori di trigger su un catalogo di registrazioni:
+ *   bench_trigger -r rumore1.txt rumore2.txt ... -e evento1.txt ...
+ * Sulle registrazioni di solo rumore (-r) ogni trigger è un falso allarme;
+ * dopo ogni trigger il motore viene riarmato con reset_trigger, quindi resta
+ * cieco per una finestra LTA. Sulle registrazioni di evento (-e) conta se il
+ * primo trigger arriva. Stessa catena di ingresso di dosews: g -> m/s^2 e
+ * high-pass. */
+
+#define FREQUENZA        200.0
+#define FC_HIGHPASS      0.075
+#define STA_SEC          0.5
+#define LTA_SEC          6.0
+#define SOGLIA_STA_LTA   4.0
+#define N_MOTORI         4
+
+typedef struct {
+    double *campioni;          /* accelerazione filtrata [m/s^2] */
+    int n;
+    int evento;                /* 1: registrazione di evento, 0: rumore */
+} Registrazione;
+
+static const char *const NOMI[N_MOTORI] = { "sta_lta", "bande", "allen", "adattivo" };
+
+static int carica(Registrazione *r, const char *percorso, int evento, const CoeffFiltro *hp) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    int capacita = 1 << 16;
+    r->campioni = malloc(capacita * sizeof(double));
+    r->n = 0;
+    r->evento = evento;
+
+    StatoFiltro filtro;
+    reset_stato_filtro(&filtro);
+    double valore;
+    while (r->campioni && fscanf(fp, "%lf", &valore) == 1) {
+        if (r->n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(r->campioni, capacita * sizeof(double));
+            if (!nuovo) {
+                free(r->campioni);
+                r->campioni = NULL;
+                break;
+            }
+            r->campioni = nuovo;
+        }
+        r->campioni[r->n++] = applica_filtro(valore * G, hp, &filtro);
+    }
+    fclose(fp);
+    return r->campioni ? 0 : -1;
+}
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Uso: %s -r rumore.txt ... -e evento.txt ...\n", argv[0]);
+        return 1;
+    }
+
+    CoeffFiltro hp;
+    calcola_coeff_highpass(FREQUENZA, FC_HIGHPASS, &hp);
+
+    Registrazione *catalogo = calloc(argc, sizeof(Registrazione));
+    if (!catalogo) {
+        return 1;
+    }
+    int n_reg = 0, evento = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            evento = 0;
+        } else if (strcmp(argv[i], "-e") == 0) {
+            evento = 1;
+        } else if (carica(&catalogo[n_reg], argv[i], evento, &hp) == 0) {
+            n_reg++;
+        } else {
+            fprintf(stderr, "Errore: impossibile leggere %s\n", argv[i]);
+        }
+    }
+
+    long long campioni_rumore = 0;
+    int n_eventi = 0;
+    for (int k = 0; k < n_reg; k++) {
+        if (catalogo[k].evento) n_eventi++;
+        else campioni_rumore += catalogo[k].n;
+    }
+    double ore_rumore = campioni_rumore / FREQUENZA / 3600.0;
+
+    printf("Catalogo: %d registrazioni, %.2f h di rumore, %d eventi\n\n", n_reg, ore_rumore, n_eventi);
+    printf("%-10s %10s %10s %14s\n", "motore", "falsi/h", "rilevati", "ns/campione");
+
+    for (int m = 0; m < N_MOTORI; m++) {
+        StatoTrigger trigger;
+        if (init_trigger(&trigger, FREQUENZA, STA_SEC, LTA_SEC, (TipoTrigger)m) != 0) {
+            return 1;
+        }
+
+        long long falsi = 0, campioni = 0;
+        int rilevati = 0;
+        double t0 = ora();
+        for (int k = 0; k < n_reg; k++) {
+            const Registrazione *r = &catalogo[k];
+            reset_trigger(&trigger);
+            int i;
+            for (i = 0; i < r->n; i++) {
+                if (aggiorna_trigger(&trigger, r->campioni[i], SOGLIA_STA_LTA)) {
+                    if (r->evento) {
+                        rilevati++;
+                        i++;
+                        break;
+                    }
+                    falsi++;
+                    reset_trigger(&trigger);
+                }
+            }
+            campioni += i;
+        }
+        double dt = ora() - t0;
+
+        printf("%-10s %10.2f %7d/%-2d %14.2f\n", NOMI[m],
+               (ore_rumore > 0.0) ? falsi / ore_rumore : 0.0, rilevati, n_eventi,
+               (campioni > 0) ? dt * 1e9 / campioni : 0.0);
+        free_trigger(&trigger);
+    }
+
+    for (int k = 0; k < n_reg; k++) {
+        free(catalogo[k].campioni);
+    }
+    free(catalogo);
+    return 0;
+}
@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dosews.h"
+#include "varianti.h"
+
+/* Confronto tra processa_campione e la variante specializzata sulla stessa
+ * configurazione:
+ *   bench_varianti [-n ripetizioni] registrazione.txt ...
+ * Ogni registrazione (in g, a 200 Hz) viene processata da capo con entrambi
+ * i percorsi; alla fine lo stato deve coincidere bit per bit. */
+
+#define FREQUENZA        200.0
+#define FC_HIGHPASS      0.075
+#define STA_SEC          0.5
+#define LTA_SEC          6.0
+#define SOGLIA_STA_LTA   4.0
+
+static const struct {
+    const char *tipologia;
+    int n_piani;
+} EDIFICI[] = { { "RC", 3 }, { "RC", 6 }, { "URM_REG", 2 } };
+
+#define N_EDIFICI (int)(sizeof(EDIFICI) / sizeof(EDIFICI[0]))
+
+static double *carica(const char *percorso, int *n) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return NULL;
+    }
+    int capacita = 1 << 16;
+    double *dati = malloc(capacita * sizeof(double));
+    *n = 0;
+    double valore;
+    while (dati && fscanf(fp, "%lf", &valore) == 1) {
+        if (*n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(dati, capacita * sizeof(double));
+            if (!nuovo) {
+                free(dati);
+                dati = NULL;
+                break;
+            }
+            dati = nuovo;
+        }
+        dati[(*n)++] = valore;
+    }
+    fclose(fp);
+    return dati;
+}
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int stesso_filtro(const StatoFiltro *a, const StatoFiltro *b) {
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+/* Confronto dello stato escludendo i puntatori ai buffer */
+static int stesso_stato(const StatoDOSEWS *a, const StatoDOSEWS *b) {
+    const StatoTrigger *ta = &a->trigger, *tb = &b->trigger;
+    return a->fase == b->fase
+        && a->indice_campione == b->indice_campione
+        && a->indice_trigger == b->indice_trigger
+        && a->indice_allarme == b->indice_allarme
+        && memcmp(&a->pgd_max, &b->pgd_max, sizeof(double)) == 0
+        && memcmp(&a->pgd_allarme, &b->pgd_allarme, sizeof(double)) == 0
+        && stesso_filtro(&a->filtro_acc, &b->filtro_acc)
+        && stesso_filtro(&a->filtro_vel, &b->filtro_vel)
+        && stesso_filtro(&a->filtro_spost, &b->filtro_spost)
+        && memcmp(&a->int_vel, &b->int_vel, sizeof(a->int_vel)) == 0
+        && memcmp(&a->int_spost, &b->int_spost, sizeof(a->int_spost)) == 0
+        && memcmp(&a->parametri_p, &b->parametri_p, sizeof(a->parametri_p)) == 0
+        && memcmp(&a->intensita, &b->intensita, sizeof(a->intensita)) == 0
+        && ta->pos == tb->pos && ta->triggered == tb->triggered
+        && ta->campioni_caricati == tb->campioni_caricati
+        && memcmp(&ta->sta_somma, &tb->sta_somma, sizeof(double)) == 0
+        && memcmp(&ta->lta_somma, &tb->lta_somma, sizeof(double)) == 0
+        && memcmp(ta->buf, tb->buf, (ta->maschera + 1) * sizeof(double)) == 0;
+}
+
+/* Ritorna il tempo per campione [ns], -1 se errore */
+static double esegui(const ConfigSistema *config, FunzioneProcessa processa,
+                     const double *dati, int n, int ripetizioni, StatoDOSEWS *finale) {
+    double totale = 0.0;
+    for (int r = 0; r < ripetizioni; r++) {
+        StatoDOSEWS sys;
+        if (init_dosews(&sys, config) != 0) {
+            return -1.0;
+        }
+        double t0 = ora();
+        for (int i = 0; i < n; i++) {
+            processa(&sys, dati[i]);
+        }
+        totale += ora() - t0;
+        if (r + 1 < ripetizioni) {
+            free_dosews(&sys);
+        } else {
+            *finale = sys;
+        }
+    }
+    return totale * 1e9 / ((double)n * ripetizioni);
+}
+
+int main(int argc, char *argv[]) {
+    int ripetizioni = 5;
+    int esito = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s [-n ripetizioni] registrazione.txt ...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-24s %-12s %-18s %12s %12s %8s\n",
+           "registrazione", "edificio", "variante", "generica ns", "variante ns", "stato");
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ripetizioni = atoi(argv[++i]);
+            if (ripetizioni < 1) ripetizioni = 1;
+            continue;
+        }
+
+        int n;
+        double *dati = carica(argv[i], &n);
+        if (!dati || n == 0) {
+            fprintf(stderr, "Errore: impossibile leggere %s\n", argv[i]);
+            free(dati);
+            esito = 1;
+            continue;
+        }
+
+        for (int e = 0; e < N_EDIFICI; e++) {
+            ConfigSistema config = {
+                .frequenza      = FREQUENZA,
+                .dt             = 1.0 / FREQUENZA,
+                .sta_sec        = STA_SEC,
+                .lta_sec        = LTA_SEC,
+                .soglia_sta_lta = SOGLIA_STA_LTA,
+                .tipo_trigger   = TRIGGER_STA_LTA,
+                .fc_hp          = FC_HIGHPASS,
+                .n_piani        = EDIFICI[e].n_piani,
+            };
+            strncpy(config.tipologia, EDIFICI[e].tipologia, sizeof(config.tipologia) - 1);
+            strncpy(config.soglia_target, "EDS", sizeof(config.soglia_target) - 1);
+
+            StatoDOSEWS sys;
+            if (init_dosews(&sys, &config) != 0) {
+                free(dati);
+                return 1;
+            }
+            const char *nome;
+            FunzioneProcessa variante = seleziona_variante(&sys, &nome);
+            free_dosews(&sys);
+
+            StatoDOSEWS a, b;
+            double ns_generica = esegui(&config, processa_campione, dati, n, ripetizioni, &a);
+            double ns_variante = esegui(&config, variante, dati, n, ripetizioni, &b);
+            if (ns_generica < 0.0 || ns_variante < 0.0) {
+                free(dati);
+                return 1;
+            }
+
+            int uguale = stesso_stato(&a, &b);
+            if (!uguale) {
+                esito = 1;
+            }
+            char edificio[32];
+            snprintf(edificio, sizeof(edificio), "%s %dp", EDIFICI[e].tipologia, EDIFICI[e].n_piani);
+            printf("%-24s %-12s %-18s %12.2f %12.2f %8s\n", argv[i], edificio, nome,
+                   ns_generica, ns_variante, uguale ? "uguale" : "DIVERSO");
+            free_dosews(&a);
+            free_dosews(&b);
+        }
+        free(dati);
+    }
+    return esito;
+}
@@ -0,0 +1,468 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "catalogo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DIM_CONTROLLATA  (sizeof(RecordCatalogo) - sizeof(unsigned int))
+
+static unsigned int fnv1a_32(const unsigned char *dati, size_t n) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= dati[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned long long fnv1a_64(unsigned long long h, const void *dati, size_t n) {
+    const unsigned char *p = dati;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int record_valido(const RecordCatalogo *r) {
+    return r->checksum == fnv1a_32((const unsigned char *)r, DIM_CONTROLLATA);
+}
+
+/* ---- Scrittura ---- */
+
+/* Lock consultivo POSIX su tutto il file: F_WRLCK per chi apre (intestazione
+ * e taglio della coda), F_RDLCK per chi aggiunge, così l'apertura non vede
+ * mai a metà la write di un altro processo. F_UNLCK per rilasciarlo */
+static int blocca(int fd, short tipo) {
+    struct flock l;
+    memset(&l, 0, sizeof(l));
+    l.l_type = tipo;
+    l.l_whence = SEEK_SET;
+    int esito;
+    while ((esito = fcntl(fd, F_SETLKW, &l)) != 0 && errno == EINTR) {
+    }
+    return esito;
+}
+
+int apri_scrittore_catalogo(ScrittoreCatalogo *s, const char *percorso) {
+    /* O_RDWR: il lock condiviso vuole il file aperto in lettura */
+    s->fd = open(percorso, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (s->fd < 0) {
+        return -1;
+    }
+    if (blocca(s->fd, F_WRLCK) != 0) {
+        chiudi_scrittore_catalogo(s);
+        return -1;
+    }
+
+    /* File vuoto (appena creato): intestazione. Se esiste già, deve
+     * cominciare con un'intestazione valida. Sotto il lock esclusivo, quindi
+     * la scrive solo il primo di più processi che creano il catalogo */
+    int ok = 0;
+    struct stat st;
+    if (fstat(s->fd, &st) != 0) {
+        goto fine;
+    }
+    if (st.st_size == 0) {
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        IntestazioneCatalogo h = {
+            .magic = CATALOGO_MAGIC,
+            .versione = CATALOGO_VERSIONE,
+            .dim_record = sizeof(RecordCatalogo),
+            .identificativo = (unsigned long long)t.tv_sec * 1000000000ULL + (unsigned long long)t.tv_nsec,
+        };
+        ok = write(s->fd, &h, sizeof(h)) == (ssize_t)sizeof(h);
+        goto fine;
+    }
+
+    /* pread sullo stesso descrittore: chiuderne un altro sullo stesso file
+     * rilascerebbe il lock */
+    IntestazioneCatalogo h;
+    if (pread(s->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)
+        || h.magic != CATALOGO_MAGIC || h.versione != CATALOGO_VERSIONE
+        || h.dim_record != sizeof(RecordCatalogo)) {
+        goto fine;
+    }
+
+    /* Coda parziale di una scrittura interrotta: senza il taglio i record
+     * aggiunti dopo sarebbero tutti fuori allineamento. Nessuna write di
+     * altri scrittori è in corso, tutte tengono il lock condiviso */
+    off_t resto = (st.st_size - (off_t)sizeof(IntestazioneCatalogo)) % (off_t)sizeof(RecordCatalogo);
+    ok = resto == 0 || ftruncate(s->fd, st.st_size - resto) == 0;
+
+fine:
+    if (!ok) {
+        chiudi_scrittore_catalogo(s);
+        return -1;
+    }
+    blocca(s->fd, F_UNLCK);
+    return 0;
+}
+
+int aggiungi_catalogo(ScrittoreCatalogo *s, RecordCatalogo *record, int n) {
+    for (int i = 0; i < n; i++) {
+        memset(record[i].riservato, 0, sizeof(record[i].riservato));
+        record[i].checksum = fnv1a_32((const unsigned char *)&record[i], DIM_CONTROLLATA);
+    }
+    size_t dim = (size_t)n * sizeof(RecordCatalogo);
+    if (blocca(s->fd, F_RDLCK) != 0) {
+        return -1;
+    }
+    int ok = write(s->fd, record, dim) == (ssize_t)dim;
+    blocca(s->fd, F_UNLCK);
+    return ok ? 0 : -1;
+}
+
+void chiudi_scrittore_catalogo(ScrittoreCatalogo *s) {
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    s->fd = -1;
+}
+
+unsigned long long impronta_config_dosews(const ConfigSistema *config) {
+    /* Campo per campo: il padding della struttura non conta */
+    unsigned long long h = 14695981039346656037ULL;
+    h = fnv1a_64(h, &config->frequenza, sizeof(double));
+    h = fnv1a_64(h, &config->sta_sec, sizeof(double));
+    h = fnv1a_64(h, &config->lta_sec, sizeof(double));
+    h = fnv1a_64(h, &config->soglia_sta_lta, sizeof(double));
+    h = fnv1a_64(h, &config->tipo_trigger, sizeof(config->tipo_trigger));
+    h = fnv1a_64(h, &config->fc_hp, sizeof(double));
+    h = fnv1a_64(h, config->tipologia, strnlen(config->tipologia, sizeof(config->tipologia)));
+    h = fnv1a_64(h, &config->n_piani, sizeof(int));
+    h = fnv1a_64(h, config->soglia_target, strnlen(config->soglia_target, sizeof(config->soglia_target)));
+    h = fnv1a_64(h, &config->richiede_conferma, sizeof(int));
+    h = fnv1a_64(h, &config->decisione_anticipata, sizeof(int));
+    return h;
+}
+
+int record_catalogo(RecordCatalogo *r, const StatoDOSEWS *sys, unsigned int stazione, double t0) {
+    RisultatiDOSEWS ris;
+    calcola_risultati(sys, &ris);
+    memset(r, 0, sizeof(*r));
+    if (!ris.triggered) {
+        return -1;
+    }
+    r->t_trigger = t0 + ris.t_trigger;
+    r->t_allarme = ris.allarme ? t0 + ris.t_allarme : 0.0;
+    r->pgd_allarme = ris.pgd_allarme;
+    r->pgd_max = ris.pgd_max;
+    r->config = impronta_config_dosews(&sys->config);
+    r->prob = (float)ris.prob_calcolata;
+    r->lead_time = (float)ris.lead_time;
+    r->pga = (float)ris.pga;
+    r->pgv = (float)ris.pgv;
+    r->cav = (float)ris.cav;
+    r->arias = (float)ris.arias;
+    r->durata = (float)ris.durata_bracketed;
+    r->stazione = stazione;
+    r->esito = CATALOGO_TRIGGER
+             | (ris.allarme ? CATALOGO_ALLARME : 0u)
+             | (ris.allarme_anticipato ? CATALOGO_ANTICIPATO : 0u)
+             | (sys->evento_confermato ? CATALOGO_CONFERMATO : 0u);
+    return 0;
+}
+
+/* ---- Indice ---- */
+
+static int confronta_tempo(const void *a, const void *b) {
+    const VoceTempoCatalogo *x = a, *y = b;
+    if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+static int confronta_stazione(const void *a, const void *b) {
+    const VoceStazioneCatalogo *x = a, *y = b;
+    if (x->stazione != y->stazione) return (x->stazione < y->stazione) ? -1 : 1;
+    if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+static size_t dimensione_indice(long long n) {
+    return sizeof(IntestazioneIndiceCatalogo)
+         + (size_t)n * (sizeof(VoceTempoCatalogo) + sizeof(VoceStazioneCatalogo));
+}
+
+static void collega_indice(Catalogo *c) {
+    unsigned char *p = (unsigned char *)c->mappa_indice + sizeof(IntestazioneIndiceCatalogo);
+    c->per_tempo = (const VoceTempoCatalogo *)p;
+    c->per_stazione = (const VoceStazioneCatalogo *)(p + (size_t)c->n_voci * sizeof(VoceTempoCatalogo));
+}
+
+/* Non zero se ogni voce punta a un record coperto dall'indice: le ricerche
+ * indicizzano c->record[] senza altri controlli */
+static int voci_valide(const IntestazioneIndiceCatalogo *h) {
+    const VoceTempoCatalogo *per_tempo = (const VoceTempoCatalogo *)(h + 1);
+    const VoceStazioneCatalogo *per_stazione = (const VoceStazioneCatalogo *)(per_tempo + h->n_voci);
+    unsigned int massimo = 0;
+    for (unsigned long long i = 0; i < h->n_voci; i++) {
+        massimo = (per_tempo[i].record > massimo) ? per_tempo[i].record : massimo;
+        massimo = (per_stazione[i].record > massimo) ? per_stazione[i].record : massimo;
+    }
+    return h->n_voci == 0 || massimo < h->n_record;
+}
+
+/* Indice esistente: record coperti dal primo (n_voci quelli validi), -1 se
+ * manca, non appartiene al catalogo o ha voci fuori dai record coperti (va
+ * ricostruito) */
+static long long mappa_indice_esistente(Catalogo *c, const char *percorso) {
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    void *mappa = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(IntestazioneIndiceCatalogo)) {
+        mappa = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mappa == MAP_FAILED) {
+        return -1;
+    }
+
+    const IntestazioneCatalogo *hc = (const IntestazioneCatalogo *)c->mappa;
+    const IntestazioneIndiceCatalogo *h = mappa;
+    if (h->magic != INDICE_CATALOGO_MAGIC || h->versione != CATALOGO_VERSIONE
+        || h->identificativo != hc->identificativo || h->n_record > (unsigned long long)c->n_record
+        || h->n_voci > h->n_record || (size_t)st.st_size != dimensione_indice((long long)h->n_voci)
+        || !voci_valide(h)) {
+        munmap(mappa, (size_t)st.st_size);
+        return -1;
+    }
+    c->mappa_indice = mappa;
+    c->dimensione_indice = (size_t)st.st_size;
+    c->n_voci = (long long)h->n_voci;
+    return (long long)h->n_record;
+}
+
+/* File temporaneo con nome unico nella stessa cartella, poi rename: due
+ * lettori che aggiornano l'indice insieme non si scrivono addosso, e vince
+ * l'ultimo rename con un indice comunque completo */
+static int scrivi_indice(const char *percorso, const void *dati, size_t n) {
+    char tmp[520];
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", percorso) >= (int)sizeof(tmp)) {
+        return -1;
+    }
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "wb");
+    if (!fp) {
+        close(fd);
+        remove(tmp);
+        return -1;
+    }
+    /* mkstemp crea con 0600: stessi permessi del catalogo */
+    int ok = (fchmod(fd, 0644) == 0) && (fwrite(dati, 1, n, fp) == n);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp, percorso) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Voci dei record dopo i primi coperti, ordinate a parte e poi fuse con
+ * le n_voci già indicizzate. I record con checksum errato restano fuori */
+static int aggiorna_indice(Catalogo *c, const char *percorso, long long coperti) {
+    long long vecchie = c->n_voci, nuovi = 0;
+    long long da_leggere = c->n_record - coperti;
+    VoceTempoCatalogo *nuovi_t = malloc((size_t)(da_leggere > 0 ? da_leggere : 1) * sizeof(VoceTempoCatalogo));
+    VoceStazioneCatalogo *nuovi_s = malloc((size_t)(da_leggere > 0 ? da_leggere : 1) * sizeof(VoceStazioneCatalogo));
+    if (!nuovi_t || !nuovi_s) {
+        free(nuovi_t);
+        free(nuovi_s);
+        return -1;
+    }
+    for (long long i = coperti; i < c->n_record; i++) {
+        const RecordCatalogo *r = &c->record[i];
+        if (!record_valido(r)) {
+            continue;
+        }
+        nuovi_t[nuovi] = (VoceTempoCatalogo){ r->t_trigger, (unsigned int)i, r->esito };
+        nuovi_s[nuovi] = (VoceStazioneCatalogo){ r->stazione, (unsigned int)i, r->t_trigger };
+        nuovi++;
+    }
+
+    long long n = vecchie + nuovi;
+    size_t dim = dimensione_indice(n);
+    unsigned char *buf = aligned_alloc(8, (dim + 7) & ~(size_t)7);
+    if (!buf) {
+        free(nuovi_t);
+        free(nuovi_s);
+        return -1;
+    }
+    qsort(nuovi_t, (size_t)nuovi, sizeof(*nuovi_t), confronta_tempo);
+    qsort(nuovi_s, (size_t)nuovi, sizeof(*nuovi_s), confronta_stazione);
+
+    const VoceTempoCatalogo *vecchi_t = NULL;
+    const VoceStazioneCatalogo *vecchi_s = NULL;
+    if (vecchie > 0) {
+        vecchi_t = c->per_tempo;
+        vecchi_s = c->per_stazione;
+    }
+
+    IntestazioneIndiceCatalogo *h = (IntestazioneIndiceCatalogo *)buf;
+    memset(h, 0, sizeof(*h));
+    h->magic = INDICE_CATALOGO_MAGIC;
+    h->versione = CATALOGO_VERSIONE;
+    h->identificativo = ((const IntestazioneCatalogo *)c->mappa)->identificativo;
+    h->n_record = (unsigned long long)c->n_record;
+    h->n_voci = (unsigned long long)n;
+    VoceTempoCatalogo *out_t = (VoceTempoCatalogo *)(buf + sizeof(*h));
+    VoceStazioneCatalogo *out_s = (VoceStazioneCatalogo *)(out_t + n);
+
+    long long i = 0, j = 0, k = 0;
+    while (i < vecchie || j < nuovi) {
+        int vecchio = j == nuovi || (i < vecchie && confronta_tempo(&vecchi_t[i], &nuovi_t[j]) <= 0);
+        out_t[k++] = vecchio ? vecchi_t[i++] : nuovi_t[j++];
+    }
+    i = j = k = 0;
+    while (i < vecchie || j < nuovi) {
+        int vecchio = j == nuovi || (i < vecchie && confronta_stazione(&vecchi_s[i], &nuovi_s[j]) <= 0);
+        out_s[k++] = vecchio ? vecchi_s[i++] : nuovi_s[j++];
+    }
+    free(nuovi_t);
+    free(nuovi_s);
+
+    if (c->mappa_indice) {
+        munmap(c->mappa_indice, c->dimensione_indice);
+    }
+    /* Se l'indice non si può scrivere (catalogo in sola lettura) resta in
+     * memoria per questa apertura */
+    c->mappa_indice = buf;
+    c->dimensione_indice = dim;
+    c->indice_allocato = 1;
+    c->n_voci = n;
+    scrivi_indice(percorso, buf, dim);
+    collega_indice(c);
+    return 0;
+}
+
+/* ---- Lettura ---- */
+
+int apri_catalogo(Catalogo *c, const char *percorso) {
+    memset(c, 0, sizeof(*c));
+
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IntestazioneCatalogo)) {
+        close(fd);
+        return -1;
+    }
+    size_t dim = (size_t)st.st_size;
+    void *mappa = mmap(NULL, dim, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappa == MAP_FAILED) {
+        return -1;
+    }
+    c->mappa = mappa;
+    c->dimensione = dim;
+
+    const IntestazioneCatalogo *h = mappa;
+    if (h->magic != CATALOGO_MAGIC || h->versione != CATALOGO_VERSIONE
+        || h->dim_record != sizeof(RecordCatalogo)) {
+        chiudi_catalogo(c);
+        return -1;
+    }
+    c->record = (const RecordCatalogo *)(c->mappa + sizeof(IntestazioneCatalogo));
+    long long interi = (long long)((dim - sizeof(IntestazioneCatalogo)) / sizeof(RecordCatalogo));
+    c->n_record = interi;
+
+    char percorso_indice[512];
+    snprintf(percorso_indice, sizeof(percorso_indice), "%s.idx", percorso);
+    long long coperti = mappa_indice_esistente(c, percorso_indice);
+    if (coperti < 0) {
+        c->n_voci = 0;
+        coperti = 0;
+    } else {
+        collega_indice(c);
+        if (coperti == interi) {
+            return 0;
+        }
+    }
+
+    /* I record già indicizzati sono stati controllati allora: si
+     * controllano solo quelli nuovi */
+    if (aggiorna_indice(c, percorso_indice, coperti) != 0) {
+        chiudi_catalogo(c);
+        return -1;
+    }
+    return 0;
+}
+
+void chiudi_catalogo(Catalogo *c) {
+    if (c->mappa) {
+        munmap((void *)c->mappa, c->dimensione);
+    }
+    if (c->indice_allocato) {
+        free(c->mappa_indice);
+    } else if (c->mappa_indice) {
+        munmap(c->mappa_indice, c->dimensione_indice);
+    }
+    memset(c, 0, sizeof(*c));
+}
+
+long long cerca_tempo_catalogo(const Catalogo *c, double t) {
+    long long lo = 0, hi = c->n_voci;
+    while (lo < hi) {
+        long long m = lo + (hi - lo) / 2;
+        if (c->per_tempo[m].t < t) lo = m + 1; else hi = m;
+    }
+    return lo;
+}
+
+long long cerca_stazione_catalogo(const Catalogo *c, unsigned int stazione, double t) {
+    long long lo = 0, hi = c->n_voci;
+    while (lo < hi) {
+        long long m = lo + (hi - lo) / 2;
+        const VoceStazioneCatalogo *v = &c->per_stazione[m];
+        if (v->stazione < stazione || (v->stazione == stazione && v->t < t)) lo = m + 1; else hi = m;
+    }
+    return lo;
+}
+
+static int esito_accettato(const FiltroCatalogo *f, unsigned int esito) {
+    return (esito & f->esito_presente) == f->esito_presente && (esito & f->esito_assente) == 0;
+}
+
+long long filtra_catalogo(const Catalogo *c, const FiltroCatalogo *f,
+                          unsigned int *risultati, long long max) {
+    long long n = 0;
+    if (f->stazione >= 0) {
+        unsigned int s = (unsigned int)f->stazione;
+        for (long long i = cerca_stazione_catalogo(c, s, f->t_da);
+             i < c->n_voci && c->per_stazione[i].stazione == s && c->per_stazione[i].t < f->t_a; i++) {
+            const RecordCatalogo *r = &c->record[c->per_stazione[i].record];
+            if (esito_accettato(f, r->esito) && r->pgd_allarme >= f->pgd_min) {
+                if (n < max) risultati[n] = c->per_stazione[i].record;
+                n++;
+            }
+        }
+        return n;
+    }
+
+    for (long long i = cerca_tempo_catalogo(c, f->t_da); i < c->n_voci && c->per_tempo[i].t < f->t_a; i++) {
+        const VoceTempoCatalogo *v = &c->per_tempo[i];
+        if (!esito_accettato(f, v->esito)
+            || (f->pgd_min > 0.0 && c->record[v->record].pgd_allarme < f->pgd_min)) {
+            continue;
+        }
+        if (n < max) risultati[n] = v->record;
+        n++;
+    }
+    return n;
+}
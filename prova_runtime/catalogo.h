@@ -0,0 +1,152 @@
+#ifndef CATALOGO_H
+#define CATALOGO_H
+
+#include <stddef.h>
+#include "dosews.h"
+
+/* Catalogo degli eventi: un record per stazione ed evento, in coda a un
+ * file binario che non viene mai riscritto:
+ *
+ *   IntestazioneCatalogo | RecordCatalogo | RecordCatalogo | ...
+ *
+ * Ogni record ha 96 byte e un proprio checksum, e si aggiunge con una sola
+ * write in O_APPEND: più processi possono scrivere nello stesso catalogo e
+ * un record corrotto resta fuori dagli indici senza perdere i successivi.
+ * Un lock fcntl su tutto il file, esclusivo all'apertura e condiviso per
+ * ogni aggiunta, fa scrivere l'intestazione a uno solo dei processi che
+ * creano il catalogo e tagliare la coda parziale solo a write finite.
+ *
+ * Accanto al catalogo, in <catalogo>.idx, due indici ordinati dei record,
+ * per istante del trigger e per (stazione, istante), letti via mmap. La
+ * lettura li aggiorna se il catalogo è cresciuto: ordina solo i record
+ * nuovi e li fonde con quelli già indicizzati. Little-endian, come gli
+ * archivi .dws. */
+
+#define CATALOGO_MAGIC         0x4b535744u  /* "DWSK" */
+#define INDICE_CATALOGO_MAGIC  0x49535744u  /* "DWSI" */
+#define CATALOGO_VERSIONE      2u   /* 2: misure di intensità */
+
+/* Bit di esito */
+#define CATALOGO_TRIGGER     (1u << 0)
+#define CATALOGO_ALLARME     (1u << 1)
+#define CATALOGO_ANTICIPATO  (1u << 2)    /* allarme dalla regola su Pd e tau_c */
+#define CATALOGO_CONFERMATO  (1u << 3)    /* conferma di rete k-su-n */
+
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned int dim_record;
+    unsigned int riservato;
+    unsigned long long identificativo;   /* istante di creazione, ns: lega l'indice al catalogo */
+    unsigned long long riservato2;
+} IntestazioneCatalogo;
+
+typedef struct {
+    double t_trigger;              /* s, assoluto (t0 della registrazione + trigger) */
+    double t_allarme;              /* s, assoluto; 0 senza allarme */
+    double pgd_allarme;            /* m */
+    double pgd_max;                /* m */
+    unsigned long long config;     /* impronta_config_dosews */
+    float prob;                    /* %, al PGD d'allarme */
+    float lead_time;               /* s */
+    float pga, pgv;                /* m/s^2, m/s, dal trigger */
+    float cav, arias;              /* m/s, m/s */
+    float durata;                  /* s, bracketed */
+    unsigned int stazione;
+    unsigned int esito;            /* CATALOGO_* */
+    unsigned int riservato[4];
+    unsigned int checksum;         /* FNV-1a a 32 bit dei 92 byte precedenti */
+} RecordCatalogo;
+
+_Static_assert(sizeof(RecordCatalogo) == 96, "record senza padding, tre mezze linee di cache");
+
+/* Voci degli indici: esito copiato per filtrare senza toccare i record */
+typedef struct {
+    double t;
+    unsigned int record;
+    unsigned int esito;
+} VoceTempoCatalogo;
+
+typedef struct {
+    unsigned int stazione;
+    unsigned int record;
+    double t;
+} VoceStazioneCatalogo;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned long long identificativo;   /* quello del catalogo */
+    unsigned long long n_record;         /* record coperti, dal primo */
+    unsigned long long n_voci;           /* quelli validi, indicizzati */
+} IntestazioneIndiceCatalogo;
+
+/* ---- Scrittura ---- */
+
+typedef struct {
+    int fd;
+} ScrittoreCatalogo;
+
+/* Apre in aggiunta, creando il file con l'intestazione se manca e
+ * tagliando un eventuale record parziale in coda, sotto lock esclusivo.
+ * Ritorna 0, oppure -1 se il file esiste ma non è un catalogo. Il lock è
+ * per processo: uno scrittore per catalogo in ogni processo. */
+int apri_scrittore_catalogo(ScrittoreCatalogo *s, const char *percorso);
+
+/* n record in una sola write, checksum calcolati qui. Ritorna 0 o -1. */
+int aggiungi_catalogo(ScrittoreCatalogo *s, RecordCatalogo *record, int n);
+
+void chiudi_scrittore_catalogo(ScrittoreCatalogo *s);
+
+/* FNV-1a a 64 bit dei campi di config che decidono trigger e allarme. */
+unsigned long long impronta_config_dosews(const ConfigSistema *config);
+
+/* Record dell'evento corrente di sys (da calcola_risultati); t0 [s] è
+ * l'istante assoluto del primo campione. Ritorna 0, -1 se sys non è
+ * scattato. */
+int record_catalogo(RecordCatalogo *r, const StatoDOSEWS *sys, unsigned int stazione, double t0);
+
+/* ---- Lettura ---- */
+
+typedef struct {
+    const unsigned char *mappa;
+    size_t dimensione;
+    const RecordCatalogo *record;
+    long long n_record;            /* interi nel file */
+    long long n_voci;              /* validi: voci di ciascun indice */
+
+    void *mappa_indice;            /* mmap di <catalogo>.idx, oppure l'indice in memoria */
+    size_t dimensione_indice;
+    int indice_allocato;           /* 1: mappa_indice da malloc (scrittura dell'indice fallita) */
+    const VoceTempoCatalogo *per_tempo;
+    const VoceStazioneCatalogo *per_stazione;
+} Catalogo;
+
+/* Mappa il catalogo e l'indice, aggiornandolo se serve. Ritorna 0, oppure
+ * -1 se il file manca o non è un catalogo. */
+int apri_catalogo(Catalogo *c, const char *percorso);
+
+void chiudi_catalogo(Catalogo *c);
+
+/* Prima posizione di per_tempo con t >= t (n_voci se nessuna). */
+long long cerca_tempo_catalogo(const Catalogo *c, double t);
+
+/* Prima posizione di per_stazione con (stazione, t) >= (stazione, t). */
+long long cerca_stazione_catalogo(const Catalogo *c, unsigned int stazione, double t);
+
+typedef struct {
+    double t_da, t_a;              /* s, trigger in [t_da, t_a) */
+    int stazione;                  /* -1: tutte */
+    unsigned int esito_presente;   /* bit che devono esserci */
+    unsigned int esito_assente;    /* bit che devono mancare */
+    double pgd_min;                /* m, su pgd_allarme; 0: nessun limite */
+} FiltroCatalogo;
+
+/* Record che passano il filtro, in ordine di istante: scrive in risultati
+ * al più max indici di record e ritorna quanti sono in tutto. Con una
+ * stazione scorre l'indice per stazione, altrimenti quello per istante,
+ * che porta l'esito: lì i record sono letti solo per pgd_min. */
+long long filtra_catalogo(const Catalogo *c, const FiltroCatalogo *f,
+                          unsigned int *risultati, long long max);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CATENA_H
+#define CATENA_H
+
+#include <math.h>
+#include "dosews.h"
+
+/* Catena dopo il trigger, interna alla libreria: una sola copia per
+ * processa_campione (dosews.c) e per le varianti (varianti.c), che cambiano
+ * solo il filtro high-pass, il passo e la soglia di PGD. Le funzioni sono
+ * note a ogni chiamata e il compilatore le espande sul posto, quindi le
+ * varianti restano specializzate. Un nuovo stadio dopo il trigger si
+ * aggiunge qui. */
+
+/* Filtro high-pass di velocità e spostamento */
+typedef double (*FiltroCatena)(double x, StatoFiltro *s, const void *contesto);
+
+/* 1 se pgd [m] basta per l'allarme */
+typedef int (*SogliaCatena)(const StatoDOSEWS *sys, double pgd, const void *contesto);
+
+/* Doppia integrazione con ri-filtraggio, misure e allarme */
+static inline StatoSistema avanza_catena_comune(StatoDOSEWS *sys, double acc_filt, double dt,
+                                                FiltroCatena filtra, SogliaCatena supera,
+                                                const void *contesto) {
+    double vel = aggiorna_integratore(&sys->int_vel, acc_filt, dt);
+    double vel_filt = filtra(vel, &sys->filtro_vel, contesto);
+    double spost = aggiorna_integratore(&sys->int_spost, vel_filt, dt);
+    double spost_filt = filtra(spost, &sys->filtro_spost, contesto);
+    double pgd = fabs(spost_filt);
+
+    if (pgd > sys->pgd_max) {
+        sys->pgd_max = pgd;
+    }
+
+    aggiorna_parametri_p(&sys->parametri_p, acc_filt, vel_filt, spost_filt);
+    aggiorna_intensita(&sys->intensita, acc_filt, vel_filt);
+    if (sys->edifici) {
+        avanza_oscillatori(sys->edifici, acc_filt);
+    }
+    if (sys->spettro) {
+        avanza_spettro(sys->spettro, acc_filt);
+    }
+
+    const ConfigSistema *cfg = &sys->config;
+    if (sys->fase == STATO_TRIGGERED && (!cfg->richiede_conferma || sys->evento_confermato)) {
+        int allarme = supera(sys, pgd, contesto);
+        if (!allarme && cfg->decisione_anticipata && decisione_parametri_p(&sys->parametri_p)) {
+            sys->allarme_anticipato = 1;
+            allarme = 1;
+        }
+        if (allarme) {
+            segnala_allarme(sys, pgd);
+        }
+    }
+
+    return sys->fase;
+}
+
+#endif
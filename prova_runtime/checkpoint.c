@@ -0,0 +1,498 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static unsigned long long fnv1a(const unsigned char *dati, size_t n) {
+    unsigned long long h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) {
+        h ^= dati[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* ---- Campi ----
+ *
+ * Un solo elenco di campi per sezione, percorso in quattro modi: contare i
+ * byte, serializzare, verificare un file e ripristinarlo. Salvataggio e
+ * ripristino non possono divergere. */
+
+typedef enum {
+    CAMPI_CONTA,
+    CAMPI_SCRIVI,
+    CAMPI_VERIFICA,            /* solo le chiavi: sys non cambia */
+    CAMPI_RIPRISTINA
+} ModoCampi;
+
+typedef struct {
+    ModoCampi modo;
+    unsigned char *uscita;         /* CAMPI_SCRIVI */
+    const unsigned char *ingresso; /* CAMPI_VERIFICA e CAMPI_RIPRISTINA */
+    size_t pos;
+    size_t fine;                   /* byte della sezione in lettura */
+    int incompatibile;
+} Campi;
+
+static int in_lettura(const Campi *c) {
+    return c->modo == CAMPI_VERIFICA || c->modo == CAMPI_RIPRISTINA;
+}
+
+/* Un campo oltre la fine della sezione non c'è nel file: resta il valore
+ * corrente, cioè quello di init_dosews. Un campo a metà è un file rovinato */
+static void campo(Campi *c, void *x, size_t n) {
+    if (c->modo == CAMPI_SCRIVI) {
+        memcpy(c->uscita + c->pos, x, n);
+    } else if (in_lettura(c) && c->pos < c->fine) {
+        if (c->fine - c->pos < n) {
+            c->incompatibile = 1;
+        } else if (c->modo == CAMPI_RIPRISTINA) {
+            memcpy(x, c->ingresso + c->pos, n);
+        }
+    }
+    c->pos += n;
+}
+
+static void campo_d(Campi *c, double *x) {
+    campo(c, x, sizeof(*x));
+}
+
+static void campo_ll(Campi *c, long long *x) {
+    campo(c, x, sizeof(*x));
+}
+
+static void campo_int(Campi *c, int *x) {
+    long long v = *x;
+    campo_ll(c, &v);
+    if (c->modo == CAMPI_RIPRISTINA) {
+        *x = (int)v;
+    }
+}
+
+static void campo_u(Campi *c, unsigned int *x) {
+    long long v = *x;
+    campo_ll(c, &v);
+    if (c->modo == CAMPI_RIPRISTINA) {
+        *x = (unsigned int)v;
+    }
+}
+
+/* Valore che nel file deve esserci e coincidere con sys, altrimenti il
+ * checkpoint è incompatibile */
+static void chiave(Campi *c, const void *atteso, size_t n) {
+    if (!in_lettura(c)) {
+        campo(c, (void *)atteso, n);
+        return;
+    }
+    c->incompatibile |= c->pos + n > c->fine || memcmp(c->ingresso + c->pos, atteso, n) != 0;
+    c->pos += n;
+}
+
+static void chiave_ll(Campi *c, long long atteso) {
+    chiave(c, &atteso, sizeof(atteso));
+}
+
+static void chiave_d(Campi *c, double atteso) {
+    chiave(c, &atteso, sizeof(atteso));
+}
+
+/* Vettore di n double preceduto dalla lunghezza, che deve coincidere */
+static void campo_vettore(Campi *c, double *v, size_t n) {
+    if (in_lettura(c) && c->pos >= c->fine) {
+        return;                    /* aggiunto dopo il salvataggio */
+    }
+    chiave_ll(c, (long long)n);
+    campo(c, v, n * sizeof(double));
+}
+
+/* ---- Sezioni ---- */
+
+static void campi_filtro(Campi *c, StatoFiltro *f) {
+    campo_d(c, &f->x1);
+    campo_d(c, &f->x2);
+    campo_d(c, &f->y1);
+    campo_d(c, &f->y2);
+}
+
+static void campi_integratore(Campi *c, StatoIntegratore *i) {
+    campo_d(c, &i->valore_precedente);
+    campo_d(c, &i->integrale);
+    campo_int(c, &i->inizializzato);
+}
+
+static void campi_motore(Campi *c, StatoDOSEWS *sys) {
+    const ConfigSistema *cfg = &sys->config;
+    chiave_d(c, cfg->frequenza);
+    chiave_d(c, cfg->sta_sec);
+    chiave_d(c, cfg->lta_sec);
+    chiave_d(c, cfg->fc_hp);
+    chiave_ll(c, cfg->tipo_trigger);
+    chiave_ll(c, 0);   /* era la decimazione di quiete: i file con D > 1 si rifiutano */
+
+    int fase = (int)sys->fase;
+    campo_int(c, &fase);
+    if (c->modo == CAMPI_RIPRISTINA) {
+        sys->fase = (StatoSistema)fase;
+    }
+    campo_ll(c, &sys->indice_campione);
+    campo_ll(c, &sys->indice_trigger);
+    campo_ll(c, &sys->indice_allarme);
+    campo_d(c, &sys->pgd_max);
+    campo_d(c, &sys->pgd_allarme);
+    campo_int(c, &sys->evento_confermato);
+    campo_int(c, &sys->allarme_anticipato);
+    campi_filtro(c, &sys->filtro_acc);
+    campi_filtro(c, &sys->filtro_vel);
+    campi_filtro(c, &sys->filtro_spost);
+    campi_integratore(c, &sys->int_vel);
+    campi_integratore(c, &sys->int_spost);
+    campo_ll(c, &sys->trigger_sospesi);
+    campo_ll(c, &sys->indice_sospeso);
+}
+
+static void campi_trigger(Campi *c, StatoDOSEWS *sys) {
+    StatoTrigger *t = &sys->trigger;
+    chiave_ll(c, t->sta_len);
+    chiave_ll(c, t->lta_len);
+
+    campo_u(c, &t->pos);
+    campo_d(c, &t->sta_somma);
+    campo_d(c, &t->lta_somma);
+    campo_int(c, &t->campioni_caricati);
+    campo_int(c, &t->triggered);
+    campo_vettore(c, t->banda_x1, TRIGGER_N_BANDE);
+    campo_vettore(c, t->banda_x2, TRIGGER_N_BANDE);
+    campo_vettore(c, t->banda_y1, TRIGGER_N_BANDE);
+    campo_vettore(c, t->banda_y2, TRIGGER_N_BANDE);
+    campo_vettore(c, t->banda_sta, TRIGGER_N_BANDE);
+    campo_vettore(c, t->banda_lta, TRIGGER_N_BANDE);
+    campo_d(c, &t->allen_precedente);
+    campo_d(c, &t->allen_abs);
+    campo_d(c, &t->allen_dabs);
+    campo_vettore(c, t->istogramma, TRIGGER_N_CLASSI);
+    campo_int(c, &t->campioni_periodo);
+    campo_d(c, &t->soglia_adattiva);
+    /* Anello delle energie, vuoto con TRIGGER_BANDE */
+    campo_vettore(c, t->buf, t->buf ? t->maschera + 1 : 0);
+}
+
+static void campi_parametri_p(Campi *c, StatoDOSEWS *sys) {
+    StatoParametriP *p = &sys->parametri_p;
+    campo_d(c, &p->somma_u2);
+    campo_d(c, &p->somma_v2);
+    campo_d(c, &p->x);
+    campo_d(c, &p->d);
+    campo_d(c, &p->tau_c);
+    campo_d(c, &p->pd);
+    campo_d(c, &p->tau_p_max);
+    campo_int(c, &p->campioni);
+}
+
+static void campi_intensita(Campi *c, StatoDOSEWS *sys) {
+    StatoIntensita *s = &sys->intensita;
+    campo_d(c, &s->pga);
+    campo_d(c, &s->pgv);
+    campo_d(c, &s->somma_abs);
+    campo_d(c, &s->somma_quadrati);
+    campo_ll(c, &s->campioni);
+    campo_ll(c, &s->primo);
+    campo_ll(c, &s->ultimo);
+}
+
+static int con_edifici(const StatoDOSEWS *sys) {
+    return sys->edifici != NULL;
+}
+
+static void campi_edifici(Campi *c, StatoDOSEWS *sys) {
+    BancoOscillatori *b = sys->edifici;
+    size_t colonne = (size_t)b->capacita;
+    chiave_ll(c, b->n_edifici);
+    chiave_ll(c, b->n_piani_max);
+    campo_d(c, &b->acc_precedente);
+    campo_vettore(c, b->stato, 2 * OSCILLATORI_MAX_MODI * colonne);
+    campo_vettore(c, b->inviluppo, (size_t)b->n_piani_max * colonne);
+    campo_vettore(c, b->drift_max, colonne);
+}
+
+static int con_spettro(const StatoDOSEWS *sys) {
+    return sys->spettro != NULL;
+}
+
+static void campi_spettro(Campi *c, StatoDOSEWS *sys) {
+    SpettroRisposta *s = sys->spettro;
+    size_t colonne = (size_t)s->capacita;
+    chiave_ll(c, s->n_periodi);
+    chiave_d(c, s->smorzamento);
+    chiave_ll(c, s->n_livelli);
+    for (int j = 0; j <= s->n_livelli; j++) {
+        chiave_ll(c, s->inizio[j]);
+    }
+    campo_u(c, &s->contatore);
+    campo_vettore(c, s->acc1, SPETTRO_MAX_LIVELLI);
+    campo_vettore(c, s->acc2, SPETTRO_MAX_LIVELLI);
+    campo_vettore(c, s->storico[0], SPETTRO_MAX_LIVELLI * 8);
+    campo_vettore(c, s->u1, colonne);
+    campo_vettore(c, s->u2, colonne);
+    campo_vettore(c, s->sd, colonne);
+}
+
+typedef struct {
+    unsigned int tipo;
+    unsigned int versione;
+    int (*presente)(const StatoDOSEWS *sys);   /* NULL: sempre */
+    void (*campi)(Campi *c, StatoDOSEWS *sys);
+} DescrizioneSezione;
+
+static const DescrizioneSezione SEZIONI[] = {
+    { SEZIONE_MOTORE,         1, NULL,                campi_motore },
+    { SEZIONE_TRIGGER,        1, NULL,                campi_trigger },
+    { SEZIONE_PARAMETRI_P,    1, NULL,                campi_parametri_p },
+    { SEZIONE_INTENSITA,      1, NULL,                campi_intensita },
+    { SEZIONE_EDIFICI,        1, con_edifici,         campi_edifici },
+    { SEZIONE_SPETTRO,        2, con_spettro,         campi_spettro },   /* 2: multirate */
+};
+
+#define N_SEZIONI ((int)(sizeof(SEZIONI) / sizeof(SEZIONI[0])))
+
+static const DescrizioneSezione *cerca_sezione(const StatoDOSEWS *sys, unsigned int tipo) {
+    for (int i = 0; i < N_SEZIONI; i++) {
+        if (SEZIONI[i].tipo == tipo) {
+            return (!SEZIONI[i].presente || SEZIONI[i].presente(sys)) ? &SEZIONI[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* ---- Scrittura ---- */
+
+/* Con uscita NULL conta soltanto. sys non cambia: in scrittura i campi
+ * sono solo letti */
+static size_t scrivi_sezioni(const StatoDOSEWS *sys, unsigned char *uscita, unsigned int *n_sezioni) {
+    Campi c = { .modo = uscita ? CAMPI_SCRIVI : CAMPI_CONTA, .uscita = uscita };
+    *n_sezioni = 0;
+    for (int i = 0; i < N_SEZIONI; i++) {
+        const DescrizioneSezione *d = &SEZIONI[i];
+        if (d->presente && !d->presente(sys)) {
+            continue;
+        }
+        size_t inizio = c.pos;
+        c.pos += sizeof(SezioneCheckpoint);
+        d->campi(&c, (StatoDOSEWS *)sys);
+        if (uscita) {
+            SezioneCheckpoint s = { d->tipo, d->versione, c.pos - inizio - sizeof(SezioneCheckpoint) };
+            memcpy(uscita + inizio, &s, sizeof(s));
+        }
+        (*n_sezioni)++;
+    }
+    return c.pos;
+}
+
+size_t dimensione_checkpoint(const StatoDOSEWS *sys) {
+    unsigned int n;
+    return sizeof(IntestazioneCheckpoint) + scrivi_sezioni(sys, NULL, &n);
+}
+
+void serializza_checkpoint(const StatoDOSEWS *sys, void *buf) {
+    unsigned char *p = buf;
+    IntestazioneCheckpoint h = { .magic = CHECKPOINT_MAGIC, .versione = CHECKPOINT_VERSIONE };
+    size_t dim = sizeof(h) + scrivi_sezioni(sys, p + sizeof(h), &h.n_sezioni);
+    h.dimensione = dim;
+    h.checksum = fnv1a(p + sizeof(h), dim - sizeof(h));
+    memcpy(p, &h, sizeof(h));
+}
+
+static int scrivi_file_atomico(const char *percorso, const void *dati, size_t n) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", percorso);
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        return -1;
+    }
+    int ok = (fwrite(dati, 1, n, fp) == n);
+    ok = (fflush(fp) == 0) && ok;
+    ok = (fsync(fileno(fp)) == 0) && ok;
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || rename(tmp, percorso) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int salva_checkpoint(const StatoDOSEWS *sys, const char *percorso) {
+    size_t dim = dimensione_checkpoint(sys);
+    void *buf = malloc(dim);
+    if (!buf) {
+        return -1;
+    }
+    serializza_checkpoint(sys, buf);
+    int ret = scrivi_file_atomico(percorso, buf, dim);
+    free(buf);
+    return ret;
+}
+
+/* ---- Lettura ---- */
+
+/* Percorre le sezioni del file nel modo dato; -1 se una sezione nota è
+ * incompatibile o il file non è ben formato */
+static int leggi_sezioni(StatoDOSEWS *sys, const unsigned char *dati, size_t dim,
+                         unsigned int n_sezioni, ModoCampi modo) {
+    size_t pos = sizeof(IntestazioneCheckpoint);
+    int motore = 0;
+    for (unsigned int i = 0; i < n_sezioni; i++) {
+        SezioneCheckpoint s;
+        if (dim - pos < sizeof(s)) {
+            return -1;
+        }
+        memcpy(&s, dati + pos, sizeof(s));
+        pos += sizeof(s);
+        if (s.dimensione > dim - pos) {
+            return -1;
+        }
+        const DescrizioneSezione *d = cerca_sezione(sys, s.tipo);
+        if (d) {
+            Campi c = { .modo = modo, .ingresso = dati + pos, .fine = (size_t)s.dimensione };
+            if (s.versione != d->versione) {
+                return -1;
+            }
+            d->campi(&c, sys);
+            if (c.incompatibile) {
+                return -1;
+            }
+            motore |= (s.tipo == SEZIONE_MOTORE);
+        }
+        pos += (size_t)s.dimensione;
+    }
+    return (pos == dim && motore) ? 0 : -1;
+}
+
+int carica_checkpoint(StatoDOSEWS *sys, const char *percorso) {
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IntestazioneCheckpoint)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t dim = (size_t)st.st_size;
+    const unsigned char *dati = mmap(NULL, dim, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dati == MAP_FAILED) {
+        return -1;
+    }
+
+    /* Prima tutto il file in verifica, poi il ripristino: un checkpoint
+     * rifiutato non lascia sys a metà */
+    IntestazioneCheckpoint h;
+    memcpy(&h, dati, sizeof(h));
+    int ret = -1;
+    if (h.magic == CHECKPOINT_MAGIC && h.versione == CHECKPOINT_VERSIONE && h.dimensione == dim
+        && h.checksum == fnv1a(dati + sizeof(h), dim - sizeof(h))
+        && leggi_sezioni(sys, dati, dim, h.n_sezioni, CAMPI_VERIFICA) == 0) {
+        ret = leggi_sezioni(sys, dati, dim, h.n_sezioni, CAMPI_RIPRISTINA);
+    }
+
+    munmap((void *)dati, dim);
+    return ret;
+}
+
+static void *ciclo_scrittore(void *arg) {
+    ScrittoreCheckpoint *s = arg;
+
+    pthread_mutex_lock(&s->mutex);
+    for (;;) {
+        while (!s->pendente && !s->termina) {
+            pthread_cond_wait(&s->cond, &s->mutex);
+        }
+        if (!s->pendente) {
+            break;
+        }
+
+        /* Scambia i buffer: la scrittura su disco avviene senza il lock */
+        unsigned char *tmp = s->istantanea;
+        s->istantanea = s->in_scrittura;
+        s->in_scrittura = tmp;
+        s->pendente = 0;
+        pthread_mutex_unlock(&s->mutex);
+
+        if (scrivi_file_atomico(s->percorso, s->in_scrittura, s->dimensione) != 0) {
+            fprintf(stderr, "Errore: scrittura checkpoint %s fallita\n", s->percorso);
+        }
+
+        pthread_mutex_lock(&s->mutex);
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+int avvia_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys,
+                               const char *percorso, long long periodo_campioni) {
+    memset(s, 0, sizeof(*s));
+    s->dimensione = dimensione_checkpoint(sys);
+    s->periodo_campioni = (periodo_campioni > 0) ? periodo_campioni : 1;
+    strncpy(s->percorso, percorso, sizeof(s->percorso) - 1);
+
+    s->istantanea = malloc(s->dimensione);
+    s->in_scrittura = malloc(s->dimensione);
+    if (!s->istantanea || !s->in_scrittura) {
+        free(s->istantanea);
+        free(s->in_scrittura);
+        return -1;
+    }
+
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    if (pthread_create(&s->thread, NULL, ciclo_scrittore, s) != 0) {
+        pthread_mutex_destroy(&s->mutex);
+        pthread_cond_destroy(&s->cond);
+        free(s->istantanea);
+        free(s->in_scrittura);
+        return -1;
+    }
+    return 0;
+}
+
+void aggiorna_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys) {
+    if (sys->indice_campione % s->periodo_campioni != 0) {
+        return;
+    }
+
+    if (pthread_mutex_trylock(&s->mutex) != 0) {
+        s->saltati++;
+        return;
+    }
+    s->saltati += s->pendente;   /* la precedente non è ancora stata presa */
+    serializza_checkpoint(sys, s->istantanea);
+    s->pendente = 1;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void ferma_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys) {
+    pthread_mutex_lock(&s->mutex);
+    serializza_checkpoint(sys, s->istantanea);
+    s->pendente = 1;
+    s->termina = 1;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+
+    pthread_join(s->thread, NULL);
+    pthread_mutex_destroy(&s->mutex);
+    pthread_cond_destroy(&s->cond);
+    free(s->istantanea);
+    free(s->in_scrittura);
+    s->istantanea = NULL;
+    s->in_scrittura = NULL;
+}
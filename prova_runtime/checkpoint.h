@@ -0,0 +1,94 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "dosews.h"
+
+/* Formato binario: IntestazioneCheckpoint e una sezione per sotto-stato
+ * (SezioneCheckpoint seguita dai campi). I campi sono scritti uno per uno a
+ * 8 byte (double o intero) e ogni vettore è preceduto dalla lunghezza:
+ * nessuna struttura è copiata in blocco, il layout di StatoDOSEWS non conta.
+ *  - Un campo nuovo va in coda alla sua sezione, senza cambiare versione:
+ *    nei file vecchi manca e resta il valore dato da init_dosews.
+ *  - La versione di una sezione cambia solo se cambia il significato dei
+ *    campi esistenti; una sezione di un'altra versione non si ripristina.
+ *  - Le sezioni sconosciute, o di un banco non collegato, sono saltate.
+ * Banco degli edifici e spettro sono salvati se collegati a sys, e
+ * ripristinati se collegati con le stesse dimensioni; senza la loro sezione
+ * restano azzerati. Callback e veto restano quelli collegati a sys.
+ * CHECKPOINT_VERSIONE riguarda solo intestazione e sezioni. */
+#define CHECKPOINT_MAGIC     0x43535744u  /* "DWSC" */
+#define CHECKPOINT_VERSIONE  14u          /* 14: sezioni campo per campo */
+
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned int n_sezioni;
+    unsigned int riservato;
+    unsigned long long dimensione; /* byte totali, intestazione inclusa */
+    unsigned long long checksum;   /* FNV-1a su tutto ciò che segue */
+} IntestazioneCheckpoint;
+
+typedef struct {
+    unsigned int tipo;             /* SEZIONE_*, mai riusati */
+    unsigned int versione;
+    unsigned long long dimensione; /* byte dei campi che seguono */
+} SezioneCheckpoint;
+
+#define SEZIONE_MOTORE          1u   /* fase, indici, filtri, integratori */
+#define SEZIONE_TRIGGER         2u
+#define SEZIONE_PRERILEVAMENTO  3u   /* dismessa, ignorata in lettura */
+#define SEZIONE_PARAMETRI_P     4u
+#define SEZIONE_INTENSITA       5u
+#define SEZIONE_EDIFICI         6u
+#define SEZIONE_SPETTRO         7u
+
+/* Dimensione in byte del checkpoint di sys. */
+size_t dimensione_checkpoint(const StatoDOSEWS *sys);
+
+/* Serializza sys in buf (almeno dimensione_checkpoint(sys) byte). Non fa I/O. */
+void serializza_checkpoint(const StatoDOSEWS *sys, void *buf);
+
+/* Scrittura atomica (file temporaneo + rename). Ritorna 0 o -1. */
+int salva_checkpoint(const StatoDOSEWS *sys, const char *percorso);
+
+/* Ripristina lo stato da file via mmap. sys deve essere già inizializzato con
+ * init_dosews, con edifici e spettro già collegati; frequenza, finestre e
+ * filtro devono coincidere con quelli del checkpoint, la restante
+ * configurazione resta quella corrente. Nulla cambia se il checkpoint è
+ * rifiutato. Ritorna 0 in caso di successo, -1 se il file manca, è
+ * corrotto o incompatibile. */
+int carica_checkpoint(StatoDOSEWS *sys, const char *percorso);
+
+/* Scrittura periodica in background: il thread di elaborazione copia lo stato
+ * in un buffer di appoggio (memcpy, nessuna syscall) e un thread separato lo
+ * scrive su disco senza tenere il lock. Se lo scrittore è ancora su disco
+ * l'istantanea in attesa è sostituita dalla più recente: su disco arriva
+ * sempre l'ultima, mai una coda. Il periodo è saltato solo se il lock è
+ * conteso in quell'istante (lo scambio dei buffer), mai atteso. */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned char *istantanea;     /* ultima copia pronta per la scrittura */
+    unsigned char *in_scrittura;   /* copia posseduta dal thread di scrittura */
+    size_t dimensione;
+    int pendente;
+    int termina;
+    long long periodo_campioni;
+    long long saltati;             /* istantanee mai scritte: sostituite o con il lock conteso */
+    char percorso[256];
+} ScrittoreCheckpoint;
+
+int avvia_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys,
+                               const char *percorso, long long periodo_campioni);
+
+/* Da chiamare dopo processa_campione: ogni periodo_campioni campioni accoda
+ * un'istantanea senza attendere il thread di scrittura. */
+void aggiorna_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys);
+
+/* Accoda lo stato finale, attende la scrittura e libera le risorse. */
+void ferma_scrittore_checkpoint(ScrittoreCheckpoint *s, const StatoDOSEWS *sys);
+
+#endif
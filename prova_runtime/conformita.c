@@ -0,0 +1,367 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dosews.h"
+#include "varianti.h"
+#include "archivio.h"
+#include "conformita.h"
+
+/* Conformità dei percorsi veloci al riferimento:
+ *   conformita [-m modo,...] [-n ripetizioni] [-s] registrazione.txt|archivio.dws ...
+ * Il riferimento è processa_campione in doppia precisione con il trigger
+ * STA/LTA. Ogni modo candidato processa le stesse
+ * registrazioni; per ciascuna:
+ *   - errore massimo di spost_filt, assoluto e relativo al massimo del
+ *     riferimento, sui campioni in cui entrambi sono già scattati;
+ *   - errore relativo del PGD massimo e del PGD d'allarme;
+ *   - differenza degli indici di trigger e di allarme, in campioni (quelli
+ *     di refactor/, da 0, riportati a campioni processati come dosews);
+ *   - decisione diversa (trigger o allarme sì/no);
+ *   - ns/campione del riferimento e del modo, senza la registrazione di
+ *     spost_filt.
+ * Modi: variante (seleziona_variante), refactor (motore batch di refactor/,
+ * che avvia gli integratori dal campione precedente al trigger), e su
+ * richiesta i trigger bande, allen e adattivo, che non devono coincidere.
+ * Default: i primi due.
+ * Con -s, o senza registrazioni, si aggiungono registrazioni sintetiche
+ * (rumore ed eventi di ampiezza crescente). Esce con 1 se una decisione
+ * differisce. */
+
+#define FREQUENZA        200.0
+#define FC_HIGHPASS      0.075
+#define STA_SEC          0.5
+#define LTA_SEC          6.0
+#define SOGLIA_STA_LTA   4.0
+#define TIPOLOGIA        "RC"
+#define N_PIANI          3
+#define SOGLIA_DANNO     "EDS"
+#define RIPETIZIONI      3
+#define SECONDI_SINTETICI 120.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum { VARIANTE, REFACTOR, BANDE, ALLEN, ADATTIVO, N_MODI };
+
+static const char *const NOMI_MODO[N_MODI] = {
+    "variante", "refactor", "bande", "allen", "adattivo"
+};
+
+/* g di picco degli eventi sintetici; 0: solo rumore */
+static const double AMPIEZZE_SINTETICHE[] = { 0.0, 0.01, 0.05, 0.2, 0.5 };
+#define N_SINTETICHE (int)(sizeof(AMPIEZZE_SINTETICHE) / sizeof(AMPIEZZE_SINTETICHE[0]))
+
+typedef struct {
+    long long indice_trigger, indice_allarme;   /* -1 se assenti */
+    double pgd_max, pgd_allarme;
+} Esito;
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double *leggi_testo(const char *percorso, long *n) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return NULL;
+    }
+    long capacita = 1 << 16;
+    double *dati = malloc(capacita * sizeof(double));
+    *n = 0;
+    double valore;
+    while (dati && fscanf(fp, "%lf", &valore) == 1) {
+        if (*n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(dati, capacita * sizeof(double));
+            if (!nuovo) {
+                free(dati);
+                dati = NULL;
+                break;
+            }
+            dati = nuovo;
+        }
+        dati[(*n)++] = valore;
+    }
+    fclose(fp);
+    return dati;
+}
+
+/* Archivio .dws o testo; la frequenza dell'archivio non è controllata: le
+ * registrazioni sono attese a FREQUENZA */
+static double *leggi_registrazione(const char *percorso, long *n) {
+    Archivio a;
+    if (apri_archivio(&a, percorso) != 0) {
+        return leggi_testo(percorso, n);
+    }
+    double *dati = malloc((a.intestazione->n_campioni + 1) * sizeof(double));
+    *n = 0;
+    for (unsigned int k = 0; dati && k < a.intestazione->n_blocchi; k++) {
+        *n += decodifica_blocco_archivio(&a, k, dati + *n);
+    }
+    chiudi_archivio(&a);
+    return dati;
+}
+
+/* Rumore gaussiano di 2e-4 g più, a 40 s, un impulso con inviluppo
+ * t^2 e^{-t/2} su tre componenti tra 0.4 e 3 Hz, di picco circa ampiezza */
+static double *sintetica(double ampiezza, long *n) {
+    *n = (long)(SECONDI_SINTETICI * FREQUENZA);
+    double *dati = malloc(*n * sizeof(double));
+    unsigned long long seme = 12345 + (unsigned long long)(ampiezza * 1e4);
+    for (long i = 0; dati && i < *n; i++) {
+        double u[2];
+        for (int k = 0; k < 2; k++) {
+            seme = seme * 6364136223846793005ULL + 1442695040888963407ULL;
+            u[k] = ((seme >> 11) + 0.5) / 9007199254740992.0;
+        }
+        double t = i / FREQUENZA - 40.0;
+        double evento = 0.0;
+        if (t > 0.0) {
+            double inviluppo = t * t * exp(-t / 2.0) / (16.0 * exp(-2.0));
+            evento = ampiezza * inviluppo * (0.5 * sin(2.0 * M_PI * 3.0 * t)
+                                           + 0.3 * sin(2.0 * M_PI * 1.2 * t + 1.0)
+                                           + 0.2 * sin(2.0 * M_PI * 0.4 * t + 2.0));
+        }
+        dati[i] = 2e-4 * sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]) + evento;
+    }
+    return dati;
+}
+
+static void config_modo(ConfigSistema *config, int modo) {
+    memset(config, 0, sizeof(*config));
+    config->frequenza = FREQUENZA;
+    config->dt = 1.0 / FREQUENZA;
+    config->sta_sec = STA_SEC;
+    config->lta_sec = LTA_SEC;
+    config->soglia_sta_lta = SOGLIA_STA_LTA;
+    config->tipo_trigger = (modo == BANDE) ? TRIGGER_BANDE
+                         : (modo == ALLEN) ? TRIGGER_ALLEN
+                         : (modo == ADATTIVO) ? TRIGGER_ADATTIVO : TRIGGER_STA_LTA;
+    config->fc_hp = FC_HIGHPASS;
+    config->n_piani = N_PIANI;
+    strncpy(config->tipologia, TIPOLOGIA, sizeof(config->tipologia) - 1);
+    strncpy(config->soglia_target, SOGLIA_DANNO, sizeof(config->soglia_target) - 1);
+}
+
+/* Riferimento con modo < 0. spost (se non NULL): spost_filt dopo ogni
+ * campione, NAN finché il motore non è scattato. Ritorna ns/campione, -1
+ * se errore. */
+static double esegui(int modo, const double *dati, long n, double *spost, Esito *e) {
+    double t0;
+    if (modo == REFACTOR) {
+        EsitoMotoreRefactor r;
+        t0 = ora();
+        if (esegui_motore_refactor(dati, n, spost, &r) != 0) {
+            return -1.0;
+        }
+        double durata = ora() - t0;
+        /* refactor/ integra dal campione dopo quello del trigger */
+        for (long i = 0; spost && i < n && (r.indice_trigger < 0 || i <= r.indice_trigger); i++) {
+            spost[i] = NAN;
+        }
+        /* Indici di refactor/ da 0, di dosews in campioni processati */
+        *e = (Esito){ r.indice_trigger < 0 ? -1 : r.indice_trigger + 1,
+                      r.indice_allarme < 0 ? -1 : r.indice_allarme + 1, r.pgd_max, r.pgd_allarme };
+        return durata * 1e9 / n;
+    }
+
+    ConfigSistema config;
+    config_modo(&config, modo < 0 ? VARIANTE : modo);
+    StatoDOSEWS sys;
+    if (init_dosews(&sys, &config) != 0) {
+        return -1.0;
+    }
+    FunzioneProcessa processa = (modo < 0) ? processa_campione : seleziona_variante(&sys, NULL);
+    t0 = ora();
+    if (spost) {
+        for (long i = 0; i < n; i++) {
+            processa(&sys, dati[i]);
+            spost[i] = (sys.indice_trigger >= 0) ? sys.filtro_spost.y1 : NAN;
+        }
+    } else {
+        for (long i = 0; i < n; i++) {
+            processa(&sys, dati[i]);
+        }
+    }
+    double durata = ora() - t0;
+    *e = (Esito){ sys.indice_trigger, (sys.fase == STATO_ALLARME) ? sys.indice_allarme : -1,
+                  sys.pgd_max, sys.pgd_allarme };
+    free_dosews(&sys);
+    return durata * 1e9 / n;
+}
+
+/* Minimo su più ripetizioni, senza registrare spost_filt */
+static double cronometra(int modo, const double *dati, long n, int ripetizioni) {
+    double migliore = -1.0;
+    for (int r = 0; r < ripetizioni; r++) {
+        Esito e;
+        double ns = esegui(modo, dati, n, NULL, &e);
+        if (ns < 0.0) {
+            return -1.0;
+        }
+        if (migliore < 0.0 || ns < migliore) migliore = ns;
+    }
+    return migliore;
+}
+
+static double errore_relativo(double candidato, double riferimento) {
+    if (riferimento == 0.0) {
+        return (candidato == 0.0) ? 0.0 : INFINITY;
+    }
+    return fabs(candidato - riferimento) / fabs(riferimento);
+}
+
+static void stampa_indice(long long riferimento, long long candidato) {
+    if (riferimento < 0 && candidato < 0) {
+        printf(" %7s", "-");
+    } else if (riferimento < 0 || candidato < 0) {
+        printf(" %7s", "solo1");
+    } else {
+        printf(" %+7lld", candidato - riferimento);
+    }
+}
+
+/* Ritorna 1 se una decisione differisce, -1 se errore */
+static int confronta(const char *nome, const double *dati, long n,
+                     const int *modi, int n_modi, int ripetizioni) {
+    double *rif = malloc(n * sizeof(double));
+    double *cand = malloc(n * sizeof(double));
+    Esito er;
+    if (!rif || !cand || esegui(-1, dati, n, rif, &er) < 0.0) {
+        free(rif);
+        free(cand);
+        return -1;
+    }
+    double ns_rif = cronometra(-1, dati, n, ripetizioni);
+    double spost_max = 0.0;
+    for (long i = 0; i < n; i++) {
+        if (!isnan(rif[i])) spost_max = fmax(spost_max, fabs(rif[i]));
+    }
+
+    int diverse = 0;
+    for (int m = 0; m < n_modi; m++) {
+        Esito ec;
+        if (esegui(modi[m], dati, n, cand, &ec) < 0.0) {
+            free(rif);
+            free(cand);
+            return -1;
+        }
+        double ns = cronometra(modi[m], dati, n, ripetizioni);
+
+        double errore = 0.0;
+        long confrontati = 0;
+        for (long i = 0; i < n; i++) {
+            if (!isnan(rif[i]) && !isnan(cand[i])) {
+                errore = fmax(errore, fabs(cand[i] - rif[i]));
+                confrontati++;
+            }
+        }
+
+        int trigger_diverso = (er.indice_trigger >= 0) != (ec.indice_trigger >= 0);
+        int allarme_diverso = (er.indice_allarme >= 0) != (ec.indice_allarme >= 0);
+        diverse |= trigger_diverso || allarme_diverso;
+
+        printf("%-24s %-11s", nome, NOMI_MODO[modi[m]]);
+        if (confrontati > 0) {
+            printf(" %11.3e %9.2e", errore, spost_max > 0.0 ? errore / spost_max : 0.0);
+        } else {
+            printf(" %11s %9s", "-", "-");
+        }
+        printf(" %9.2e", errore_relativo(ec.pgd_max, er.pgd_max));
+        if (er.indice_allarme >= 0 && ec.indice_allarme >= 0) {
+            printf(" %9.2e", errore_relativo(ec.pgd_allarme, er.pgd_allarme));
+        } else {
+            printf(" %9s", "-");
+        }
+        stampa_indice(er.indice_trigger, ec.indice_trigger);
+        stampa_indice(er.indice_allarme, ec.indice_allarme);
+        printf("  %-9s %8.2f %8.2f\n",
+               trigger_diverso ? "TRIGGER" : allarme_diverso ? "ALLARME" : "uguale", ns_rif, ns);
+    }
+    free(rif);
+    free(cand);
+    return diverse;
+}
+
+/* "variante,refactor" -> indici dei modi; ritorna quanti, -1 se ignoto */
+static int leggi_modi(char *elenco, int *modi) {
+    int n = 0;
+    for (char *nome = strtok(elenco, ","); nome; nome = strtok(NULL, ",")) {
+        int trovato = -1;
+        for (int m = 0; m < N_MODI; m++) {
+            if (strcmp(nome, NOMI_MODO[m]) == 0) trovato = m;
+        }
+        if (trovato < 0 || n == N_MODI) {
+            return -1;
+        }
+        modi[n++] = trovato;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    int modi[N_MODI] = { VARIANTE, REFACTOR };
+    int n_modi = 2, ripetizioni = RIPETIZIONI, sintetiche = 0, n_file = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            n_modi = leggi_modi(argv[++i], modi);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ripetizioni = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            sintetiche = 1;
+        } else if (argv[i][0] != '-') {
+            argv[++n_file] = argv[i];
+        } else {
+            n_modi = -1;
+            break;
+        }
+    }
+    if (n_modi <= 0 || ripetizioni < 1) {
+        fprintf(stderr, "Uso: %s [-m modo,...] [-n ripetizioni] [-s] registrazione.txt|archivio.dws ...\n"
+                        "     modi: variante refactor bande allen adattivo\n", argv[0]);
+        return 1;
+    }
+    if (n_file == 0) {
+        sintetiche = 1;
+    }
+
+    printf("%-24s %-11s %11s %9s %9s %9s %7s %7s  %-9s %8s %8s\n", "registrazione", "modo",
+           "spost [m]", "rel", "PGD rel", "PGDa rel", "trigger", "allarme", "decisione", "ns rif", "ns modo");
+
+    int esito = 0;
+    for (int f = 0; f < n_file + (sintetiche ? N_SINTETICHE : 0); f++) {
+        long n;
+        char nome[64];
+        double *dati;
+        if (f < n_file) {
+            dati = leggi_registrazione(argv[f + 1], &n);
+            snprintf(nome, sizeof(nome), "%s", argv[f + 1]);
+        } else {
+            double ampiezza = AMPIEZZE_SINTETICHE[f - n_file];
+            dati = sintetica(ampiezza, &n);
+            snprintf(nome, sizeof(nome), "sintetica %.2f g", ampiezza);
+        }
+        if (!dati || n == 0) {
+            fprintf(stderr, "Errore: impossibile leggere %s\n", nome);
+            free(dati);
+            esito = 1;
+            continue;
+        }
+        int diverse = confronta(nome, dati, n, modi, n_modi, ripetizioni);
+        free(dati);
+        if (diverse < 0) {
+            fprintf(stderr, "Errore: inizializzazione fallita\n");
+            return 1;
+        }
+        esito |= diverse;
+    }
+    return esito;
+}
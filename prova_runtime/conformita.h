@@ -0,0 +1,23 @@
+#ifndef CONFORMITA_H
+#define CONFORMITA_H
+
+/* Motore batch di refactor/ visto dall'harness di conformità. L'adattatore
+ * (conformita_refactor.c) è l'unico simbolo globale del suo oggetto: filter,
+ * trigger e allarme di refactor/ hanno gli stessi nomi di quelli di questa
+ * cartella con firme diverse, e restano locali (vedi makefile). Nessun tipo
+ * dei due motori attraversa questa interfaccia. */
+
+typedef struct {
+    long long indice_trigger;      /* -1 se non è scattato */
+    long long indice_allarme;      /* -1 senza allarme */
+    double pgd_max;                /* m */
+    double pgd_allarme;            /* m */
+} EsitoMotoreRefactor;
+
+/* Processa n campioni in g con la configurazione di refactor/main.c (200 Hz,
+ * RC 3 piani, soglia EDS). Se spost non è NULL vi scrive lo spostamento
+ * filtrato dopo ogni campione [m]. Ritorna 0, -1 se l'inizializzazione
+ * fallisce. */
+int esegui_motore_refactor(const double *acc_g, long n, double *spost, EsitoMotoreRefactor *esito);
+
+#endif
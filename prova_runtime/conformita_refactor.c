@@ -0,0 +1,26 @@
+#include "conformita.h"
+#include "motore.h"   /* di refactor/: compilato con -I../refactor */
+#include "costanti.h"
+
+/* Stessi parametri di refactor/main.c */
+#define FREQUENZA      200.0
+#define INDICE_INIZIO  1200
+
+int esegui_motore_refactor(const double *acc_g, long n, double *spost, EsitoMotoreRefactor *esito) {
+    StatoMotore m;
+    if (init_motore(&m, FREQUENZA, 0.075, 0.5, 6.0, 4, INDICE_INIZIO, "RC", 3, "EDS") != 0) {
+        return -1;
+    }
+    for (long i = 0; i < n; i++) {
+        avanza_motore(&m, acc_g[i] * G);
+        if (spost) {
+            spost[i] = m.y1_spost;
+        }
+    }
+    esito->indice_trigger = m.indice_trigger;
+    esito->indice_allarme = m.allarme_attivo ? m.indice_allarme : -1;
+    esito->pgd_max = m.pgd_max;
+    esito->pgd_allarme = m.pgd_allarme;
+    free_motore(&m);
+    return 0;
+}
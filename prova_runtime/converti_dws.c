@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "archivio.h"
+
+/* Conversione tra i file di testo (un valore per riga, come salva_dati) e
+ * l'archivio .dws:
+ *   converti_dws [-f frequenza] [-t t0] [-q quanto] <registrazione.txt> <registrazione.dws>
+ *   converti_dws -x <registrazione.dws> <registrazione.txt>
+ * Senza -q il quanto è il più fine che rappresenta il massimo assoluto della
+ * registrazione. Dopo la conversione l'archivio viene riletto: errore massimo
+ * di quantizzazione e velocità di decodifica. */
+
+#define FREQUENZA         200.0
+#define RIPETIZIONI_MIN   0.2    /* s di decodifica per la misura */
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double *leggi_testo(const char *percorso, long *n) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return NULL;
+    }
+    long capacita = 1 << 16;
+    double *dati = malloc(capacita * sizeof(double));
+    *n = 0;
+    double valore;
+    while (dati && fscanf(fp, "%lf", &valore) == 1) {
+        if (*n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(dati, capacita * sizeof(double));
+            if (!nuovo) {
+                free(dati);
+                dati = NULL;
+                break;
+            }
+            dati = nuovo;
+        }
+        dati[(*n)++] = valore;
+    }
+    fclose(fp);
+    return dati;
+}
+
+static int estrai(const char *ingresso, const char *uscita) {
+    Archivio a;
+    if (apri_archivio(&a, ingresso) != 0) {
+        fprintf(stderr, "Errore: %s non è un archivio valido\n", ingresso);
+        return 1;
+    }
+    FILE *fp = fopen(uscita, "w");
+    double *blocco = malloc(a.intestazione->campioni_blocco * sizeof(double));
+    if (!fp || !blocco) {
+        fprintf(stderr, "Errore: impossibile creare il file %s\n", uscita);
+        if (fp) fclose(fp);
+        free(blocco);
+        chiudi_archivio(&a);
+        return 1;
+    }
+    for (unsigned int k = 0; k < a.intestazione->n_blocchi; k++) {
+        int n = decodifica_blocco_archivio(&a, k, blocco);
+        for (int i = 0; i < n; i++) {
+            fprintf(fp, "%.10e\n", blocco[i]);
+        }
+    }
+    int ok = (fclose(fp) == 0);
+    free(blocco);
+    chiudi_archivio(&a);
+    return ok ? 0 : 1;
+}
+
+/* Rilettura: errore massimo rispetto al testo e GB/s di double decodificati */
+static int verifica(const char *percorso, const double *originale, long n) {
+    Archivio a;
+    if (apri_archivio(&a, percorso) != 0 || (long)a.intestazione->n_campioni != n) {
+        fprintf(stderr, "Errore: rilettura di %s fallita\n", percorso);
+        return 1;
+    }
+    double *decodificati = malloc((n > 0 ? n : 1) * sizeof(double));
+    if (!decodificati) {
+        chiudi_archivio(&a);
+        return 1;
+    }
+
+    double errore = 0.0;
+    long long letti = leggi_finestra_archivio(&a, a.intestazione->t0,
+                                              n / a.intestazione->frequenza + 1.0,
+                                              decodificati, n);
+    for (long i = 0; i < letti; i++) {
+        errore = fmax(errore, fabs(decodificati[i] - originale[i]));
+    }
+
+    /* Decodifica blocco per blocco in un buffer che resta in cache, come
+     * quando i campioni passano subito alla catena */
+    long long campioni = 0;
+    double t0 = ora(), t;
+    do {
+        for (unsigned int k = 0; k < a.intestazione->n_blocchi; k++) {
+            campioni += decodifica_blocco_archivio(&a, k, decodificati);
+        }
+        t = ora() - t0;
+    } while (t < RIPETIZIONI_MIN);
+
+    printf("Rilettura: %lld/%ld campioni, errore massimo %.3e (quanto/2 = %.3e)\n",
+           letti, n, errore, a.intestazione->quanto / 2);
+    printf("Decodifica: %.2f ns/campione, %.2f GB/s di double\n",
+           t * 1e9 / campioni, campioni * sizeof(double) / t * 1e-9);
+
+    int ok = (letti == n && errore <= a.intestazione->quanto / 2);
+    free(decodificati);
+    chiudi_archivio(&a);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    double frequenza = FREQUENZA, t0 = 0.0, quanto = 0.0;
+    const char *file[2] = { NULL, NULL };
+    int n_file = 0, estrazione = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            frequenza = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            t0 = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            quanto = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-x") == 0) {
+            estrazione = 1;
+        } else if (n_file < 2) {
+            file[n_file++] = argv[i];
+        } else {
+            n_file = 0;
+            break;
+        }
+    }
+    if (n_file != 2) {
+        fprintf(stderr, "Uso: %s [-f frequenza] [-t t0] [-q quanto] <registrazione.txt> <registrazione.dws>\n"
+                        "     %s -x <registrazione.dws> <registrazione.txt>\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (estrazione) {
+        return estrai(file[0], file[1]);
+    }
+
+    long n;
+    double *dati = leggi_testo(file[0], &n);
+    if (!dati) {
+        fprintf(stderr, "Errore: impossibile leggere %s\n", file[0]);
+        return 1;
+    }
+    if (quanto <= 0.0) {
+        double massimo = 0.0;
+        for (long i = 0; i < n; i++) {
+            massimo = fmax(massimo, fabs(dati[i]));
+        }
+        quanto = quanto_per_ampiezza(massimo);
+    }
+
+    ScrittoreArchivio s;
+    if (apri_scrittore_archivio(&s, file[1], frequenza, t0, quanto) != 0) {
+        fprintf(stderr, "Errore: impossibile creare %s\n", file[1]);
+        free(dati);
+        return 1;
+    }
+    int errore = scrivi_archivio(&s, dati, n) != 0;
+    errore = (chiudi_scrittore_archivio(&s) != 0) || errore;
+    if (errore) {
+        fprintf(stderr, "Errore: scrittura di %s fallita (valori oltre %d quanti?)\n",
+                file[1], ARCHIVIO_LIMITE_INTERO);
+        free(dati);
+        return 1;
+    }
+
+    FILE *fp = fopen(file[1], "rb");
+    long dimensione = 0;
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        dimensione = ftell(fp);
+        fclose(fp);
+    }
+    printf("%s: %ld campioni a %.1f Hz, quanto %.3e, %ld byte (%.2f byte/campione)\n",
+           file[1], n, frequenza, quanto, dimensione, n > 0 ? (double)dimensione / n : 0.0);
+
+    int esito = verifica(file[1], dati, n);
+    free(dati);
+    return esito;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "portafoglio.h"
+
+/* Converte un inventario testuale, una riga per edificio:
+ *   TIPOLOGIA N_PIANI LAT LON STAZIONE
+ * nel formato binario letto da carica_portafoglio. */
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Uso: %s <inventario.txt> <inventario.bin>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[1], "r");
+    if (!fp) {
+        fprintf(stderr, "Errore: impossibile aprire il file %s\n", argv[1]);
+        return 1;
+    }
+
+    char riga[256];
+    int capacita = 0;
+    while (fgets(riga, sizeof(riga), fp)) {
+        capacita++;
+    }
+    rewind(fp);
+
+    Portafoglio p;
+    if (init_portafoglio(&p, capacita) != 0) {
+        fprintf(stderr, "Errore: inventario vuoto o memoria insufficiente\n");
+        fclose(fp);
+        return 1;
+    }
+
+    int n_riga = 0;
+    while (fgets(riga, sizeof(riga), fp)) {
+        char nome[16];
+        int n_piani, stazione;
+        double lat, lon;
+        n_riga++;
+        if (riga[0] == '#' || riga[0] == '\n') {
+            continue;
+        }
+        int tipologia = -1;
+        if (sscanf(riga, "%15s %d %lf %lf %d", nome, &n_piani, &lat, &lon, &stazione) == 5) {
+            tipologia = tipologia_da_nome(nome);
+        }
+        if (tipologia < 0 || aggiungi_edificio(&p, (Tipologia)tipologia, n_piani, lat, lon, stazione) < 0) {
+            fprintf(stderr, "Errore: riga %d non valida\n", n_riga);
+            fclose(fp);
+            free_portafoglio(&p);
+            return 1;
+        }
+    }
+    fclose(fp);
+
+    if (salva_portafoglio(&p, argv[2]) != 0) {
+        fprintf(stderr, "Errore: scrittura di %s fallita\n", argv[2]);
+        free_portafoglio(&p);
+        return 1;
+    }
+    printf("%d edifici scritti in %s\n", p.n_edifici, argv[2]);
+    free_portafoglio(&p);
+    return 0;
+}
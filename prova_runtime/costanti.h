@@ -0,0 +1,7 @@
+#ifndef COSTANTI_H
+#define COSTANTI_H
+
+/* Accelerazione di gravità [m/s^2]: registrazioni e soglie sono in g */
+#define G 9.81
+
+#endif
@@ -1,12 +1,30 @@
 #include "dosews.h"
-#include "output.h"
+#include "catena.h"
+#include "costanti.h"
 #include <math.h>
 #include <string.h>
-#include <stdio.h>
 
-#define G 9.81
+/* Pd di soglia della regola anticipata per lo stato di danno obiettivo.
+ * PARAMETRI_P_SOGLIA_PD vale per EDS; letto come PGD, si sposta come il PGD
+ * che la regressione drift-PGD di allarme.h associa al drift obiettivo.
+ * Con un obiettivo sconosciuto nessun allarme, come per il PGD. */
+static double soglia_pd_target(const ConfigSistema *config) {
+    const ConfigurazioneAllarme *c = get_configurazione(config->tipologia, config->n_piani);
+    double drift;
+    if (strcmp(config->soglia_target, "MDS") == 0) {
+        drift = c->mds;
+    } else if (strcmp(config->soglia_target, "EDS") == 0) {
+        drift = c->eds;
+    } else if (strcmp(config->soglia_target, "CDS") == 0) {
+        drift = c->cds;
+    } else {
+        return HUGE_VAL;
+    }
+    return PARAMETRI_P_SOGLIA_PD * pow(drift / c->eds, 1.0 / REGRESSIONE_PENDENZA);
+}
 
-int init_dosews(StatoDOSEWS *sys, const ConfigSistema *config) {
+/* Inizializzazione comune: con arena NULL i buffer vengono allocati */
+static int init_comune(StatoDOSEWS *sys, const ConfigSistema *config, Arena *arena) {
     memset(sys, 0, sizeof(StatoDOSEWS));
     sys->config = *config;
 
@@ -19,14 +37,20 @@ int init_dosews(StatoDOSEWS *sys, const ConfigSistema *config) {
     reset_stato_filtro(&sys->filtro_spost);
 
     // Inizializza trigger
-    if (init_trigger(&sys->trigger, config->frequenza,
-                     config->sta_sec, config->lta_sec) != 0) {
+    int esito = arena
+        ? init_trigger_arena(&sys->trigger, config->frequenza, config->sta_sec, config->lta_sec,
+                             config->tipo_trigger, arena)
+        : init_trigger(&sys->trigger, config->frequenza, config->sta_sec, config->lta_sec,
+                       config->tipo_trigger);
+    if (esito != 0) {
         return -1;
     }
 
     // Inizializza integratori
     init_integratore(&sys->int_vel);
     init_integratore(&sys->int_spost);
+    init_parametri_p(&sys->parametri_p, config->frequenza, soglia_pd_target(config));
+    init_intensita(&sys->intensita, config->frequenza);
 
     sys->fase = STATO_ATTESA_TRIGGER;
     sys->pgd_max = 0.0;
@@ -34,18 +58,109 @@ int init_dosews(StatoDOSEWS *sys, const ConfigSistema *config) {
     sys->indice_campione = 0;
     sys->indice_trigger = -1;
     sys->indice_allarme = -1;
+    sys->indice_sospeso = -1;
+    sys->evento_confermato = 0;
+    sys->allarme_anticipato = 0;
 
     return 0;
 }
 
+int init_dosews(StatoDOSEWS *sys, const ConfigSistema *config) {
+    return init_comune(sys, config, NULL);
+}
+
+size_t dimensione_memoria_dosews(const ConfigSistema *config) {
+    if (!finestre_trigger_valide(config->frequenza, config->sta_sec, config->lta_sec)) {
+        return 0;
+    }
+    size_t dim = memoria_trigger(config->frequenza, config->sta_sec, config->lta_sec, config->tipo_trigger);
+    /* TRIGGER_BANDE non chiede buffer: almeno un blocco, perché 0 è l'errore */
+    return (dim > 0) ? dim : ARENA_ALLINEAMENTO;
+}
+
+int init_dosews_arena(StatoDOSEWS *sys, const ConfigSistema *config,
+                      void *memoria, size_t dimensione) {
+    Arena arena;
+    if (init_arena(&arena, memoria, dimensione) != 0) {
+        return -1;
+    }
+    return init_comune(sys, config, &arena);
+}
+
 void free_dosews(StatoDOSEWS *sys) {
     free_trigger(&sys->trigger);
 }
 
+void imposta_callback_dosews(StatoDOSEWS *sys, const CallbackDOSEWS *callback) {
+    sys->callback = *callback;
+}
+
+void imposta_edifici_dosews(StatoDOSEWS *sys, BancoOscillatori *edifici) {
+    sys->edifici = edifici;
+    if (edifici) {
+        azzera_oscillatori(edifici);
+    }
+}
+
+void imposta_spettro_dosews(StatoDOSEWS *sys, SpettroRisposta *spettro) {
+    sys->spettro = spettro;
+    if (spettro) {
+        azzera_spettro(spettro);
+    }
+}
+
+void imposta_veto_trigger_dosews(StatoDOSEWS *sys, const atomic_int *veto) {
+    sys->veto_trigger = veto;
+}
+
+void segnala_trigger(StatoDOSEWS *sys) {
+    if (sys->veto_trigger && atomic_load_explicit(sys->veto_trigger, memory_order_acquire)) {
+        /* Il motore riarmato riscatta al campione dopo: campioni consecutivi
+         * oltre soglia sono un solo trigger sospeso */
+        if (sys->indice_campione != sys->indice_sospeso + 1) {
+            sys->trigger_sospesi++;
+        }
+        sys->indice_sospeso = sys->indice_campione;
+        sys->trigger.triggered = 0;
+        return;
+    }
+    sys->fase = STATO_TRIGGERED;
+    sys->indice_trigger = sys->indice_campione;
+    if (sys->callback.trigger) {
+        sys->callback.trigger(sys->callback.contesto, sys);
+    }
+}
+
+void segnala_allarme(StatoDOSEWS *sys, double pgd) {
+    sys->fase = STATO_ALLARME;
+    sys->indice_allarme = sys->indice_campione;
+    sys->pgd_allarme = pgd;
+    if (sys->callback.allarme) {
+        sys->callback.allarme(sys->callback.contesto, sys);
+    }
+}
+
+/* Catena dopo il trigger (catena.h) con il filtro e la soglia generici */
+static double filtra_generico(double x, StatoFiltro *s, const void *contesto) {
+    const StatoDOSEWS *sys = contesto;
+    return applica_filtro(x, &sys->coeff_hp, s);
+}
+
+static int supera_generico(const StatoDOSEWS *sys, double pgd, const void *contesto) {
+    (void)contesto;
+    const ConfigSistema *cfg = &sys->config;
+    return valuta_allarme_istantaneo(pgd, cfg->tipologia, cfg->n_piani, cfg->soglia_target);
+}
+
+static StatoSistema avanza_catena(StatoDOSEWS *sys, double acc_filt) {
+    return avanza_catena_comune(sys, acc_filt, sys->config.dt, filtra_generico, supera_generico, sys);
+}
+
 StatoSistema processa_campione(StatoDOSEWS *sys, double acc_g) {
     const ConfigSistema *cfg = &sys->config;
 
     double acc_ms2 = acc_g * G;
+
     double acc_filt = applica_filtro(acc_ms2, &sys->coeff_hp, &sys->filtro_acc);
 
     sys->indice_campione++;
@@ -53,85 +168,63 @@ StatoSistema processa_campione(StatoDOSEWS *sys, double acc_g) {
     if (sys->fase == STATO_ATTESA_TRIGGER) {
         int scattato = aggiorna_trigger(&sys->trigger, acc_filt, cfg->soglia_sta_lta);
         if (scattato) {
-            sys->fase = STATO_TRIGGERED;
-            sys->indice_trigger = sys->indice_campione;
-            printf("Trigger rilevato a: %.3f s (campione %lld)\n",
-                   sys->indice_campione / cfg->frequenza, sys->indice_campione);
+            segnala_trigger(sys);
         }
         return sys->fase;
     }
 
-    double vel = aggiorna_integratore(&sys->int_vel, acc_filt, cfg->dt);
-
-    double vel_filt = applica_filtro(vel, &sys->coeff_hp, &sys->filtro_vel);
-
-    double spost = aggiorna_integratore(&sys->int_spost, vel_filt, cfg->dt);
-
-    double spost_filt = applica_filtro(spost, &sys->coeff_hp, &sys->filtro_spost);
-
-    double pgd = fabs(spost_filt);
-
-    if (pgd > sys->pgd_max) {
-        sys->pgd_max = pgd;
-    }
-
-    if (sys->fase == STATO_TRIGGERED) {
-        int allarme = valuta_allarme_istantaneo(pgd, cfg->tipologia,
-                                                cfg->n_piani, cfg->soglia_target);
-        if (allarme) {
-            sys->fase = STATO_ALLARME;
-            sys->indice_allarme = sys->indice_campione;
-            sys->pgd_allarme = pgd;
-            printf(">>> ALLARME a: %.3f s (campione %lld)\n",
-                   sys->indice_campione / cfg->frequenza, sys->indice_campione);
-        }
-    }
+    return avanza_catena(sys, acc_filt);
+}
 
-    return sys->fase;
+void conferma_evento(StatoDOSEWS *sys) {
+    sys->evento_confermato = 1;
 }
 
-void stampa_risultati(const StatoDOSEWS *sys) {
+void calcola_risultati(const StatoDOSEWS *sys, RisultatiDOSEWS *r) {
     const ConfigSistema *cfg = &sys->config;
 
-    if (sys->indice_trigger < 0) {
-        printf("Nessun trigger rilevato.\n");
+    memset(r, 0, sizeof(*r));
+    r->triggered = (sys->indice_trigger >= 0);
+    r->allarme = (sys->fase == STATO_ALLARME);
+    r->pgd_allarme = sys->pgd_allarme;
+    r->pgd_max = sys->pgd_max;
+    r->allarme_anticipato = sys->allarme_anticipato;
+    r->tau_c = sys->parametri_p.tau_c;
+    r->pd = sys->parametri_p.pd;
+    r->tau_p_max = sys->parametri_p.tau_p_max;
+    r->pga = sys->intensita.pga;
+    r->pgv = sys->intensita.pgv;
+    r->cav = cav_intensita(&sys->intensita);
+    r->arias = arias_intensita(&sys->intensita);
+    r->durata_bracketed = durata_intensita(&sys->intensita);
+    if (!r->triggered) {
         return;
     }
 
     const ConfigurazioneAllarme *config_danno = get_configurazione(cfg->tipologia, cfg->n_piani);
 
-    double soglia_fisica, soglia_prob;
     if (strcmp(cfg->soglia_target, "MDS") == 0) {
-        soglia_fisica = config_danno->mds;
-        soglia_prob   = config_danno->p_mds;
+        r->soglia_fisica = config_danno->mds;
+        r->soglia_prob   = config_danno->p_mds;
     } else if (strcmp(cfg->soglia_target, "EDS") == 0) {
-        soglia_fisica = config_danno->eds;
-        soglia_prob   = config_danno->p_eds;
+        r->soglia_fisica = config_danno->eds;
+        r->soglia_prob   = config_danno->p_eds;
     } else {
-        soglia_fisica = config_danno->cds;
-        soglia_prob   = config_danno->p_cds;
+        r->soglia_fisica = config_danno->cds;
+        r->soglia_prob   = config_danno->p_cds;
     }
 
-    double t_trigger = sys->indice_trigger / cfg->frequenza;
-    double t_allarme = (sys->indice_allarme >= 0) ? sys->indice_allarme / cfg->frequenza : 0.0;
-
-    double drift_mediano = 0.0;
-    double prob_calcolata = 0.0;
-    double lead_time = 0.0;
+    r->t_trigger = sys->indice_trigger / cfg->frequenza;
+    r->t_allarme = (sys->indice_allarme >= 0) ? sys->indice_allarme / cfg->frequenza : 0.0;
 
-    if (sys->fase == STATO_ALLARME) {
+    if (r->allarme) {
         double log10_drift = REGRESSIONE_INTERCETTA + REGRESSIONE_PENDENZA * log10(sys->pgd_allarme);
-        drift_mediano = pow(10.0, log10_drift);
-        prob_calcolata = calcola_probabilita_previsiva(sys->pgd_allarme, soglia_fisica);
+        r->drift_mediano = pow(10.0, log10_drift);
+        r->prob_calcolata = calcola_probabilita_previsiva(sys->pgd_allarme, r->soglia_fisica);
 
         /* Lead time = tempo tra allarme e fine del segnale (proxy del picco sismico) */
-        lead_time = (sys->pgd_max > sys->pgd_allarme)
-                    ? (sys->indice_campione - sys->indice_allarme) / cfg->frequenza
-                    : 0.0;
+        r->lead_time = (sys->pgd_max > sys->pgd_allarme)
+                       ? (sys->indice_campione - sys->indice_allarme) / cfg->frequenza
+                       : 0.0;
     }
-
-    stampa_report_allarme(cfg->soglia_target, t_trigger, t_allarme,
-                          sys->pgd_allarme, sys->pgd_max, drift_mediano,
-                          soglia_fisica, prob_calcolata, soglia_prob,
-                          lead_time, (sys->fase == STATO_ALLARME));
 }
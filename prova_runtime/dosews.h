@@ -5,6 +5,13 @@
 #include "trigger.h"
 #include "integrazione.h"
 #include "allarme.h"
+#include "parametri_p.h"
+#include "intensita.h"
+#include "oscillatori.h"
+#include "spettro.h"
+#include "arena.h"
+#include <stddef.h>
+#include <stdatomic.h>
 
 typedef enum {
     STATO_ATTESA_TRIGGER = 0, 
@@ -18,13 +25,46 @@ typedef struct {
     double sta_sec;            /* finestra STA [s] */
     double lta_sec;            /* finestra LTA [s] */
     double soglia_sta_lta;     /* rapporto STA/LTA per il trigger */
+    TipoTrigger tipo_trigger;  /* motore di trigger (default TRIGGER_STA_LTA) */
     double fc_hp;              /* frequenza di taglio high-pass [Hz] */
     char tipologia[16];        /* "RC", "URM_REG", "URM_STONE" */
     int n_piani;               /* numero piani edificio */
     char soglia_target[8];     /* "MDS", "EDS", "CDS" */
+    int richiede_conferma;     /* 1: allarme solo dopo conferma di rete (k-su-n) */
+    int decisione_anticipata;  /* 1: allarme anche da Pd e tau_c (parametri_p.h), Pd per soglia_target */
 } ConfigSistema;
 
+typedef struct StatoDOSEWS StatoDOSEWS;
+
+/* Notifiche delle transizioni di fase, chiamate da processa_campione sul
+ * thread di elaborazione: non devono bloccare. Campi NULL = nessuna notifica. */
+typedef struct {
+    void (*trigger)(void *contesto, const StatoDOSEWS *sys);
+    void (*allarme)(void *contesto, const StatoDOSEWS *sys);
+    void *contesto;
+} CallbackDOSEWS;
+
+/* Esito dell'evento corrente, per il report finale */
 typedef struct {
+    int triggered;
+    int allarme;
+    double t_trigger;          /* s */
+    double t_allarme;          /* s, 0 se nessun allarme */
+    double pgd_allarme;        /* m */
+    double pgd_max;            /* m */
+    double drift_mediano;      /* m, drift predetto al PGD d'allarme */
+    double soglia_fisica;      /* m */
+    double prob_calcolata;     /* %, al PGD d'allarme */
+    double soglia_prob;        /* % */
+    double lead_time;          /* s */
+    int allarme_anticipato;    /* allarme dalla regola su Pd e tau_c */
+    double tau_c, pd, tau_p_max;   /* parametri dell'onda P: s, m, s */
+    double pga, pgv;           /* m/s^2, m/s, dal trigger */
+    double cav, arias;         /* m/s, m/s */
+    double durata_bracketed;   /* s, oltre INTENSITA_SOGLIA_DURATA */
+} RisultatiDOSEWS;
+
+struct StatoDOSEWS {
     StatoSistema fase;
 
     CoeffFiltro coeff_hp;
@@ -36,23 +76,70 @@ typedef struct {
 
     StatoIntegratore int_vel;   /* acc → vel */
     StatoIntegratore int_spost; /* vel_filt → spost */
+    StatoParametriP parametri_p;
+    StatoIntensita intensita;   /* PGA, PGV, CAV, Arias, durata dal trigger */
+    BancoOscillatori *edifici;  /* opzionale, del chiamante: risposta simulata dopo il trigger */
+    SpettroRisposta *spettro;   /* opzionale, del chiamante: spettro dal trigger */
+    const atomic_int *veto_trigger;  /* opzionale: trigger rifiutati mentre vale non zero */
+    long long trigger_sospesi;  /* trigger rifiutati per il veto, uno per fronte di salita */
+    long long indice_sospeso;   /* ultimo campione con il trigger rifiutato, -1 se nessuno */
 
     double pgd_max;
     double pgd_allarme;
     long long indice_campione;  /* campioni totali processati */
     long long indice_trigger;   /* campione in cui è scattato il trigger */
     long long indice_allarme;   /* campione in cui è scattato l'allarme */
+    int evento_confermato;      /* impostato da conferma_evento */
+    int allarme_anticipato;     /* allarme dalla regola su Pd e tau_c */
 
     ConfigSistema config;
-} StatoDOSEWS;
+    CallbackDOSEWS callback;
+};
 
 /* Ritorna 0 in caso di successo, -1 se errore. */
 int init_dosews(StatoDOSEWS *sys, const ConfigSistema *config);
 
+/* Byte di memoria richiesti da init_dosews_arena per config; 0 se la
+ * configurazione non è valida. Multiplo di ARENA_ALLINEAMENTO, quindi le
+ * memorie di più stazioni possono stare una dopo l'altra in un solo blocco. */
+size_t dimensione_memoria_dosews(const ConfigSistema *config);
+
+/* Come init_dosews, ma tutti i buffer stanno in memoria (allineata ad
+ * ARENA_ALLINEAMENTO, almeno dimensione_memoria_dosews(config) byte), che
+ * resta del chiamante: free_dosews non la libera. Nessuna allocazione. */
+int init_dosews_arena(StatoDOSEWS *sys, const ConfigSistema *config,
+                      void *memoria, size_t dimensione);
+
 void free_dosews(StatoDOSEWS *sys);
 
+/* Callback per le transizioni di fase; senza, l'elaborazione è silenziosa. */
+void imposta_callback_dosews(StatoDOSEWS *sys, const CallbackDOSEWS *callback);
+
+/* Dal trigger in poi ogni campione di accelerazione filtrata [m/s^2] fa
+ * avanzare anche gli edifici del banco, azzerato qui. NULL per staccarlo. */
+void imposta_edifici_dosews(StatoDOSEWS *sys, BancoOscillatori *edifici);
+
+/* Come imposta_edifici_dosews, per lo spettro di risposta. */
+void imposta_spettro_dosews(StatoDOSEWS *sys, SpettroRisposta *spettro);
+
+/* Collega un veto sul trigger, di norma veto_salute (salute.h): finché vale
+ * non zero il trigger è rifiutato e il motore riarmato, senza cambiare
+ * fase. Il motore riscatta a ogni campione oltre soglia: trigger_sospesi
+ * conta i fronti di salita, non i campioni. Letto solo quando il trigger
+ * scatta. NULL per staccarlo. */
+void imposta_veto_trigger_dosews(StatoDOSEWS *sys, const atomic_int *veto);
+
 StatoSistema processa_campione(StatoDOSEWS *sys, double acc_g);
 
-void stampa_risultati(const StatoDOSEWS *sys);
+void calcola_risultati(const StatoDOSEWS *sys, RisultatiDOSEWS *r);
+
+/* Transizioni di fase con la relativa callback, al campione corrente;
+ * usate da processa_campione e dalle varianti specializzate. */
+void segnala_trigger(StatoDOSEWS *sys);
+void segnala_allarme(StatoDOSEWS *sys, double pgd);
+
+/* Segnala che l'associazione di rete ha confermato l'evento: con
+ * config.richiede_conferma l'allarme può scattare solo da questo momento. */
+void conferma_evento(StatoDOSEWS *sys);
 
 #endif
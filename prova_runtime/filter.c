@@ -29,6 +29,18 @@ void calcola_coeff_lowpass(double fs, double fc, CoeffFiltro *coeff) {
     coeff->b2 = (1.0 - sqrt(2.0) * K + K * K) * norm;
 }
 
+void calcola_coeff_bandpass(double fs, double f_centro, double q, CoeffFiltro *coeff) {
+    double omega_c = 2.0 * M_PI * f_centro / fs;
+    double alpha = sin(omega_c) / (2.0 * q);
+    double norm = 1.0 / (1.0 + alpha);
+
+    coeff->a0 =  alpha * norm;
+    coeff->a1 =  0.0;
+    coeff->a2 = -alpha * norm;
+    coeff->b1 = -2.0 * cos(omega_c) * norm;
+    coeff->b2 = (1.0 - alpha) * norm;
+}
+
 void reset_stato_filtro(StatoFiltro *stato) {
     stato->x1 = 0.0;
     stato->x2 = 0.0;
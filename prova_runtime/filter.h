@@ -13,6 +13,8 @@ typedef struct {
 
 void calcola_coeff_highpass(double fs, double fc, CoeffFiltro *coeff);
 void calcola_coeff_lowpass(double fs, double fc, CoeffFiltro *coeff);
+/* Passa-banda a guadagno unitario in f_centro, banda di circa f_centro / q */
+void calcola_coeff_bandpass(double fs, double f_centro, double q, CoeffFiltro *coeff);
 
 void filtro_highpass(const double *in, double *out, int n, const CoeffFiltro *coeff);
 void filtro_lowpass(const double *in, double *out, int n, const CoeffFiltro *coeff);
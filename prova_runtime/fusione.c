@@ -0,0 +1,63 @@
+#include "fusione.h"
+#include <stdlib.h>
+
+static int precede(const VoceFusione *a, const VoceFusione *b) {
+    return a->t < b->t || (a->t == b->t && a->flusso < b->flusso);
+}
+
+/* Riporta in posizione la voce i, che può solo essere cresciuta */
+static void scendi(CodaFusione *c, int i) {
+    VoceFusione voce = c->voci[i];
+    for (;;) {
+        int figlio = 2 * i + 1;
+        if (figlio >= c->n) break;
+        if (figlio + 1 < c->n && precede(&c->voci[figlio + 1], &c->voci[figlio])) {
+            figlio++;
+        }
+        if (!precede(&c->voci[figlio], &voce)) break;
+        c->voci[i] = c->voci[figlio];
+        i = figlio;
+    }
+    c->voci[i] = voce;
+}
+
+int init_coda_fusione(CodaFusione *c, int capacita) {
+    c->voci = malloc((size_t)(capacita > 0 ? capacita : 1) * sizeof(VoceFusione));
+    c->n = 0;
+    c->capacita = capacita;
+    return c->voci ? 0 : -1;
+}
+
+void free_coda_fusione(CodaFusione *c) {
+    free(c->voci);
+    c->voci = NULL;
+    c->n = c->capacita = 0;
+}
+
+int inserisci_fusione(CodaFusione *c, double t, int flusso) {
+    if (c->n == c->capacita) {
+        return -1;
+    }
+    VoceFusione voce = { t, flusso };
+    int i = c->n++;
+    while (i > 0) {
+        int padre = (i - 1) / 2;
+        if (!precede(&voce, &c->voci[padre])) break;
+        c->voci[i] = c->voci[padre];
+        i = padre;
+    }
+    c->voci[i] = voce;
+    return 0;
+}
+
+void avanza_fusione(CodaFusione *c, double t) {
+    c->voci[0].t = t;
+    scendi(c, 0);
+}
+
+void rimuovi_fusione(CodaFusione *c) {
+    if (--c->n > 0) {
+        c->voci[0] = c->voci[c->n];
+        scendi(c, 0);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef FUSIONE_H
+#define FUSIONE_H
+
+/* Fusione k-vie di flussi di campioni ordinati nel tempo: heap binario di
+ * coppie (istante, flusso) con in testa il prossimo campione da elaborare.
+ * A parità di istante viene prima il flusso con indice minore, quindi
+ * l'ordine di elaborazione dipende solo dai dati e non dai tempi di
+ * esecuzione. Costo O(log k) per campione. */
+
+typedef struct {
+    double t;                  /* istante del prossimo campione [s] */
+    int flusso;
+} VoceFusione;
+
+typedef struct {
+    VoceFusione *voci;
+    int n;
+    int capacita;
+} CodaFusione;
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int init_coda_fusione(CodaFusione *c, int capacita);
+void free_coda_fusione(CodaFusione *c);
+
+/* Ritorna 0, -1 se la coda è piena. */
+int inserisci_fusione(CodaFusione *c, double t, int flusso);
+
+/* Il flusso in testa avanza al campione successivo, all'istante t: una sola
+ * discesa invece di estrazione più inserimento. */
+void avanza_fusione(CodaFusione *c, double t);
+
+/* Il flusso in testa è esaurito. */
+void rimuovi_fusione(CodaFusione *c);
+
+#endif
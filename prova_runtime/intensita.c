@@ -0,0 +1,41 @@
+#include "intensita.h"
+#include "costanti.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void init_intensita(StatoIntensita *s, double frequenza) {
+    memset(s, 0, sizeof(*s));
+    s->dt = 1.0 / frequenza;
+    s->soglia = INTENSITA_SOGLIA_DURATA * G;
+    s->primo = -1;
+    s->ultimo = -1;
+}
+
+void aggiorna_intensita(StatoIntensita *s, double acc, double vel) {
+    double a = fabs(acc), v = fabs(vel);
+    if (a > s->pga) s->pga = a;
+    if (v > s->pgv) s->pgv = v;
+    s->somma_abs += a;
+    s->somma_quadrati += acc * acc;
+    if (a >= s->soglia) {
+        if (s->primo < 0) s->primo = s->campioni;
+        s->ultimo = s->campioni;
+    }
+    s->campioni++;
+}
+
+double cav_intensita(const StatoIntensita *s) {
+    return s->somma_abs * s->dt;
+}
+
+double arias_intensita(const StatoIntensita *s) {
+    return M_PI / (2.0 * G) * s->somma_quadrati * s->dt;
+}
+
+double durata_intensita(const StatoIntensita *s) {
+    return (s->primo < 0) ? 0.0 : (s->ultimo - s->primo) * s->dt;
+}
@@ -0,0 +1,33 @@
+#ifndef INTENSITA_H
+#define INTENSITA_H
+
+/* Misure di intensità del moto dal trigger in poi, aggiornate a ogni
+ * campione con accelerazione e velocità già filtrate dalla catena:
+ *   PGA   = max |a|                           [m/s^2]
+ *   PGV   = max |v|                           [m/s]
+ *   CAV   = somma |a| dt                      [m/s]
+ *   Arias = pi / (2 g) * somma a^2 dt         [m/s]
+ * e la durata bracketed: dal primo all'ultimo campione con |a| oltre
+ * INTENSITA_SOGLIA_DURATA. Stato costante, nessun buffer. */
+
+#define INTENSITA_SOGLIA_DURATA  0.05    /* g */
+
+typedef struct {
+    double pga, pgv;
+    double somma_abs, somma_quadrati;   /* di |a| e a^2 */
+    double dt;
+    double soglia;                      /* m/s^2 */
+    long long campioni;                 /* dal trigger */
+    long long primo, ultimo;            /* oltre soglia, -1 se nessuno */
+} StatoIntensita;
+
+void init_intensita(StatoIntensita *s, double frequenza);
+
+/* Un campione della catena dopo il trigger, O(1). */
+void aggiorna_intensita(StatoIntensita *s, double acc, double vel);
+
+double cav_intensita(const StatoIntensita *s);      /* m/s */
+double arias_intensita(const StatoIntensita *s);    /* m/s */
+double durata_intensita(const StatoIntensita *s);   /* s, 0 senza superamenti */
+
+#endif
@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "catalogo.h"
+#include "costanti.h"
+
+/* Interrogazioni sul catalogo degli eventi:
+ *   interroga_catalogo <catalogo> [-t da a] [-s stazione] [-p pgd_min] [-n max_righe]
+ *                      [allarmi|senza_allarme|lead_time|riepilogo]
+ * allarmi: record con allarme (default); senza_allarme: scattati senza
+ * allarme; lead_time: distribuzione del lead time degli allarmi;
+ * riepilogo: conteggi per esito. Apertura (con l'eventuale aggiornamento
+ * dell'indice) e interrogazione sono cronometrate a parte. */
+
+#define MAX_RIGHE  20
+
+enum { ALLARMI, SENZA_ALLARME, LEAD_TIME, RIEPILOGO };
+
+static double ora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int confronta_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void stampa_record(const Catalogo *c, unsigned int i) {
+    const RecordCatalogo *r = &c->record[i];
+    printf("%9u  %8u  %16.3f  %16.3f  %8.4f  %8.4f  %6.1f  %7.2f  %7.4f  %8.4f  %s%s  %016llx\n",
+           i, r->stazione, r->t_trigger, r->t_allarme, r->pgd_allarme * 100.0, r->pgd_max * 100.0,
+           r->prob, r->lead_time, r->pga / G, r->pgv * 100.0,
+           (r->esito & CATALOGO_ANTICIPATO) ? "A" : "-", (r->esito & CATALOGO_CONFERMATO) ? "C" : "-",
+           r->config);
+}
+
+static void stampa_lead_time(const Catalogo *c, const unsigned int *risultati, long long n) {
+    float *lead = malloc((size_t)(n > 0 ? n : 1) * sizeof(float));
+    if (!lead) {
+        return;
+    }
+    double somma = 0.0;
+    for (long long i = 0; i < n; i++) {
+        lead[i] = c->record[risultati[i]].lead_time;
+        somma += lead[i];
+    }
+    qsort(lead, (size_t)n, sizeof(float), confronta_float);
+    printf("Lead time su %lld allarmi [s]: media %.2f\n", n, n > 0 ? somma / n : 0.0);
+    if (n > 0) {
+        static const double QUANTILI[] = { 0.0, 0.05, 0.25, 0.5, 0.75, 0.95, 1.0 };
+        for (size_t q = 0; q < sizeof(QUANTILI) / sizeof(QUANTILI[0]); q++) {
+            printf("  q%-4.2f  %7.2f\n", QUANTILI[q], lead[(long long)(QUANTILI[q] * (n - 1) + 0.5)]);
+        }
+    }
+    free(lead);
+}
+
+static void stampa_riepilogo(const Catalogo *c, const unsigned int *risultati, long long n) {
+    long long allarmi = 0, anticipati = 0, confermati = 0;
+    double pgd_max = 0.0, pga_max = 0.0, pgv_max = 0.0;
+    for (long long i = 0; i < n; i++) {
+        const RecordCatalogo *r = &c->record[risultati[i]];
+        pga_max = fmax(pga_max, r->pga);
+        pgv_max = fmax(pgv_max, r->pgv);
+        allarmi += (r->esito & CATALOGO_ALLARME) != 0;
+        anticipati += (r->esito & CATALOGO_ANTICIPATO) != 0;
+        confermati += (r->esito & CATALOGO_CONFERMATO) != 0;
+        pgd_max = fmax(pgd_max, r->pgd_max);
+    }
+    printf("Trigger: %lld, allarmi: %lld (anticipati %lld), senza allarme: %lld, confermati: %lld\n",
+           n, allarmi, anticipati, n - allarmi, confermati);
+    printf("PGD massimo: %.4f cm, PGA massima: %.4f g, PGV massima: %.4f cm/s\n",
+           pgd_max * 100.0, pga_max / G, pgv_max * 100.0);
+}
+
+int main(int argc, char *argv[]) {
+    FiltroCatalogo f = { .t_da = -INFINITY, .t_a = INFINITY, .stazione = -1 };
+    const char *percorso = NULL;
+    long long max_righe = MAX_RIGHE;
+    int modo = ALLARMI, errore = 0;
+
+    for (int i = 1; i < argc && !errore; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 2 < argc) {
+            f.t_da = atof(argv[++i]);
+            f.t_a = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            f.stazione = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            f.pgd_min = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_righe = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "allarmi") == 0) {
+            modo = ALLARMI;
+        } else if (strcmp(argv[i], "senza_allarme") == 0) {
+            modo = SENZA_ALLARME;
+        } else if (strcmp(argv[i], "lead_time") == 0) {
+            modo = LEAD_TIME;
+        } else if (strcmp(argv[i], "riepilogo") == 0) {
+            modo = RIEPILOGO;
+        } else if (!percorso) {
+            percorso = argv[i];
+        } else {
+            errore = 1;
+        }
+    }
+    if (!percorso || errore || max_righe < 0) {
+        fprintf(stderr, "Uso: %s <catalogo> [-t da a] [-s stazione] [-p pgd_min] [-n max_righe]\n"
+                        "     [allarmi|senza_allarme|lead_time|riepilogo]\n", argv[0]);
+        return 1;
+    }
+
+    switch (modo) {
+    case ALLARMI:
+    case LEAD_TIME:     f.esito_presente = CATALOGO_ALLARME; break;
+    case SENZA_ALLARME: f.esito_presente = CATALOGO_TRIGGER; f.esito_assente = CATALOGO_ALLARME; break;
+    default:            break;
+    }
+
+    double t0 = ora();
+    Catalogo c;
+    if (apri_catalogo(&c, percorso) != 0) {
+        fprintf(stderr, "Errore: %s non è un catalogo valido\n", percorso);
+        return 1;
+    }
+    double durata_apertura = ora() - t0;
+
+    /* Per le statistiche servono tutti i risultati, per gli elenchi solo
+     * le righe da stampare */
+    long long max = (modo == LEAD_TIME || modo == RIEPILOGO) ? c.n_voci : max_righe;
+    unsigned int *risultati = malloc((size_t)(max > 0 ? max : 1) * sizeof(unsigned int));
+    if (!risultati) {
+        chiudi_catalogo(&c);
+        return 1;
+    }
+    t0 = ora();
+    long long n = filtra_catalogo(&c, &f, risultati, max);
+    double durata = ora() - t0;
+
+    if (modo == LEAD_TIME) {
+        stampa_lead_time(&c, risultati, n);
+    } else if (modo == RIEPILOGO) {
+        stampa_riepilogo(&c, risultati, n);
+    } else {
+        printf("%9s  %8s  %16s  %16s  %8s  %8s  %6s  %7s  %7s  %8s  %2s  %16s\n", "record", "stazione",
+               "t_trigger [s]", "t_allarme [s]", "PGD [cm]", "max [cm]", "P [%]", "lead [s]",
+               "PGA [g]", "PGV[cm/s]", "AC", "config");
+        for (long long i = 0; i < n && i < max; i++) {
+            stampa_record(&c, risultati[i]);
+        }
+        if (n > max) {
+            printf("... altri %lld\n", n - max);
+        }
+        printf("Record: %lld\n", n);
+    }
+    printf("%lld record nel catalogo; apertura %.3f ms, interrogazione %.3f ms\n",
+           c.n_voci, durata_apertura * 1e3, durata * 1e3);
+    if (c.n_record > c.n_voci) {
+        printf("Record con checksum errato, esclusi: %lld\n", c.n_record - c.n_voci);
+    }
+
+    free(risultati);
+    chiudi_catalogo(&c);
+    return 0;
+}
@@ -1,8 +1,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "dosews.h"
 #include "output.h"
+#include "checkpoint.h"
+#include "ricampionamento.h"
+#include "portafoglio.h"
+#include "varianti.h"
+#include "tempo_reale.h"
+#include "archivio.h"
+#include "registro.h"
+#include "oscillatori.h"
+#include "spettro.h"
+#include "salute.h"
+#include "catalogo.h"
+#include "costanti.h"
 
 
 #define FREQUENZA        200.0
@@ -13,13 +26,257 @@
 #define TIPOLOGIA        "RC"
 #define N_PIANI          3
 #define SOGLIA_DANNO     "EDS"
+#define CHECKPOINT_SEC   60.0
+
+/* Richiamate dentro processa: solo record nel registro, la stampa vera
+ * avviene nel thread del formattatore */
+static void stampa_trigger(void *contesto, const StatoDOSEWS *sys) {
+    (void)contesto;
+    REGISTRA(REGISTRO_INFO, "Trigger rilevato a: %.3f s (campione %lld)\n",
+             REGISTRO_REALE(sys->indice_campione / sys->config.frequenza),
+             REGISTRO_INTERO(sys->indice_campione));
+}
+
+static void stampa_allarme(void *contesto, const StatoDOSEWS *sys) {
+    (void)contesto;
+    REGISTRA(REGISTRO_AVVISO, ">>> ALLARME a: %.3f s (campione %lld)\n",
+             REGISTRO_REALE(sys->indice_campione / sys->config.frequenza),
+             REGISTRO_INTERO(sys->indice_campione));
+}
+
+static void stampa_uso(const char *nome) {
+    fprintf(stderr, "Uso: %s <file_accelerometrico|archivio.dws> [-c file_checkpoint] [-f fs_ingresso] [-p inventario.bin]\n"
+                    "          [-t sta_lta|bande|allen|adattivo] [-r cpu] [-a] [-s] [-e n_periodi] [-m]\n"
+                    "          [-l catalogo] [-i id_stazione]\n", nome);
+}
+
+/* Banco per -s: l'edificio della configurazione, sempre il primo, poi quelli
+ * dell'inventario associati alla stazione 0. Gli edifici oltre
+ * OSCILLATORI_MAX_PIANI piani restano fuori. Ritorna 0 o -1. */
+static int prepara_edifici(BancoOscillatori *b, const ConfigSistema *config, const char *file_portafoglio) {
+    Portafoglio p;
+    int con_portafoglio = file_portafoglio && carica_portafoglio(&p, file_portafoglio) == 0;
+
+    int capacita = 1, n_piani_max = config->n_piani;
+    for (int i = 0; con_portafoglio && i < p.n_edifici; i++) {
+        if (p.stazione[i] == 0) {
+            capacita++;
+            if (p.n_piani[i] > n_piani_max) n_piani_max = p.n_piani[i];
+        }
+    }
+    if (n_piani_max > OSCILLATORI_MAX_PIANI) {
+        n_piani_max = OSCILLATORI_MAX_PIANI;
+    }
+
+    int esito = init_oscillatori(b, capacita, n_piani_max, config->frequenza);
+    if (esito == 0 && aggiungi_edificio_oscillatori(b, config->tipologia, config->n_piani) != 0) {
+        esito = -1;
+    }
+    for (int i = 0; esito == 0 && con_portafoglio && i < p.n_edifici; i++) {
+        if (p.stazione[i] == 0) {
+            aggiungi_edificio_oscillatori(b, nome_tipologia((Tipologia)p.tipologia[i]), p.n_piani[i]);
+        }
+    }
+    if (con_portafoglio) {
+        free_portafoglio(&p);
+    }
+    return esito;
+}
+
+/* Legge tutto il file prima di partire: nel ciclo a tempo reale non c'è I/O */
+static double *leggi_campioni(FILE *fp, long *n) {
+    long capacita = 1 << 16;
+    double *dati = malloc(capacita * sizeof(double));
+    *n = 0;
+    double valore;
+    while (dati && fscanf(fp, "%lf", &valore) == 1) {
+        if (*n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(dati, capacita * sizeof(double));
+            if (!nuovo) {
+                free(dati);
+                return NULL;
+            }
+            dati = nuovo;
+        }
+        dati[(*n)++] = valore;
+    }
+    /* Un valore non numerico non è la fine dei dati */
+    if (dati && !feof(fp)) {
+        free(dati);
+        return NULL;
+    }
+    return dati;
+}
+
+/* Come leggi_campioni, decodificando tutti i blocchi dell'archivio */
+static double *leggi_campioni_archivio(const Archivio *a, long *n) {
+    const IntestazioneArchivio *h = a->intestazione;
+    double *dati = malloc((h->n_campioni + h->campioni_blocco) * sizeof(double));
+    *n = 0;
+    for (unsigned int k = 0; dati && k < h->n_blocchi; k++) {
+        *n += decodifica_blocco_archivio(a, k, dati + *n);
+    }
+    return dati;
+}
+
+/* Stadi che seguono ogni campione d'ingresso, comuni ai tre percorsi di
+ * lettura (testo, archivio, tempo reale) */
+typedef struct {
+    StatoDOSEWS *sys;
+    FunzioneProcessa processa;
+    const CoeffRicampionatore *coeff_ric;
+    StatoRicampionatore *stato_ric;
+    ScrittoreCheckpoint *scrittore;    /* NULL senza -c */
+    MonitorSalute *salute;             /* NULL senza -m */
+} Elaborazione;
+
+/* Ricampionamento, catena, checkpoint e salute per un campione d'ingresso */
+static void elabora_campione(Elaborazione *e, double valore) {
+    double ricampionati[RICAMPIONAMENTO_MAX_L];
+    int n = ricampiona_campione(valore, e->coeff_ric, e->stato_ric, ricampionati);
+    for (int k = 0; k < n; k++) {
+        e->processa(e->sys, ricampionati[k]);
+        if (e->scrittore) aggiorna_scrittore_checkpoint(e->scrittore, e->sys);
+        if (e->salute && e->sys->fase == STATO_ATTESA_TRIGGER) {
+            campione_salute(e->salute, 0, e->sys->indice_campione, ricampionati[k]);
+        }
+    }
+}
+
+/* Modalità -r, dopo avvia_tempo_reale: un campione d'ingresso ogni
+ * 1/fs_ingresso, misurando ritardo di risveglio ed elaborazione. */
+static void esegui_tempo_reale(Elaborazione *e, int cpu, const double *dati, long n_dati) {
+    /* mlockall ha già reso residenti le pagine mappate: il primo accesso ai
+     * buffer non deve comunque trovare pagine condivise copy-on-write */
+    StatoDOSEWS *sys = e->sys;
+    precarica_memoria((void *)dati, n_dati * sizeof(double));
+    if (sys->trigger.buf) {
+        precarica_memoria(sys->trigger.buf, (sys->trigger.maschera + 1) * sizeof(double));
+    }
+
+    IstogrammaLatenza risveglio, elaborazione;
+    azzera_latenza(&risveglio);
+    azzera_latenza(&elaborazione);
+
+    double periodo = 1.0 / e->coeff_ric->fs_in;
+    struct timespec scadenza, sveglia, fine;
+    istante_corrente(&scadenza);
+
+    for (long i = 0; i < n_dati; i++) {
+        avanza_istante(&scadenza, periodo);
+        attendi_istante(&scadenza);
+        istante_corrente(&sveglia);
+
+        elabora_campione(e, dati[i]);
+
+        istante_corrente(&fine);
+        registra_latenza(&risveglio, differenza_istanti(&sveglia, &scadenza));
+        registra_latenza(&elaborazione, differenza_istanti(&fine, &sveglia));
+    }
+
+    svuota_registro();
+    printf("\nTempo reale: CPU %d, SCHED_FIFO %d, periodo %.3f ms, %ld campioni\n",
+           cpu, TEMPO_REALE_PRIORITA, periodo * 1e3, n_dati);
+    stampa_latenza(&risveglio, "Ritardo di risveglio");
+    stampa_latenza(&elaborazione, "Elaborazione");
+}
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <file_accelerometrico>\n", argv[0]);
+    const char *file_dati = NULL;
+    const char *file_checkpoint = NULL;
+    double frequenza_ingresso = FREQUENZA;
+    int frequenza_esplicita = 0;
+    const char *file_portafoglio = NULL;
+    int tipo_trigger = TRIGGER_STA_LTA;
+    const char *nome_trigger = NULL;
+    int cpu_tempo_reale = -1;
+    int decisione_anticipata = 0;
+    int simula = 0;
+    int n_periodi_spettro = 0;
+    int monitora = 0;
+    const char *file_catalogo = NULL;
+    int id_stazione = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            file_checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            frequenza_ingresso = atof(argv[++i]);
+            frequenza_esplicita = 1;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            file_portafoglio = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            nome_trigger = argv[++i];
+            tipo_trigger = tipo_trigger_da_nome(nome_trigger);
+            if (tipo_trigger < 0) {
+                stampa_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            cpu_tempo_reale = atoi(argv[++i]);
+            if (cpu_tempo_reale < 0) {
+                stampa_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-a") == 0) {
+            decisione_anticipata = 1;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            simula = 1;
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            n_periodi_spettro = atoi(argv[++i]);
+            if (n_periodi_spettro < 1 || n_periodi_spettro > SPETTRO_MAX_PERIODI) {
+                stampa_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-m") == 0) {
+            monitora = 1;
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            file_catalogo = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            id_stazione = atoi(argv[++i]);
+            if (id_stazione < 0) {
+                stampa_uso(argv[0]);
+                return 1;
+            }
+        } else if (!file_dati && argv[i][0] != '-') {
+            file_dati = argv[i];
+        } else {
+            stampa_uso(argv[0]);
+            return 1;
+        }
+    }
+    if (!file_dati) {
+        stampa_uso(argv[0]);
         return 1;
     }
 
+    /* Risorse liberate tutte all'uscita, anche in caso di errore: le
+     * funzioni di chiusura accettano lo stato azzerato */
+    int esito = 1;
+    Archivio archivio = { 0 };
+    CoeffRicampionatore coeff_ric = { 0 };
+    StatoRicampionatore stato_ric = { 0 };
+    StatoDOSEWS sys = { 0 };
+    ScrittoreCheckpoint scrittore;
+    int con_scrittore = 0;
+    MonitorSalute salute = { 0 };
+    BancoOscillatori edifici = { 0 };
+    SpettroRisposta spettro = { 0 };
+    FILE *fp = NULL;
+    double *dati = NULL;
+
+    /* Archivio .dws riconosciuto dal magic: se intestazione o blocchi non
+     * tornano è un errore, non un file di testo. Se -f manca la frequenza
+     * è quella dell'intestazione */
+    int da_archivio = riconosci_archivio(file_dati);
+    if (da_archivio && apri_archivio(&archivio, file_dati) != 0) {
+        fprintf(stderr, "Errore: archivio %s troncato o corrotto\n", file_dati);
+        goto fine;
+    }
+    if (da_archivio && !frequenza_esplicita) {
+        frequenza_ingresso = archivio.intestazione->frequenza;
+    }
 
     ConfigSistema config = {
         .frequenza      = FREQUENZA,
@@ -27,44 +284,274 @@ int main(int argc, char *argv[]) {
         .sta_sec        = STA_SEC,
         .lta_sec        = LTA_SEC,
         .soglia_sta_lta = SOGLIA_STA_LTA,
+        .tipo_trigger   = (TipoTrigger)tipo_trigger,
         .fc_hp          = FC_HIGHPASS,
         .n_piani        = N_PIANI,
+        .decisione_anticipata = decisione_anticipata,
     };
     strncpy(config.tipologia,     TIPOLOGIA,    sizeof(config.tipologia) - 1);
     strncpy(config.soglia_target, SOGLIA_DANNO, sizeof(config.soglia_target) - 1);
 
-    StatoDOSEWS sys;
+    /* Stadio di ricampionamento: il resto della catena lavora sempre a FREQUENZA */
+    if (calcola_coeff_ricampionatore(frequenza_ingresso, config.frequenza, &coeff_ric) != 0) {
+        fprintf(stderr, "Errore: ricampionamento %.3f -> %.3f Hz non supportato\n",
+                frequenza_ingresso, config.frequenza);
+        goto fine;
+    }
+    if (init_ricampionatore(&stato_ric, &coeff_ric) != 0) {
+        fprintf(stderr, "Errore: inizializzazione ricampionatore fallita\n");
+        goto fine;
+    }
+
     if (init_dosews(&sys, &config) != 0) {
         fprintf(stderr, "Errore: inizializzazione sistema fallita\n");
-        return 1;
+        goto fine;
     }
+    CallbackDOSEWS callback = { stampa_trigger, stampa_allarme, NULL };
+    imposta_callback_dosews(&sys, &callback);
 
+    /* Risposta simulata degli edifici, in aggiunta alla regressione sul PGD.
+     * Edifici e spettro prima del checkpoint, che ne salva lo stato */
+    if (simula) {
+        if (prepara_edifici(&edifici, &config, file_portafoglio) != 0) {
+            fprintf(stderr, "Errore: inizializzazione degli edifici simulati fallita\n");
+            goto fine;
+        }
+        imposta_edifici_dosews(&sys, &edifici);
+    }
 
-    FILE *fp = fopen(argv[1], "r");
-    if (!fp) {
-        fprintf(stderr, "Errore: impossibile aprire il file %s\n", argv[1]);
-        free_dosews(&sys);
-        return 1;
+    /* Spettro di risposta aggiornato a ogni campione dal trigger */
+    if (n_periodi_spettro > 0) {
+        if (init_spettro(&spettro, n_periodi_spettro, SPETTRO_T_MIN, SPETTRO_T_MAX,
+                         SPETTRO_SMORZAMENTO, config.frequenza) != 0) {
+            fprintf(stderr, "Errore: inizializzazione dello spettro di risposta fallita\n");
+            goto fine;
+        }
+        imposta_spettro_dosews(&sys, &spettro);
+    }
+
+    /* Riavvio a caldo: se il checkpoint è valido il trigger è subito operativo */
+    if (file_checkpoint) {
+        if (carica_checkpoint(&sys, file_checkpoint) == 0) {
+            printf("Checkpoint ripristinato da %s (campione %lld)\n",
+                   file_checkpoint, sys.indice_campione);
+        }
+        if (avvia_scrittore_checkpoint(&scrittore, &sys, file_checkpoint,
+                                       (long long)(CHECKPOINT_SEC * config.frequenza)) != 0) {
+            fprintf(stderr, "Errore: avvio scrittura checkpoint fallito\n");
+            goto fine;
+        }
+        con_scrittore = 1;
+    }
+
+    /* Anche il formattatore del registro nasce prima di avvia_tempo_reale:
+     * resta nella classe normale e su qualunque CPU */
+    if (avvia_registro(stdout, 0) != 0) {
+        fprintf(stderr, "Errore: avvio del registro fallito\n");
+        goto fine;
+    }
+
+    /* Salute del canale. Da file l'analisi è sincrona, a fine blocco, e il
+     * veto dipende solo dai dati; con -r gira in un thread della classe
+     * normale, fuori dal percorso critico */
+    if (monitora) {
+        ConfigSalute config_s;
+        config_salute(&config_s, config.frequenza);
+        if (init_salute(&salute, &config_s, 1) != 0 || (cpu_tempo_reale >= 0 && avvia_salute(&salute) != 0)) {
+            fprintf(stderr, "Errore: avvio del monitor di salute fallito\n");
+            goto fine;
+        }
+        imposta_veto_trigger_dosews(&sys, veto_salute(&salute, 0));
+    }
+
+    /* Dopo l'avvio dello scrittore, che resta nella classe normale: senza
+     * privilegi la modalità richiesta non parte affatto */
+    if (cpu_tempo_reale >= 0) {
+        char errore[160];
+        if (avvia_tempo_reale(cpu_tempo_reale, TEMPO_REALE_PRIORITA, errore, sizeof(errore)) != 0) {
+            fprintf(stderr, "Errore: modalità tempo reale non disponibile: %s\n", errore);
+            goto fine;
+        }
+    }
+
+    /* Percorso specializzato se la configurazione è una di quelle della flotta */
+    Elaborazione elaborazione = {
+        .sys       = &sys,
+        .processa  = seleziona_variante(&sys, NULL),
+        .coeff_ric = &coeff_ric,
+        .stato_ric = &stato_ric,
+        .scrittore = con_scrittore ? &scrittore : NULL,
+        .salute    = monitora ? &salute : NULL,
+    };
+
+    if (!da_archivio && !(fp = fopen(file_dati, "r"))) {
+        fprintf(stderr, "Errore: impossibile aprire il file %s\n", file_dati);
+        goto fine;
     }
 
-    printf("DOSEWS avviato — file: %s\n", argv[1]);
-    printf("Configurazione: %s %d piani, soglia %s, fs=%.0f Hz, HP=%.3f Hz\n\n",
+    printf("DOSEWS avviato — file: %s\n", file_dati);
+    printf("Configurazione: %s %d piani, soglia %s, fs=%.0f Hz, HP=%.3f Hz\n",
            config.tipologia, config.n_piani, config.soglia_target,
            config.frequenza, config.fc_hp);
+    if (coeff_ric.L != coeff_ric.M) {
+        printf("Ricampionamento: %.0f -> %.0f Hz (L=%d, M=%d, %d coeff/fase), ritardo %.3f s\n",
+               coeff_ric.fs_in, coeff_ric.fs_out, coeff_ric.L, coeff_ric.M,
+               coeff_ric.taps_per_fase, coeff_ric.ritardo_gruppo);
+    }
+    if (tipo_trigger != TRIGGER_STA_LTA) {
+        printf("Trigger: %s\n", nome_trigger);
+    }
+    if (cpu_tempo_reale >= 0) {
+        printf("Modalità tempo reale su CPU %d\n", cpu_tempo_reale);
+    }
+    if (simula) {
+        printf("Risposta simulata: %d edifici, %d modi, smorzamento %.0f%%\n",
+               edifici.n_edifici, OSCILLATORI_MAX_MODI, OSCILLATORI_SMORZAMENTO * 100.0);
+    }
+    printf("\n");
 
 
-    double valore;
-    while (fscanf(fp, "%lf", &valore) == 1) {
-        processa_campione(&sys, valore);
+    if (cpu_tempo_reale >= 0) {
+        long n_dati;
+        dati = da_archivio ? leggi_campioni_archivio(&archivio, &n_dati) : leggi_campioni(fp, &n_dati);
+        if (!dati) {
+            fprintf(stderr, "Errore: %s non numerico o memoria insufficiente\n", file_dati);
+            goto fine;
+        }
+        esegui_tempo_reale(&elaborazione, cpu_tempo_reale, dati, n_dati);
+    } else if (da_archivio) {
+        /* Blocchi decodificati direttamente dalla mappa, senza parsing */
+        dati = malloc(archivio.intestazione->campioni_blocco * sizeof(double));
+        for (unsigned int b = 0; dati && b < archivio.intestazione->n_blocchi; b++) {
+            int n_blocco = decodifica_blocco_archivio(&archivio, b, dati);
+            for (int j = 0; j < n_blocco; j++) {
+                elabora_campione(&elaborazione, dati[j]);
+            }
+        }
+    } else {
+        double valore;
+        while (fscanf(fp, "%lf", &valore) == 1) {
+            elabora_campione(&elaborazione, valore);
 
-        /* In produzione: qui ci sarebbe la ricezione dal sensore, non fscanf */
+            /* In produzione: qui ci sarebbe la ricezione dal sensore, non fscanf */
+        }
+        if (!feof(fp)) {
+            fprintf(stderr, "Errore: valore non numerico in %s\n", file_dati);
+            goto fine;
+        }
     }
 
-    fclose(fp);
+    /* Messaggi del percorso di elaborazione prima del riepilogo */
+    ferma_registro();
+    ferma_salute(&salute);
+
+    if (con_scrittore) {
+        ferma_scrittore_checkpoint(&scrittore, &sys);
+        con_scrittore = 0;
+    }
 
 
     stampa_risultati(&sys);
 
+    if (monitora) {
+        RapportoSalute rs;
+        char diagnosi[96];
+        rapporto_salute(&salute, 0, &rs);
+        descrivi_salute(rs.stato, diagnosi, sizeof(diagnosi));
+        printf("Salute del canale (%lld blocchi da %.2f s prima del trigger): %s",
+               rs.blocchi, SALUTE_CAMPIONI_BLOCCO / config.frequenza, diagnosi);
+        if (!isnan(rs.rumore)) {
+            printf("; rumore %.3e g rms in [%.0f, %.0f] Hz, offset %.3e g",
+                   rs.rumore, salute.config.f_min, salute.config.f_max, rs.offset);
+        }
+        printf("\n");
+        if (rs.conteggio[0] + rs.conteggio[1] + rs.conteggio[2] + rs.conteggio[3] + rs.conteggio[4] > 0) {
+            printf("Blocchi con diagnosi: saturazione %lld, piatto %lld, lacuna %lld, offset %lld, rumore %lld\n",
+                   rs.conteggio[0], rs.conteggio[1], rs.conteggio[2], rs.conteggio[3], rs.conteggio[4]);
+        }
+        if (rs.scartati > 0) {
+            printf("Blocchi scartati a coda piena: %lld\n", rs.scartati);
+        }
+        if (sys.trigger_sospesi > 0) {
+            printf("Trigger sospesi per la salute del canale: %lld\n", sys.trigger_sospesi);
+        }
+    }
+
+    /* Drift dell'edificio della configurazione dalla simulazione, accanto
+     * al valore della regressione allo stesso PGD massimo */
+    if (simula && sys.indice_trigger >= 0 && sys.pgd_max > 0.0) {
+        int piano;
+        double drift = drift_edificio_oscillatori(&edifici, 0, &piano);
+        double regressione = pow(10.0, REGRESSIONE_INTERCETTA + REGRESSIONE_PENDENZA * log10(sys.pgd_max));
+        int superamenti[3];
+        conta_superamenti_oscillatori(&edifici, superamenti);
+        printf("Drift simulato (T1=%.3f s): %.6e m al piano %d; regressione al PGD massimo: %.6e m\n",
+               edifici.periodo[0], drift, piano, regressione);
+        printf("Edifici simulati (%d): oltre soglia MDS %d, EDS %d, CDS %d\n",
+               edifici.n_edifici, superamenti[0], superamenti[1], superamenti[2]);
+    }
+
+    if (n_periodi_spettro > 0 && sys.indice_trigger >= 0) {
+        double psa[SPETTRO_MAX_PERIODI];
+        psa_spettro(&spettro, psa);
+        printf("\nSpettro di risposta (smorzamento %.0f%%, dal trigger)\n", spettro.smorzamento * 100.0);
+        printf("   T [s]    PSA [g]      SD [m]\n");
+        for (int i = 0; i < spettro.n_periodi; i++) {
+            printf("%8.3f  %9.4f  %.4e\n", spettro.periodo[i], psa[i] / G, spettro.sd[i]);
+        }
+    }
+
+    /* Stima dei danni sull'inventario: con una sola stazione tutti gli
+     * edifici associati alla stazione 0 ricevono il PGD massimo */
+    if (file_portafoglio && sys.indice_trigger >= 0) {
+        Portafoglio portafoglio;
+        if (carica_portafoglio(&portafoglio, file_portafoglio) != 0) {
+            fprintf(stderr, "Errore: inventario %s non valido\n", file_portafoglio);
+        } else {
+            valuta_portafoglio(&portafoglio, &sys.pgd_max, 1);
+            printf("Portafoglio %s (%d edifici): oltre soglia MDS %d, EDS %d, CDS %d\n",
+                   file_portafoglio, portafoglio.n_edifici, portafoglio.n_superamenti[0],
+                   portafoglio.n_superamenti[1], portafoglio.n_superamenti[2]);
+            free_portafoglio(&portafoglio);
+        }
+    }
+
+    /* Catalogo degli eventi: un record se la stazione è scattata. Gli
+     * istanti sono assoluti solo per gli archivi, che portano t0 */
+    if (file_catalogo) {
+        RecordCatalogo record;
+        ScrittoreCatalogo catalogo;
+        double t0 = da_archivio ? archivio.intestazione->t0 : 0.0;
+        if (record_catalogo(&record, &sys, (unsigned int)id_stazione, t0) == 0) {
+            if (apri_scrittore_catalogo(&catalogo, file_catalogo) != 0) {
+                fprintf(stderr, "Errore: %s non è un catalogo valido\n", file_catalogo);
+            } else {
+                if (aggiungi_catalogo(&catalogo, &record, 1) != 0) {
+                    fprintf(stderr, "Errore: scrittura nel catalogo %s fallita\n", file_catalogo);
+                }
+                chiudi_scrittore_catalogo(&catalogo);
+            }
+        }
+    }
+
+    esito = 0;
+
+fine:
+    ferma_registro();
+    ferma_salute(&salute);
+    if (con_scrittore) {
+        ferma_scrittore_checkpoint(&scrittore, &sys);
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    free(dati);
     free_dosews(&sys);
-    return 0;
+    free_oscillatori(&edifici);
+    free_spettro(&spettro);
+    free_salute(&salute);
+    free_ricampionatore(&stato_ric);
+    free_coeff_ricampionatore(&coeff_ric);
+    chiudi_archivio(&archivio);
+    return esito;
 }
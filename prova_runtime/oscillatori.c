@@ -0,0 +1,223 @@
+#include "oscillatori.h"
+#include "arena.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define N_COEFF OSCILLATORI_N_COEFF
+
+/* La combinazione in avanza_oscillatori è scritta per tre modi */
+_Static_assert(OSCILLATORI_MAX_MODI == 3, "avanza_oscillatori combina tre modi");
+
+static double *riga(double *base, const BancoOscillatori *b, int r) {
+    return base + (size_t)r * b->capacita;
+}
+
+static double *alloca_righe(int righe, int capacita) {
+    size_t n = ARENA_ALLINEA((size_t)righe * capacita * sizeof(double));
+    double *p = aligned_alloc(ARENA_ALLINEAMENTO, n);
+    if (p) {
+        memset(p, 0, n);
+    }
+    return p;
+}
+
+void free_oscillatori(BancoOscillatori *b) {
+    free(b->stato);
+    free(b->coeff);
+    free(b->combinazione);
+    free(b->drift_max);
+    free(b->inviluppo);
+    free(b->periodo);
+    free(b->soglia[0]);
+    free(b->n_piani);
+    memset(b, 0, sizeof(*b));
+}
+
+int init_oscillatori(BancoOscillatori *b, int capacita, int n_piani_max, double frequenza) {
+    memset(b, 0, sizeof(*b));
+    if (capacita < 1 || n_piani_max < 1 || n_piani_max > OSCILLATORI_MAX_PIANI || frequenza <= 0.0) {
+        return -1;
+    }
+    /* Colonne allineate: ogni riga comincia su una linea di cache */
+    capacita = (capacita + 7) & ~7;
+    b->stato         = alloca_righe(2 * OSCILLATORI_MAX_MODI, capacita);
+    b->coeff         = alloca_righe(N_COEFF * OSCILLATORI_MAX_MODI, capacita);
+    b->combinazione  = alloca_righe(n_piani_max * OSCILLATORI_MAX_MODI, capacita);
+    b->drift_max     = alloca_righe(1, capacita);
+    b->inviluppo     = alloca_righe(n_piani_max, capacita);
+    b->periodo       = alloca_righe(1, capacita);
+    b->soglia[0]     = alloca_righe(3, capacita);
+    b->n_piani       = calloc(capacita, sizeof(int));
+    if (!b->stato || !b->coeff || !b->combinazione || !b->drift_max || !b->inviluppo
+        || !b->periodo || !b->soglia[0] || !b->n_piani) {
+        free_oscillatori(b);
+        return -1;
+    }
+    b->soglia[1] = b->soglia[0] + capacita;
+    b->soglia[2] = b->soglia[0] + 2 * capacita;
+    b->capacita = capacita;
+    b->n_piani_max = n_piani_max;
+    b->dt = 1.0 / frequenza;
+    return 0;
+}
+
+double periodo_fondamentale(const char *tipologia, int n_piani) {
+    double ct = (strcmp(tipologia, "RC") == 0) ? 0.075 : 0.05;
+    return ct * pow(n_piani * OSCILLATORI_ALTEZZA_PIANO, 0.75);
+}
+
+void coefficienti_nigam_jennings(double w, double z, double dt, double k[OSCILLATORI_N_COEFF]) {
+    double s = sqrt(1.0 - z * z);
+    double wd = w * s;
+    double e = exp(-z * w * dt);
+    double sn = sin(wd * dt), cs = cos(wd * dt);
+    double w2 = w * w, w3 = w2 * w;
+    double r = z / s;
+    double t1 = (2.0 * z * z - 1.0) / (w2 * dt);
+    double t2 = 2.0 * z / (w3 * dt);
+
+    k[NJ_A11] = e * (r * sn + cs);
+    k[NJ_A12] = e * sn / wd;
+    k[NJ_A21] = -w / s * e * sn;
+    k[NJ_A22] = e * (cs - r * sn);
+    k[NJ_B11] = e * ((t1 + z / w) * sn / wd + (t2 + 1.0 / w2) * cs) - t2;
+    k[NJ_B12] = -e * (t1 * sn / wd + t2 * cs) - 1.0 / w2 + t2;
+    k[NJ_B21] = e * ((t1 + z / w) * (cs - r * sn) - (t2 + 1.0 / w2) * (wd * sn + z * w * cs))
+           + 1.0 / (w2 * dt);
+    k[NJ_B22] = -e * (t1 * (cs - r * sn) - t2 * (wd * sn + z * w * cs)) - 1.0 / (w2 * dt);
+}
+
+int aggiungi_oscillatore(BancoOscillatori *b, double periodo, double smorzamento,
+                         int n_piani, const ConfigurazioneAllarme *soglie) {
+    if (b->n_edifici >= b->capacita || periodo <= 0.0 || smorzamento < 0.0 || smorzamento >= 1.0
+        || n_piani < 1 || n_piani > b->n_piani_max) {
+        return -1;
+    }
+    int e = b->n_edifici;
+    int n_modi = (n_piani < OSCILLATORI_MAX_MODI) ? n_piani : OSCILLATORI_MAX_MODI;
+
+    /* Telaio shear-type uniforme, base incastrata: w_j = 2 w_s sin((2j-1) pi / (2(2n+1))),
+     * phi_j(i) = sin((2j-1) i pi / (2n+1)); w_s dal periodo del primo modo */
+    double w1 = 2.0 * M_PI / periodo;
+    double ws = w1 / (2.0 * sin(M_PI / (2.0 * (2 * n_piani + 1))));
+    for (int j = 0; j < n_modi; j++) {
+        double m = 2 * j + 1;
+        double w = 2.0 * ws * sin(m * M_PI / (2.0 * (2 * n_piani + 1)));
+        double k[N_COEFF];
+        coefficienti_nigam_jennings(w, smorzamento, b->dt, k);
+        for (int c = 0; c < N_COEFF; c++) {
+            riga(b->coeff, b, N_COEFF * j + c)[e] = k[c];
+        }
+
+        /* Masse uguali: gamma_j = somma phi / somma phi^2 */
+        double somma = 0.0, somma2 = 0.0;
+        for (int i = 1; i <= n_piani; i++) {
+            double phi = sin(m * i * M_PI / (2 * n_piani + 1));
+            somma += phi;
+            somma2 += phi * phi;
+        }
+        double gamma = somma / somma2;
+        for (int i = 1; i <= n_piani; i++) {
+            double phi = sin(m * i * M_PI / (2 * n_piani + 1));
+            double phi_sotto = sin(m * (i - 1) * M_PI / (2 * n_piani + 1));
+            riga(b->combinazione, b, (i - 1) * OSCILLATORI_MAX_MODI + j)[e] = gamma * (phi - phi_sotto);
+        }
+    }
+
+    b->periodo[e] = periodo;
+    b->soglia[0][e] = soglie->mds;
+    b->soglia[1][e] = soglie->eds;
+    b->soglia[2][e] = soglie->cds;
+    b->n_piani[e] = n_piani;
+    return b->n_edifici++;
+}
+
+int aggiungi_edificio_oscillatori(BancoOscillatori *b, const char *tipologia, int n_piani) {
+    if (n_piani < 1) {
+        return -1;
+    }
+    return aggiungi_oscillatore(b, periodo_fondamentale(tipologia, n_piani), OSCILLATORI_SMORZAMENTO,
+                                n_piani, get_configurazione(tipologia, n_piani));
+}
+
+void azzera_oscillatori(BancoOscillatori *b) {
+    size_t c = b->capacita;
+    memset(b->stato, 0, 2 * OSCILLATORI_MAX_MODI * c * sizeof(double));
+    memset(b->drift_max, 0, c * sizeof(double));
+    memset(b->inviluppo, 0, b->n_piani_max * c * sizeof(double));
+    b->acc_precedente = 0.0;
+}
+
+/* Kernel per colonne: restrict sui parametri, l'unica forma in cui il
+ * compilatore rinuncia ai controlli di aliasing a tempo di esecuzione */
+static void avanza_modo(int n, size_t riga_coeff, double a0, double a1,
+                        double *restrict q, double *restrict v, const double *restrict k) {
+    const double *a11 = k + NJ_A11 * riga_coeff, *a12 = k + NJ_A12 * riga_coeff;
+    const double *a21 = k + NJ_A21 * riga_coeff, *a22 = k + NJ_A22 * riga_coeff;
+    const double *b11 = k + NJ_B11 * riga_coeff, *b12 = k + NJ_B12 * riga_coeff;
+    const double *b21 = k + NJ_B21 * riga_coeff, *b22 = k + NJ_B22 * riga_coeff;
+    for (int e = 0; e < n; e++) {
+        double q0 = q[e], v0 = v[e];
+        q[e] = a11[e] * q0 + a12[e] * v0 + b11[e] * a0 + b12[e] * a1;
+        v[e] = a21[e] * q0 + a22[e] * v0 + b21[e] * a0 + b22[e] * a1;
+    }
+}
+
+static void aggiorna_piano(int n, const double *restrict q0, const double *restrict q1,
+                           const double *restrict q2, const double *restrict c0,
+                           const double *restrict c1, const double *restrict c2,
+                           double *restrict inviluppo, double *restrict massimo) {
+    for (int e = 0; e < n; e++) {
+        double d = fabs(c0[e] * q0[e] + c1[e] * q1[e] + c2[e] * q2[e]);
+        inviluppo[e] = (d > inviluppo[e]) ? d : inviluppo[e];
+        massimo[e] = (d > massimo[e]) ? d : massimo[e];
+    }
+}
+
+void avanza_oscillatori(BancoOscillatori *b, double acc) {
+    for (int j = 0; j < OSCILLATORI_MAX_MODI; j++) {
+        avanza_modo(b->n_edifici, b->capacita, b->acc_precedente, acc,
+                    riga(b->stato, b, 2 * j), riga(b->stato, b, 2 * j + 1),
+                    riga(b->coeff, b, N_COEFF * j));
+    }
+    b->acc_precedente = acc;
+
+    for (int i = 0; i < b->n_piani_max; i++) {
+        int r = i * OSCILLATORI_MAX_MODI;
+        aggiorna_piano(b->n_edifici,
+                       riga(b->stato, b, 0), riga(b->stato, b, 2), riga(b->stato, b, 4),
+                       riga(b->combinazione, b, r), riga(b->combinazione, b, r + 1),
+                       riga(b->combinazione, b, r + 2), riga(b->inviluppo, b, i), b->drift_max);
+    }
+}
+
+double drift_edificio_oscillatori(const BancoOscillatori *b, int e, int *piano) {
+    int critico = 0;
+    double massimo = 0.0;
+    for (int i = 0; i < b->n_piani[e]; i++) {
+        double d = riga(b->inviluppo, b, i)[e];
+        if (d > massimo) {
+            massimo = d;
+            critico = i + 1;
+        }
+    }
+    if (piano) {
+        *piano = critico;
+    }
+    return massimo;
+}
+
+void conta_superamenti_oscillatori(const BancoOscillatori *b, int n_superamenti[3]) {
+    for (int s = 0; s < 3; s++) {
+        int n = 0;
+        for (int e = 0; e < b->n_edifici; e++) {
+            n += b->drift_max[e] >= b->soglia[s][e];
+        }
+        n_superamenti[s] = n;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef OSCILLATORI_H
+#define OSCILLATORI_H
+
+#include "allarme.h"
+
+/* Risposta simulata degli edifici all'accelerazione del suolo, in
+ * alternativa alla regressione PGD -> drift di allarme.h. Ogni edificio è
+ * un telaio shear-type a n piani uguali (n = 1: oscillatore semplice),
+ * risolto per sovrapposizione modale sui primi OSCILLATORI_MAX_MODI modi.
+ * Ogni modo è un oscillatore semplice
+ *     q'' + 2 z w q' + w^2 q = -a(t)
+ * integrato con la ricorsione esatta per ingresso lineare nel passo
+ * (Nigam e Jennings 1969): otto coefficienti per modo, calcolati una volta.
+ * Il drift d'interpiano del piano i è poi una combinazione fissa dei q.
+ *
+ * Il banco è per colonne: tutti gli edifici avanzano insieme, un ciclo
+ * senza salti per modo e per piano che il compilatore vettorizza (vedi
+ * VETTORIALE nel makefile). Gli edifici con meno modi o piani hanno
+ * coefficienti nulli nelle righe in più. */
+
+#define OSCILLATORI_MAX_MODI     3
+#define OSCILLATORI_MAX_PIANI    16
+#define OSCILLATORI_SMORZAMENTO  0.05
+#define OSCILLATORI_ALTEZZA_PIANO 3.0   /* m, per il periodo da normativa */
+
+/* Indici dei coefficienti della ricorsione esatta */
+#define OSCILLATORI_N_COEFF 8
+enum { NJ_A11, NJ_A12, NJ_A21, NJ_A22, NJ_B11, NJ_B12, NJ_B21, NJ_B22 };
+
+typedef struct {
+    int n_edifici;
+    int capacita;              /* colonne allocate, multiplo di 8 */
+    int n_piani_max;           /* righe di combinazione */
+    double dt;
+    double acc_precedente;     /* ingresso al passo precedente, m/s^2 */
+
+    /* Righe da capacita valori, per modo j:
+     *   stato        2*j: spostamento q, 2*j+1: velocità
+     *   coeff        8*j + NJ_A11 ... NJ_B22
+     *   combinazione piano*OSCILLATORI_MAX_MODI + j */
+    double *stato;
+    double *coeff;
+    double *combinazione;
+
+    double *inviluppo;         /* righe n_piani_max: massimo |drift| del piano, m */
+    double *drift_max;         /* m, massimo su tutti i piani dall'azzeramento */
+    double *periodo;           /* s, primo modo */
+    double *soglia[3];         /* m: MDS, EDS, CDS della classe di fragilità */
+    int *n_piani;
+} BancoOscillatori;
+
+/* Nigam e Jennings: q(k+1) = A11 q + A12 q' + B11 a(k) + B12 a(k+1), e così
+ * la velocità, esatti se a(t) è lineare tra due campioni. w in rad/s, z < 1. */
+void coefficienti_nigam_jennings(double w, double z, double dt, double k[OSCILLATORI_N_COEFF]);
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int init_oscillatori(BancoOscillatori *b, int capacita, int n_piani_max, double frequenza);
+
+void free_oscillatori(BancoOscillatori *b);
+
+/* Periodo fondamentale T1 = Ct H^(3/4) (EN 1998-1, 4.3.3.2.2), Ct = 0.075
+ * per RC e 0.05 per la muratura, H = n_piani * OSCILLATORI_ALTEZZA_PIANO. */
+double periodo_fondamentale(const char *tipologia, int n_piani);
+
+/* Edificio generico con soglie di drift date. Ritorna l'indice, -1 se il
+ * banco è pieno o i parametri non sono validi. */
+int aggiungi_oscillatore(BancoOscillatori *b, double periodo, double smorzamento,
+                         int n_piani, const ConfigurazioneAllarme *soglie);
+
+/* Come aggiungi_oscillatore, con periodo_fondamentale, smorzamento
+ * OSCILLATORI_SMORZAMENTO e soglie di get_configurazione. */
+int aggiungi_edificio_oscillatori(BancoOscillatori *b, const char *tipologia, int n_piani);
+
+/* Tutti gli edifici in quiete, massimi azzerati. */
+void azzera_oscillatori(BancoOscillatori *b);
+
+/* Un campione di accelerazione del suolo [m/s^2] per tutti gli edifici. */
+void avanza_oscillatori(BancoOscillatori *b, double acc);
+
+/* Drift massimo dell'edificio e, se piano non è NULL, il piano (da 1) in
+ * cui è stato raggiunto; 0 se l'edificio è ancora in quiete. */
+double drift_edificio_oscillatori(const BancoOscillatori *b, int e, int *piano);
+
+/* Edifici con drift_max oltre la soglia MDS, EDS, CDS. */
+void conta_superamenti_oscillatori(const BancoOscillatori *b, int n_superamenti[3]);
+
+#endif
@@ -1,4 +1,5 @@
 #include "output.h"
+#include "costanti.h"
 #include <stdio.h>
 
 void salva_dati(const char *filename, const double *data, int n_campioni) {
@@ -64,3 +65,39 @@ void stampa_report_allarme(const char *soglia_target, double t_trigger, double t
         fclose(fp);
     }
 }
+
+/* Una riga, a video e in coda ad allarme_report.txt */
+static void stampa_intensita(FILE *fp, const RisultatiDOSEWS *r) {
+    fprintf(fp, "Intensita (dal trigger): PGA %.4f g, PGV %.4e m/s, CAV %.4e m/s, Arias %.4e m/s, "
+                "durata bracketed (%.2f g) %.3f s\n",
+            r->pga / G, r->pgv, r->cav, r->arias, INTENSITA_SOGLIA_DURATA, r->durata_bracketed);
+}
+
+void stampa_risultati(const StatoDOSEWS *sys) {
+    RisultatiDOSEWS r;
+    calcola_risultati(sys, &r);
+
+    if (!r.triggered) {
+        printf("Nessun trigger rilevato.\n");
+        return;
+    }
+
+    stampa_report_allarme(sys->config.soglia_target, r.t_trigger, r.t_allarme,
+                          r.pgd_allarme, r.pgd_max, r.drift_mediano,
+                          r.soglia_fisica, r.prob_calcolata, r.soglia_prob,
+                          r.lead_time, r.allarme);
+
+    printf("Parametri onda P (primi %.1f s): tau_c %.3f s, Pd %.6e m, tau_p_max %.3f s\n",
+           PARAMETRI_P_FINESTRA, r.tau_c, r.pd, r.tau_p_max);
+    if (r.allarme_anticipato) {
+        printf("Allarme anticipato: Pd >= %.3e m e tau_c >= %.2f s prima della soglia di PGD\n",
+               PARAMETRI_P_SOGLIA_PD, PARAMETRI_P_SOGLIA_TAU_C);
+    }
+
+    stampa_intensita(stdout, &r);
+    FILE *fp = fopen("allarme_report.txt", "a");
+    if (fp) {
+        stampa_intensita(fp, &r);
+        fclose(fp);
+    }
+}
@@ -1,6 +1,8 @@
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
+#include "dosews.h"
+
 void salva_dati(const char *filename, const double *data, int n_campioni);
 
 void stampa_report_allarme(const char *soglia_target, double t_trigger, double t_allarme,
@@ -8,4 +10,7 @@ void stampa_report_allarme(const char *soglia_target, double t_trigger, double t
                            double soglia_fisica, double prob_calcolata,
                            double soglia_probabilita, double lead_time, int allarme_attivo);
 
+/* Report finale dell'evento (calcola_risultati + stampa_report_allarme) */
+void stampa_risultati(const StatoDOSEWS *sys);
+
 #endif
@@ -0,0 +1,48 @@
+#include "parametri_p.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void init_parametri_p(StatoParametriP *p, double frequenza, double soglia_pd) {
+    memset(p, 0, sizeof(*p));
+    p->soglia_pd = soglia_pd;
+    p->alfa = 1.0 - 1.0 / (PARAMETRI_P_MEMORIA_TAU_P * frequenza);
+    p->campioni_finestra = (int)(PARAMETRI_P_FINESTRA * frequenza);
+    p->campioni_minimi = (int)(PARAMETRI_P_DURATA_MIN * frequenza);
+}
+
+void aggiorna_parametri_p(StatoParametriP *p, double acc, double vel, double spost) {
+    if (p->campioni >= p->campioni_finestra) {
+        return;
+    }
+    p->campioni++;
+
+    p->somma_u2 += spost * spost;
+    p->somma_v2 += vel * vel;
+    if (p->somma_v2 > 0.0) {
+        p->tau_c = 2.0 * M_PI * sqrt(p->somma_u2 / p->somma_v2);
+    }
+
+    double u = fabs(spost);
+    if (u > p->pd) {
+        p->pd = u;
+    }
+
+    p->x = p->alfa * p->x + vel * vel;
+    p->d = p->alfa * p->d + acc * acc;
+    if (p->d > 0.0) {
+        double tau_p = 2.0 * M_PI * sqrt(p->x / p->d);
+        if (tau_p > p->tau_p_max) {
+            p->tau_p_max = tau_p;
+        }
+    }
+}
+
+int decisione_parametri_p(const StatoParametriP *p) {
+    return p->campioni >= p->campioni_minimi
+        && p->pd >= p->soglia_pd
+        && p->tau_c >= PARAMETRI_P_SOGLIA_TAU_C;
+}
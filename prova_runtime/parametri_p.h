@@ -0,0 +1,45 @@
+#ifndef PARAMETRI_P_H
+#define PARAMETRI_P_H
+
+/* Parametri dell'onda P nei primi secondi dopo il trigger, aggiornati a ogni
+ * campione con i segnali già calcolati dalla catena di integrazione:
+ *   tau_c     = 2*pi*sqrt(somma u^2 / somma v^2)   (Kanamori 2005)
+ *   Pd        = max |u|
+ *   tau_p_max = max 2*pi*sqrt(X/D), X = alfa*X + v^2, D = alfa*D + a^2
+ *               (Allen e Kanamori 2003)
+ * con a, v, u accelerazione, velocità e spostamento filtrati. Regola di
+ * decisione anticipata (Wu e Kanamori 2005): dopo una durata minima,
+ * Pd e tau_c entrambi oltre soglia indicano un evento potenzialmente
+ * dannoso, prima che il PGD raggiunga la soglia della curva di fragilità.
+ * La soglia di Pd è quella dello stato di danno obiettivo, passata a
+ * init_parametri_p: PARAMETRI_P_SOGLIA_PD vale per EDS. */
+
+#define PARAMETRI_P_FINESTRA      3.0     /* s dopo il trigger */
+#define PARAMETRI_P_DURATA_MIN    1.0     /* s prima di poter decidere */
+#define PARAMETRI_P_SOGLIA_PD     0.005   /* m (0.5 cm), per EDS */
+#define PARAMETRI_P_SOGLIA_TAU_C  0.6     /* s */
+#define PARAMETRI_P_MEMORIA_TAU_P 1.0     /* s, costante di tempo di X e D */
+
+typedef struct {
+    double somma_u2, somma_v2;
+    double x, d;                   /* medie ricorsive di v^2 e a^2 */
+    double alfa;
+    double tau_c;                  /* s */
+    double pd;                     /* m */
+    double tau_p_max;              /* s */
+    int campioni;                  /* dall'inizio della finestra */
+    int campioni_finestra;
+    int campioni_minimi;
+    double soglia_pd;              /* m */
+} StatoParametriP;
+
+void init_parametri_p(StatoParametriP *p, double frequenza, double soglia_pd);
+
+/* Un campione della catena dopo il trigger, O(1). Oltre campioni_finestra
+ * i parametri restano quelli finali. */
+void aggiorna_parametri_p(StatoParametriP *p, double acc, double vel, double spost);
+
+/* 1 se dopo PARAMETRI_P_DURATA_MIN sia Pd che tau_c superano le soglie. */
+int decisione_parametri_p(const StatoParametriP *p);
+
+#endif
@@ -0,0 +1,284 @@
+#include "portafoglio.h"
+#include "allarme.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCCO_LETTURA   4096
+#define LOG10_PGD_NULLO  -1e6f   /* porta la probabilità a 0 */
+
+static const char *const NOMI_TIPOLOGIA[N_TIPOLOGIE] = { "RC", "URM_REG", "URM_STONE" };
+
+static const ConfigurazioneAllarme *const CLASSI[N_CLASSI_FRAGILITA] = {
+    &RC_BASSO, &RC_MEDIO,
+    &URM_REG_BASSO, &URM_REG_MEDIO,
+    &URM_STONE_BASSO, &URM_STONE_MEDIO
+};
+
+/* ---- Kernel in singola precisione, senza salti (vettorizzabili) ---- */
+
+static inline unsigned int bit_float(float x) {
+    unsigned int u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static inline float float_bit(unsigned int u) {
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+/* log10(x) per x normale positivo, errore relativo ~1e-7 */
+static inline float log10_kernel(float x) {
+    unsigned int u = bit_float(x);
+    int e = (int)((u >> 23) & 0xff) - 127;
+    float m = float_bit((u & 0x007fffffu) | 0x3f800000u);   /* [1, 2) */
+
+    /* m in [sqrt(1/2), sqrt(2)) */
+    int sopra = m > 1.41421356f;
+    m = sopra ? 0.5f * m : m;
+    e += sopra;
+
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    float ln_m = 2.0f * s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 * (1.0f / 9)))));
+    return ((float)e * 0.693147181f + ln_m) * 0.434294482f;
+}
+
+/* exp(x) per -87 <= x <= 0 */
+static inline float exp_kernel(float x) {
+    float kf = (x * 1.44269504f + 12582912.0f) - 12582912.0f;   /* arrotondamento */
+    float r = x - kf * 0.693145752f - kf * 1.42860677e-6f;
+    float p = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6 + r * (1.0f / 24
+              + r * (1.0f / 120 + r * (1.0f / 720 + r * (1.0f / 5040)))))));
+    return p * float_bit((unsigned int)((int)kf + 127) << 23);
+}
+
+/* erfc(x), errore relativo < 1.2e-7 (Numerical Recipes, erfcc) */
+static inline float erfc_kernel(float x) {
+    float z = fabsf(x);
+    z = (z > 9.0f) ? 9.0f : z;   /* erfc(9) ~ 4e-37: tiene exp_kernel nel suo dominio */
+    float t = 1.0f / (1.0f + 0.5f * z);
+    float arg = -z * z - 1.26551223f + t * (1.00002368f + t * (0.37409196f + t * (0.09678418f
+              + t * (-0.18628806f + t * (0.27886807f + t * (-1.13520398f + t * (1.48851587f
+              + t * (-0.82215223f + t * 0.17087277f))))))));
+    float r = t * exp_kernel(arg);
+    return (x < 0.0f) ? 2.0f - r : r;
+}
+
+/* ---- Inventario ---- */
+
+void free_portafoglio(Portafoglio *p) {
+    free(p->lat);
+    free(p->lon);
+    free(p->stazione);
+    free(p->tipologia);
+    free(p->n_piani);
+    free(p->classe);
+    free(p->p_mds);
+    free(p->p_eds);
+    free(p->p_cds);
+    memset(p, 0, sizeof(*p));
+}
+
+int init_portafoglio(Portafoglio *p, int capacita) {
+    memset(p, 0, sizeof(*p));
+    if (capacita < 1) {
+        return -1;
+    }
+    size_t n = (size_t)capacita;
+    p->lat       = malloc(n * sizeof(float));
+    p->lon       = malloc(n * sizeof(float));
+    p->stazione  = malloc(n * sizeof(int));
+    p->tipologia = malloc(n);
+    p->n_piani   = malloc(n);
+    p->classe    = malloc(n);
+    p->p_mds     = calloc(n, sizeof(float));
+    p->p_eds     = calloc(n, sizeof(float));
+    p->p_cds     = calloc(n, sizeof(float));
+    if (!p->lat || !p->lon || !p->stazione || !p->tipologia || !p->n_piani
+        || !p->classe || !p->p_mds || !p->p_eds || !p->p_cds) {
+        free_portafoglio(p);
+        return -1;
+    }
+    p->capacita = capacita;
+    return 0;
+}
+
+int tipologia_da_nome(const char *nome) {
+    for (int t = 0; t < N_TIPOLOGIE; t++) {
+        if (strcmp(nome, NOMI_TIPOLOGIA[t]) == 0) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+const char *nome_tipologia(Tipologia tipologia) {
+    return NOMI_TIPOLOGIA[tipologia];
+}
+
+/* Stessa scelta di get_configurazione, risolta una volta per edificio */
+static int classe_fragilita(Tipologia tipologia, int n_piani) {
+    const ConfigurazioneAllarme *config = get_configurazione(NOMI_TIPOLOGIA[tipologia], n_piani);
+    for (int c = 0; c < N_CLASSI_FRAGILITA; c++) {
+        if (CLASSI[c] == config) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+int aggiungi_edificio(Portafoglio *p, Tipologia tipologia, int n_piani,
+                      double lat, double lon, int stazione) {
+    if (p->n_edifici >= p->capacita || (int)tipologia < 0 || tipologia >= N_TIPOLOGIE
+        || n_piani < 1 || n_piani > 255) {
+        return -1;
+    }
+    int i = p->n_edifici;
+    p->lat[i] = (float)lat;
+    p->lon[i] = (float)lon;
+    p->stazione[i] = stazione;
+    p->tipologia[i] = (unsigned char)tipologia;
+    p->n_piani[i] = (unsigned char)n_piani;
+    p->classe[i] = (unsigned char)classe_fragilita(tipologia, n_piani);
+    return p->n_edifici++;
+}
+
+int salva_portafoglio(const Portafoglio *p, const char *percorso) {
+    FILE *fp = fopen(percorso, "wb");
+    if (!fp) {
+        return -1;
+    }
+
+    IntestazionePortafoglio h = {
+        .magic = PORTAFOGLIO_MAGIC,
+        .versione = PORTAFOGLIO_VERSIONE,
+        .n_edifici = (unsigned int)p->n_edifici,
+        .dim_record = sizeof(RecordEdificio),
+    };
+    int ok = (fwrite(&h, sizeof(h), 1, fp) == 1);
+
+    RecordEdificio blocco[BLOCCO_LETTURA];
+    for (int i = 0; ok && i < p->n_edifici; i += BLOCCO_LETTURA) {
+        int n = (p->n_edifici - i < BLOCCO_LETTURA) ? p->n_edifici - i : BLOCCO_LETTURA;
+        for (int j = 0; j < n; j++) {
+            RecordEdificio *r = &blocco[j];
+            r->lat = p->lat[i + j];
+            r->lon = p->lon[i + j];
+            r->stazione = p->stazione[i + j];
+            r->tipologia = p->tipologia[i + j];
+            r->n_piani = p->n_piani[i + j];
+            r->riservato = 0;
+        }
+        ok = (fwrite(blocco, sizeof(RecordEdificio), n, fp) == (size_t)n);
+    }
+
+    ok = (fclose(fp) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+int carica_portafoglio(Portafoglio *p, const char *percorso) {
+    FILE *fp = fopen(percorso, "rb");
+    if (!fp) {
+        return -1;
+    }
+
+    IntestazionePortafoglio h;
+    if (fread(&h, sizeof(h), 1, fp) != 1 || h.magic != PORTAFOGLIO_MAGIC
+        || h.versione != PORTAFOGLIO_VERSIONE || h.dim_record != sizeof(RecordEdificio)
+        || h.n_edifici == 0 || h.n_edifici > 0x7fffffffu
+        || init_portafoglio(p, (int)h.n_edifici) != 0) {
+        fclose(fp);
+        return -1;
+    }
+
+    RecordEdificio blocco[BLOCCO_LETTURA];
+    int rimasti = (int)h.n_edifici;
+    while (rimasti > 0) {
+        int n = (rimasti < BLOCCO_LETTURA) ? rimasti : BLOCCO_LETTURA;
+        if (fread(blocco, sizeof(RecordEdificio), n, fp) != (size_t)n) {
+            break;
+        }
+        for (int j = 0; j < n; j++) {
+            const RecordEdificio *r = &blocco[j];
+            if (aggiungi_edificio(p, (Tipologia)r->tipologia, r->n_piani,
+                                  r->lat, r->lon, r->stazione) < 0) {
+                break;
+            }
+        }
+        rimasti -= n;
+    }
+    fclose(fp);
+
+    if (p->n_edifici != (int)h.n_edifici) {
+        free_portafoglio(p);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---- Valutazione per evento ---- */
+
+int valuta_portafoglio(Portafoglio *p, const double *pgd_stazione, int n_stazioni) {
+    /* log10 del PGD per stazione; l'ultima voce raccoglie le stazioni senza dati */
+    float *log_pgd = malloc(((size_t)n_stazioni + 1) * sizeof(float));
+    if (!log_pgd) {
+        return -1;
+    }
+    for (int s = 0; s < n_stazioni; s++) {
+        float pgd = (float)pgd_stazione[s];
+        int valido = pgd >= FLT_MIN;
+        float l = log10_kernel(valido ? pgd : 1.0f);
+        log_pgd[s] = valido ? l : LOG10_PGD_NULLO;
+    }
+    log_pgd[n_stazioni] = LOG10_PGD_NULLO;
+
+    /* Argomento di erfc per classe e stato di danno: u = a + b * log10(PGD),
+     * ovvero (log10 soglia - log10 drift predetto) / (sigma * sqrt(2)) */
+    float a_mds[N_CLASSI_FRAGILITA], a_eds[N_CLASSI_FRAGILITA], a_cds[N_CLASSI_FRAGILITA];
+    float pr_mds[N_CLASSI_FRAGILITA], pr_eds[N_CLASSI_FRAGILITA], pr_cds[N_CLASSI_FRAGILITA];
+    double scala = 1.0 / (SIGMA_INCERTEZZA * sqrt(2.0));
+    float b = (float)(-REGRESSIONE_PENDENZA * scala);
+    for (int c = 0; c < N_CLASSI_FRAGILITA; c++) {
+        a_mds[c] = (float)((log10(CLASSI[c]->mds) - REGRESSIONE_INTERCETTA) * scala);
+        a_eds[c] = (float)((log10(CLASSI[c]->eds) - REGRESSIONE_INTERCETTA) * scala);
+        a_cds[c] = (float)((log10(CLASSI[c]->cds) - REGRESSIONE_INTERCETTA) * scala);
+        pr_mds[c] = (float)CLASSI[c]->p_mds;
+        pr_eds[c] = (float)CLASSI[c]->p_eds;
+        pr_cds[c] = (float)CLASSI[c]->p_cds;
+    }
+
+    const unsigned char *classe = p->classe;
+    const int *stazione = p->stazione;
+    float *restrict p_mds = p->p_mds;
+    float *restrict p_eds = p->p_eds;
+    float *restrict p_cds = p->p_cds;
+    int n_mds = 0, n_eds = 0, n_cds = 0;
+
+    for (int i = 0; i < p->n_edifici; i++) {
+        int c = classe[i];
+        unsigned int s = (unsigned int)stazione[i];   /* negativi compresi */
+        s = (s < (unsigned int)n_stazioni) ? s : (unsigned int)n_stazioni;
+        float l = log_pgd[s];
+
+        float pm = 50.0f * erfc_kernel(a_mds[c] + b * l);
+        float pe = 50.0f * erfc_kernel(a_eds[c] + b * l);
+        float pc = 50.0f * erfc_kernel(a_cds[c] + b * l);
+        p_mds[i] = pm;
+        p_eds[i] = pe;
+        p_cds[i] = pc;
+        n_mds += (pm >= pr_mds[c]);
+        n_eds += (pe >= pr_eds[c]);
+        n_cds += (pc >= pr_cds[c]);
+    }
+
+    p->n_superamenti[0] = n_mds;
+    p->n_superamenti[1] = n_eds;
+    p->n_superamenti[2] = n_cds;
+    free(log_pgd);
+    return 0;
+}
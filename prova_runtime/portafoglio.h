@@ -0,0 +1,85 @@
+#ifndef PORTAFOGLIO_H
+#define PORTAFOGLIO_H
+
+/* Valutazione della fragilità su un inventario di edifici. Per ogni evento
+ * il log10 del PGD viene calcolato una volta per stazione; per ogni edificio
+ * restano una lettura indicizzata e tre erfc, calcolate con kernel in
+ * singola precisione senza salti così che il compilatore li vettorizzi.
+ * Le probabilità coincidono con calcola_probabilita_previsiva entro 1e-4
+ * punti percentuali. Il file va compilato con -ftree-vectorize e
+ * -fno-trapping-math (vedi makefile), altrimenti le selezioni nei kernel
+ * restano salti e il ciclo non viene vettorizzato. */
+
+#define PORTAFOGLIO_MAGIC     0x50535744u  /* "DWSP" */
+#define PORTAFOGLIO_VERSIONE  1u
+
+typedef enum {
+    TIPOLOGIA_RC = 0,
+    TIPOLOGIA_URM_REG,
+    TIPOLOGIA_URM_STONE,
+    N_TIPOLOGIE
+} Tipologia;
+
+/* Classi di fragilità: tipologia x (basso, medio), stesso criterio di
+ * get_configurazione */
+#define N_CLASSI_FRAGILITA  (2 * N_TIPOLOGIE)
+
+/* Record del file di inventario (16 byte, little-endian), dopo l'intestazione */
+typedef struct {
+    float lat, lon;
+    int stazione;              /* indice della stazione più vicina */
+    unsigned char tipologia;   /* Tipologia */
+    unsigned char n_piani;
+    unsigned short riservato;
+} RecordEdificio;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned int n_edifici;
+    unsigned int dim_record;   /* sizeof(RecordEdificio) */
+} IntestazionePortafoglio;
+
+/* Inventario in memoria, per colonne */
+typedef struct {
+    int n_edifici;
+    int capacita;
+    float *lat, *lon;
+    int *stazione;
+    unsigned char *tipologia;
+    unsigned char *n_piani;
+    unsigned char *classe;     /* indice in N_CLASSI_FRAGILITA */
+
+    /* Probabilità di superamento [%] dell'ultimo evento valutato */
+    float *p_mds, *p_eds, *p_cds;
+    int n_superamenti[3];      /* edifici oltre la soglia di probabilità MDS, EDS, CDS */
+} Portafoglio;
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int init_portafoglio(Portafoglio *p, int capacita);
+
+void free_portafoglio(Portafoglio *p);
+
+/* "RC", "URM_REG", "URM_STONE"; -1 se sconosciuta. */
+int tipologia_da_nome(const char *nome);
+
+/* Inverso di tipologia_da_nome. */
+const char *nome_tipologia(Tipologia tipologia);
+
+/* Ritorna l'indice dell'edificio, -1 se pieno o dati non validi. */
+int aggiungi_edificio(Portafoglio *p, Tipologia tipologia, int n_piani,
+                      double lat, double lon, int stazione);
+
+/* Ritorna 0 in caso di successo, -1 se errore. */
+int salva_portafoglio(const Portafoglio *p, const char *percorso);
+
+/* Inizializza p dal file binario. Ritorna 0 o -1. */
+int carica_portafoglio(Portafoglio *p, const char *percorso);
+
+/* Calcola p_mds/p_eds/p_cds e n_superamenti per tutti gli edifici.
+ * pgd_stazione[s] è il PGD [m] della stazione s; edifici associati a stazioni
+ * fuori da [0, n_stazioni) o con PGD <= 0 hanno probabilità 0.
+ * Ritorna 0 in caso di successo, -1 se errore. */
+int valuta_portafoglio(Portafoglio *p, const double *pgd_stazione, int n_stazioni);
+
+#endif
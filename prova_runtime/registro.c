@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "registro.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINEA_CACHE 64
+
+/* 64 byte: un record per linea di cache */
+typedef struct {
+    long long istante_ns;
+    const char *formato;
+    ArgomentoRegistro argomenti[REGISTRO_MAX_ARGOMENTI];
+    unsigned char livello;
+    unsigned char n_argomenti;
+} RecordRegistro;
+
+/* scrittura è del produttore, lettura del formattatore: su linee diverse
+ * per non rimbalzarle tra i core a ogni messaggio */
+typedef struct {
+    _Alignas(LINEA_CACHE) atomic_ullong scrittura;
+    unsigned long long lettura_nota;   /* copia locale del produttore */
+    atomic_llong persi;
+    _Alignas(LINEA_CACHE) atomic_ullong lettura;
+    int indice;
+    atomic_int libero;                 /* il thread è uscito: riusabile una volta svuotato */
+    _Alignas(LINEA_CACHE) RecordRegistro record[REGISTRO_CAPACITA];
+} AnelloRegistro;
+
+static _Atomic(AnelloRegistro *) anelli[REGISTRO_MAX_THREAD];
+static atomic_int n_anelli;
+static atomic_llong persi_senza_anello;
+static _Thread_local AnelloRegistro *anello_thread;
+static pthread_key_t chiave_uscita;
+static pthread_once_t chiave_creata = PTHREAD_ONCE_INIT;
+
+static FILE *uscita_registro;
+static int prefisso_registro;
+static long long istante_avvio;
+static pthread_t formattatore;
+static pthread_mutex_t consumo = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int termina;
+static int attivo;
+
+static const char *const NOMI_LIVELLO[] = { "INFO", "AVVISO", "ERRORE" };
+
+static long long istante_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/* All'uscita del thread: le ultime scritture restano da formattare, poi
+ * l'anello passa al prossimo thread che si iscrive */
+static void rilascia_anello(void *arg) {
+    AnelloRegistro *a = arg;
+    atomic_store_explicit(&a->libero, 1, memory_order_release);
+}
+
+static void crea_chiave(void) {
+    pthread_key_create(&chiave_uscita, rilascia_anello);
+}
+
+/* Anello di un thread uscito e già svuotato dal formattatore: i contatori
+ * proseguono, il nuovo thread ne diventa l'unico produttore */
+static AnelloRegistro *riusa_anello(void) {
+    int n = atomic_load_explicit(&n_anelli, memory_order_acquire);
+    for (int i = 0; i < n && i < REGISTRO_MAX_THREAD; i++) {
+        AnelloRegistro *a = atomic_load_explicit(&anelli[i], memory_order_acquire);
+        int libero = 1;
+        if (!a || !atomic_load_explicit(&a->libero, memory_order_acquire)) {
+            continue;
+        }
+        unsigned long long s = atomic_load_explicit(&a->scrittura, memory_order_relaxed);
+        if (atomic_load_explicit(&a->lettura, memory_order_acquire) != s
+            || !atomic_compare_exchange_strong(&a->libero, &libero, 0)) {
+            continue;
+        }
+        a->lettura_nota = s;
+        return a;
+    }
+    return NULL;
+}
+
+static AnelloRegistro *iscrivi_anello(void) {
+    pthread_once(&chiave_creata, crea_chiave);
+    AnelloRegistro *a = riusa_anello();
+    if (a) {
+        pthread_setspecific(chiave_uscita, a);
+        return a;
+    }
+
+    /* Il contatore non cresce oltre il limite: a tabella piena un thread
+     * che riprova a ogni messaggio non tocca la linea condivisa */
+    int indice = atomic_load_explicit(&n_anelli, memory_order_relaxed);
+    do {
+        if (indice >= REGISTRO_MAX_THREAD) {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&n_anelli, &indice, indice + 1));
+    a = aligned_alloc(LINEA_CACHE, sizeof(AnelloRegistro));
+    if (!a) {
+        return NULL;
+    }
+    /* Anche le pagine dei record: niente page fault al primo messaggio */
+    memset(a, 0, sizeof(*a));
+    atomic_init(&a->scrittura, 0);
+    atomic_init(&a->persi, 0);
+    atomic_init(&a->lettura, 0);
+    atomic_init(&a->libero, 0);
+    a->indice = indice;
+    atomic_store_explicit(&anelli[indice], a, memory_order_release);
+    pthread_setspecific(chiave_uscita, a);
+    return a;
+}
+
+int iscrivi_thread_registro(void) {
+    if (!anello_thread) {
+        anello_thread = iscrivi_anello();
+    }
+    return anello_thread ? 0 : -1;
+}
+
+void registra_messaggio(LivelloRegistro livello, const char *formato,
+                        const ArgomentoRegistro *argomenti, int n_argomenti) {
+    AnelloRegistro *a = anello_thread;
+    if (!a && iscrivi_thread_registro() != 0) {
+        atomic_fetch_add_explicit(&persi_senza_anello, 1, memory_order_relaxed);
+        return;
+    }
+    a = anello_thread;
+
+    /* La lettura condivisa si ricarica solo quando la copia locale dice
+     * pieno: di norma il produttore non tocca la linea del formattatore */
+    unsigned long long s = atomic_load_explicit(&a->scrittura, memory_order_relaxed);
+    if (s - a->lettura_nota >= REGISTRO_CAPACITA) {
+        a->lettura_nota = atomic_load_explicit(&a->lettura, memory_order_acquire);
+        if (s - a->lettura_nota >= REGISTRO_CAPACITA) {
+            atomic_fetch_add_explicit(&a->persi, 1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    if (n_argomenti > REGISTRO_MAX_ARGOMENTI) {
+        n_argomenti = REGISTRO_MAX_ARGOMENTI;
+    }
+    RecordRegistro *r = &a->record[s & (REGISTRO_CAPACITA - 1)];
+    r->istante_ns = istante_ns();
+    r->formato = formato;
+    r->livello = (unsigned char)livello;
+    r->n_argomenti = (unsigned char)n_argomenti;
+    for (int i = 0; i < n_argomenti; i++) {
+        r->argomenti[i] = argomenti[i];
+    }
+    atomic_store_explicit(&a->scrittura, s + 1, memory_order_release);
+}
+
+/* printf su un record: il formato è spezzato a ogni conversione e ciascuna
+ * è passata a fprintf con il tipo del membro dell'unione corrispondente */
+static void formatta_record(FILE *f, const RecordRegistro *r, int thread) {
+    if (prefisso_registro) {
+        fprintf(f, "[%12.6f %-6s t%02d] ", (r->istante_ns - istante_avvio) * 1e-9,
+                NOMI_LIVELLO[r->livello], thread);
+    }
+
+    const char *p = r->formato;
+    int usati = 0;
+    while (*p) {
+        const char *inizio = strchr(p, '%');
+        if (!inizio) {
+            fputs(p, f);
+            break;
+        }
+        fwrite(p, 1, inizio - p, f);
+        if (inizio[1] == '%') {
+            fputc('%', f);
+            p = inizio + 2;
+            continue;
+        }
+
+        /* flag, larghezza e precisione sono conservati, le lunghezze
+         * (h l ll z ...) sostituite da quella del tipo nell'unione */
+        char spec[32];
+        size_t n = 0;
+        const char *q = inizio + 1;
+        spec[n++] = '%';
+        while (*q && strchr("-+ #0123456789.", *q) && n < sizeof(spec) - 4) {
+            spec[n++] = *q++;
+        }
+        while (*q && strchr("hlLqjzt", *q)) {
+            q++;
+        }
+        char conversione = *q;
+        if (!conversione || usati >= r->n_argomenti) {
+            fputs(inizio, f);
+            break;
+        }
+        const ArgomentoRegistro *arg = &r->argomenti[usati++];
+        if (strchr("diouxX", conversione)) {
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conversione;
+            spec[n] = '\0';
+            fprintf(f, spec, arg->intero);
+        } else if (conversione == 'c') {
+            spec[n++] = conversione;
+            spec[n] = '\0';
+            fprintf(f, spec, (int)arg->intero);
+        } else if (strchr("fFeEgGaA", conversione)) {
+            spec[n++] = conversione;
+            spec[n] = '\0';
+            fprintf(f, spec, arg->reale);
+        } else if (conversione == 's') {
+            spec[n++] = conversione;
+            spec[n] = '\0';
+            fprintf(f, spec, arg->testo ? arg->testo : "(null)");
+        } else {
+            fwrite(inizio, 1, q + 1 - inizio, f);
+        }
+        p = q + 1;
+    }
+}
+
+/* Con il mutex di consumo. Fusione per istante tra le teste degli anelli:
+ * dentro un anello l'ordine è già quello di scrittura. */
+static int svuota_anelli(void) {
+    AnelloRegistro *a[REGISTRO_MAX_THREAD];
+    unsigned long long pos[REGISTRO_MAX_THREAD], fine[REGISTRO_MAX_THREAD];
+    int n = atomic_load_explicit(&n_anelli, memory_order_acquire);
+    if (n > REGISTRO_MAX_THREAD) {
+        n = REGISTRO_MAX_THREAD;
+    }
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        AnelloRegistro *x = atomic_load_explicit(&anelli[i], memory_order_acquire);
+        if (!x) {
+            continue;
+        }
+        a[m] = x;
+        pos[m] = atomic_load_explicit(&x->lettura, memory_order_relaxed);
+        fine[m] = atomic_load_explicit(&x->scrittura, memory_order_acquire);
+        m++;
+    }
+
+    int scritti = 0;
+    for (;;) {
+        int scelto = -1;
+        long long minimo = 0;
+        for (int i = 0; i < m; i++) {
+            if (pos[i] == fine[i]) {
+                continue;
+            }
+            long long t = a[i]->record[pos[i] & (REGISTRO_CAPACITA - 1)].istante_ns;
+            if (scelto < 0 || t < minimo) {
+                scelto = i;
+                minimo = t;
+            }
+        }
+        if (scelto < 0) {
+            break;
+        }
+        AnelloRegistro *x = a[scelto];
+        formatta_record(uscita_registro, &x->record[pos[scelto] & (REGISTRO_CAPACITA - 1)], x->indice);
+        /* Slot restituito subito: se l'uscita è lenta il produttore
+         * ritrova spazio record per record */
+        atomic_store_explicit(&x->lettura, ++pos[scelto], memory_order_release);
+        scritti++;
+    }
+    return scritti;
+}
+
+static void *ciclo_formattatore(void *arg) {
+    (void)arg;
+    struct timespec periodo = { 0, REGISTRO_PERIODO_NS };
+    while (!atomic_load_explicit(&termina, memory_order_acquire)) {
+        pthread_mutex_lock(&consumo);
+        if (svuota_anelli() > 0) {
+            fflush(uscita_registro);
+        }
+        pthread_mutex_unlock(&consumo);
+        nanosleep(&periodo, NULL);
+    }
+    return NULL;
+}
+
+int avvia_registro(FILE *uscita, int prefisso) {
+    if (attivo) {
+        return -1;
+    }
+    uscita_registro = uscita;
+    prefisso_registro = prefisso;
+    istante_avvio = istante_ns();
+    atomic_store(&termina, 0);
+    if (iscrivi_thread_registro() != 0) {
+        return -1;
+    }
+    if (pthread_create(&formattatore, NULL, ciclo_formattatore, NULL) != 0) {
+        return -1;
+    }
+    attivo = 1;
+    return 0;
+}
+
+void svuota_registro(void) {
+    if (!attivo) {
+        return;
+    }
+    pthread_mutex_lock(&consumo);
+    svuota_anelli();
+    fflush(uscita_registro);
+    pthread_mutex_unlock(&consumo);
+}
+
+long long messaggi_persi_registro(void) {
+    long long persi = atomic_load_explicit(&persi_senza_anello, memory_order_relaxed);
+    int n = atomic_load_explicit(&n_anelli, memory_order_acquire);
+    for (int i = 0; i < n && i < REGISTRO_MAX_THREAD; i++) {
+        AnelloRegistro *a = atomic_load_explicit(&anelli[i], memory_order_acquire);
+        if (a) {
+            persi += atomic_load_explicit(&a->persi, memory_order_relaxed);
+        }
+    }
+    return persi;
+}
+
+void ferma_registro(void) {
+    if (!attivo) {
+        return;
+    }
+    atomic_store_explicit(&termina, 1, memory_order_release);
+    pthread_join(formattatore, NULL);
+    attivo = 0;
+
+    pthread_mutex_lock(&consumo);
+    svuota_anelli();
+    fflush(uscita_registro);
+    pthread_mutex_unlock(&consumo);
+
+    long long persi = messaggi_persi_registro();
+    if (persi > 0) {
+        fprintf(stderr, "Registro: %lld messaggi persi (anelli pieni)\n", persi);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <stdio.h>
+
+/* Registro asincrono dei messaggi. Chi elabora i campioni non chiama mai
+ * printf: REGISTRA copia in un anello del proprio thread un record binario
+ * di dimensione fissa (formato + argomenti) e ritorna; un thread in
+ * background svuota gli anelli, formatta e scrive. Ogni anello ha un solo
+ * produttore (il thread) e un solo consumatore (il formattatore), quindi
+ * basta una coppia di contatori atomici: nessun lock, nessuna chiamata di
+ * sistema, costo di una copia di 64 byte. Se l'uscita è bloccata (terminale
+ * lento, pipe piena) l'anello si riempie e i messaggi in più sono scartati
+ * e contati, mai attesi. */
+
+#define REGISTRO_CAPACITA      1024    /* record per anello, potenza di 2 */
+#define REGISTRO_MAX_THREAD    64      /* anelli: thread vivi, o usciti e non ancora svuotati */
+#define REGISTRO_MAX_ARGOMENTI 5
+#define REGISTRO_PERIODO_NS    1000000L
+
+typedef enum {
+    REGISTRO_INFO = 0,
+    REGISTRO_AVVISO,
+    REGISTRO_ERRORE
+} LivelloRegistro;
+
+/* Il tipo effettivo è deciso dalla conversione nel formato: d i o u x X c
+ * vogliono intero, f e g a (maiuscole comprese) reale, s testo. Le stringhe
+ * non sono copiate: devono restare valide fino a svuota_registro. */
+typedef union {
+    long long intero;
+    double reale;
+    const char *testo;
+} ArgomentoRegistro;
+
+#define REGISTRO_INTERO(x) ((ArgomentoRegistro){ .intero = (x) })
+#define REGISTRO_REALE(x)  ((ArgomentoRegistro){ .reale = (x) })
+#define REGISTRO_TESTO(x)  ((ArgomentoRegistro){ .testo = (x) })
+
+/* REGISTRA(REGISTRO_INFO, "Trigger a %.3f s\n", REGISTRO_REALE(t)); almeno un
+ * argomento, per i messaggi senza argomenti registra_messaggio(l, f, NULL, 0) */
+#define REGISTRA(livello, formato, ...) \
+    registra_messaggio((livello), (formato), (const ArgomentoRegistro[]){ __VA_ARGS__ }, \
+                       (int)(sizeof((const ArgomentoRegistro[]){ __VA_ARGS__ }) / sizeof(ArgomentoRegistro)))
+
+/* Avvia il formattatore su uscita e iscrive il thread chiamante. Con
+ * prefisso != 0 ogni riga è preceduta da istante, livello e thread; con 0
+ * l'uscita è identica a quella di printf. Ritorna 0 o -1. */
+int avvia_registro(FILE *uscita, int prefisso);
+
+/* Alloca l'anello del thread chiamante, altrimenti creato alla prima
+ * REGISTRA. Da chiamare prima dei cicli in tempo reale. Ritorna 0 o -1.
+ * Quando il thread esce l'anello torna libero appena il formattatore lo ha
+ * svuotato, e il prossimo thread che si iscrive lo riprende. */
+int iscrivi_thread_registro(void);
+
+/* Percorso critico: O(1), non blocca. Oltre REGISTRO_MAX_ARGOMENTI gli
+ * argomenti sono troncati. */
+void registra_messaggio(LivelloRegistro livello, const char *formato,
+                        const ArgomentoRegistro *argomenti, int n_argomenti);
+
+/* Scrive subito tutto ciò che è già nei record, in ordine di istante, e fa
+ * fflush: da chiamare prima di stampare direttamente sulla stessa uscita. */
+void svuota_registro(void);
+
+/* Svuota, ferma il formattatore e segnala su stderr i messaggi persi. Gli
+ * anelli restano iscritti: un avvio successivo li riusa. */
+void ferma_registro(void);
+
+long long messaggi_persi_registro(void);
+
+#endif
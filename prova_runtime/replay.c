@@ -0,0 +1,594 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dosews.h"
+#include "varianti.h"
+#include "ricampionamento.h"
+#include "associazione.h"
+#include "archivio.h"
+#include "fusione.h"
+#include "registro.h"
+#include "tempo_reale.h"
+#include "salute.h"
+#include "catalogo.h"
+#include "aggregazione.h"
+
+/* Riproduzione di un evento registrato da una rete di stazioni:
+ *   replay <manifesto> [-v accelerazione] [-k k] [-n n] [-m] [-l catalogo] [-a host:porta [-i nodo]]
+ * Il manifesto ha una riga per stazione (righe vuote e # ignorate):
+ *   percorso lat lon [t0 [frequenza]]
+ * percorso è un file di testo (g, un valore per riga) o un archivio .dws,
+ * da cui t0 e frequenza sono presi se mancano. I campioni di tutte le
+ * stazioni sono elaborati in ordine di istante con una fusione k-vie.
+ * Senza -v la riproduzione va alla massima velocità; con -v l'evento scorre
+ * a accelerazione volte il tempo reale. Con -k i trigger passano
+ * dall'associazione k-su-n e l'allarme richiede la conferma di rete. Con
+ * -m i campioni in attesa del trigger passano anche al monitor di salute
+ * (salute.h), che sospende il trigger delle stazioni guaste. Con -l ogni
+ * stazione scattata aggiunge un record al catalogo degli eventi
+ * (catalogo.h), con l'indice nel manifesto come stazione. Con -a il
+ * processo è il nodo nodo (default 0) della rete e manda i delta delle sue
+ * stazioni all'aggregatore (aggregazione.h), con nodo << 16 | indice nel
+ * manifesto come stazione.
+ * Il registro degli eventi dipende solo dai dati, non dalla modalità. */
+
+#define FREQUENZA        200.0
+#define FC_HIGHPASS      0.075
+#define STA_SEC          0.5
+#define LTA_SEC          6.0
+#define SOGLIA_STA_LTA   4.0
+#define TIPOLOGIA        "RC"
+#define N_PIANI          3
+#define SOGLIA_DANNO     "EDS"
+#define VICINI           6
+#define VELOCITA_P       6.0      /* km/s */
+#define TOLLERANZA       1.0      /* s */
+#define PASSO_RITMO      0.005    /* s di evento tra due controlli dell'orologio */
+#define MAX_FREQUENZE    8        /* frequenze di ingresso distinte */
+
+typedef struct Replay Replay;
+
+typedef struct {
+    char percorso[256];
+    double lat, lon;
+    double t0;                     /* s, istante del primo campione */
+    int ha_t0;                     /* t0 dal manifesto, anche negativo */
+    double frequenza;              /* Hz, di ingresso */
+    Archivio archivio;             /* mappa nulla per i file di testo */
+    double *campioni;              /* testo: tutta la registrazione; archivio: blocco corrente */
+    long n_campioni, pos;
+    unsigned int prossimo_blocco;
+    long long letti;
+    const CoeffRicampionatore *coeff_ric;
+    StatoRicampionatore stato_ric;
+    StatoDOSEWS sys;
+    FunzioneProcessa processa;
+    Replay *replay;
+    int id;                        /* indice nella rete */
+    int confermata;
+} Stazione;
+
+struct Replay {
+    Stazione *stazioni;
+    int n_stazioni;
+    ReteStazioni rete;
+    int associazione;
+
+    double t_corrente;             /* istante del campione in elaborazione */
+    double t_primo_trigger, t_prima_conferma, t_primo_allarme;   /* validi con il contatore > 0 */
+    int n_trigger, n_conferme, n_allarmi;
+
+    double accelerazione;          /* 0: massima velocità */
+    double t_inizio;               /* istante di evento alla partenza */
+    struct timespec partenza;
+    IstogrammaLatenza ritmo;       /* ritardo rispetto al tempo di evento riscalato */
+    IstogrammaLatenza ritardo_allarmi;
+    MonitorSalute *salute;         /* NULL senza -m */
+    EmettitoreAggregazione *aggregazione;   /* NULL senza -a */
+    unsigned int nodo;
+    double adesso;                 /* s, CLOCK_REALTIME letto a ogni PASSO_RITMO */
+};
+
+static double *leggi_testo(const char *percorso, long *n) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return NULL;
+    }
+    long capacita = 1 << 16;
+    double *dati = malloc(capacita * sizeof(double));
+    *n = 0;
+    double valore;
+    while (dati && fscanf(fp, "%lf", &valore) == 1) {
+        if (*n == capacita) {
+            capacita *= 2;
+            double *nuovo = realloc(dati, capacita * sizeof(double));
+            if (!nuovo) {
+                free(dati);
+                dati = NULL;
+                break;
+            }
+            dati = nuovo;
+        }
+        dati[(*n)++] = valore;
+    }
+    /* Un valore non numerico non è la fine dei dati */
+    if (dati && !feof(fp)) {
+        free(dati);
+        dati = NULL;
+    }
+    fclose(fp);
+    return dati;
+}
+
+/* Ritorna il numero di stazioni, -1 se errore */
+static int leggi_manifesto(const char *percorso, Stazione **stazioni) {
+    FILE *fp = fopen(percorso, "r");
+    if (!fp) {
+        return -1;
+    }
+    int n = 0, capacita = 64;
+    Stazione *s = malloc(capacita * sizeof(Stazione));
+    char riga[512];
+    while (s && fgets(riga, sizeof(riga), fp)) {
+        char nome[256];
+        double lat, lon, t0 = 0.0, frequenza = 0.0;
+        int campi = sscanf(riga, "%255s %lf %lf %lf %lf", nome, &lat, &lon, &t0, &frequenza);
+        if (campi <= 0 || nome[0] == '#') {
+            continue;
+        }
+        if (campi < 3) {
+            fprintf(stderr, "Errore: riga del manifesto non valida: %s", riga);
+            n = -1;
+            break;
+        }
+        if (n == capacita) {
+            capacita *= 2;
+            Stazione *nuovo = realloc(s, capacita * sizeof(Stazione));
+            if (!nuovo) {
+                n = -1;
+                break;
+            }
+            s = nuovo;
+        }
+        Stazione *st = &s[n++];
+        memset(st, 0, sizeof(*st));
+        strcpy(st->percorso, nome);
+        st->lat = lat;
+        st->lon = lon;
+        st->t0 = t0;
+        st->ha_t0 = (campi >= 4);
+        st->frequenza = (campi >= 5) ? frequenza : 0.0;
+    }
+    fclose(fp);
+    if (!s || n < 0) {
+        free(s);
+        return -1;
+    }
+    *stazioni = s;
+    return n;
+}
+
+/* Archivio .dws mappato e decodificato a blocchi, oppure testo letto tutto.
+ * Un file con il magic dell'archivio ma rovinato è un errore */
+static int apri_sorgente(Stazione *s) {
+    if (riconosci_archivio(s->percorso)) {
+        if (apri_archivio(&s->archivio, s->percorso) != 0) {
+            return -1;
+        }
+        const IntestazioneArchivio *h = s->archivio.intestazione;
+        if (!s->ha_t0) s->t0 = h->t0;
+        if (s->frequenza <= 0.0) s->frequenza = h->frequenza;
+        s->campioni = malloc(h->campioni_blocco * sizeof(double));
+        return s->campioni ? 0 : -1;
+    }
+    if (s->frequenza <= 0.0) s->frequenza = FREQUENZA;
+    s->campioni = leggi_testo(s->percorso, &s->n_campioni);
+    return s->campioni ? 0 : -1;
+}
+
+static int disponibile(const Stazione *s) {
+    return s->pos < s->n_campioni
+        || (s->archivio.mappa && s->prossimo_blocco < s->archivio.intestazione->n_blocchi);
+}
+
+static double prossimo_campione(Stazione *s) {
+    if (s->pos == s->n_campioni) {
+        s->n_campioni = decodifica_blocco_archivio(&s->archivio, s->prossimo_blocco++, s->campioni);
+        s->pos = 0;
+    }
+    return s->campioni[s->pos++];
+}
+
+static double istante_prossimo(const Stazione *s) {
+    return s->t0 + (double)s->letti / s->frequenza;
+}
+
+/* Ritardo [s] dell'orologio rispetto all'istante di evento t riscalato */
+static double ritardo_da_evento(const Replay *r, double t) {
+    struct timespec adesso;
+    istante_corrente(&adesso);
+    return differenza_istanti(&adesso, &r->partenza) - (t - r->t_inizio) / r->accelerazione;
+}
+
+static void conferma(Replay *r, Stazione *s, double t) {
+    if (s->confermata) {
+        return;
+    }
+    s->confermata = 1;
+    conferma_evento(&s->sys);
+    if (r->n_conferme++ == 0) r->t_prima_conferma = t;
+    REGISTRA(REGISTRO_INFO, "%10.3f s  conferma  %s\n", REGISTRO_REALE(t), REGISTRO_TESTO(s->percorso));
+}
+
+static void su_trigger(void *contesto, const StatoDOSEWS *sys) {
+    (void)sys;
+    Stazione *s = contesto;
+    Replay *r = s->replay;
+    double t = r->t_corrente;
+    if (r->n_trigger++ == 0) r->t_primo_trigger = t;
+    REGISTRA(REGISTRO_INFO, "%10.3f s  trigger   %s\n", REGISTRO_REALE(t), REGISTRO_TESTO(s->percorso));
+
+    /* La conferma vale anche per i vicini che hanno contribuito */
+    if (r->associazione && registra_trigger(&r->rete, s->id, t)) {
+        int vicini[ASSOCIAZIONE_MAX_VICINI];
+        int n = vicini_compatibili(&r->rete, s->id, t, vicini);
+        conferma(r, s, t);
+        for (int v = 0; v < n; v++) {
+            conferma(r, &r->stazioni[vicini[v]], t);
+        }
+    }
+}
+
+static void su_allarme(void *contesto, const StatoDOSEWS *sys) {
+    Stazione *s = contesto;
+    Replay *r = s->replay;
+    double t = r->t_corrente;
+    if (r->n_allarmi++ == 0) r->t_primo_allarme = t;
+    if (r->accelerazione > 0.0) {
+        registra_latenza(&r->ritardo_allarmi, ritardo_da_evento(r, t));
+    }
+    REGISTRA(REGISTRO_AVVISO, "%10.3f s  allarme   %s (PGD %.4f cm)\n",
+             REGISTRO_REALE(t), REGISTRO_TESTO(s->percorso), REGISTRO_REALE(sys->pgd_allarme * 100.0));
+}
+
+static const CoeffRicampionatore *coeff_per_frequenza(CoeffRicampionatore *coeff, int *n_coeff,
+                                                      double fs_in) {
+    for (int i = 0; i < *n_coeff; i++) {
+        if (coeff[i].fs_in == fs_in) return &coeff[i];
+    }
+    if (*n_coeff == MAX_FREQUENZE || calcola_coeff_ricampionatore(fs_in, FREQUENZA, &coeff[*n_coeff]) != 0) {
+        return NULL;
+    }
+    return &coeff[(*n_coeff)++];
+}
+
+/* Stazioni con diagnosi nell'ultimo blocco analizzato, poi i totali */
+static void stampa_salute(const Replay *r) {
+    int guaste = 0;
+    long long blocchi = 0, scartati = 0, sospesi = 0;
+    for (int i = 0; i < r->n_stazioni; i++) {
+        RapportoSalute rs;
+        rapporto_salute(r->salute, i, &rs);
+        blocchi += rs.blocchi;
+        scartati += rs.scartati;
+        sospesi += r->stazioni[i].sys.trigger_sospesi;
+        if (rs.stato != 0) {
+            char diagnosi[96];
+            descrivi_salute(rs.stato, diagnosi, sizeof(diagnosi));
+            printf("Salute %s: %s\n", r->stazioni[i].percorso, diagnosi);
+            guaste++;
+        }
+    }
+    printf("Salute: %d stazioni con diagnosi su %d, %lld blocchi analizzati, %lld scartati, "
+           "%lld trigger sospesi\n", guaste, r->n_stazioni, blocchi, scartati, sospesi);
+}
+
+/* Un record per stazione scattata, tutti in una sola aggiunta */
+static void scrivi_catalogo(const Replay *r, const char *percorso) {
+    RecordCatalogo *record = malloc((size_t)r->n_stazioni * sizeof(RecordCatalogo));
+    ScrittoreCatalogo catalogo;
+    if (!record || apri_scrittore_catalogo(&catalogo, percorso) != 0) {
+        fprintf(stderr, "Errore: catalogo %s non valido\n", percorso);
+        free(record);
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < r->n_stazioni; i++) {
+        const Stazione *s = &r->stazioni[i];
+        n += (record_catalogo(&record[n], &s->sys, (unsigned int)i, s->t0) == 0);
+    }
+    if (n > 0 && aggiungi_catalogo(&catalogo, record, n) != 0) {
+        fprintf(stderr, "Errore: scrittura nel catalogo %s fallita\n", percorso);
+    } else {
+        printf("Catalogo %s: %d record aggiunti\n", percorso, n);
+    }
+    chiudi_scrittore_catalogo(&catalogo);
+    free(record);
+}
+
+/* Stato della stazione verso l'aggregatore; niente da fare finché è a riposo */
+static void aggiorna_aggregazione(Replay *r, const Stazione *s, int i) {
+    EmettitoreAggregazione *e = r->aggregazione;
+    if (s->sys.fase == STATO_ATTESA_TRIGGER && e->correnti[i].fase == STATO_ATTESA_TRIGGER) {
+        return;
+    }
+    VoceAggregazione v;
+    voce_aggregazione(&v, &s->sys, r->nodo << 16 | (unsigned int)i, s->t0, &e->correnti[i]);
+    aggiorna_emettitore(e, i, &v, r->adesso);
+}
+
+/* Ciclo di fusione; ritorna i campioni elaborati */
+static long long esegui(Replay *r, CodaFusione *coda) {
+    long long campioni = 0;
+    double prossimo_controllo = r->t_inizio, prossimo_invio = r->t_inizio;
+    double ricampionati[RICAMPIONAMENTO_MAX_L];
+
+    while (coda->n > 0) {
+        Stazione *s = &r->stazioni[coda->voci[0].flusso];
+        double t = coda->voci[0].t;
+
+        /* Ritmo: controllo dell'orologio ogni PASSO_RITMO di evento, non a ogni campione */
+        if (r->accelerazione > 0.0 && t >= prossimo_controllo) {
+            struct timespec obiettivo = r->partenza;
+            avanza_istante(&obiettivo, (t - r->t_inizio) / r->accelerazione);
+            attendi_istante(&obiettivo);
+            registra_latenza(&r->ritmo, ritardo_da_evento(r, t));
+            prossimo_controllo = t + PASSO_RITMO;
+        }
+        if (r->aggregazione && t >= prossimo_invio) {
+            r->adesso = istante_aggregazione();
+            invia_emettitore(r->aggregazione, r->adesso, 0);
+            prossimo_invio = t + PASSO_RITMO;
+        }
+
+        r->t_corrente = t;
+        int n = ricampiona_campione(prossimo_campione(s), s->coeff_ric, &s->stato_ric, ricampionati);
+        for (int k = 0; k < n; k++) {
+            s->processa(&s->sys, ricampionati[k]);
+            if (r->salute && s->sys.fase == STATO_ATTESA_TRIGGER) {
+                campione_salute(r->salute, coda->voci[0].flusso, s->sys.indice_campione, ricampionati[k]);
+            }
+        }
+        if (r->aggregazione) {
+            aggiorna_aggregazione(r, s, coda->voci[0].flusso);
+        }
+        s->letti++;
+        campioni++;
+
+        if (disponibile(s)) {
+            avanza_fusione(coda, istante_prossimo(s));
+        } else {
+            rimuovi_fusione(coda);
+        }
+    }
+    return campioni;
+}
+
+int main(int argc, char *argv[]) {
+    const char *file_manifesto = NULL;
+    double accelerazione = 0.0;
+    int k = 0, n_vicini = VICINI;
+    int monitora = 0;
+    const char *file_catalogo = NULL;
+    const char *aggregatore = NULL;
+    long nodo = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            accelerazione = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n_vicini = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            monitora = 1;
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            file_catalogo = argv[++i];
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            aggregatore = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            nodo = atol(argv[++i]);
+        } else if (!file_manifesto && argv[i][0] != '-') {
+            file_manifesto = argv[i];
+        } else {
+            file_manifesto = NULL;
+            break;
+        }
+    }
+    if (!file_manifesto || accelerazione < 0.0 || k < 0 || n_vicini < 1 || nodo < 0 || nodo > 0xffff) {
+        fprintf(stderr, "Uso: %s <manifesto> [-v accelerazione] [-k k] [-n n] [-m] [-l catalogo] "
+                        "[-a host:porta [-i nodo]]\n", argv[0]);
+        return 1;
+    }
+
+    /* Risorse liberate tutte all'uscita, anche in caso di errore: le
+     * funzioni di chiusura accettano lo stato azzerato */
+    int esito = 1;
+    Replay r;
+    memset(&r, 0, sizeof(r));
+    unsigned char *memoria = NULL;
+    CoeffRicampionatore coeff[MAX_FREQUENZE];
+    int n_coeff = 0;
+    CodaFusione coda = { 0 };
+    MonitorSalute salute = { 0 };
+    EmettitoreAggregazione emettitore = { .socket = -1 };
+
+    r.accelerazione = accelerazione;
+    r.associazione = (k > 0);
+    azzera_latenza(&r.ritmo);
+    azzera_latenza(&r.ritardo_allarmi);
+
+    r.n_stazioni = leggi_manifesto(file_manifesto, &r.stazioni);
+    if (r.n_stazioni <= 0) {
+        fprintf(stderr, "Errore: manifesto %s non valido o vuoto\n", file_manifesto);
+        goto fine;
+    }
+
+    ConfigSistema config = {
+        .frequenza         = FREQUENZA,
+        .dt                = 1.0 / FREQUENZA,
+        .sta_sec           = STA_SEC,
+        .lta_sec           = LTA_SEC,
+        .soglia_sta_lta    = SOGLIA_STA_LTA,
+        .tipo_trigger      = TRIGGER_STA_LTA,
+        .fc_hp             = FC_HIGHPASS,
+        .n_piani           = N_PIANI,
+        .richiede_conferma = r.associazione,
+    };
+    strncpy(config.tipologia,     TIPOLOGIA,    sizeof(config.tipologia) - 1);
+    strncpy(config.soglia_target, SOGLIA_DANNO, sizeof(config.soglia_target) - 1);
+
+    if (r.associazione && init_rete(&r.rete, r.n_stazioni, k, n_vicini, VELOCITA_P, TOLLERANZA) != 0) {
+        fprintf(stderr, "Errore: inizializzazione della rete fallita\n");
+        goto fine;
+    }
+
+    /* Stati di tutte le stazioni in un solo blocco, coefficienti del
+     * ricampionatore condivisi per frequenza di ingresso */
+    size_t per_stazione = dimensione_memoria_dosews(&config);
+    memoria = aligned_alloc(ARENA_ALLINEAMENTO, per_stazione * (size_t)r.n_stazioni);
+    if (!memoria || init_coda_fusione(&coda, r.n_stazioni) != 0) {
+        fprintf(stderr, "Errore: memoria insufficiente\n");
+        goto fine;
+    }
+
+    long long totale_campioni = 0;
+    for (int i = 0; i < r.n_stazioni; i++) {
+        Stazione *s = &r.stazioni[i];
+        if (apri_sorgente(s) != 0) {
+            fprintf(stderr, "Errore: impossibile leggere %s\n", s->percorso);
+            goto fine;
+        }
+        s->coeff_ric = coeff_per_frequenza(coeff, &n_coeff, s->frequenza);
+        if (!s->coeff_ric || init_ricampionatore(&s->stato_ric, s->coeff_ric) != 0) {
+            fprintf(stderr, "Errore: ricampionamento %.3f -> %.3f Hz non supportato (%s)\n",
+                    s->frequenza, FREQUENZA, s->percorso);
+            goto fine;
+        }
+        if (init_dosews_arena(&s->sys, &config, memoria + (size_t)i * per_stazione, per_stazione) != 0) {
+            fprintf(stderr, "Errore: inizializzazione sistema fallita\n");
+            goto fine;
+        }
+        CallbackDOSEWS callback = { su_trigger, su_allarme, s };
+        imposta_callback_dosews(&s->sys, &callback);
+        s->processa = seleziona_variante(&s->sys, NULL);
+        s->replay = &r;
+        if (r.associazione) {
+            s->id = aggiungi_stazione(&r.rete, s->lat, s->lon);
+        }
+        totale_campioni += s->archivio.mappa ? (long long)s->archivio.intestazione->n_campioni
+                                             : s->n_campioni;
+        if (disponibile(s)) {
+            inserisci_fusione(&coda, istante_prossimo(s), i);
+        }
+    }
+    if (monitora) {
+        ConfigSalute config_s;
+        config_salute(&config_s, FREQUENZA);
+        /* Senza thread: analisi sincrona a fine blocco, come da file con
+         * dosews, così il veto non dipende dalla velocità di riproduzione */
+        if (init_salute(&salute, &config_s, r.n_stazioni) != 0) {
+            fprintf(stderr, "Errore: avvio del monitor di salute fallito\n");
+            goto fine;
+        }
+        for (int i = 0; i < r.n_stazioni; i++) {
+            imposta_veto_trigger_dosews(&r.stazioni[i].sys, veto_salute(&salute, i));
+        }
+        r.salute = &salute;
+    }
+    if (aggregatore) {
+        if (r.n_stazioni > 0x10000 || apri_emettitore(&emettitore, aggregatore, (unsigned int)nodo, r.n_stazioni) != 0) {
+            fprintf(stderr, "Errore: aggregatore %s non valido\n", aggregatore);
+            goto fine;
+        }
+        r.aggregazione = &emettitore;
+        r.nodo = (unsigned int)nodo;
+        r.adesso = istante_aggregazione();
+    }
+    if (r.associazione && costruisci_indice_rete(&r.rete) != 0) {
+        fprintf(stderr, "Errore: indice della rete fallito\n");
+        goto fine;
+    }
+
+    r.t_inizio = (coda.n > 0) ? coda.voci[0].t : 0.0;
+    printf("Replay di %d stazioni, %lld campioni, dall'istante %.3f s\n",
+           r.n_stazioni, totale_campioni, r.t_inizio);
+    if (r.associazione) {
+        printf("Associazione: %d su %d, vP=%.1f km/s, tolleranza %.1f s\n",
+               k, n_vicini, VELOCITA_P, TOLLERANZA);
+    }
+    printf("\n");
+
+    /* Le righe per evento passano dal registro: una pipe lenta a valle non
+     * frena la riproduzione, al più perde righe (contate) */
+    if (avvia_registro(stdout, 0) != 0) {
+        fprintf(stderr, "Errore: avvio del registro fallito\n");
+        goto fine;
+    }
+    istante_corrente(&r.partenza);
+    long long campioni = esegui(&r, &coda);
+    struct timespec termine;
+    istante_corrente(&termine);
+    ferma_registro();
+    ferma_salute(&salute);
+    chiudi_emettitore(&emettitore);
+    double durata = differenza_istanti(&termine, &r.partenza);
+
+    printf("\nTrigger: %d, conferme: %d, allarmi: %d\n", r.n_trigger, r.n_conferme, r.n_allarmi);
+    if (r.n_trigger > 0) {
+        printf("Primo trigger a %.3f s", r.t_primo_trigger);
+        if (r.n_conferme > 0) printf(", conferma dopo %.3f s", r.t_prima_conferma - r.t_primo_trigger);
+        if (r.n_allarmi > 0) printf(", allarme dopo %.3f s", r.t_primo_allarme - r.t_primo_trigger);
+        printf("\n");
+    }
+
+    if (monitora) {
+        stampa_salute(&r);
+    }
+
+    if (file_catalogo) {
+        scrivi_catalogo(&r, file_catalogo);
+    }
+
+    if (aggregatore) {
+        printf("Aggregazione (nodo %ld): %lld pacchetti, %lld voci, %lld errori di invio\n",
+               nodo, emettitore.pacchetti, emettitore.voci, emettitore.errori);
+    }
+
+    /* Tempi di esecuzione: l'unica parte che cambia tra due riproduzioni */
+    printf("Elaborati %lld campioni in %.3f s: %.0f campioni/s, %.1f ns/campione\n",
+            campioni, durata, campioni / durata, durata * 1e9 / (campioni > 0 ? campioni : 1));
+    if (accelerazione > 0.0) {
+        printf("Ritmo %.1fx il tempo reale\n", accelerazione);
+        stampa_latenza(&r.ritmo, "Ritardo sul ritmo");
+        if (r.ritardo_allarmi.n > 0) {
+            stampa_latenza(&r.ritardo_allarmi, "Ritardo allarmi");
+        }
+    }
+
+    esito = 0;
+
+fine:
+    ferma_registro();
+    ferma_salute(&salute);
+    chiudi_emettitore(&emettitore);
+    for (int i = 0; i < r.n_stazioni; i++) {
+        Stazione *s = &r.stazioni[i];
+        free_dosews(&s->sys);
+        free_ricampionatore(&s->stato_ric);
+        chiudi_archivio(&s->archivio);
+        free(s->campioni);
+    }
+    for (int i = 0; i < n_coeff; i++) {
+        free_coeff_ricampionatore(&coeff[i]);
+    }
+    free_rete(&r.rete);
+    free_salute(&salute);
+    free_coda_fusione(&coda);
+    free(memoria);
+    free(r.stazioni);
+    return esito;
+}
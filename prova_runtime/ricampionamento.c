@@ -0,0 +1,165 @@
+#include "ricampionamento.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define ATTENUAZIONE_DB   80.0
+#define BANDA_PASSANTE    0.8   /* frazione della Nyquist minore lasciata intatta */
+
+static long mcd(long a, long b) {
+    while (b != 0) {
+        long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/* Funzione di Bessel modificata di ordine zero (serie) per la finestra di Kaiser */
+static double bessel_i0(double x) {
+    double somma = 1.0, termine = 1.0;
+    for (int k = 1; k < 50; k++) {
+        termine *= (x / (2.0 * k)) * (x / (2.0 * k));
+        somma += termine;
+        if (termine < 1e-12 * somma) break;
+    }
+    return somma;
+}
+
+int calcola_coeff_ricampionatore(double fs_in, double fs_out, CoeffRicampionatore *coeff) {
+    memset(coeff, 0, sizeof(*coeff));
+
+    /* Rapporto razionale sulle frequenze espresse in mHz: entrambe almeno
+     * 1 mHz (con M = 0 ricampiona_campione non termina) e non oltre 1 GHz.
+     * Scritto così esclude anche i NaN. */
+    if (!(fs_in >= 0.0005 && fs_in <= 1e9 && fs_out >= 0.0005 && fs_out <= 1e9)) {
+        return -1;
+    }
+    long in_mhz  = lround(fs_in * 1000.0);
+    long out_mhz = lround(fs_out * 1000.0);
+    long g = mcd(in_mhz, out_mhz);
+    long L = out_mhz / g;
+    long M = in_mhz / g;
+    if (L < 1 || L > RICAMPIONAMENTO_MAX_L || M < 1 || M > RICAMPIONAMENTO_MAX_M) {
+        return -1;
+    }
+    coeff->L = (int)L;
+    coeff->M = (int)M;
+    coeff->fs_in = fs_in;
+    coeff->fs_out = fs_out;
+
+    if (coeff->L == coeff->M) {
+        coeff->L = coeff->M = 1;
+        coeff->taps_per_fase = 1;
+        coeff->coeff = malloc(sizeof(double));
+        if (!coeff->coeff) return -1;
+        coeff->coeff[0] = 1.0;
+        coeff->ritardo_gruppo = 0.0;
+        return 0;
+    }
+
+    /* Progetto alla frequenza sovracampionata L*fs_in, frequenze normalizzate a 1 */
+    double fs_su = coeff->L * fs_in;
+    double nyquist = 0.5 * fmin(fs_in, fs_out);
+    double f_taglio = 0.5 * (1.0 + BANDA_PASSANTE) * nyquist / fs_su;
+    double transizione = 2.0 * M_PI * (1.0 - BANDA_PASSANTE) * nyquist / fs_su;
+
+    int n = (int)ceil((ATTENUAZIONE_DB - 8.0) / (2.285 * transizione)) + 1;
+    int T = (n + coeff->L - 1) / coeff->L;
+    n = T * coeff->L;
+    double beta = 0.1102 * (ATTENUAZIONE_DB - 8.7);
+
+    double *h = malloc(n * sizeof(double));
+    coeff->coeff = malloc(n * sizeof(double));
+    if (!h || !coeff->coeff) {
+        free(h);
+        free(coeff->coeff);
+        coeff->coeff = NULL;
+        return -1;
+    }
+
+    double centro = 0.5 * (n - 1);
+    double i0_beta = bessel_i0(beta);
+    double somma = 0.0;
+    for (int k = 0; k < n; k++) {
+        double t = k - centro;
+        double sinc = (t == 0.0) ? 2.0 * f_taglio
+                                 : sin(2.0 * M_PI * f_taglio * t) / (M_PI * t);
+        double r = t / centro;
+        double w = bessel_i0(beta * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+        h[k] = sinc * w;
+        somma += h[k];
+    }
+
+    /* Guadagno L per compensare gli zeri inseriti dal sovracampionamento */
+    for (int k = 0; k < n; k++) {
+        h[k] *= coeff->L / somma;
+    }
+
+    /* Sottofiltro della fase p in ordine inverso: il prodotto scalare scorre
+     * lo storico dal campione più vecchio al più recente */
+    for (int p = 0; p < coeff->L; p++) {
+        for (int i = 0; i < T; i++) {
+            coeff->coeff[p * T + i] = h[p + (T - 1 - i) * coeff->L];
+        }
+    }
+    free(h);
+
+    coeff->taps_per_fase = T;
+    coeff->ritardo_gruppo = centro / fs_su;
+    return 0;
+}
+
+void free_coeff_ricampionatore(CoeffRicampionatore *coeff) {
+    free(coeff->coeff);
+    coeff->coeff = NULL;
+}
+
+int init_ricampionatore(StatoRicampionatore *stato, const CoeffRicampionatore *coeff) {
+    stato->storico = calloc(2 * coeff->taps_per_fase, sizeof(double));
+    if (!stato->storico) {
+        return -1;
+    }
+    stato->pos = 0;
+    stato->prossima = 0;
+    return 0;
+}
+
+void free_ricampionatore(StatoRicampionatore *stato) {
+    free(stato->storico);
+    stato->storico = NULL;
+}
+
+int max_uscite_ricampionatore(const CoeffRicampionatore *coeff) {
+    return (coeff->L + coeff->M - 1) / coeff->M;
+}
+
+int ricampiona_campione(double x0, const CoeffRicampionatore *coeff,
+                        StatoRicampionatore *stato, double *out) {
+    const int T = coeff->taps_per_fase;
+
+    /* Doppia scrittura: gli ultimi T campioni sono sempre contigui in
+     * storico[pos + 1 .. pos + T] */
+    stato->storico[stato->pos] = x0;
+    stato->storico[stato->pos + T] = x0;
+    const double *finestra = &stato->storico[stato->pos + 1];
+    stato->pos = (stato->pos + 1) % T;
+
+    int n_uscite = 0;
+    while (stato->prossima < coeff->L) {
+        const double *g = &coeff->coeff[stato->prossima * T];
+        double y = 0.0;
+        for (int i = 0; i < T; i++) {
+            y += finestra[i] * g[i];
+        }
+        out[n_uscite++] = y;
+        stato->prossima += coeff->M;
+    }
+    stato->prossima -= coeff->L;
+
+    return n_uscite;
+}
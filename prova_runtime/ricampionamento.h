@@ -0,0 +1,42 @@
+#ifndef RICAMPIONAMENTO_H
+#define RICAMPIONAMENTO_H
+
+/* Ricampionatore polifase razionale L/M: sovracampiona di L, filtra con un
+ * FIR passa-basso a fase lineare (sinc con finestra di Kaiser) e decima di M.
+ * I coefficienti dipendono solo dalla coppia di frequenze e possono essere
+ * condivisi da tutte le stazioni con la stessa frequenza di ingresso. */
+
+#define RICAMPIONAMENTO_MAX_L 64
+#define RICAMPIONAMENTO_MAX_M 1024   /* il FIR ha circa 50·M prese */
+
+typedef struct {
+    int L, M;                /* fattori di interpolazione e decimazione */
+    int taps_per_fase;       /* lunghezza di ciascun sottofiltro */
+    double *coeff;           /* L sottofiltri da taps_per_fase, ordinati per il prodotto scalare */
+    double fs_in, fs_out;    /* Hz */
+    double ritardo_gruppo;   /* ritardo introdotto [s] */
+} CoeffRicampionatore;
+
+typedef struct {
+    double *storico;         /* ultimi taps_per_fase ingressi, memorizzati due volte */
+    int pos;
+    int prossima;            /* posizione della prossima uscita sulla griglia sovracampionata */
+} StatoRicampionatore;
+
+/* Ritorna 0 in caso di successo, -1 se una frequenza è sotto 1 mHz (una
+ * volta arrotondata), se il rapporto ridotto L/M ha L oltre
+ * RICAMPIONAMENTO_MAX_L o M oltre RICAMPIONAMENTO_MAX_M, o per errore. */
+int calcola_coeff_ricampionatore(double fs_in, double fs_out, CoeffRicampionatore *coeff);
+void free_coeff_ricampionatore(CoeffRicampionatore *coeff);
+
+int init_ricampionatore(StatoRicampionatore *stato, const CoeffRicampionatore *coeff);
+void free_ricampionatore(StatoRicampionatore *stato);
+
+/* Numero massimo di uscite prodotte da un singolo ingresso. */
+int max_uscite_ricampionatore(const CoeffRicampionatore *coeff);
+
+/* Inserisce un campione, scrive in out le uscite prodotte e ne ritorna il numero. */
+int ricampiona_campione(double x0, const CoeffRicampionatore *coeff,
+                        StatoRicampionatore *stato, double *out);
+
+#endif
@@ -0,0 +1,398 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "salute.h"
+#include "arena.h"
+#include "costanti.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define LINEA_CACHE  64
+#define META_FFT     (SALUTE_N_FFT / 2)
+#define N_PSD        (META_FFT + 1)
+#define N_SEGMENTI   ((SALUTE_CAMPIONI_BLOCCO - SALUTE_N_FFT) / META_FFT + 1)
+
+_Static_assert((SALUTE_BLOCCHI_CODA & (SALUTE_BLOCCHI_CODA - 1)) == 0, "coda potenza di 2");
+_Static_assert((SALUTE_N_FFT & (SALUTE_N_FFT - 1)) == 0, "FFT radix 2");
+
+typedef struct {
+    long long primo, ultimo;   /* indici del primo e dell'ultimo campione */
+    int discontinuo;           /* blocchi scartati subito prima: nessuna lacuna tra i due */
+    double campioni[SALUTE_CAMPIONI_BLOCCO];
+} BloccoSalute;
+
+/* Come gli anelli del registro: scrittura e lettura su linee diverse, la
+ * parte del produttore e quella dell'analisi pure */
+struct StazioneSalute {
+    _Alignas(LINEA_CACHE) atomic_uint scrittura;
+    unsigned int lettura_nota;       /* copia locale del produttore */
+    int n;                           /* campioni nel blocco corrente */
+    int in_scarto;                   /* blocco corrente senza posto in coda */
+    int discontinuo;
+    long long scartati;
+
+    _Alignas(LINEA_CACHE) atomic_uint lettura;
+    atomic_int stato;
+    atomic_int veto;
+
+    _Alignas(LINEA_CACHE) long long ultimo_analizzato;   /* -1: nessuno */
+    long long blocchi;
+    long long conteggio[SALUTE_N_DIAGNOSI];
+    long long blocchi_psd;
+    double offset;
+    double rumore;
+    double psd[N_PSD];
+
+    _Alignas(LINEA_CACHE) BloccoSalute blocchi_coda[SALUTE_BLOCCHI_CODA];
+};
+
+static const char *const NOMI_DIAGNOSI[SALUTE_N_DIAGNOSI] = {
+    "saturazione", "piatto", "lacuna", "offset", "rumore"
+};
+
+void config_salute(ConfigSalute *c, double frequenza) {
+    c->frequenza = frequenza;
+    c->fondo_scala = 2.0;
+    c->sec_piatto = 1.0;
+    c->soglia_offset = 0.05;
+    c->soglia_rumore = 0.005;
+    c->f_min = 1.0;
+    c->f_max = 20.0;
+    c->veto = SALUTE_SATURAZIONE | SALUTE_PIATTO | SALUTE_LACUNA;
+}
+
+void free_salute(MonitorSalute *m) {
+    free(m->stazioni);
+    free(m->finestra);
+    memset(m, 0, sizeof(*m));
+}
+
+int init_salute(MonitorSalute *m, const ConfigSalute *config, int n_stazioni) {
+    memset(m, 0, sizeof(*m));
+    if (n_stazioni < 1 || config->frequenza <= 0.0 || config->fondo_scala <= 0.0
+        || config->f_min < 0.0 || config->f_max <= config->f_min) {
+        return -1;
+    }
+    m->stazioni = aligned_alloc(LINEA_CACHE, ARENA_ALLINEA(n_stazioni * sizeof(StazioneSalute)));
+    /* finestra, coseni, seni, segmento (re, im), PSD del blocco */
+    m->finestra = malloc((SALUTE_N_FFT + 2 * META_FFT + 2 * META_FFT + N_PSD) * sizeof(double));
+    if (!m->stazioni || !m->finestra) {
+        free_salute(m);
+        return -1;
+    }
+    memset(m->stazioni, 0, n_stazioni * sizeof(StazioneSalute));
+    m->coseni = m->finestra + SALUTE_N_FFT;
+    m->seni = m->coseni + META_FFT;
+    m->lavoro = m->seni + META_FFT;
+    m->config = *config;
+    m->n_stazioni = n_stazioni;
+
+    for (int i = 0; i < n_stazioni; i++) {
+        StazioneSalute *s = &m->stazioni[i];
+        atomic_init(&s->scrittura, 0);
+        atomic_init(&s->lettura, 0);
+        atomic_init(&s->stato, 0);
+        atomic_init(&s->veto, 0);
+        s->ultimo_analizzato = -1;
+        s->rumore = NAN;
+    }
+
+    /* Hann periodica: con sovrapposizione a metà le finestre sommano a 1 */
+    double somma2 = 0.0;
+    for (int i = 0; i < SALUTE_N_FFT; i++) {
+        double w = 0.5 - 0.5 * cos(2.0 * M_PI * i / SALUTE_N_FFT);
+        m->finestra[i] = w;
+        somma2 += w * w;
+    }
+    for (int k = 0; k < META_FFT; k++) {
+        m->coseni[k] = cos(2.0 * M_PI * k / SALUTE_N_FFT);
+        m->seni[k] = -sin(2.0 * M_PI * k / SALUTE_N_FFT);
+    }
+    m->scala_psd = 2.0 / (config->frequenza * somma2 * N_SEGMENTI);
+    return 0;
+}
+
+static int analizza_stazione(MonitorSalute *m, StazioneSalute *s);
+
+/* ---- Produttore ---- */
+
+void campione_salute(MonitorSalute *m, int stazione, long long indice, double acc_g) {
+    StazioneSalute *s = &m->stazioni[stazione];
+    unsigned int w = atomic_load_explicit(&s->scrittura, memory_order_relaxed);
+    BloccoSalute *b = &s->blocchi_coda[w & (SALUTE_BLOCCHI_CODA - 1)];
+
+    /* Posto in coda controllato una volta per blocco; la lettura condivisa
+     * si ricarica solo se la copia locale dice pieno */
+    if (s->n == 0) {
+        s->in_scarto = 0;
+        if (w - s->lettura_nota >= SALUTE_BLOCCHI_CODA) {
+            s->lettura_nota = atomic_load_explicit(&s->lettura, memory_order_acquire);
+            s->in_scarto = (w - s->lettura_nota >= SALUTE_BLOCCHI_CODA);
+        }
+        if (!s->in_scarto) {
+            b->primo = indice;
+            b->discontinuo = s->discontinuo;
+        }
+    }
+    if (!s->in_scarto) {
+        b->campioni[s->n] = acc_g;
+    }
+    if (++s->n < SALUTE_CAMPIONI_BLOCCO) {
+        return;
+    }
+
+    s->n = 0;
+    if (s->in_scarto) {
+        s->scartati++;
+        s->discontinuo = 1;
+        return;
+    }
+    b->ultimo = indice;
+    s->discontinuo = 0;
+    atomic_store_explicit(&s->scrittura, w + 1, memory_order_release);
+    /* Senza thread l'analisi è qui: il veto segue il blocco appena chiuso */
+    if (!m->attivo) {
+        analizza_stazione(m, s);
+    }
+}
+
+/* ---- Analisi ---- */
+
+/* FFT complessa radix 2 in posto su META_FFT punti, twiddle presi a passo
+ * doppio dalla tabella di SALUTE_N_FFT */
+static void fft_complessa(const MonitorSalute *m, double *re, double *im) {
+    const int n = META_FFT;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int lunghezza = 2; lunghezza <= n; lunghezza <<= 1) {
+        int passo = SALUTE_N_FFT / lunghezza;
+        int meta = lunghezza >> 1;
+        for (int i = 0; i < n; i += lunghezza) {
+            for (int k = 0; k < meta; k++) {
+                double wr = m->coseni[k * passo], wi = m->seni[k * passo];
+                double *ar = &re[i + k], *ai = &im[i + k];
+                double *br = &re[i + k + meta], *bi = &im[i + k + meta];
+                double tr = *br * wr - *bi * wi;
+                double ti = *br * wi + *bi * wr;
+                *br = *ar - tr;
+                *bi = *ai - ti;
+                *ar += tr;
+                *ai += ti;
+            }
+        }
+    }
+}
+
+/* FFT reale di SALUTE_N_FFT punti come complessa di META_FFT (pari nella
+ * parte reale, dispari nell'immaginaria) più la separazione finale;
+ * accumula |X(k)|^2 in potenza, k = 0 ... META_FFT */
+static void accumula_segmento(const MonitorSalute *m, const double *x, double media, double *potenza) {
+    double *re = m->lavoro, *im = m->lavoro + META_FFT;
+    for (int i = 0; i < META_FFT; i++) {
+        re[i] = (x[2 * i] - media) * m->finestra[2 * i];
+        im[i] = (x[2 * i + 1] - media) * m->finestra[2 * i + 1];
+    }
+    fft_complessa(m, re, im);
+
+    potenza[0] += (re[0] + im[0]) * (re[0] + im[0]);
+    potenza[META_FFT] += (re[0] - im[0]) * (re[0] - im[0]);
+    for (int k = 1; k < META_FFT; k++) {
+        /* Z(k) e coniugato di Z(N/2 - k): trasformate delle parti pari e dispari */
+        double zr = re[k], zi = im[k];
+        double cr = re[META_FFT - k], ci = -im[META_FFT - k];
+        double pr = 0.5 * (zr + cr), pi = 0.5 * (zi + ci);
+        double dr = 0.5 * (zi - ci), di = -0.5 * (zr - cr);
+        double wr = m->coseni[k], wi = m->seni[k];
+        double xr = pr + dr * wr - di * wi;
+        double xi = pi + dr * wi + di * wr;
+        potenza[k] += xr * xr + xi * xi;
+    }
+}
+
+/* Welch sul blocco: Hann, metà sovrapposizione, media tolta. Campioni non
+ * finiti già sostituiti dalla media. PSD a una faccia [(m/s^2)^2/Hz]. */
+static void psd_blocco(const MonitorSalute *m, const double *x, double media, double *psd) {
+    memset(psd, 0, N_PSD * sizeof(double));
+    for (int s = 0; s < N_SEGMENTI; s++) {
+        accumula_segmento(m, x + s * META_FFT, media, psd);
+    }
+    double scala = m->scala_psd * G * G;
+    for (int k = 0; k < N_PSD; k++) {
+        /* DC e Nyquist non hanno la controparte negativa */
+        psd[k] *= (k == 0 || k == META_FFT) ? 0.5 * scala : scala;
+    }
+}
+
+static double rumore_in_banda(const MonitorSalute *m, const double *psd) {
+    double df = m->config.frequenza / SALUTE_N_FFT;
+    double somma = 0.0;
+    for (int k = 0; k < N_PSD; k++) {
+        double f = k * df;
+        if (f >= m->config.f_min && f <= m->config.f_max) {
+            somma += psd[k] * df;
+        }
+    }
+    return sqrt(somma) / G;
+}
+
+static void analizza_blocco(MonitorSalute *m, StazioneSalute *s, BloccoSalute *b) {
+    const ConfigSalute *c = &m->config;
+    double *x = b->campioni;
+    int stato = 0;
+
+    if (b->ultimo - b->primo != SALUTE_CAMPIONI_BLOCCO - 1
+        || (s->ultimo_analizzato >= 0 && !b->discontinuo && b->primo != s->ultimo_analizzato + 1)) {
+        stato |= SALUTE_LACUNA;
+    }
+    s->ultimo_analizzato = b->ultimo;
+
+    double somma = 0.0, saturazione = 0.999 * c->fondo_scala;
+    int finiti = 0, saturati = 0, piatti = 0, piatti_max = 0;
+    for (int i = 0; i < SALUTE_CAMPIONI_BLOCCO; i++) {
+        if (!isfinite(x[i])) {
+            stato |= SALUTE_LACUNA;
+            piatti = 0;
+            continue;
+        }
+        finiti++;
+        somma += x[i];
+        saturati += fabs(x[i]) >= saturazione;
+        piatti = (i > 0 && x[i] == x[i - 1]) ? piatti + 1 : 1;
+        piatti_max = (piatti > piatti_max) ? piatti : piatti_max;
+    }
+    double media = (finiti > 0) ? somma / finiti : 0.0;
+    for (int i = 0; i < SALUTE_CAMPIONI_BLOCCO && finiti < SALUTE_CAMPIONI_BLOCCO; i++) {
+        if (!isfinite(x[i])) {
+            x[i] = media;
+        }
+    }
+
+    if (saturati > 0) stato |= SALUTE_SATURAZIONE;
+    if (piatti_max >= c->sec_piatto * c->frequenza || finiti == 0) stato |= SALUTE_PIATTO;
+    if (fabs(media) > c->soglia_offset) stato |= SALUTE_OFFSET;
+
+    /* Solo i blocchi integri entrano nella PSD del rumore: media esatta sui
+     * primi SALUTE_BLOCCHI_MEDIA, poi esponenziale con lo stesso peso */
+    if (!(stato & (SALUTE_SATURAZIONE | SALUTE_PIATTO | SALUTE_LACUNA))) {
+        double *corrente = m->lavoro + 2 * META_FFT;
+        psd_blocco(m, x, media, corrente);
+        s->blocchi_psd++;
+        double peso = 1.0 / ((s->blocchi_psd < SALUTE_BLOCCHI_MEDIA) ? s->blocchi_psd : SALUTE_BLOCCHI_MEDIA);
+        for (int k = 0; k < N_PSD; k++) {
+            s->psd[k] += peso * (corrente[k] - s->psd[k]);
+        }
+        s->rumore = rumore_in_banda(m, s->psd);
+    }
+    if (s->blocchi_psd > 0 && s->rumore > c->soglia_rumore) {
+        stato |= SALUTE_RUMORE;
+    }
+
+    s->offset = media;
+    s->blocchi++;
+    for (int d = 0; d < SALUTE_N_DIAGNOSI; d++) {
+        s->conteggio[d] += (stato >> d) & 1;
+    }
+    atomic_store_explicit(&s->stato, stato, memory_order_relaxed);
+    atomic_store_explicit(&s->veto, (stato & c->veto) != 0, memory_order_release);
+}
+
+/* Blocchi pubblicati e non ancora analizzati di una stazione; ritorna quanti */
+static int analizza_stazione(MonitorSalute *m, StazioneSalute *s) {
+    int analizzati = 0;
+    unsigned int r = atomic_load_explicit(&s->lettura, memory_order_relaxed);
+    unsigned int w = atomic_load_explicit(&s->scrittura, memory_order_acquire);
+    for (; r != w; r++) {
+        analizza_blocco(m, s, &s->blocchi_coda[r & (SALUTE_BLOCCHI_CODA - 1)]);
+        atomic_store_explicit(&s->lettura, r + 1, memory_order_release);
+        analizzati++;
+    }
+    return analizzati;
+}
+
+/* Ritorna i blocchi analizzati */
+static int analizza_code(MonitorSalute *m) {
+    int analizzati = 0;
+    for (int i = 0; i < m->n_stazioni; i++) {
+        analizzati += analizza_stazione(m, &m->stazioni[i]);
+    }
+    return analizzati;
+}
+
+static void *ciclo_salute(void *arg) {
+    MonitorSalute *m = arg;
+    struct timespec periodo = { 0, SALUTE_PERIODO_NS };
+    while (!atomic_load_explicit(&m->termina, memory_order_acquire)) {
+        if (analizza_code(m) == 0) {
+            nanosleep(&periodo, NULL);
+        }
+    }
+    return NULL;
+}
+
+int avvia_salute(MonitorSalute *m) {
+    if (m->attivo) {
+        return -1;
+    }
+    atomic_store(&m->termina, 0);
+    if (pthread_create(&m->thread, NULL, ciclo_salute, m) != 0) {
+        return -1;
+    }
+    m->attivo = 1;
+    return 0;
+}
+
+void ferma_salute(MonitorSalute *m) {
+    if (m->attivo) {
+        atomic_store_explicit(&m->termina, 1, memory_order_release);
+        pthread_join(m->thread, NULL);
+        m->attivo = 0;
+    }
+    analizza_code(m);
+}
+
+const atomic_int *veto_salute(const MonitorSalute *m, int stazione) {
+    return &m->stazioni[stazione].veto;
+}
+
+int stato_salute(const MonitorSalute *m, int stazione) {
+    return atomic_load_explicit(&m->stazioni[stazione].stato, memory_order_relaxed);
+}
+
+void rapporto_salute(const MonitorSalute *m, int stazione, RapportoSalute *r) {
+    const StazioneSalute *s = &m->stazioni[stazione];
+    r->stato = stato_salute(m, stazione);
+    r->blocchi = s->blocchi;
+    r->scartati = s->scartati;
+    memcpy(r->conteggio, s->conteggio, sizeof(r->conteggio));
+    r->offset = s->offset;
+    r->rumore = s->rumore;
+}
+
+const double *psd_salute(const MonitorSalute *m, int stazione) {
+    const StazioneSalute *s = &m->stazioni[stazione];
+    return (s->blocchi_psd > 0) ? s->psd : NULL;
+}
+
+void descrivi_salute(int stato, char *testo, int dimensione) {
+    int n = snprintf(testo, dimensione, "%s", stato ? "" : "ok");
+    for (int d = 0; d < SALUTE_N_DIAGNOSI && n < dimensione; d++) {
+        if (stato & (1 << d)) {
+            n += snprintf(testo + n, dimensione - n, "%s%s", (n > 0) ? ", " : "", NOMI_DIAGNOSI[d]);
+        }
+    }
+}
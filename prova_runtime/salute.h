@@ -0,0 +1,111 @@
+#ifndef SALUTE_H
+#define SALUTE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Salute dei canali in background. Il thread di elaborazione copia i
+ * campioni in attesa del trigger, così come arrivano, in blocchi di
+ * SALUTE_CAMPIONI_BLOCCO di una coda per stazione (un produttore, un
+ * consumatore, nessun lock); a blocco pieno pubblica un indice e basta. Un
+ * thread separato analizza i blocchi: saturazione, canale piatto, lacune,
+ * offset e la PSD del rumore (Welch con FFT reale, media esponenziale tra
+ * i blocchi). Il risultato è una maschera di diagnosi per stazione e un
+ * veto atomico da collegare al trigger (imposta_veto_trigger_dosews).
+ * Senza il thread (avvia_salute non chiamata) ogni blocco è analizzato
+ * appena chiuso, dentro campione_salute: il veto vale dal campione dopo la
+ * fine del blocco e nessun blocco è scartato, quindi il risultato dipende
+ * solo dai dati. Il thread serve solo ai dati dal vivo, dove l'analisi non
+ * deve stare nel percorso critico. */
+
+#define SALUTE_CAMPIONI_BLOCCO  1024    /* 5.12 s a 200 Hz */
+#define SALUTE_BLOCCHI_CODA     4       /* per stazione, potenza di 2 */
+#define SALUTE_N_FFT            256     /* segmenti di Welch, sovrapposti a metà */
+#define SALUTE_BLOCCHI_MEDIA    16      /* memoria della media della PSD, blocchi */
+#define SALUTE_PERIODO_NS       10000000L
+
+/* Diagnosi, bit della maschera */
+#define SALUTE_SATURAZIONE  (1 << 0)
+#define SALUTE_PIATTO       (1 << 1)
+#define SALUTE_LACUNA       (1 << 2)
+#define SALUTE_OFFSET       (1 << 3)
+#define SALUTE_RUMORE       (1 << 4)
+#define SALUTE_N_DIAGNOSI   5
+
+typedef struct {
+    double frequenza;          /* Hz, dei campioni passati a campione_salute */
+    double fondo_scala;        /* g, saturazione a |x| >= 0.999 fondo_scala */
+    double sec_piatto;         /* s di campioni identici per il canale piatto */
+    double soglia_offset;      /* g, |media del blocco| */
+    double soglia_rumore;      /* g rms in [f_min, f_max] dalla PSD media */
+    double f_min, f_max;       /* Hz */
+    int veto;                  /* diagnosi che sospendono il trigger */
+} ConfigSalute;
+
+typedef struct StazioneSalute StazioneSalute;
+
+typedef struct {
+    ConfigSalute config;
+    int n_stazioni;
+    StazioneSalute *stazioni;
+
+    /* Solo del thread di analisi */
+    double *finestra;          /* Hann, SALUTE_N_FFT */
+    double *coseni, *seni;     /* e^{-2 pi i k / SALUTE_N_FFT}, k < SALUTE_N_FFT / 2 */
+    double *lavoro;            /* segmento, parti reale e immaginaria, PSD del blocco */
+    double scala_psd;          /* 2 / (fs * somma w^2 * n_segmenti) */
+
+    pthread_t thread;
+    atomic_int termina;
+    int attivo;
+} MonitorSalute;
+
+/* Per una stazione, dopo ferma_salute (o come istantanea non coerente) */
+typedef struct {
+    int stato;                 /* maschera dell'ultimo blocco */
+    long long blocchi;         /* analizzati */
+    long long scartati;        /* persi a coda piena */
+    long long conteggio[SALUTE_N_DIAGNOSI];   /* blocchi con ciascuna diagnosi */
+    double offset;             /* g, media dell'ultimo blocco */
+    double rumore;             /* g rms in [f_min, f_max], NAN senza PSD */
+} RapportoSalute;
+
+/* Soglie di default per un accelerometro da +-2 g campionato a frequenza;
+ * veto su saturazione, canale piatto e lacune. */
+void config_salute(ConfigSalute *c, double frequenza);
+
+/* Code e buffer di analisi, nessun thread. Ritorna 0 o -1. */
+int init_salute(MonitorSalute *m, const ConfigSalute *config, int n_stazioni);
+
+void free_salute(MonitorSalute *m);
+
+/* Avvia il thread di analisi (classe normale, prima di avvia_tempo_reale):
+ * solo per i dati dal vivo. Ritorna 0 o -1. */
+int avvia_salute(MonitorSalute *m);
+
+/* Ferma il thread, se avviato, e analizza i blocchi ancora in coda. */
+void ferma_salute(MonitorSalute *m);
+
+/* Percorso critico: una copia del campione (g) e, a blocco pieno, una
+ * pubblicazione atomica (senza thread, anche l'analisi del blocco). indice
+ * è il numero progressivo del campione: un salto è una lacuna, come un
+ * campione non finito. Da chiamare solo in attesa del trigger. Coda piena,
+ * solo con il thread: il blocco è scartato e contato. */
+void campione_salute(MonitorSalute *m, int stazione, long long indice, double acc_g);
+
+/* Non nullo se le diagnosi correnti della stazione sospendono il trigger:
+ * da passare a imposta_veto_trigger_dosews. */
+const atomic_int *veto_salute(const MonitorSalute *m, int stazione);
+
+int stato_salute(const MonitorSalute *m, int stazione);
+
+void rapporto_salute(const MonitorSalute *m, int stazione, RapportoSalute *r);
+
+/* PSD media del rumore [(m/s^2)^2/Hz], SALUTE_N_FFT / 2 + 1 valori a passo
+ * frequenza / SALUTE_N_FFT; NULL se nessun blocco è stato ancora valido. */
+const double *psd_salute(const MonitorSalute *m, int stazione);
+
+/* Nomi delle diagnosi in stato separati da virgola, "ok" se nessuna. */
+void descrivi_salute(int stato, char *testo, int dimensione);
+
+#endif
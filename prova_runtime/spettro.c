@@ -0,0 +1,145 @@
+#include "spettro.h"
+#include "oscillatori.h"
+#include "arena.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum { C1, C2, B0, B1, B2, N_RIGHE_COEFF };
+
+/* Righe di capacita valori nell'unico blocco: periodo, omega2, coeff, u1, u2, sd */
+#define N_RIGHE (2 + N_RIGHE_COEFF + 3)
+
+void free_spettro(SpettroRisposta *s) {
+    free(s->periodo);
+    memset(s, 0, sizeof(*s));
+}
+
+/* Dallo stato (q, q') della ricorsione esatta alla funzione di trasferimento
+ * del solo q: denominatore z^2 - tr(A) z + det(A), numeratore dalla prima
+ * riga di adj(zI - A) (B0 + z B1) */
+static void coefficienti_biquad(double w, double z, double dt, double *c) {
+    double k[OSCILLATORI_N_COEFF];
+    coefficienti_nigam_jennings(w, z, dt, k);
+    double e = exp(-z * w * dt);
+    double wd = w * sqrt(1.0 - z * z);
+
+    c[C1] = 2.0 * e * cos(wd * dt);       /* tr(A) */
+    c[C2] = -e * e;                       /* -det(A) */
+    c[B0] = k[NJ_B12];
+    c[B1] = k[NJ_B11] - k[NJ_A22] * k[NJ_B12] + k[NJ_A12] * k[NJ_B22];
+    c[B2] = k[NJ_A12] * k[NJ_B21] - k[NJ_A22] * k[NJ_B11];
+}
+
+int init_spettro(SpettroRisposta *s, int n_periodi, double t_min, double t_max,
+                 double smorzamento, double frequenza) {
+    memset(s, 0, sizeof(*s));
+    if (n_periodi < 1 || n_periodi > SPETTRO_MAX_PERIODI || frequenza <= 0.0
+        || t_min <= 2.0 / frequenza || t_max < t_min || smorzamento < 0.0 || smorzamento >= 1.0) {
+        return -1;
+    }
+
+    int capacita = (n_periodi + 7) & ~7;
+    size_t dim = ARENA_ALLINEA((size_t)N_RIGHE * capacita * sizeof(double));
+    double *m = aligned_alloc(ARENA_ALLINEAMENTO, dim);
+    if (!m) {
+        return -1;
+    }
+    memset(m, 0, dim);
+    s->periodo = m;
+    s->omega2 = m + capacita;
+    s->coeff = m + 2 * capacita;
+    s->u1 = s->coeff + N_RIGHE_COEFF * capacita;
+    s->u2 = s->u1 + capacita;
+    s->sd = s->u2 + capacita;
+    s->capacita = capacita;
+    s->n_periodi = n_periodi;
+    s->smorzamento = smorzamento;
+
+    /* Periodi crescenti, quindi livelli crescenti e colonne contigue */
+    double passo = (n_periodi > 1) ? log(t_max / t_min) / (n_periodi - 1) : 0.0;
+    int livello = 0;
+    for (int i = 0; i < n_periodi; i++) {
+        double t = t_min * exp(passo * i);
+        while (livello + 1 < SPETTRO_MAX_LIVELLI
+               && frequenza >= SPETTRO_FREQUENZA_MIN * (double)(2 << livello)
+               && t * frequenza >= SPETTRO_CAMPIONI_PERIODO * (double)(2 << livello)) {
+            s->inizio[++livello] = i;
+        }
+        double w = 2.0 * M_PI / t;
+        double c[N_RIGHE_COEFF];
+        coefficienti_biquad(w, smorzamento, (1 << livello) / frequenza, c);
+        for (int r = 0; r < N_RIGHE_COEFF; r++) {
+            s->coeff[r * capacita + i] = c[r];
+        }
+        s->periodo[i] = t;
+        s->omega2[i] = w * w;
+    }
+    s->n_livelli = livello + 1;
+    s->inizio[s->n_livelli] = n_periodi;
+    return 0;
+}
+
+void azzera_spettro(SpettroRisposta *s) {
+    memset(s->u1, 0, 3 * (size_t)s->capacita * sizeof(double));
+    memset(s->acc1, 0, sizeof(s->acc1));
+    memset(s->acc2, 0, sizeof(s->acc2));
+    memset(s->storico, 0, sizeof(s->storico));
+    s->contatore = 0;
+}
+
+/* u scritto sopra u(k-2): le due righe si scambiano a ogni campione */
+static void avanza_periodi(int n, size_t riga, double a0, double a1, double a2,
+                           const double *restrict k, const double *restrict u1,
+                           double *restrict u2, double *restrict sd) {
+    const double *c1 = k + C1 * riga, *c2 = k + C2 * riga;
+    const double *b0 = k + B0 * riga, *b1 = k + B1 * riga, *b2 = k + B2 * riga;
+    for (int i = 0; i < n; i++) {
+        double u = c1[i] * u1[i] + c2[i] * u2[i] + b0[i] * a0 + b1[i] * a1 + b2[i] * a2;
+        u2[i] = u;
+        double a = fabs(u);
+        sd[i] = (a > sd[i]) ? a : sd[i];
+    }
+}
+
+/* Campione n del livello j: u(n-1) nella riga u1 se n è dispari, u2 se è pari */
+static void avanza_livello(SpettroRisposta *s, int j, unsigned int n, double acc) {
+    int i = s->inizio[j];
+    double *pari = s->u2 + i, *dispari = s->u1 + i;
+    avanza_periodi(s->inizio[j + 1] - i, s->capacita, acc, s->acc1[j], s->acc2[j], s->coeff + i,
+                   (n & 1) ? dispari : pari, (n & 1) ? pari : dispari, s->sd + i);
+    s->acc2[j] = s->acc1[j];
+    s->acc1[j] = acc;
+}
+
+void avanza_spettro(SpettroRisposta *s, double acc) {
+    unsigned int k = s->contatore++;
+    for (int j = 0; ; j++) {
+        unsigned int n = k >> j;
+        avanza_livello(s, j, n, acc);
+        if (j + 1 == s->n_livelli) {
+            break;
+        }
+
+        /* Decimatore verso j+1 sui campioni n del livello j: half-band a
+         * massima piattezza (-1 0 9 16 9 0 -1) / 32, ritardo 3 campioni,
+         * calcolato solo sui campioni tenuti */
+        double *x = s->storico[j + 1];
+        x[n & 7] = acc;
+        if (n & 1) {
+            break;
+        }
+        acc = (16.0 * x[(n - 3) & 7] + 9.0 * (x[(n - 2) & 7] + x[(n - 4) & 7])
+               - (x[n & 7] + x[(n - 6) & 7])) * (1.0 / 32.0);
+    }
+}
+
+void psa_spettro(const SpettroRisposta *s, double *psa) {
+    for (int i = 0; i < s->n_periodi; i++) {
+        psa[i] = s->omega2[i] * s->sd[i];
+    }
+}
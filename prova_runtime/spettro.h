@@ -0,0 +1,68 @@
+#ifndef SPETTRO_H
+#define SPETTRO_H
+
+/* Spettro di risposta elastico aggiornato a ogni campione: per ogni periodo
+ * un oscillatore semplice smorzato, con la ricorsione esatta di Nigam e
+ * Jennings (oscillatori.h) riscritta sul solo spostamento relativo
+ *     u(k) = c1 u(k-1) + c2 u(k-2) + b0 a(k) + b1 a(k-1) + b2 a(k-2)
+ * cioè un biquad per periodo. L'ingresso è lo stesso per tutti i periodi,
+ * quindi il ciclo sui periodi è per colonne e senza salti (VETTORIALE nel
+ * makefile). PSA = w^2 * max|u|, pseudo-accelerazione spettrale.
+ *
+ * Banco multirate: il livello j lavora a frequenza / 2^j e prende i periodi
+ * che lì hanno ancora almeno SPETTRO_CAMPIONI_PERIODO campioni per periodo,
+ * senza scendere sotto SPETTRO_FREQUENZA_MIN: i periodi lunghi rispondono
+ * anche al contenuto ben sopra la propria frequenza (lo spostamento del
+ * suolo), che deve restare nella banda del livello. Ogni livello riceve dal
+ * precedente un campione su due dopo un passa-basso half-band a 7 prese
+ * (-70 dB sull'alias, 0.03% in banda). A 200 Hz 100 periodi in [0.05, 5] s
+ * costano come 48 a piena frequenza, circa la metà (bench_spettro). Il
+ * prezzo è il picco campionato più rado: max|u| sottostima il picco vero al
+ * più di 1 - cos(pi / SPETTRO_CAMPIONI_PERIODO), il 2%, meno di quanto già
+ * accade ai periodi più corti a piena frequenza. */
+
+#define SPETTRO_T_MIN        0.05    /* s */
+#define SPETTRO_T_MAX        5.0     /* s */
+#define SPETTRO_SMORZAMENTO  0.05
+#define SPETTRO_MAX_PERIODI  1024
+#define SPETTRO_MAX_LIVELLI  8
+#define SPETTRO_CAMPIONI_PERIODO 16     /* minimo per passare a un livello decimato */
+#define SPETTRO_FREQUENZA_MIN    50.0   /* Hz, minima di un livello decimato */
+
+typedef struct {
+    int n_periodi;
+    int capacita;              /* colonne allocate, multiplo di 8 */
+    double smorzamento;
+    int n_livelli;
+    int inizio[SPETTRO_MAX_LIVELLI + 1];   /* colonne del livello j: [inizio[j], inizio[j+1]) */
+    unsigned int contatore;                /* campioni in ingresso */
+    double acc1[SPETTRO_MAX_LIVELLI];      /* ingresso di ogni livello ai due campioni precedenti, m/s^2 */
+    double acc2[SPETTRO_MAX_LIVELLI];
+    double storico[SPETTRO_MAX_LIVELLI][8];   /* ultimi ingressi del livello j-1, decimatore verso j */
+
+    double *periodo;           /* s */
+    double *omega2;            /* (2 pi / T)^2 */
+    double *coeff;             /* 5 righe da capacita: c1 c2 b0 b1 b2 */
+    double *u1, *u2;           /* spostamento ai due campioni precedenti del livello, m;
+                                  righe alternate, u1 con l'ultimo dei campioni dispari */
+    double *sd;                /* max |u| dall'azzeramento, m */
+} SpettroRisposta;
+
+/* n_periodi spaziati in modo logaritmico in [t_min, t_max], ciascuno al
+ * livello più decimato che gli lascia SPETTRO_CAMPIONI_PERIODO campioni;
+ * serve t_min > 2/frequenza. Ritorna 0 in caso di successo, -1 se errore. */
+int init_spettro(SpettroRisposta *s, int n_periodi, double t_min, double t_max,
+                 double smorzamento, double frequenza);
+
+void free_spettro(SpettroRisposta *s);
+
+/* Oscillatori in quiete, picchi azzerati. */
+void azzera_spettro(SpettroRisposta *s);
+
+/* Un campione di accelerazione del suolo [m/s^2] per tutti i periodi. */
+void avanza_spettro(SpettroRisposta *s, double acc);
+
+/* PSA corrente [m/s^2] per ogni periodo in psa (n_periodi valori). */
+void psa_spettro(const SpettroRisposta *s, double *psa);
+
+#endif
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+
+#include "tempo_reale.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define PAGINA 4096
+
+static void precarica_stack(void) {
+    volatile unsigned char stack[TEMPO_REALE_STACK];
+    for (size_t i = 0; i < sizeof(stack); i += PAGINA) {
+        stack[i] = 0;
+    }
+}
+
+int avvia_tempo_reale(int cpu, int priorita, char *errore, size_t dim_errore) {
+    long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu < 0 || cpu >= n_cpu || cpu >= CPU_SETSIZE) {
+        snprintf(errore, dim_errore, "CPU %d non disponibile (%ld online)", cpu, n_cpu);
+        return -1;
+    }
+
+    /* Prima i controlli che non cambiano nulla: SCHED_FIFO richiede
+     * CAP_SYS_NICE o un limite RLIMIT_RTPRIO sufficiente */
+    if (priorita < sched_get_priority_min(SCHED_FIFO) || priorita > sched_get_priority_max(SCHED_FIFO)) {
+        snprintf(errore, dim_errore, "priorità SCHED_FIFO %d fuori intervallo", priorita);
+        return -1;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        snprintf(errore, dim_errore, "mlockall: %s (serve CAP_IPC_LOCK o RLIMIT_MEMLOCK)",
+                 strerror(errno));
+        return -1;
+    }
+    precarica_stack();
+
+    cpu_set_t insieme;
+    CPU_ZERO(&insieme);
+    CPU_SET(cpu, &insieme);
+    if (sched_setaffinity(0, sizeof(insieme), &insieme) != 0) {
+        snprintf(errore, dim_errore, "sched_setaffinity(CPU %d): %s", cpu, strerror(errno));
+        munlockall();
+        return -1;
+    }
+
+    struct sched_param parametri = { .sched_priority = priorita };
+    if (sched_setscheduler(0, SCHED_FIFO, &parametri) != 0) {
+        snprintf(errore, dim_errore, "SCHED_FIFO: %s (serve CAP_SYS_NICE o RLIMIT_RTPRIO)",
+                 strerror(errno));
+        munlockall();
+        return -1;
+    }
+    return 0;
+}
+
+void precarica_memoria(void *memoria, size_t n) {
+    volatile unsigned char *p = memoria;
+    for (size_t i = 0; i < n; i += PAGINA) {
+        p[i] = p[i];
+    }
+    if (n > 0) {
+        p[n - 1] = p[n - 1];
+    }
+}
+
+void istante_corrente(struct timespec *t) {
+    clock_gettime(CLOCK_MONOTONIC, t);
+}
+
+void attendi_istante(const struct timespec *t) {
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, t, NULL) == EINTR) {
+    }
+}
+
+void avanza_istante(struct timespec *t, double secondi) {
+    long long ns = t->tv_nsec + (long long)(secondi * 1e9 + 0.5);
+    t->tv_sec += ns / 1000000000LL;
+    t->tv_nsec = ns % 1000000000LL;
+}
+
+double differenza_istanti(const struct timespec *a, const struct timespec *b) {
+    return (double)(a->tv_sec - b->tv_sec) + (a->tv_nsec - b->tv_nsec) * 1e-9;
+}
+
+void azzera_latenza(IstogrammaLatenza *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void registra_latenza(IstogrammaLatenza *h, double secondi) {
+    if (secondi < 0.0) {
+        secondi = 0.0;
+    }
+    double us = secondi * 1e6;
+    int k;
+    if (us < LATENZA_CLASSI_US) {
+        k = (int)us;
+    } else if (us < 1000.0 * (LATENZA_CLASSI_MS + 1)) {
+        k = LATENZA_CLASSI_US + (int)(us * 1e-3) - 1;
+    } else {
+        k = LATENZA_CLASSI;
+    }
+    h->conteggio[k]++;
+    h->n++;
+    h->somma += secondi;
+    if (secondi > h->massimo) {
+        h->massimo = secondi;
+    }
+}
+
+double percentile_latenza(const IstogrammaLatenza *h, double q) {
+    long long obiettivo = (long long)(q * h->n);
+    long long cumulato = 0;
+    for (int k = 0; k < LATENZA_CLASSI; k++) {
+        cumulato += h->conteggio[k];
+        if (cumulato > obiettivo) {
+            return (k < LATENZA_CLASSI_US) ? (k + 1) * 1e-6 : (k - LATENZA_CLASSI_US + 2) * 1e-3;
+        }
+    }
+    return h->massimo;
+}
+
+void stampa_latenza(const IstogrammaLatenza *h, const char *nome) {
+    if (h->n == 0) {
+        printf("%-22s: nessun campione\n", nome);
+        return;
+    }
+    printf("%-22s: media %7.1f us, p50 %6.0f us, p99 %6.0f us, p99.9 %6.0f us, max %8.1f us",
+           nome, h->somma / h->n * 1e6, percentile_latenza(h, 0.5) * 1e6,
+           percentile_latenza(h, 0.99) * 1e6, percentile_latenza(h, 0.999) * 1e6,
+           h->massimo * 1e6);
+    long long oltre = h->n;
+    for (int k = 0; k < LATENZA_CLASSI_US; k++) {
+        oltre -= h->conteggio[k];
+    }
+    if (oltre > 0) {
+        printf(", %lld oltre 1 ms", oltre);
+    }
+    printf("\n");
+}
@@ -0,0 +1,56 @@
+#ifndef TEMPO_REALE_H
+#define TEMPO_REALE_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* Modalità tempo reale per il thread di elaborazione (Linux): memoria
+ * bloccata e pre-caricata, thread fissato su una CPU (isolata con isolcpus)
+ * con SCHED_FIFO, e istogrammi del ritardo di risveglio e del tempo di
+ * elaborazione rispetto alla cadenza attesa dt. */
+
+#define TEMPO_REALE_PRIORITA   80
+#define TEMPO_REALE_STACK      (512 * 1024)  /* byte di stack pre-caricati */
+#define LATENZA_CLASSI_US     1000          /* classi da 1 us fino a 1 ms ... */
+#define LATENZA_CLASSI_MS     1000          /* ... poi da 1 ms fino a 1 s; oltre: ultima classe */
+#define LATENZA_CLASSI        (LATENZA_CLASSI_US + LATENZA_CLASSI_MS)
+
+typedef struct {
+    long long conteggio[LATENZA_CLASSI + 1];
+    long long n;
+    double somma;              /* s */
+    double massimo;            /* s */
+} IstogrammaLatenza;
+
+/* mlockall, pre-caricamento dello stack, affinità su cpu e SCHED_FIFO a
+ * priorità priorita per il thread chiamante. I thread creati prima (es. lo
+ * scrittore dei checkpoint) restano nella classe normale.
+ * Ritorna 0, oppure -1 con la causa in errore (privilegi mancanti, CPU
+ * inesistente): la modalità non viene mai attivata a metà in silenzio. */
+int avvia_tempo_reale(int cpu, int priorita, char *errore, size_t dim_errore);
+
+/* Tocca una pagina ogni 4 KiB di [memoria, memoria + n): dopo mlockall le
+ * pagine restano residenti e il primo accesso non causa page fault. */
+void precarica_memoria(void *memoria, size_t n);
+
+/* Istanti su CLOCK_MONOTONIC */
+void istante_corrente(struct timespec *t);
+
+/* Dorme fino all'istante assoluto t (anche se interrotta da segnali) */
+void attendi_istante(const struct timespec *t);
+
+/* Istante spostato di secondi */
+void avanza_istante(struct timespec *t, double secondi);
+
+/* Differenza a - b [s] */
+double differenza_istanti(const struct timespec *a, const struct timespec *b);
+
+void azzera_latenza(IstogrammaLatenza *h);
+void registra_latenza(IstogrammaLatenza *h, double secondi);
+
+/* Latenza [s] sotto la quale cade la frazione q dei campioni (limite superiore della classe) */
+double percentile_latenza(const IstogrammaLatenza *h, double q);
+
+void stampa_latenza(const IstogrammaLatenza *h, const char *nome);
+
+#endif
@@ -1,80 +1,312 @@
 #include "trigger.h"
+#include "filter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-int init_trigger(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec) {
+#define BANDE_Q               2.0
+#define CLASSE_RAPPORTO       0.1   /* larghezza delle classi dell'istogramma */
+#define PERCENTILE_RUMORE     0.99
+#define FATTORE_ADATTIVO      1.5   /* soglia = fattore * percentile del rumore */
+#define MEMORIA_RUMORE_SEC    60.0
+
+static const double CENTRI_BANDE[TRIGGER_N_BANDE] = { 1.5, 3.0, 6.0, 12.0 };  /* Hz */
+
+static const char *const NOMI_TRIGGER[] = { "sta_lta", "bande", "allen", "adattivo" };
+
+static void azzera_rumore(StatoTrigger *stato) {
+    memset(stato->istogramma, 0, sizeof(stato->istogramma));
+    stato->campioni_periodo = 0;
+    stato->soglia_adattiva = 0.0;
+}
+
+/* Lunghezze delle finestre e capacità dell'anello; 0 se non valide */
+static unsigned int capacita_anello(double frequenza, double sta_sec, double lta_sec) {
+    int sta_len = (int)(sta_sec * frequenza);
+    int lta_len = (int)(lta_sec * frequenza);
+
+    if (sta_len < 1 || lta_len < sta_len) {
+        return 0;
+    }
+
+    unsigned int capacita = 1;
+    while (capacita < (unsigned int)lta_len) {
+        capacita <<= 1;
+    }
+    return capacita;
+}
+
+/* TRIGGER_BANDE usa solo le medie ricorsive per banda */
+static int usa_anello(TipoTrigger tipo) {
+    return tipo != TRIGGER_BANDE;
+}
+
+/* Inizializzazione comune, con stato->buf già assegnato (NULL senza anello) */
+static void imposta_trigger(StatoTrigger *stato, double frequenza, double sta_sec,
+                            double lta_sec, unsigned int capacita, TipoTrigger tipo) {
     stato->sta_len = (int)(sta_sec * frequenza);
     stato->lta_len = (int)(lta_sec * frequenza);
+    stato->maschera = capacita - 1;
 
-    stato->buf_sta = calloc(stato->sta_len, sizeof(double));
-    stato->buf_lta = calloc(stato->lta_len, sizeof(double));
+    stato->c_sta = 1.0 / stato->sta_len;
+    stato->c_lta = 1.0 / stato->lta_len;
+    configura_trigger(stato, tipo, frequenza);
+}
 
-    if (!stato->buf_sta || !stato->buf_lta) {
-        free(stato->buf_sta);
-        free(stato->buf_lta);
+int init_trigger(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec,
+                 TipoTrigger tipo) {
+    unsigned int capacita = capacita_anello(frequenza, sta_sec, lta_sec);
+    if (capacita == 0) {
         return -1;
     }
+    stato->buf = NULL;
+    if (usa_anello(tipo)) {
+        stato->buf = calloc(capacita, sizeof(double));
+        if (!stato->buf) {
+            return -1;
+        }
+    }
+    stato->proprietario = (stato->buf != NULL);
+    stato->in_arena = 0;
+    imposta_trigger(stato, frequenza, sta_sec, lta_sec, capacita, tipo);
+    return 0;
+}
 
+int finestre_trigger_valide(double frequenza, double sta_sec, double lta_sec) {
+    return capacita_anello(frequenza, sta_sec, lta_sec) != 0;
+}
+
+size_t memoria_trigger(double frequenza, double sta_sec, double lta_sec, TipoTrigger tipo) {
+    unsigned int capacita = capacita_anello(frequenza, sta_sec, lta_sec);
+    return (capacita == 0 || !usa_anello(tipo)) ? 0 : ARENA_ALLINEA(capacita * sizeof(double));
+}
+
+int init_trigger_arena(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec,
+                       TipoTrigger tipo, Arena *arena) {
+    unsigned int capacita = capacita_anello(frequenza, sta_sec, lta_sec);
+    if (capacita == 0) {
+        return -1;
+    }
+    stato->buf = NULL;
+    if (usa_anello(tipo)) {
+        stato->buf = alloca_arena(arena, capacita * sizeof(double));
+        if (!stato->buf) {
+            return -1;
+        }
+    }
+    stato->proprietario = 0;
+    stato->in_arena = 1;
+    imposta_trigger(stato, frequenza, sta_sec, lta_sec, capacita, tipo);
+    return 0;
+}
+
+int configura_trigger(StatoTrigger *stato, TipoTrigger tipo, double frequenza) {
+    /* L'anello segue il motore: liberato se non serve, allocato se manca */
+    if (!usa_anello(tipo) && stato->proprietario) {
+        free(stato->buf);
+        stato->buf = NULL;
+        stato->proprietario = 0;
+    } else if (usa_anello(tipo) && !stato->buf) {
+        if (stato->in_arena) {
+            return -1;
+        }
+        stato->buf = calloc(stato->maschera + 1, sizeof(double));
+        if (!stato->buf) {
+            return -1;
+        }
+        stato->proprietario = 1;
+    }
+    stato->tipo = tipo;
+
+    for (int b = 0; b < TRIGGER_N_BANDE; b++) {
+        CoeffFiltro c;
+        double centro = fmin(CENTRI_BANDE[b], 0.4 * frequenza);
+        calcola_coeff_bandpass(frequenza, centro, BANDE_Q, &c);
+        stato->banda_a0[b] = c.a0;
+        stato->banda_a2[b] = c.a2;
+        stato->banda_b1[b] = c.b1;
+        stato->banda_b2[b] = c.b2;
+    }
+
+    stato->periodo = (int)frequenza;
+    stato->oblio = exp(-1.0 / MEMORIA_RUMORE_SEC);
+
+    azzera_rumore(stato);
     reset_trigger(stato);
     return 0;
 }
 
+int tipo_trigger_da_nome(const char *nome) {
+    for (int t = 0; t < (int)(sizeof(NOMI_TRIGGER) / sizeof(NOMI_TRIGGER[0])); t++) {
+        if (strcmp(nome, NOMI_TRIGGER[t]) == 0) {
+            return t;
+        }
+    }
+    return -1;
+}
+
 void free_trigger(StatoTrigger *stato) {
-    free(stato->buf_sta);
-    free(stato->buf_lta);
-    stato->buf_sta = NULL;
-    stato->buf_lta = NULL;
+    if (stato->proprietario) {
+        free(stato->buf);
+    }
+    stato->buf = NULL;
+    stato->proprietario = 0;
 }
 
 void reset_trigger(StatoTrigger *stato) {
-    if (stato->buf_sta) memset(stato->buf_sta, 0, stato->sta_len * sizeof(double));
-    if (stato->buf_lta) memset(stato->buf_lta, 0, stato->lta_len * sizeof(double));
-    stato->sta_idx = 0;
-    stato->lta_idx = 0;
+    if (stato->buf) memset(stato->buf, 0, (stato->maschera + 1) * sizeof(double));
+    stato->pos = 0;
     stato->sta_somma = 0.0;
     stato->lta_somma = 0.0;
     stato->campioni_caricati = 0;
     stato->triggered = 0;
-}
 
-int aggiorna_trigger(StatoTrigger *stato, double campione_filtrato, double soglia) {
-    if (stato->triggered) {
-        return 0;
+    for (int b = 0; b < TRIGGER_N_BANDE; b++) {
+        stato->banda_x1[b] = stato->banda_x2[b] = 0.0;
+        stato->banda_y1[b] = stato->banda_y2[b] = 0.0;
+        stato->banda_sta[b] = stato->banda_lta[b] = 0.0;
     }
+    stato->allen_precedente = 0.0;
+    stato->allen_abs = 0.0;
+    stato->allen_dabs = 0.0;
+}
 
-    double campione_sq = campione_filtrato * campione_filtrato;
-
-    /* Aggiorna finestra STA: rimuove il campione che esce, inserisce il nuovo */
-    stato->sta_somma -= stato->buf_sta[stato->sta_idx];
-    stato->sta_somma += campione_sq;
-    stato->buf_sta[stato->sta_idx] = campione_sq;
-    stato->sta_idx = (stato->sta_idx + 1) % stato->sta_len;
+/* Finestre rettangolari STA/LTA sull'energia. Ritorna il rapporto, oppure
+ * -1 se la finestra LTA non è ancora piena o la LTA è nulla. */
+static double aggiorna_finestre(StatoTrigger *stato, double energia) {
+    unsigned int p = stato->pos++;
 
-    /* Aggiorna finestra LTA */
-    stato->lta_somma -= stato->buf_lta[stato->lta_idx];
-    stato->lta_somma += campione_sq;
-    stato->buf_lta[stato->lta_idx] = campione_sq;
-    stato->lta_idx = (stato->lta_idx + 1) % stato->lta_len;
+    /* Aggiorna finestre STA e LTA: rimuove il campione che esce, inserisce il nuovo */
+    stato->sta_somma -= stato->buf[(p - stato->sta_len) & stato->maschera];
+    stato->sta_somma += energia;
+    stato->lta_somma -= stato->buf[(p - stato->lta_len) & stato->maschera];
+    stato->lta_somma += energia;
+    stato->buf[p & stato->maschera] = energia;
 
     stato->campioni_caricati++;
 
     /* Aspetta che la finestra LTA sia piena prima di valutare */
     if (stato->campioni_caricati < stato->lta_len) {
-        return 0;
+        return -1.0;
     }
 
     double sta_media = stato->sta_somma / stato->sta_len;
     double lta_media = stato->lta_somma / stato->lta_len;
 
-    if (lta_media > 1e-15) {
-        double rapporto = sta_media / lta_media;
-        if (rapporto >= soglia) {
-            stato->triggered = 1;
-            return 1;
+    if (lta_media > TRIGGER_LTA_MINIMA) {
+        return sta_media / lta_media;
+    }
+    return -1.0;
+}
+
+/* Il rumore culturale è in genere a banda stretta, l'onda P no: si richiede
+ * il superamento della soglia in almeno TRIGGER_BANDE_MINIME bande */
+static int aggiorna_bande(StatoTrigger *stato, double x0, double soglia) {
+    const double c_sta = stato->c_sta, c_lta = stato->c_lta;
+
+    for (int b = 0; b < TRIGGER_N_BANDE; b++) {
+        double y0 = stato->banda_a0[b] * x0
+                  + stato->banda_a2[b] * stato->banda_x2[b]
+                  - stato->banda_b1[b] * stato->banda_y1[b]
+                  - stato->banda_b2[b] * stato->banda_y2[b];
+        stato->banda_x2[b] = stato->banda_x1[b];
+        stato->banda_x1[b] = x0;
+        stato->banda_y2[b] = stato->banda_y1[b];
+        stato->banda_y1[b] = y0;
+
+        double energia = y0 * y0;
+        stato->banda_sta[b] += c_sta * (energia - stato->banda_sta[b]);
+        stato->banda_lta[b] += c_lta * (energia - stato->banda_lta[b]);
+    }
+
+    stato->campioni_caricati++;
+    if (stato->campioni_caricati < stato->lta_len) {
+        return 0;
+    }
+
+    int sopra = 0;
+    for (int b = 0; b < TRIGGER_N_BANDE; b++) {
+        sopra += (stato->banda_lta[b] > TRIGGER_LTA_MINIMA)
+               & (stato->banda_sta[b] >= soglia * stato->banda_lta[b]);
+    }
+    return sopra >= TRIGGER_BANDE_MINIME;
+}
+
+/* Allen (1978): E = y^2 + C2 * dy^2, con C2 = sum|y| / sum|dy| (qui medie
+ * ricorsive sulla scala della LTA) */
+static double funzione_allen(StatoTrigger *stato, double y) {
+    double dy = y - stato->allen_precedente;
+    stato->allen_precedente = y;
+    stato->allen_abs += stato->c_lta * (fabs(y) - stato->allen_abs);
+    stato->allen_dabs += stato->c_lta * (fabs(dy) - stato->allen_dabs);
+
+    double c2 = (stato->allen_dabs > 0.0) ? stato->allen_abs / stato->allen_dabs : 0.0;
+    return y * y + c2 * dy * dy;
+}
+
+/* Ogni secondo: oblio dell'istogramma e nuova soglia dal percentile */
+static void aggiorna_soglia_adattiva(StatoTrigger *stato) {
+    double totale = 0.0;
+    for (int k = 0; k < TRIGGER_N_CLASSI; k++) {
+        stato->istogramma[k] *= stato->oblio;
+        totale += stato->istogramma[k];
+    }
+
+    double cumulata = 0.0;
+    int k = 0;
+    while (k < TRIGGER_N_CLASSI - 1) {
+        cumulata += stato->istogramma[k];
+        if (cumulata >= PERCENTILE_RUMORE * totale) {
+            break;
         }
+        k++;
+    }
+    stato->soglia_adattiva = FATTORE_ADATTIVO * (k + 1) * CLASSE_RAPPORTO;
+}
+
+int aggiorna_trigger(StatoTrigger *stato, double campione_filtrato, double soglia) {
+    if (stato->triggered) {
+        return 0;
     }
 
+    double rapporto;
+    switch (stato->tipo) {
+    case TRIGGER_BANDE:
+        if (!aggiorna_bande(stato, campione_filtrato, soglia)) {
+            return 0;
+        }
+        stato->triggered = 1;
+        return 1;
+
+    case TRIGGER_ALLEN:
+        rapporto = aggiorna_finestre(stato, funzione_allen(stato, campione_filtrato));
+        break;
+
+    case TRIGGER_ADATTIVO:
+        rapporto = aggiorna_finestre(stato, campione_filtrato * campione_filtrato);
+        if (rapporto < 0.0) {
+            return 0;
+        }
+        int k = (int)(rapporto / CLASSE_RAPPORTO);
+        stato->istogramma[(k < TRIGGER_N_CLASSI) ? k : TRIGGER_N_CLASSI - 1] += 1.0;
+        if (++stato->campioni_periodo >= stato->periodo) {
+            stato->campioni_periodo = 0;
+            aggiorna_soglia_adattiva(stato);
+        }
+        if (stato->soglia_adattiva > soglia) {
+            soglia = stato->soglia_adattiva;
+        }
+        break;
+
+    default:
+        rapporto = aggiorna_finestre(stato, campione_filtrato * campione_filtrato);
+        break;
+    }
+
+    if (rapporto >= soglia) {
+        stato->triggered = 1;
+        return 1;
+    }
     return 0;
 }
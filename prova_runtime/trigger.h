@@ -1,25 +1,91 @@
 #ifndef TRIGGER_H
 #define TRIGGER_H
 
+#include <stddef.h>
+#include "arena.h"
+
+/* Motori di trigger selezionabili con configura_trigger. Tutti valutano solo
+ * a finestra LTA piena e restano nello stesso StatoTrigger. */
+typedef enum {
+    TRIGGER_STA_LTA = 0,   /* energia del segnale filtrato, finestre rettangolari */
+    TRIGGER_BANDE,         /* banco di passa-banda, STA/LTA ricorsivo per banda */
+    TRIGGER_ALLEN,         /* STA/LTA sulla funzione caratteristica di Allen */
+    TRIGGER_ADATTIVO       /* STA/LTA con soglia dal percentile mobile del rumore */
+} TipoTrigger;
+
+#define TRIGGER_N_BANDE         4
+#define TRIGGER_BANDE_MINIME    3     /* bande oltre soglia richieste insieme */
+#define TRIGGER_N_CLASSI        64    /* istogramma dei rapporti STA/LTA */
+#define TRIGGER_LTA_MINIMA      1e-15 /* sotto questa LTA media non si valuta */
+
 typedef struct {
-    double *buf_sta;      
-    double *buf_lta;     
+    /* Un solo anello di energie: la finestra STA è la coda della LTA.
+     * Capacità potenza di 2 >= lta_len, indice con maschera invece di % */
+    double *buf;               /* NULL con TRIGGER_BANDE */
+    unsigned int maschera;     /* capacità - 1 */
+    unsigned int pos;          /* campioni scritti, modulo 2^32 */
     int sta_len;
     int lta_len; 
-    int sta_idx; 
-    int lta_idx;     
     double sta_somma;  
     double lta_somma;
     int campioni_caricati; 
     int triggered;   
+    int proprietario;          /* 1: buf allocato da init_trigger, liberato da free_trigger */
+    int in_arena;              /* 1: da init_trigger_arena, mai allocazioni */
+
+    TipoTrigger tipo;
+    double c_sta, c_lta;        /* 1/sta_len, 1/lta_len per le medie ricorsive */
+
+    /* TRIGGER_BANDE: un elemento per banda, così il ciclo sulle bande si
+     * vettorizza (a1 = 0 per il passa-banda) */
+    double banda_a0[TRIGGER_N_BANDE], banda_a2[TRIGGER_N_BANDE];
+    double banda_b1[TRIGGER_N_BANDE], banda_b2[TRIGGER_N_BANDE];
+    double banda_x1[TRIGGER_N_BANDE], banda_x2[TRIGGER_N_BANDE];
+    double banda_y1[TRIGGER_N_BANDE], banda_y2[TRIGGER_N_BANDE];
+    double banda_sta[TRIGGER_N_BANDE], banda_lta[TRIGGER_N_BANDE];
+
+    /* TRIGGER_ALLEN */
+    double allen_precedente;
+    double allen_abs, allen_dabs;  /* medie ricorsive di |y| e |dy| */
+
+    /* TRIGGER_ADATTIVO */
+    double istogramma[TRIGGER_N_CLASSI];  /* rapporti in quiete, con oblio */
+    int periodo, campioni_periodo;        /* aggiornamento della soglia ogni secondo */
+    double oblio;
+    double soglia_adattiva;
 } StatoTrigger;
 
-int init_trigger(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec);
+/* Trigger con il motore tipo. L'anello delle energie è allocato solo per i
+ * motori che lo usano (non TRIGGER_BANDE): senza anello buf resta NULL. */
+int init_trigger(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec,
+                 TipoTrigger tipo);
+
+/* Non zero se le finestre sono valide: STA di almeno un campione, LTA non più corta. */
+int finestre_trigger_valide(double frequenza, double sta_sec, double lta_sec);
+
+/* Byte di arena richiesti da init_trigger_arena per il motore tipo; 0 se il
+ * motore non usa l'anello o se le finestre non sono valide. */
+size_t memoria_trigger(double frequenza, double sta_sec, double lta_sec, TipoTrigger tipo);
+
+/* Come init_trigger, con l'anello preso da arena (free_trigger non lo libera). */
+int init_trigger_arena(StatoTrigger *stato, double frequenza, double sta_sec, double lta_sec,
+                       TipoTrigger tipo, Arena *arena);
 
 void free_trigger(StatoTrigger *stato);
 
+/* Azzera finestre e filtri; la statistica del rumore di TRIGGER_ADATTIVO
+ * resta (la azzerano init_trigger e configura_trigger). */
 void reset_trigger(StatoTrigger *stato);
 
+/* Cambia motore e azzera lo stato. L'anello proprio è liberato se il nuovo
+ * motore non lo usa, allocato se lo usa e manca. Ritorna 0, -1 se la
+ * memoria non basta o se l'anello manca a uno stato di init_trigger_arena
+ * (l'arena è dimensionata con memoria_trigger per il motore iniziale). */
+int configura_trigger(StatoTrigger *stato, TipoTrigger tipo, double frequenza);
+
+/* "sta_lta", "bande", "allen", "adattivo"; -1 se sconosciuto. */
+int tipo_trigger_da_nome(const char *nome);
+
 int aggiorna_trigger(StatoTrigger *stato, double campione_filtrato, double soglia);
 
 #endif
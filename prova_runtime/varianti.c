@@ -0,0 +1,200 @@
+#include "varianti.h"
+#include "catena.h"
+#include "costanti.h"
+#include <math.h>
+#include <string.h>
+
+/* Banda attorno alla soglia di PGD in cui si ricalcola la probabilità
+ * esatta: fuori dalla banda la decisione segue dalla monotonia */
+#define MARGINE_PGD 1e-9
+
+typedef struct {
+    const char *nome;
+    FunzioneProcessa funzione;
+
+    /* Configurazione a cui si applica */
+    double frequenza, fc_hp, sta_sec, lta_sec, soglia_sta_lta;
+    const ConfigurazioneAllarme *classe;
+    const char *soglia_target;
+
+    /* Costanti specializzate */
+    double a0, a1, a2, b1, b2;   /* high-pass, come da calcola_coeff_highpass */
+    double dt;
+    int sta_len, lta_len;
+    unsigned int maschera;       /* anello del trigger */
+    double pgd_soglia;           /* PGD [m] oltre cui la probabilità supera la soglia */
+} Variante;
+
+/* Acquisizione della flotta: 200 Hz, HP 0.075 Hz, STA 0.5 s, LTA 6 s, soglia 4 */
+#define FLOTTA_200HZ \
+    200.0, 0.075, 0.5, 6.0, 4.0, \
+    0.99833530603987819, -1.9966706120797564, 0.99833530603987819, \
+    -1.9966678408718557, 0.9966733832876572, 0.005, 100, 1200, 2047u
+
+/* nome, acquisizione, classe di fragilità, stato di danno, PGD di soglia.
+ * I valori costanti vengono verificati in seleziona_variante: se non
+ * corrispondono più al codice generico si ricade su processa_campione. */
+#define ELENCO_VARIANTI(X) \
+    X(rc_basso_eds,      FLOTTA_200HZ, RC_BASSO,      eds, p_eds, "EDS", 0.069038353010608289) \
+    X(rc_medio_eds,      FLOTTA_200HZ, RC_MEDIO,      eds, p_eds, "EDS", 0.12265653499868175) \
+    X(urm_reg_basso_eds, FLOTTA_200HZ, URM_REG_BASSO, eds, p_eds, "EDS", 0.020879905130295411)
+
+/* ---- Corpo comune, specializzato per costanti dal compilatore ---- */
+
+static inline double filtra(double x0, StatoFiltro *s, const Variante *k) {
+    double y0 = k->a0 * x0 + k->a1 * s->x1 + k->a2 * s->x2 - k->b1 * s->y1 - k->b2 * s->y2;
+    s->x2 = s->x1;
+    s->x1 = x0;
+    s->y2 = s->y1;
+    s->y1 = y0;
+    return y0;
+}
+
+/* Come aggiorna_trigger con TRIGGER_STA_LTA */
+static inline int finestre(StatoTrigger *t, double campione, const Variante *k) {
+    if (t->triggered) {
+        return 0;
+    }
+
+    double energia = campione * campione;
+    unsigned int p = t->pos++;
+    t->sta_somma -= t->buf[(p - k->sta_len) & k->maschera];
+    t->sta_somma += energia;
+    t->lta_somma -= t->buf[(p - k->lta_len) & k->maschera];
+    t->lta_somma += energia;
+    t->buf[p & k->maschera] = energia;
+
+    t->campioni_caricati++;
+    if (t->campioni_caricati < k->lta_len) {
+        return 0;
+    }
+
+    double sta_media = t->sta_somma / k->sta_len;
+    double lta_media = t->lta_somma / k->lta_len;
+    if (lta_media > TRIGGER_LTA_MINIMA && sta_media / lta_media >= k->soglia_sta_lta) {
+        t->triggered = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Soglia di PGD della variante, con la classe di fragilità del target */
+typedef struct {
+    const Variante *k;
+    double fisica, prob;
+} SogliaVariante;
+
+static inline int supera_soglia(const StatoDOSEWS *sys, double pgd, const void *contesto) {
+    const SogliaVariante *v = contesto;
+    (void)sys;
+    if (pgd < v->k->pgd_soglia * (1.0 - MARGINE_PGD)) {
+        return 0;
+    }
+    if (pgd > v->k->pgd_soglia * (1.0 + MARGINE_PGD)) {
+        return 1;
+    }
+    return calcola_probabilita_previsiva(pgd, v->fisica) >= v->prob;
+}
+
+static inline double filtra_catena(double x, StatoFiltro *s, const void *contesto) {
+    return filtra(x, s, ((const SogliaVariante *)contesto)->k);
+}
+
+static inline StatoSistema processa_fisso(StatoDOSEWS *sys, double acc_g, const Variante *k,
+                                          double fisica, double prob) {
+    double acc_filt = filtra(acc_g * G, &sys->filtro_acc, k);
+
+    sys->indice_campione++;
+
+    if (sys->fase == STATO_ATTESA_TRIGGER) {
+        if (finestre(&sys->trigger, acc_filt, k)) {
+            segnala_trigger(sys);
+        }
+        return sys->fase;
+    }
+
+    const SogliaVariante soglia = { k, fisica, prob };
+    return avanza_catena_comune(sys, acc_filt, k->dt, filtra_catena, supera_soglia, &soglia);
+}
+
+/* ---- Generazione delle varianti ---- */
+
+#define VARIANTE_COSTANTI(NOME, FS, FC, STA, LTA, SOGLIA, A0, A1, A2, B1, B2, DT,       \
+                          STA_LEN, LTA_LEN, MASCHERA, CLASSE, FISICA, PROB, TARGET, PGD) \
+    static StatoSistema processa_##NOME(StatoDOSEWS *sys, double acc_g);                \
+    static const Variante variante_##NOME = {                                             \
+        #NOME, processa_##NOME, FS, FC, STA, LTA, SOGLIA, &CLASSE, TARGET,                \
+        A0, A1, A2, B1, B2, DT, STA_LEN, LTA_LEN, MASCHERA, PGD                           \
+    };                                                                                    \
+    static StatoSistema processa_##NOME(StatoDOSEWS *sys, double acc_g) {                 \
+        return processa_fisso(sys, acc_g, &variante_##NOME, CLASSE.FISICA, CLASSE.PROB);  \
+    }
+#define DEFINISCI_VARIANTE(...) VARIANTE_COSTANTI(__VA_ARGS__)
+
+ELENCO_VARIANTI(DEFINISCI_VARIANTE)
+
+#define VOCE_VARIANTE(NOME, ...) &variante_##NOME,
+
+static const Variante *const VARIANTI[] = {
+    ELENCO_VARIANTI(VOCE_VARIANTE)
+};
+
+/* ---- Selezione ---- */
+
+static int costanti_valide(const Variante *v, const StatoDOSEWS *sys,
+                           double fisica, double prob) {
+    const CoeffFiltro *c = &sys->coeff_hp;
+    if (c->a0 != v->a0 || c->a1 != v->a1 || c->a2 != v->a2 || c->b1 != v->b1 || c->b2 != v->b2
+        || sys->config.dt != v->dt
+        || sys->trigger.sta_len != v->sta_len || sys->trigger.lta_len != v->lta_len
+        || sys->trigger.maschera != v->maschera) {
+        return 0;
+    }
+
+    /* La soglia di PGD deve separare le due decisioni attorno alla banda */
+    return calcola_probabilita_previsiva(v->pgd_soglia * (1.0 - MARGINE_PGD), fisica) < prob
+        && calcola_probabilita_previsiva(v->pgd_soglia * (1.0 + MARGINE_PGD), fisica) >= prob;
+}
+
+FunzioneProcessa seleziona_variante(const StatoDOSEWS *sys, const char **nome) {
+    const ConfigSistema *cfg = &sys->config;
+
+    if (nome) {
+        *nome = "generica";
+    }
+    if (cfg->tipo_trigger != TRIGGER_STA_LTA) {
+        return processa_campione;
+    }
+
+    const ConfigurazioneAllarme *classe = get_configurazione(cfg->tipologia, cfg->n_piani);
+    for (size_t i = 0; i < sizeof(VARIANTI) / sizeof(VARIANTI[0]); i++) {
+        const Variante *v = VARIANTI[i];
+        if (v->frequenza != cfg->frequenza || v->fc_hp != cfg->fc_hp
+            || v->sta_sec != cfg->sta_sec || v->lta_sec != cfg->lta_sec
+            || v->soglia_sta_lta != cfg->soglia_sta_lta
+            || v->classe != classe || strcmp(v->soglia_target, cfg->soglia_target) != 0) {
+            continue;
+        }
+
+        double fisica, prob;
+        if (strcmp(cfg->soglia_target, "MDS") == 0) {
+            fisica = classe->mds;
+            prob = classe->p_mds;
+        } else if (strcmp(cfg->soglia_target, "EDS") == 0) {
+            fisica = classe->eds;
+            prob = classe->p_eds;
+        } else {
+            fisica = classe->cds;
+            prob = classe->p_cds;
+        }
+        if (!costanti_valide(v, sys, fisica, prob)) {
+            break;
+        }
+
+        if (nome) {
+            *nome = v->nome;
+        }
+        return v->funzione;
+    }
+    return processa_campione;
+}
@@ -0,0 +1,20 @@
+#ifndef VARIANTI_H
+#define VARIANTI_H
+
+#include "dosews.h"
+
+/* Varianti di processa_campione specializzate per le configurazioni della
+ * flotta: coefficienti del filtro, lunghezze delle finestre (anello con
+ * maschera costante) e soglia di allarme sono costanti di compilazione.
+ * Lavorano sullo stesso StatoDOSEWS del percorso generico, quindi checkpoint
+ * e stampa_risultati non cambiano, e danno gli stessi risultati. */
+
+typedef StatoSistema (*FunzioneProcessa)(StatoDOSEWS *sys, double acc_g);
+
+/* Variante adatta a sys (già inizializzato), oppure processa_campione se
+ * nessuna corrisponde. Il puntatore non va salvato nello stato: dopo un
+ * ripristino da checkpoint va richiesto di nuovo. Se nome non è NULL riceve
+ * il nome della variante ("generica" per processa_campione). */
+FunzioneProcessa seleziona_variante(const StatoDOSEWS *sys, const char **nome);
+
+#endif
@@ -0,0 +1,451 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <limits.h>
+#include <string.h>
+#include "dosews.h"
+#include "varianti.h"
+#include "archivio.h"
+
+/* Estensione Python sul motore di libdosews. I vettori arrivano con il
+ * protocollo buffer (array NumPy, array.array, memoryview): float64
+ * contigui, letti e scritti senza copie. Il GIL viene rilasciato durante
+ * l'elaborazione, quindi più thread Python elaborano stazioni diverse in
+ * parallelo. Nessuna callback verso Python dal percorso di elaborazione:
+ * gli esiti si leggono dallo stato dopo ogni blocco. */
+
+/* ---- Vettori ---- */
+
+static int formato_double(const char *formato) {
+    if (!formato) {
+        return 1;   /* senza PyBUF_FORMAT: byte grezzi, controllati da itemsize */
+    }
+    if (*formato == '@' || *formato == '=' || *formato == '<') {
+        formato++;
+    }
+    return strcmp(formato, "d") == 0;
+}
+
+/* Vettore monodimensionale contiguo di float64; da rilasciare con
+ * PyBuffer_Release. Ritorna 0, oppure -1 con l'eccezione impostata: quella
+ * dell'esportatore se il vettore non è contiguo (ValueError per NumPy),
+ * TypeError se non è float64 o non è monodimensionale. */
+static int ottieni_vettore(PyObject *oggetto, Py_buffer *vettore, int scrivibile, const char *nome) {
+    int flag = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (scrivibile ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(oggetto, vettore, flag) != 0) {
+        return -1;
+    }
+    if (vettore->ndim > 1 || vettore->itemsize != sizeof(double) || !formato_double(vettore->format)) {
+        PyErr_Format(PyExc_TypeError, "%s: serve un vettore contiguo di float64", nome);
+        PyBuffer_Release(vettore);
+        return -1;
+    }
+    return 0;
+}
+
+static Py_ssize_t lunghezza(const Py_buffer *vettore) {
+    return vettore->len / (Py_ssize_t)sizeof(double);
+}
+
+/* ---- Filtri e trigger su interi vettori ---- */
+
+static PyObject *filtra(PyObject *args, int passa_alto) {
+    PyObject *o_in, *o_out;
+    double fs, fc;
+    if (!PyArg_ParseTuple(args, "OOdd", &o_in, &o_out, &fs, &fc)) {
+        return NULL;
+    }
+    if (!(fs > 0.0) || !(fc > 0.0) || fc >= fs / 2.0) {
+        PyErr_SetString(PyExc_ValueError, "serve 0 < fc < fs/2");
+        return NULL;
+    }
+    Py_buffer in, out;
+    if (ottieni_vettore(o_in, &in, 0, "ingresso") != 0) {
+        return NULL;
+    }
+    if (ottieni_vettore(o_out, &out, 1, "uscita") != 0) {
+        PyBuffer_Release(&in);
+        return NULL;
+    }
+    Py_ssize_t n = lunghezza(&in);
+    if (lunghezza(&out) != n || n > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "ingresso e uscita devono avere la stessa lunghezza (< 2^31)");
+        PyBuffer_Release(&in);
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    CoeffFiltro coeff;
+    Py_BEGIN_ALLOW_THREADS
+    if (passa_alto) {
+        calcola_coeff_highpass(fs, fc, &coeff);
+        filtro_highpass(in.buf, out.buf, (int)n, &coeff);
+    } else {
+        calcola_coeff_lowpass(fs, fc, &coeff);
+        filtro_lowpass(in.buf, out.buf, (int)n, &coeff);
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&in);
+    PyBuffer_Release(&out);
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_filtro_highpass(PyObject *self, PyObject *args) {
+    (void)self;
+    return filtra(args, 1);
+}
+
+static PyObject *py_filtro_lowpass(PyObject *self, PyObject *args) {
+    (void)self;
+    return filtra(args, 0);
+}
+
+/* Primo campione (da 0) in cui scatta il trigger sul vettore già filtrato,
+ * -1 se non scatta: il motore di trigger del runtime sull'intero vettore. */
+static PyObject *py_rileva_trigger(PyObject *self, PyObject *args, PyObject *kw) {
+    (void)self;
+    static char *chiavi[] = { "acc_filtrata", "frequenza", "sta_sec", "lta_sec", "soglia", "tipo", NULL };
+    PyObject *o_in;
+    double fs, sta, lta, soglia;
+    const char *nome_tipo = "sta_lta";
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "Odddd|s", chiavi, &o_in, &fs, &sta, &lta, &soglia,
+                                     &nome_tipo)) {
+        return NULL;
+    }
+    int tipo = tipo_trigger_da_nome(nome_tipo);
+    if (tipo < 0) {
+        PyErr_Format(PyExc_ValueError, "tipo di trigger sconosciuto: %s", nome_tipo);
+        return NULL;
+    }
+    StatoTrigger trigger;
+    if (!finestre_trigger_valide(fs, sta, lta)) {
+        PyErr_SetString(PyExc_ValueError, "finestre di trigger non valide");
+        return NULL;
+    }
+    if (init_trigger(&trigger, fs, sta, lta, (TipoTrigger)tipo) != 0) {
+        return PyErr_NoMemory();
+    }
+
+    Py_buffer in;
+    if (ottieni_vettore(o_in, &in, 0, "acc_filtrata") != 0) {
+        free_trigger(&trigger);
+        return NULL;
+    }
+    const double *x = in.buf;
+    Py_ssize_t n = lunghezza(&in), indice = -1;
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (aggiorna_trigger(&trigger, x[i], soglia)) {
+            indice = i;
+            break;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&in);
+    free_trigger(&trigger);
+    return PyLong_FromSsize_t(indice);
+}
+
+/* ---- Archivi .dws ---- */
+
+static PyObject *py_info_archivio(PyObject *self, PyObject *args) {
+    (void)self;
+    const char *percorso;
+    if (!PyArg_ParseTuple(args, "s", &percorso)) {
+        return NULL;
+    }
+    Archivio a;
+    if (apri_archivio(&a, percorso) != 0) {
+        PyErr_Format(PyExc_OSError, "%s non è un archivio .dws valido", percorso);
+        return NULL;
+    }
+    const IntestazioneArchivio *h = a.intestazione;
+    PyObject *info = Py_BuildValue("{s:K,s:d,s:d,s:d,s:I,s:I}",
+                                   "n_campioni", h->n_campioni, "frequenza", h->frequenza,
+                                   "t0", h->t0, "quanto", h->quanto,
+                                   "campioni_blocco", h->campioni_blocco, "n_blocchi", h->n_blocchi);
+    chiudi_archivio(&a);
+    return info;
+}
+
+/* Decodifica l'intero archivio in out (almeno n_campioni valori) */
+static PyObject *py_leggi_archivio(PyObject *self, PyObject *args) {
+    (void)self;
+    const char *percorso;
+    PyObject *o_out;
+    if (!PyArg_ParseTuple(args, "sO", &percorso, &o_out)) {
+        return NULL;
+    }
+    Archivio a;
+    if (apri_archivio(&a, percorso) != 0) {
+        PyErr_Format(PyExc_OSError, "%s non è un archivio .dws valido", percorso);
+        return NULL;
+    }
+    Py_buffer out;
+    if (ottieni_vettore(o_out, &out, 1, "uscita") != 0) {
+        chiudi_archivio(&a);
+        return NULL;
+    }
+    if ((unsigned long long)lunghezza(&out) < a.intestazione->n_campioni) {
+        PyErr_SetString(PyExc_ValueError, "uscita più corta dell'archivio");
+        PyBuffer_Release(&out);
+        chiudi_archivio(&a);
+        return NULL;
+    }
+
+    /* Blocchi decodificati direttamente nel vettore di destinazione */
+    double *x = out.buf;
+    unsigned long long scritti = 0;
+    Py_BEGIN_ALLOW_THREADS
+    for (unsigned int k = 0; k < a.intestazione->n_blocchi; k++) {
+        scritti += (unsigned long long)decodifica_blocco_archivio(&a, k, x + scritti);
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&out);
+    chiudi_archivio(&a);
+    return PyLong_FromUnsignedLongLong(scritti);
+}
+
+/* ---- Stazione: StatoDOSEWS in streaming ---- */
+
+typedef struct {
+    PyObject_HEAD
+    StatoDOSEWS sys;
+    FunzioneProcessa processa;
+    int inizializzata;
+    int occupata;              /* processa in corso su un altro thread */
+} OggettoStazione;
+
+static int stazione_init(OggettoStazione *self, PyObject *args, PyObject *kw) {
+    static char *chiavi[] = { "frequenza", "sta_sec", "lta_sec", "soglia_sta_lta", "fc_hp",
+                              "tipologia", "n_piani", "soglia_danno", "trigger",
+                              "richiede_conferma", "decisione_anticipata", NULL };
+    ConfigSistema config = {
+        .frequenza      = 200.0,
+        .sta_sec        = 0.5,
+        .lta_sec        = 6.0,
+        .soglia_sta_lta = 4.0,
+        .fc_hp          = 0.075,
+        .n_piani        = 3,
+    };
+    const char *tipologia = "RC", *soglia_danno = "EDS", *nome_trigger = "sta_lta";
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|dddddsisspp", chiavi,
+                                     &config.frequenza, &config.sta_sec, &config.lta_sec,
+                                     &config.soglia_sta_lta, &config.fc_hp, &tipologia,
+                                     &config.n_piani, &soglia_danno, &nome_trigger,
+                                     &config.richiede_conferma, &config.decisione_anticipata)) {
+        return -1;
+    }
+    int tipo = tipo_trigger_da_nome(nome_trigger);
+    if (tipo < 0) {
+        PyErr_Format(PyExc_ValueError, "tipo di trigger sconosciuto: %s", nome_trigger);
+        return -1;
+    }
+    if (self->occupata) {
+        PyErr_SetString(PyExc_RuntimeError, "stazione in elaborazione su un altro thread");
+        return -1;
+    }
+    config.dt = 1.0 / config.frequenza;
+    config.tipo_trigger = (TipoTrigger)tipo;
+    strncpy(config.tipologia, tipologia, sizeof(config.tipologia) - 1);
+    strncpy(config.soglia_target, soglia_danno, sizeof(config.soglia_target) - 1);
+
+    if (self->inizializzata) {
+        free_dosews(&self->sys);
+        self->inizializzata = 0;
+    }
+    if (init_dosews(&self->sys, &config) != 0) {
+        PyErr_SetString(PyExc_ValueError, "configurazione non valida");
+        return -1;
+    }
+    self->processa = seleziona_variante(&self->sys, NULL);
+    self->inizializzata = 1;
+    return 0;
+}
+
+static void stazione_dealloc(OggettoStazione *self) {
+    if (self->inizializzata) {
+        free_dosews(&self->sys);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int stazione_pronta(OggettoStazione *self) {
+    if (!self->inizializzata) {
+        PyErr_SetString(PyExc_RuntimeError, "stazione non inizializzata");
+        return 0;
+    }
+    if (self->occupata) {
+        PyErr_SetString(PyExc_RuntimeError, "stazione in elaborazione su un altro thread");
+        return 0;
+    }
+    return 1;
+}
+
+/* Blocco di accelerazioni in g; ritorna la fase dopo l'ultimo campione */
+static PyObject *stazione_processa(OggettoStazione *self, PyObject *o_blocco) {
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    Py_buffer blocco;
+    if (ottieni_vettore(o_blocco, &blocco, 0, "blocco") != 0) {
+        return NULL;
+    }
+    const double *x = blocco.buf;
+    Py_ssize_t n = lunghezza(&blocco);
+    StatoDOSEWS *sys = &self->sys;
+    FunzioneProcessa processa = self->processa;
+    StatoSistema fase = sys->fase;
+
+    self->occupata = 1;
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; i++) {
+        fase = processa(sys, x[i]);
+    }
+    Py_END_ALLOW_THREADS
+    self->occupata = 0;
+
+    PyBuffer_Release(&blocco);
+    return PyLong_FromLong(fase);
+}
+
+static PyObject *stazione_conferma(OggettoStazione *self, PyObject *unused) {
+    (void)unused;
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    conferma_evento(&self->sys);
+    Py_RETURN_NONE;
+}
+
+static PyObject *stazione_risultati(OggettoStazione *self, PyObject *unused) {
+    (void)unused;
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    RisultatiDOSEWS r;
+    calcola_risultati(&self->sys, &r);
+    return Py_BuildValue("{s:O,s:O,s:O,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d}",
+                         "triggered", r.triggered ? Py_True : Py_False,
+                         "allarme", r.allarme ? Py_True : Py_False,
+                         "allarme_anticipato", r.allarme_anticipato ? Py_True : Py_False,
+                         "t_trigger", r.t_trigger, "t_allarme", r.t_allarme,
+                         "pgd_allarme", r.pgd_allarme, "pgd_max", r.pgd_max,
+                         "drift_mediano", r.drift_mediano, "soglia_fisica", r.soglia_fisica,
+                         "prob_calcolata", r.prob_calcolata, "soglia_prob", r.soglia_prob,
+                         "lead_time", r.lead_time,
+                         "tau_c", r.tau_c, "pd", r.pd, "tau_p_max", r.tau_p_max,
+                         "pga", r.pga, "pgv", r.pgv, "cav", r.cav, "arias", r.arias,
+                         "durata_bracketed", r.durata_bracketed);
+}
+
+/* I campi si leggono solo a stazione ferma: durante processa lo stato cambia */
+static PyObject *stazione_fase(OggettoStazione *self, void *chiusura) {
+    (void)chiusura;
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    return PyLong_FromLong(self->sys.fase);
+}
+
+static PyObject *stazione_campo_ll(OggettoStazione *self, void *chiusura) {
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    return PyLong_FromLongLong(*(long long *)((char *)&self->sys + (size_t)chiusura));
+}
+
+static PyObject *stazione_campo_d(OggettoStazione *self, void *chiusura) {
+    if (!stazione_pronta(self)) {
+        return NULL;
+    }
+    return PyFloat_FromDouble(*(double *)((char *)&self->sys + (size_t)chiusura));
+}
+
+#define CAMPO(nome, campo, tipo, descrizione) \
+    { nome, (getter)stazione_campo_##tipo, NULL, descrizione, (void *)offsetof(StatoDOSEWS, campo) }
+
+static PyGetSetDef stazione_campi[] = {
+    { "fase", (getter)stazione_fase, NULL, "0 attesa trigger, 1 triggered, 2 allarme", NULL },
+    CAMPO("indice_campione", indice_campione, ll, "campioni elaborati"),
+    CAMPO("indice_trigger", indice_trigger, ll, "campione del trigger, -1 se assente"),
+    CAMPO("indice_allarme", indice_allarme, ll, "campione dell'allarme, -1 se assente"),
+    CAMPO("pgd_max", pgd_max, d, "PGD massimo [m]"),
+    CAMPO("pgd_allarme", pgd_allarme, d, "PGD all'allarme [m]"),
+    CAMPO("tau_c", parametri_p.tau_c, d, "tau_c [s]"),
+    CAMPO("pd", parametri_p.pd, d, "Pd [m]"),
+    CAMPO("tau_p_max", parametri_p.tau_p_max, d, "tau_p_max [s]"),
+    CAMPO("pga", intensita.pga, d, "PGA dal trigger [m/s^2]"),
+    CAMPO("pgv", intensita.pgv, d, "PGV dal trigger [m/s]"),
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyMethodDef stazione_metodi[] = {
+    { "processa", (PyCFunction)stazione_processa, METH_O,
+      "processa(blocco) -> fase\nElabora un vettore float64 di accelerazioni in g, senza copie e senza GIL." },
+    { "conferma", (PyCFunction)stazione_conferma, METH_NOARGS,
+      "Conferma di rete dell'evento (con richiede_conferma)." },
+    { "risultati", (PyCFunction)stazione_risultati, METH_NOARGS,
+      "Esito dell'evento corrente, come nel report di dosews." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject TipoStazione = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "dosews._dosews.Stazione",
+    .tp_basicsize = sizeof(OggettoStazione),
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Stazione(frequenza=200, sta_sec=0.5, lta_sec=6, soglia_sta_lta=4, fc_hp=0.075,\n"
+                    "         tipologia='RC', n_piani=3, soglia_danno='EDS', trigger='sta_lta',\n"
+                    "         richiede_conferma=False, decisione_anticipata=False)\n"
+                    "Stato di elaborazione in streaming di una stazione (StatoDOSEWS).",
+    .tp_new       = PyType_GenericNew,
+    .tp_init      = (initproc)stazione_init,
+    .tp_dealloc   = (destructor)stazione_dealloc,
+    .tp_methods   = stazione_metodi,
+    .tp_getset    = stazione_campi,
+};
+
+/* ---- Modulo ---- */
+
+static PyMethodDef metodi[] = {
+    { "filtro_highpass", py_filtro_highpass, METH_VARARGS,
+      "filtro_highpass(ingresso, uscita, fs, fc)\nPassa-alto di Butterworth del secondo ordine, senza GIL." },
+    { "filtro_lowpass", py_filtro_lowpass, METH_VARARGS,
+      "filtro_lowpass(ingresso, uscita, fs, fc)\nPassa-basso di Butterworth del secondo ordine, senza GIL." },
+    { "rileva_trigger", (PyCFunction)(void (*)(void))py_rileva_trigger, METH_VARARGS | METH_KEYWORDS,
+      "rileva_trigger(acc_filtrata, frequenza, sta_sec, lta_sec, soglia, tipo='sta_lta') -> indice\n"
+      "Primo campione in cui scatta il trigger, -1 se non scatta." },
+    { "info_archivio", py_info_archivio, METH_VARARGS,
+      "info_archivio(percorso) -> dict\nIntestazione di un archivio .dws." },
+    { "leggi_archivio", py_leggi_archivio, METH_VARARGS,
+      "leggi_archivio(percorso, uscita) -> n\nDecodifica un archivio .dws in uscita, senza GIL." },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef modulo = {
+    PyModuleDef_HEAD_INIT, "_dosews", "Motore DOSEWS (libdosews) su vettori float64.", -1, metodi,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__dosews(void) {
+    if (PyType_Ready(&TipoStazione) < 0) {
+        return NULL;
+    }
+    PyObject *m = PyModule_Create(&modulo);
+    if (!m) {
+        return NULL;
+    }
+    Py_INCREF(&TipoStazione);
+    if (PyModule_AddObject(m, "Stazione", (PyObject *)&TipoStazione) < 0) {
+        Py_DECREF(&TipoStazione);
+        Py_DECREF(m);
+        return NULL;
+    }
+    PyModule_AddIntConstant(m, "ATTESA_TRIGGER", STATO_ATTESA_TRIGGER);
+    PyModule_AddIntConstant(m, "TRIGGERED", STATO_TRIGGERED);
+    PyModule_AddIntConstant(m, "ALLARME", STATO_ALLARME);
+    return m;
+}
@@ -0,0 +1,54 @@
+"""Motore DOSEWS su array NumPy.
+
+Le funzioni del modulo C (_dosews) lavorano sul protocollo buffer senza
+copie e senza GIL; qui si aggiungono solo l'allocazione delle uscite e la
+conversione degli ingressi che non sono già float64 contigui.
+
+    import numpy as np, dosews
+    acc = dosews.leggi_archivio('registrazione.dws')    # oppure np.loadtxt
+    st = dosews.Stazione(tipologia='RC', n_piani=3)
+    for blocco in np.array_split(acc, 100):
+        st.processa(blocco)
+    print(st.risultati())
+"""
+
+import numpy as np
+
+from ._dosews import (Stazione, rileva_trigger, info_archivio,
+                      ATTESA_TRIGGER, TRIGGERED, ALLARME)
+from . import _dosews
+
+__all__ = ['Stazione', 'filtro_highpass', 'filtro_lowpass', 'rileva_trigger',
+           'info_archivio', 'leggi_archivio', 'ATTESA_TRIGGER', 'TRIGGERED', 'ALLARME']
+
+
+def _vettore(x):
+    # Nessuna copia se x è già float64 contiguo
+    return np.ascontiguousarray(x, dtype=np.float64)
+
+
+def filtro_highpass(x, fs, fc, out=None):
+    """Passa-alto di Butterworth del secondo ordine; out può coincidere con x."""
+    x = _vettore(x)
+    if out is None:
+        out = np.empty_like(x)
+    _dosews.filtro_highpass(x, out, fs, fc)
+    return out
+
+
+def filtro_lowpass(x, fs, fc, out=None):
+    """Passa-basso di Butterworth del secondo ordine; out può coincidere con x."""
+    x = _vettore(x)
+    if out is None:
+        out = np.empty_like(x)
+    _dosews.filtro_lowpass(x, out, fs, fc)
+    return out
+
+
+def leggi_archivio(percorso, out=None):
+    """Campioni di un archivio .dws (vedi prova_runtime/archivio.h)."""
+    n = info_archivio(percorso)['n_campioni']
+    if out is None:
+        out = np.empty(n, dtype=np.float64)
+    _dosews.leggi_archivio(percorso, out)
+    return out[:n]
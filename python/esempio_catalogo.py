@@ -0,0 +1,70 @@
+"""Elaborazione di un catalogo di registrazioni da Python, senza passare da
+./dosews e dai file di testo intermedi:
+
+    python3 esempio_catalogo.py [-j thread] [-a] registrazione.{txt,dws} ...
+
+Ogni registrazione (in g, a 200 Hz) passa da una Stazione a blocchi di un
+secondo; le stazioni girano su un pool di thread, possibile perché il modulo
+C rilascia il GIL durante l'elaborazione.
+"""
+
+import argparse
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+import dosews
+
+FREQUENZA = 200.0
+BLOCCO = int(FREQUENZA)
+
+
+def carica(percorso):
+    if percorso.endswith('.dws'):
+        return dosews.leggi_archivio(percorso)
+    return np.loadtxt(percorso, dtype=np.float64, ndmin=1)
+
+
+def elabora(percorso, acc, anticipata):
+    st = dosews.Stazione(frequenza=FREQUENZA, decisione_anticipata=anticipata)
+    for inizio in range(0, len(acc), BLOCCO):
+        st.processa(acc[inizio:inizio + BLOCCO])
+    return percorso, len(acc), st.risultati()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-j', type=int, default=4, help='thread di elaborazione')
+    parser.add_argument('-a', action='store_true', help='decisione anticipata da Pd e tau_c')
+    parser.add_argument('registrazioni', nargs='+')
+    args = parser.parse_args()
+
+    t0 = time.perf_counter()
+    dati = [(p, carica(p)) for p in args.registrazioni]
+    t_lettura = time.perf_counter() - t0
+
+    t0 = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=args.j) as pool:
+        esiti = list(pool.map(lambda d: elabora(d[0], d[1], args.a), dati))
+    t_elaborazione = time.perf_counter() - t0
+
+    campioni = 0
+    for percorso, n, r in esiti:
+        campioni += n
+        if not r['triggered']:
+            print(f'{percorso}: nessun trigger')
+        elif r['allarme']:
+            origine = ' (anticipato)' if r['allarme_anticipato'] else ''
+            print(f"{percorso}: trigger {r['t_trigger']:.3f} s, allarme {r['t_allarme']:.3f} s{origine}, "
+                  f"PGD max {r['pgd_max']:.6e} m, tau_c {r['tau_c']:.3f} s")
+        else:
+            print(f"{percorso}: trigger {r['t_trigger']:.3f} s, nessun allarme, "
+                  f"PGD max {r['pgd_max']:.6e} m, tau_c {r['tau_c']:.3f} s")
+
+    print(f'Lettura: {t_lettura:.3f} s; elaborazione: {t_elaborazione:.3f} s '
+          f'({campioni / t_elaborazione / 1e6:.1f} M campioni/s, {args.j} thread)')
+
+
+if __name__ == '__main__':
+    main()
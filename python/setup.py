@@ -0,0 +1,21 @@
+# Estensione Python sul motore di prova_runtime (gli stessi sorgenti di libdosews):
+#   cd python && python3 setup.py build_ext --inplace
+import os
+from setuptools import setup, Extension
+
+RUNTIME = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'prova_runtime')
+
+# Come LIB_SRCS nel makefile di prova_runtime
+LIB_SRCS = ['dosews.c', 'filter.c', 'trigger.c', 'integrazione.c', 'allarme.c',
+            'varianti.c', 'arena.c', 'checkpoint.c', 'archivio.c', 'parametri_p.c',
+            'intensita.c', 'oscillatori.c', 'spettro.c']
+
+estensione = Extension(
+    'dosews._dosews',
+    sources=['_dosews.c'] + [os.path.relpath(os.path.join(RUNTIME, f)) for f in LIB_SRCS],
+    include_dirs=[RUNTIME],
+    extra_compile_args=['-std=c11', '-O2', '-Wall', '-Wextra'],
+    libraries=['m'],
+)
+
+setup(name='dosews', version='0.1', packages=['dosews'], ext_modules=[estensione])
@@ -1,5 +1,5 @@
-#include <stdio.h>
 #include <math.h>
+#include "registro.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -19,10 +19,11 @@ void calcola_coeff_highpass(double fs, double fc,
     *b1 = 2.0 * (K * K - 1.0) * norm;
     *b2 = (1.0 - sqrt(2.0) * K + K * K) * norm;
     
-    printf("High-pass: fc=%.3f Hz\n", fc);
-    printf("a0=%.5e, a1=%.5e, a2=%.5e\n", *a0, *a1, *a2);
-    printf("b1=%.5e, b2=%.5e\n", *b1, *b2);
-    printf("---------------------------\n");
+    REGISTRA(REGISTRO_INFO, "High-pass: fc=%.3f Hz\n", REGISTRO_REALE(fc));
+    REGISTRA(REGISTRO_INFO, "a0=%.5e, a1=%.5e, a2=%.5e\n",
+             REGISTRO_REALE(*a0), REGISTRO_REALE(*a1), REGISTRO_REALE(*a2));
+    REGISTRA(REGISTRO_INFO, "b1=%.5e, b2=%.5e\n", REGISTRO_REALE(*b1), REGISTRO_REALE(*b2));
+    registra_messaggio(REGISTRO_INFO, "---------------------------\n", NULL, 0);
 }
 
 void calcola_coeff_lowpass(double fs, double fc,
@@ -39,10 +40,11 @@ void calcola_coeff_lowpass(double fs, double fc,
     *b1 = 2.0 * (K * K - 1.0) * norm;
     *b2 = (1.0 - sqrt(2.0) * K + K * K) * norm;
     
-    printf("Low-pass: fc=%.3f Hz\n", fc);
-    printf("a0=%.5e, a1=%.5e, a2=%.5e\n", *a0, *a1, *a2);
-    printf("b1=%.5e, b2=%.5e\n", *b1, *b2);
-    printf("---------------------------\n");
+    REGISTRA(REGISTRO_INFO, "Low-pass: fc=%.3f Hz\n", REGISTRO_REALE(fc));
+    REGISTRA(REGISTRO_INFO, "a0=%.5e, a1=%.5e, a2=%.5e\n",
+             REGISTRO_REALE(*a0), REGISTRO_REALE(*a1), REGISTRO_REALE(*a2));
+    REGISTRA(REGISTRO_INFO, "b1=%.5e, b2=%.5e\n", REGISTRO_REALE(*b1), REGISTRO_REALE(*b2));
+    registra_messaggio(REGISTRO_INFO, "---------------------------\n", NULL, 0);
 }
 
 void filtro_highpass(const double *in, double *out, int n,
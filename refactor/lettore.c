@@ -0,0 +1,193 @@
+#include "lettore.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM_BLOCCO      (1 << 16)
+#define MARGINE_TOKEN   512   /* byte garantiti dopo l'inizio di un token */
+
+/* Potenze di 10 rappresentabili esattamente in double */
+static const double potenze_10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int apri_lettore(LettoreCampioni *lettore, const char *filename) {
+    memset(lettore, 0, sizeof(*lettore));
+    /* Con il magic dell'archivio non si ricade sul testo */
+    if (riconosci_archivio(filename)) {
+        if (apri_archivio(&lettore->archivio, filename) != 0) {
+            return -1;
+        }
+        lettore->blocco = malloc(lettore->archivio.intestazione->campioni_blocco * sizeof(double));
+        if (!lettore->blocco) {
+            chiudi_archivio(&lettore->archivio);
+            return -1;
+        }
+        return 0;
+    }
+
+    lettore->fp = fopen(filename, "r");
+    if (!lettore->fp) {
+        return -1;
+    }
+    lettore->dim = DIM_BLOCCO + MARGINE_TOKEN;
+    lettore->buf = malloc(lettore->dim + 1);
+    if (!lettore->buf) {
+        fclose(lettore->fp);
+        lettore->fp = NULL;
+        return -1;
+    }
+    lettore->buf[0] = '\0';
+    return 0;
+}
+
+void chiudi_lettore(LettoreCampioni *lettore) {
+    if (lettore->fp) fclose(lettore->fp);
+    free(lettore->buf);
+    lettore->fp = NULL;
+    lettore->buf = NULL;
+    chiudi_archivio(&lettore->archivio);
+    free(lettore->blocco);
+    lettore->blocco = NULL;
+}
+
+static void ricarica(LettoreCampioni *lettore) {
+    size_t resto = lettore->len - lettore->pos;
+    memmove(lettore->buf, lettore->buf + lettore->pos, resto);
+    lettore->pos = 0;
+    lettore->len = resto;
+
+    while (!lettore->eof && lettore->len < lettore->dim) {
+        size_t n = fread(lettore->buf + lettore->len, 1, lettore->dim - lettore->len, lettore->fp);
+        if (n == 0) {
+            lettore->eof = 1;
+        }
+        lettore->len += n;
+    }
+    lettore->buf[lettore->len] = '\0';
+}
+
+static int is_spazio(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+static int is_cifra(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* Percorso veloce di Clinger: mantissa intera < 2^53 e |esponente| <= 22 danno
+ * una sola operazione IEEE, quindi lo stesso arrotondamento di strtod. */
+static int converti_veloce(const char *s, double *valore, const char **fine) {
+    const char *p = s;
+    int negativo = 0;
+    if (*p == '+' || *p == '-') {
+        negativo = (*p == '-');
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int cifre = 0, cifre_decimali = 0, trovata_cifra = 0;
+
+    while (is_cifra(*p)) {
+        trovata_cifra = 1;
+        if (mantissa != 0 || *p != '0') {
+            if (++cifre > 19) return 0;
+            mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+        }
+        p++;
+    }
+    if (*p == '.') {
+        p++;
+        while (is_cifra(*p)) {
+            trovata_cifra = 1;
+            if (mantissa != 0 || *p != '0') {
+                if (++cifre > 19) return 0;
+                mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+            }
+            cifre_decimali++;
+            p++;
+        }
+    }
+    if (!trovata_cifra) return 0;
+
+    int esponente = 0;
+    if (*p == 'e' || *p == 'E') {
+        const char *q = p + 1;
+        int esp_negativo = 0;
+        if (*q == '+' || *q == '-') {
+            esp_negativo = (*q == '-');
+            q++;
+        }
+        if (!is_cifra(*q)) return 0;
+        while (is_cifra(*q)) {
+            if (esponente > 10000) return 0;
+            esponente = esponente * 10 + (*q - '0');
+            q++;
+        }
+        if (esp_negativo) esponente = -esponente;
+        p = q;
+    }
+    if (*p != '\0' && !is_spazio(*p)) return 0;
+
+    int k = esponente - cifre_decimali;
+    double v;
+    if (mantissa == 0) {
+        v = 0.0;
+    } else if (mantissa < (1ULL << 53) && k >= -22 && k <= 22) {
+        v = (double)mantissa;
+        v = (k >= 0) ? v * potenze_10[k] : v / potenze_10[-k];
+    } else {
+        return 0;
+    }
+
+    *valore = negativo ? -v : v;
+    *fine = p;
+    return 1;
+}
+
+/* Archivio: un blocco alla volta, pos scorre i campioni decodificati */
+static int leggi_campione_archivio(LettoreCampioni *lettore, double *valore) {
+    if (lettore->pos >= lettore->n_blocco) {
+        int n = decodifica_blocco_archivio(&lettore->archivio, lettore->prossimo_blocco, lettore->blocco);
+        if (n <= 0) {
+            return 0;
+        }
+        lettore->prossimo_blocco++;
+        lettore->n_blocco = (unsigned int)n;
+        lettore->pos = 0;
+    }
+    *valore = lettore->blocco[lettore->pos++];
+    return 1;
+}
+
+int leggi_campione(LettoreCampioni *lettore, double *valore) {
+    if (lettore->archivio.mappa) {
+        return leggi_campione_archivio(lettore, valore);
+    }
+    for (;;) {
+        while (lettore->pos < lettore->len && is_spazio(lettore->buf[lettore->pos])) {
+            lettore->pos++;
+        }
+        if (lettore->eof || lettore->len - lettore->pos >= MARGINE_TOKEN) {
+            break;
+        }
+        ricarica(lettore);
+    }
+    if (lettore->pos >= lettore->len) {
+        return 0;
+    }
+
+    const char *inizio = lettore->buf + lettore->pos;
+    const char *fine;
+    if (!converti_veloce(inizio, valore, &fine)) {
+        char *fine_strtod;
+        *valore = strtod(inizio, &fine_strtod);
+        if (fine_strtod == inizio) {
+            return 0;
+        }
+        fine = fine_strtod;
+    }
+
+    lettore->pos = (size_t)(fine - lettore->buf);
+    return 1;
+}
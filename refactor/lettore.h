@@ -0,0 +1,32 @@
+#ifndef LETTORE_H
+#define LETTORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "archivio.h"
+
+/* Lettura a blocchi di file di testo con un valore per riga (o separati da
+ * spazi). Stessi valori di fscanf("%lf"): i numeri decimali brevi sono
+ * convertiti con il percorso veloce esatto, gli altri con strtod.
+ * Se il file è un archivio .dws i valori arrivano dai blocchi decodificati. */
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t dim;
+    size_t pos;
+    size_t len;
+    int eof;
+    Archivio archivio;             /* mappa nulla se il file è di testo */
+    double *blocco;                /* campioni decodificati del blocco corrente */
+    unsigned int n_blocco;
+    unsigned int prossimo_blocco;
+} LettoreCampioni;
+
+int apri_lettore(LettoreCampioni *lettore, const char *filename);
+
+/* Ritorna 1 se ha letto un valore, 0 a fine file o al primo token non numerico. */
+int leggi_campione(LettoreCampioni *lettore, double *valore);
+
+void chiudi_lettore(LettoreCampioni *lettore);
+
+#endif
@@ -7,99 +7,87 @@
 #include "output.h"
 #include "integrazione.h"
 #include "allarme.h"
+#include "lettore.h"
+#include "motore.h"
+#include "registro.h"
+#include "costanti.h"
 
-#define G 9.81
 #define FREQUENZA 200.0
 #define SOGLIA_DANNO "EDS"
 #define N_PIANI 3
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <file_accelerometrico>\n", argv[0]);
+    int salva_intermedi = 1;
+    const char *file_dati = NULL;
+    
+    for (int k = 1; k < argc; k++) {
+        if (strcmp(argv[k], "-q") == 0) {
+            salva_intermedi = 0;
+        } else if (!file_dati) {
+            file_dati = argv[k];
+        } else {
+            file_dati = NULL;
+            break;
+        }
+    }
+    if (!file_dati) {
+        fprintf(stderr, "Uso: %s [-q] <file_accelerometrico>\n", argv[0]);
         return 1;
     }
 
-    FILE *fp = fopen(argv[1], "r");
-    if (!fp) {
+    LettoreCampioni lettore;
+    if (apri_lettore(&lettore, file_dati) != 0) {
         fprintf(stderr, "Errore: impossibile aprire il file\n");
         return 1;
     }
 
-    int n_campioni = 0;
-    double value;
-    while (fscanf(fp, "%lf", &value) == 1) {
-        n_campioni++;
+    /* Coefficienti e trigger passano dal registro: il ciclo sui campioni
+     * non scrive mai direttamente su stdout */
+    if (avvia_registro(stdout, 0) != 0) {
+        fprintf(stderr, "Errore: avvio del registro fallito\n");
+        chiudi_lettore(&lettore);
+        return 1;
     }
-    rewind(fp);
-
-    double *acc_data = malloc(n_campioni * sizeof(double));
-    double *acc_hp = malloc(n_campioni * sizeof(double));
-    double *acc_filtrata = malloc(n_campioni * sizeof(double));
 
-    int i = 0;
-    while (fscanf(fp, "%lf", &value) == 1) {
-        acc_data[i++] = value * G;
+    StatoMotore motore;
+    if (init_motore(&motore, FREQUENZA, 0.075, 0.5, 6.0, 4, 1200, "RC", N_PIANI, SOGLIA_DANNO) != 0) {
+        fprintf(stderr, "Errore: inizializzazione fallita\n");
+        ferma_registro();
+        chiudi_lettore(&lettore);
+        return 1;
     }
-    fclose(fp);
-
-    salva_dati("acc_convertita.txt", acc_data, n_campioni);
-
-    double a0_hp, a1_hp, a2_hp, b1_hp, b2_hp;
-    double a0_lp, a1_lp, a2_lp, b1_lp, b2_lp;
     
-    calcola_coeff_highpass(FREQUENZA, 0.075, &a0_hp, &a1_hp, &a2_hp, &b1_hp, &b2_hp);
+    double a0_lp, a1_lp, a2_lp, b1_lp, b2_lp;
     calcola_coeff_lowpass(FREQUENZA, 1.0, &a0_lp, &a1_lp, &a2_lp, &b1_lp, &b2_lp);
 
-    filtro_highpass(acc_data, acc_filtrata, n_campioni, a0_hp, a1_hp, a2_hp, b1_hp, b2_hp);
-    salva_dati("acc_hp.txt", acc_hp, n_campioni);
+    /* Un solo passaggio: lettura, conversione, high-pass, trigger, integrazione
+     * e allarme per ogni campione; i file intermedi sono scritti in streaming */
+    FILE *fp_acc = salva_intermedi ? apri_file_dati("acc_convertita.txt") : NULL;
+    FILE *fp_hp = salva_intermedi ? apri_file_dati("acc_hp.txt") : NULL;
+    
+    double value;
+    while (leggi_campione(&lettore, &value)) {
+        double acc = value * G;
+        scrivi_dato(fp_acc, acc);
+        double acc_hp = avanza_motore(&motore, acc);
+        scrivi_dato(fp_hp, acc_hp);
+    }
+    chiudi_lettore(&lettore);
+    if (fp_acc) fclose(fp_acc);
+    if (fp_hp) fclose(fp_hp);
+    ferma_registro();
 
     //filtro_lowpass(acc_hp, acc_filtrata, n_campioni, a0_lp, a1_lp, a2_lp, b1_lp, b2_lp);
     //salva_dati("acc_lp.txt", acc_filtrata, n_campioni);
 
-    int indice_trigger = rileva_trigger(acc_filtrata, n_campioni, FREQUENZA, 0.5, 6.0, 4, 1200);
+    int indice_trigger = motore.indice_trigger;
     
     if (indice_trigger >= 0) {
-        double vel = 0.0;
-        double vel_filt = 0.0;
-        double vel_filt_prev = 0.0;
-        double spost = 0.0;
-        double dt = 1.0 / FREQUENZA;
-        double pgd_max = 0.0;
-        int indice_pgd_max = indice_trigger;
-        int allarme_attivo = 0;
-        int indice_allarme = -1;
-        double pgd_allarme = 0.0;
-        
-        double x1_vel = 0.0, x2_vel = 0.0, y1_vel = 0.0, y2_vel = 0.0;
-        double x1_spost = 0.0, x2_spost = 0.0, y1_spost = 0.0, y2_spost = 0.0;
-        
-        for (int i = indice_trigger + 1; i < n_campioni; i++) {
-            vel += 0.5 * dt * (acc_filtrata[i-1] + acc_filtrata[i]);
-            vel_filt = applica_filtro_singolo(vel, a0_hp, a1_hp, a2_hp, b1_hp, b2_hp, 
-                                             &x1_vel, &x2_vel, &y1_vel, &y2_vel);
-            
-            spost += 0.5 * dt * (vel_filt_prev + vel_filt);
-            double spost_filt = applica_filtro_singolo(spost, a0_hp, a1_hp, a2_hp, b1_hp, b2_hp,
-                                                       &x1_spost, &x2_spost, &y1_spost, &y2_spost);
-            
-            double pgd = fabs(spost_filt);
-            
-            if (!allarme_attivo) {
-                int allarme = valuta_allarme_istantaneo(pgd, "RC", N_PIANI, SOGLIA_DANNO);
-                if (allarme) {
-                    allarme_attivo = 1;
-                    indice_allarme = i;
-                    pgd_allarme = pgd;
-                }
-            }
-            
-            if (pgd > pgd_max) {
-                pgd_max = pgd;
-                indice_pgd_max = i;
-            }
-            
-            vel_filt_prev = vel_filt;
-        }
+        double pgd_max = motore.pgd_max;
+        int indice_pgd_max = motore.indice_pgd_max;
+        int allarme_attivo = motore.allarme_attivo;
+        int indice_allarme = motore.indice_allarme;
+        double pgd_allarme = motore.pgd_allarme;
         
         ConfigurazioneAllarme config = RC_BASSO;
         double soglia_fisica = (strcmp(SOGLIA_DANNO, "MDS") == 0) ? config.mds :
@@ -137,8 +125,6 @@ int main(int argc, char *argv[]) {
         printf("Nessun trigger rilevato\n");
     }
 
-    free(acc_data);
-    free(acc_hp);
-    free(acc_filtrata);
+    free_motore(&motore);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "motore.h"
+#include "filter.h"
+#include "allarme.h"
+#include <math.h>
+#include <string.h>
+
+int init_motore(StatoMotore *m, double frequenza, double fc_hp,
+                double sta_sec, double lta_sec, double soglia, int indice_inizio,
+                const char *tipologia, int n_piani, const char *soglia_danno) {
+    
+    memset(m, 0, sizeof(*m));
+    m->dt = 1.0 / frequenza;
+    m->indice_trigger = -1;
+    m->indice_allarme = -1;
+    m->tipologia = tipologia;
+    m->n_piani = n_piani;
+    m->soglia_danno = soglia_danno;
+    
+    calcola_coeff_highpass(frequenza, fc_hp, &m->a0_hp, &m->a1_hp, &m->a2_hp, &m->b1_hp, &m->b2_hp);
+    
+    return init_rilevatore(&m->rilevatore, frequenza, sta_sec, lta_sec, soglia, indice_inizio);
+}
+
+void free_motore(StatoMotore *m) {
+    free_rilevatore(&m->rilevatore);
+}
+
+double avanza_motore(StatoMotore *m, double acc) {
+    int i = m->indice++;
+    double acc_filt = applica_filtro_singolo(acc, m->a0_hp, m->a1_hp, m->a2_hp, m->b1_hp, m->b2_hp,
+                                             &m->x1_acc, &m->x2_acc, &m->y1_acc, &m->y2_acc);
+    
+    if (m->indice_trigger < 0) {
+        if (aggiorna_rilevatore(&m->rilevatore, acc_filt)) {
+            m->indice_trigger = i;
+            m->indice_pgd_max = i;
+        }
+        m->acc_precedente = acc_filt;
+        return acc_filt;
+    }
+    
+    m->vel += 0.5 * m->dt * (m->acc_precedente + acc_filt);
+    double vel_filt = applica_filtro_singolo(m->vel, m->a0_hp, m->a1_hp, m->a2_hp, m->b1_hp, m->b2_hp,
+                                             &m->x1_vel, &m->x2_vel, &m->y1_vel, &m->y2_vel);
+    
+    m->spost += 0.5 * m->dt * (m->vel_filt_prev + vel_filt);
+    double spost_filt = applica_filtro_singolo(m->spost, m->a0_hp, m->a1_hp, m->a2_hp, m->b1_hp, m->b2_hp,
+                                               &m->x1_spost, &m->x2_spost, &m->y1_spost, &m->y2_spost);
+    
+    double pgd = fabs(spost_filt);
+    
+    if (!m->allarme_attivo) {
+        if (valuta_allarme_istantaneo(pgd, m->tipologia, m->n_piani, m->soglia_danno)) {
+            m->allarme_attivo = 1;
+            m->indice_allarme = i;
+            m->pgd_allarme = pgd;
+        }
+    }
+    
+    if (pgd > m->pgd_max) {
+        m->pgd_max = pgd;
+        m->indice_pgd_max = i;
+    }
+    
+    m->vel_filt_prev = vel_filt;
+    m->acc_precedente = acc_filt;
+    return acc_filt;
+}
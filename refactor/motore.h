@@ -0,0 +1,42 @@
+#ifndef MOTORE_H
+#define MOTORE_H
+
+#include "trigger.h"
+
+/* Catena batch in un solo passaggio: high-pass, trigger, doppia integrazione
+ * con ri-filtraggio e valutazione dell'allarme campione per campione.
+ * Memoria costante, stessi risultati della versione a tre array. */
+typedef struct {
+    double dt;
+    double a0_hp, a1_hp, a2_hp, b1_hp, b2_hp;
+    double x1_acc, x2_acc, y1_acc, y2_acc;
+    
+    StatoRilevatore rilevatore;
+    int indice;
+    int indice_trigger;
+    double acc_precedente;
+    
+    double vel, vel_filt_prev, spost;
+    double x1_vel, x2_vel, y1_vel, y2_vel;
+    double x1_spost, x2_spost, y1_spost, y2_spost;
+    
+    double pgd_max;
+    int indice_pgd_max;
+    int allarme_attivo;
+    int indice_allarme;
+    double pgd_allarme;
+    
+    const char *tipologia;
+    int n_piani;
+    const char *soglia_danno;
+} StatoMotore;
+
+int init_motore(StatoMotore *m, double frequenza, double fc_hp,
+                double sta_sec, double lta_sec, double soglia, int indice_inizio,
+                const char *tipologia, int n_piani, const char *soglia_danno);
+void free_motore(StatoMotore *m);
+
+/* Processa un campione di accelerazione [m/s^2] e ritorna il valore filtrato. */
+double avanza_motore(StatoMotore *m, double acc);
+
+#endif
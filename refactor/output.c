@@ -15,6 +15,20 @@ void salva_dati(const char *filename, const double *data, int n_campioni) {
     fclose(fp);
 }
 
+FILE *apri_file_dati(const char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Errore: impossibile creare il file %s\n", filename);
+    }
+    return fp;
+}
+
+void scrivi_dato(FILE *fp, double valore) {
+    if (fp) {
+        fprintf(fp, "%.10e\n", valore);
+    }
+}
+
 void stampa_report_allarme(const char *soglia_target, int idx_trigger, double freq,
                           double pgd_max, double drift_mediano, double soglia_fisica,
                           double prob_calcolata, double soglia_probabilita, int allarme_attivo) {
@@ -1,7 +1,13 @@
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
+#include <stdio.h>
+
 void salva_dati(const char *filename, const double *data, int n_campioni);
+
+/* Scrittura incrementale, stesso formato di salva_dati */
+FILE *apri_file_dati(const char *filename);
+void scrivi_dato(FILE *fp, double valore);
 void stampa_report_allarme(const char *soglia_target, int idx_trigger, double freq, 
                           double pgd_max, double drift_mediano, double soglia_fisica,
                           double prob_calcolata, double soglia_probabilita, int allarme_attivo);
@@ -1,7 +1,7 @@
 #include "trigger.h"
-#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include "registro.h"
 
 int rileva_trigger(double *accelerazione_filtrata, int n_campioni, double frequenza,
                    double sta_sec, double lta_sec, double soglia, int indice_inizio) {
@@ -46,10 +46,94 @@ int rileva_trigger(double *accelerazione_filtrata, int n_campioni, double freque
         }
         
         if (rapporto >= soglia) {
-            printf("Trigger rilevato all'indice %d (Rapporto Quadrati: %.2f)\n", i, rapporto);
+            REGISTRA(REGISTRO_INFO, "Trigger rilevato all'indice %d (Rapporto Quadrati: %.2f)\n",
+                     REGISTRO_INTERO(i), REGISTRO_REALE(rapporto));
             return i;
         }
     }
     
     return -1;
+}
+
+static double campione_storico(const StatoRilevatore *stato, int indice) {
+    /* Gli indici negativi corrispondono a campioni mai ricevuti */
+    if (indice < 0) {
+        return 0.0;
+    }
+    return stato->storico[indice % stato->lunghezza_storico];
+}
+
+int init_rilevatore(StatoRilevatore *stato, double frequenza, double sta_sec,
+                    double lta_sec, double soglia, int indice_inizio) {
+    
+    stato->sta_lunghezza = (int)(sta_sec * frequenza);
+    stato->lta_lunghezza = (int)(lta_sec * frequenza);
+    stato->indice_inizio = indice_inizio;
+    stato->soglia = soglia;
+    stato->sta_somma = 0.0;
+    stato->lta_somma = 0.0;
+    stato->indice = 0;
+    
+    if (indice_inizio < stato->lta_lunghezza) {
+        stato->storico = NULL;
+        return -1;
+    }
+    
+    stato->lunghezza_storico = stato->lta_lunghezza + 2;
+    stato->storico = calloc(stato->lunghezza_storico, sizeof(double));
+    return stato->storico ? 0 : -1;
+}
+
+void free_rilevatore(StatoRilevatore *stato) {
+    free(stato->storico);
+    stato->storico = NULL;
+}
+
+int aggiorna_rilevatore(StatoRilevatore *stato, double campione_filtrato) {
+    int i = stato->indice++;
+    stato->storico[i % stato->lunghezza_storico] = campione_filtrato;
+    
+    if (i < stato->indice_inizio) {
+        return 0;
+    }
+    
+    if (i == stato->indice_inizio) {
+        for (int k = i - stato->sta_lunghezza; k < i; k++) {
+            double val = campione_storico(stato, k);
+            stato->sta_somma += val * val;
+        }
+        for (int k = i - stato->lta_lunghezza; k < i; k++) {
+            double val = campione_storico(stato, k);
+            stato->lta_somma += val * val;
+        }
+    }
+    
+    double precedente = campione_storico(stato, i - 1);
+    double uscente_sta = campione_storico(stato, i - stato->sta_lunghezza - 1);
+    double uscente_lta = campione_storico(stato, i - stato->lta_lunghezza - 1);
+    
+    double attuale_sq = precedente * precedente;
+    double out_sta_sq = uscente_sta * uscente_sta;
+    double out_lta_sq = uscente_lta * uscente_lta;
+    
+    stato->sta_somma += attuale_sq - out_sta_sq;
+    stato->lta_somma += attuale_sq - out_lta_sq;
+    
+    double sta_media = stato->sta_somma / stato->sta_lunghezza;
+    double lta_media = stato->lta_somma / stato->lta_lunghezza;
+    
+    double rapporto;
+    if (lta_media > 1e-15) {
+        rapporto = sta_media / lta_media;
+    } else {
+        rapporto = 0.0;
+    }
+    
+    if (rapporto >= stato->soglia) {
+        REGISTRA(REGISTRO_INFO, "Trigger rilevato all'indice %d (Rapporto Quadrati: %.2f)\n",
+                     REGISTRO_INTERO(i), REGISTRO_REALE(rapporto));
+        return 1;
+    }
+    
+    return 0;
 }
\ No newline at end of file
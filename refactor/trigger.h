@@ -4,4 +4,25 @@
 int rileva_trigger(double *accelerazione_filtrata, int n_campioni, double frequenza,
                    double sta_sec, double lta_sec, double soglia, int indice_inizio);
 
+/* Versione in streaming di rileva_trigger: stesse somme e stesso indice di
+ * trigger, ma conserva solo gli ultimi lta_lunghezza + 2 campioni filtrati. */
+typedef struct {
+    double *storico;
+    int lunghezza_storico;
+    int sta_lunghezza;
+    int lta_lunghezza;
+    int indice_inizio;
+    double soglia;
+    double sta_somma;
+    double lta_somma;
+    int indice;
+} StatoRilevatore;
+
+int init_rilevatore(StatoRilevatore *stato, double frequenza, double sta_sec,
+                    double lta_sec, double soglia, int indice_inizio);
+void free_rilevatore(StatoRilevatore *stato);
+
+/* Ritorna 1 se il campione appena inserito e' l'indice di trigger. */
+int aggiorna_rilevatore(StatoRilevatore *stato, double campione_filtrato);
+
 #endif
\ No newline at end of file